@@ -0,0 +1,491 @@
+// Command-line front end for the wrapper. The wrapper sources are compiled into the executable, so setting a color
+// costs one NvAPI initialization, one enumeration and the driver calls of the write itself.
+//
+// Every command runs through the same path as a batch: set commands are collected first, later sets of a zone replace
+// earlier ones and each GPU is then written with a single SetIlluminationZonesBatch, whose one SetControl call carries
+// every zone of that GPU. get commands run after the writes. Timing of each phase goes to stderr, results to stdout.
+//
+// Batch input has one command per line, # starts a comment:
+//	set GPU ZONE COLOR [BRIGHTNESS]		GPU and ZONE are indexes or *, COLOR is rrggbb, rrggbbww, r,g,b[,w] or - for zones
+//										without a color, BRIGHTNESS is 0 to 100 and defaults to 100
+//	get GPU [ZONE]
+//
+// Usage: NvApiLightingCli [--emulator] [--default] list
+//        NvApiLightingCli [--emulator] [--default] get GPU [ZONE]
+//        NvApiLightingCli [--emulator] [--default] set GPU ZONE COLOR [BRIGHTNESS]
+//        NvApiLightingCli [--emulator] [--default] batch [FILE|-]
+
+#include "NvApiDll.h"
+#include <ctype.h>
+#include <string>
+#include <vector>
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// set or get, a gpuIndex or zoneIndex of ALL_INDEXES stands for every GPU or zone
+#define ALL_INDEXES 0xFFFFFFFFu
+
+struct CliCommand
+{
+	bool isSet;
+	unsigned int line;
+	unsigned int gpuIndex;
+	unsigned int zoneIndex;
+	ZoneUpdate update;
+};
+
+struct CliOptions
+{
+	bool emulator = false;
+	bool useDefault = false;
+};
+
+static double elapsedMs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+	return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+static bool parseIndex(const std::string &token, unsigned int &index)
+{
+	if (token == "*")
+	{
+		index = ALL_INDEXES;
+		return true;
+	}
+	char *end = nullptr;
+	unsigned long value = strtoul(token.c_str(), &end, 10);
+	if (token.empty() || *end || value >= ALL_INDEXES)
+		return false;
+	index = static_cast<unsigned int>(value);
+	return true;
+}
+
+static bool parseByte(const char *text, char **end, uint8_t &value, unsigned long maximum)
+{
+	unsigned long number = strtoul(text, end, 10);
+	if (*end == text || number > maximum)
+		return false;
+	value = static_cast<uint8_t>(number);
+	return true;
+}
+
+// rrggbb, rrggbbww, r,g,b[,w] or -
+static bool parseColor(const std::string &token, ZoneUpdate &update)
+{
+	update.r = update.g = update.b = update.w = 0;
+	if (token == "-")
+		return true;
+	if (token.find(',') != std::string::npos)
+	{
+		uint8_t *channels[] = {&update.r, &update.g, &update.b, &update.w};
+		const char *text = token.c_str();
+		for (unsigned int i = 0; i < 4; ++i)
+		{
+			char *end = nullptr;
+			if (!parseByte(text, &end, *channels[i], 255))
+				return false;
+			if (*end == '\0')
+				return i >= 2;
+			if (*end != ',')
+				return false;
+			text = end + 1;
+		}
+		return false;
+	}
+	size_t start = token[0] == '#' ? 1 : 0;
+	size_t digits = token.size() - start;
+	if (digits != 6 && digits != 8)
+		return false;
+	// hex digits only, strtoul alone would also take a sign or a 0x prefix
+	for (size_t i = start; i < token.size(); ++i)
+		if (!isxdigit(static_cast<unsigned char>(token[i])))
+			return false;
+	unsigned long long value = strtoull(token.c_str() + start, nullptr, 16);
+	if (digits == 6)
+		value <<= 8;
+	update.r = static_cast<uint8_t>(value >> 24);
+	update.g = static_cast<uint8_t>(value >> 16);
+	update.b = static_cast<uint8_t>(value >> 8);
+	update.w = static_cast<uint8_t>(value);
+	return true;
+}
+
+// Parses one command, false with the reason in error if it is malformed
+static bool parseCommand(const std::vector<std::string> &tokens, unsigned int line, CliCommand &command, std::string &error)
+{
+	memset(&command, 0, sizeof(command));
+	command.line = line;
+	if (tokens[0] == "set")
+	{
+		command.isSet = true;
+		if (tokens.size() < 4 || tokens.size() > 5)
+			error = "set takes GPU ZONE COLOR [BRIGHTNESS]";
+		else if (!parseIndex(tokens[1], command.gpuIndex) || !parseIndex(tokens[2], command.zoneIndex))
+			error = "bad GPU or zone index";
+		else if (!parseColor(tokens[3], command.update))
+			error = "bad color '" + tokens[3] + "'";
+		else
+		{
+			command.update.brightness = 100;
+			char *end = nullptr;
+			if (tokens.size() == 5 && (!parseByte(tokens[4].c_str(), &end, command.update.brightness, 100) || *end))
+				error = "brightness must be 0 to 100";
+		}
+	}
+	else if (tokens[0] == "get")
+	{
+		command.zoneIndex = ALL_INDEXES;
+		if (tokens.size() < 2 || tokens.size() > 3)
+			error = "get takes GPU [ZONE]";
+		else if (!parseIndex(tokens[1], command.gpuIndex) || (tokens.size() == 3 && !parseIndex(tokens[2], command.zoneIndex)))
+			error = "bad GPU or zone index";
+	}
+	else
+		error = "unknown command '" + tokens[0] + "'";
+	return error.empty();
+}
+
+// Splits text into lines and whitespace separated tokens, blank lines and comments are skipped
+static bool parseScript(const std::string &text, std::vector<CliCommand> &commands)
+{
+	unsigned int line = 0;
+	size_t position = 0;
+	while (position < text.size())
+	{
+		size_t lineEnd = text.find('\n', position);
+		if (lineEnd == std::string::npos)
+			lineEnd = text.size();
+		++line;
+		std::vector<std::string> tokens;
+		size_t i = position;
+		while (i < lineEnd && text[i] != '#')
+		{
+			while (i < lineEnd && isspace(static_cast<unsigned char>(text[i])))
+				++i;
+			size_t start = i;
+			while (i < lineEnd && !isspace(static_cast<unsigned char>(text[i])) && text[i] != '#')
+				++i;
+			if (i > start)
+				tokens.emplace_back(text, start, i - start);
+		}
+		position = lineEnd + 1;
+		if (tokens.empty())
+			continue;
+		CliCommand command;
+		std::string error;
+		if (!parseCommand(tokens, line, command, error))
+		{
+			fprintf(stderr, "line %u: %s\n", line, error.c_str());
+			return false;
+		}
+		commands.push_back(command);
+	}
+	return true;
+}
+
+static bool readInput(const char *path, std::string &text)
+{
+	FILE *in = stdin;
+	if (strcmp(path, "-") != 0)
+	{
+#ifdef _WIN32
+		if (fopen_s(&in, path, "rb") != 0)
+			in = nullptr;
+#else
+		in = fopen(path, "rb");
+#endif
+		if (!in)
+		{
+			fprintf(stderr, "Cannot open %s\n", path);
+			return false;
+		}
+	}
+	char buffer[64 * 1024];
+	size_t count;
+	while ((count = fread(buffer, 1, sizeof(buffer), in)) > 0)
+		text.append(buffer, count);
+	if (in != stdin)
+		fclose(in);
+	return true;
+}
+
+// Zone count of every GPU, read only when a command names all zones or the list command needs it
+struct Topology
+{
+	unsigned int gpuCount;
+	IlluminationZonesInfoV2 zones[NVAPI_MAX_PHYSICAL_GPUS];
+	bool zonesRead[NVAPI_MAX_PHYSICAL_GPUS];
+};
+
+static const IlluminationZonesInfoV2 *zonesOf(Topology &topology, unsigned int gpuIndex)
+{
+	if (!topology.zonesRead[gpuIndex])
+	{
+		if (!GetIlluminationZonesInfoV2(gpuIndex, &topology.zones[gpuIndex]))
+			topology.zones[gpuIndex].numZones = 0;
+		topology.zonesRead[gpuIndex] = true;
+	}
+	return &topology.zones[gpuIndex];
+}
+
+// Reports a command that names a GPU or zone that does not exist, batch commands with their line. A zoneIndex of
+// ALL_INDEXES reports the GPU itself as missing.
+static void reportMissing(const CliCommand &command, unsigned int gpuIndex, unsigned int zoneIndex)
+{
+	if (command.line)
+		fprintf(stderr, "line %u: ", command.line);
+	if (zoneIndex == ALL_INDEXES)
+		fprintf(stderr, "there is no GPU %u\n", gpuIndex);
+	else
+		fprintf(stderr, "GPU %u has no zone %u\n", gpuIndex, zoneIndex);
+}
+
+// Checks every index against the GPU count and the zone count each GPU reports, so a command naming a GPU or zone that
+// does not exist is a usage error and nothing is written
+static bool validateCommands(const std::vector<CliCommand> &commands, Topology &topology)
+{
+	bool valid = true;
+	for (const CliCommand &command : commands)
+	{
+		if (command.gpuIndex != ALL_INDEXES && command.gpuIndex >= topology.gpuCount)
+		{
+			reportMissing(command, command.gpuIndex, ALL_INDEXES);
+			valid = false;
+			continue;
+		}
+		if (command.zoneIndex == ALL_INDEXES)
+			continue;
+		unsigned int firstGpu = command.gpuIndex == ALL_INDEXES ? 0 : command.gpuIndex;
+		unsigned int lastGpu = command.gpuIndex == ALL_INDEXES ? topology.gpuCount : command.gpuIndex + 1;
+		for (unsigned int gpu = firstGpu; gpu < lastGpu; ++gpu)
+		{
+			if (command.zoneIndex < zonesOf(topology, gpu)->numZones)
+				continue;
+			reportMissing(command, gpu, command.zoneIndex);
+			valid = false;
+		}
+	}
+	return valid;
+}
+
+static void printZone(unsigned int gpuIndex, unsigned int zoneIndex, const IlluminationZoneControlV2 &control)
+{
+	const IlluminationColorV2 &color = control.manualColor;
+	char hex[16];
+	if (control.zoneType == NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW)
+		snprintf(hex, sizeof(hex), "%02x%02x%02x%02x", color.r, color.g, color.b, color.w);
+	else if (control.zoneType == NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB)
+		snprintf(hex, sizeof(hex), "%02x%02x%02x", color.r, color.g, color.b);
+	else
+		snprintf(hex, sizeof(hex), "-");
+	printf("gpu=%u zone=%u type=%s mode=%s color=%s brightness=%u\n", gpuIndex, zoneIndex, GetIlluminationZoneTypeName(control.zoneType),
+		   GetIlluminationControlModeName(control.ctrlMode), hex, color.brightness);
+}
+
+static int runList(Topology &topology)
+{
+	for (unsigned int gpu = 0; gpu < topology.gpuCount; ++gpu)
+	{
+		unsigned long busId = 0;
+		GetGPUBusId(gpu, &busId);
+		printf("gpu=%u bus=%lu name=\"%s\"\n", gpu, busId, GetGPUName(gpu));
+		const IlluminationZonesInfoV2 *pZones = zonesOf(topology, gpu);
+		for (unsigned int zone = 0; zone < pZones->numZones; ++zone)
+			printf("  zone=%u type=%s location=%s\n", zone, GetIlluminationZoneTypeName(pZones->zones[zone].zoneType),
+				   GetIlluminationZoneLocationName(pZones->zones[zone].zoneLocation));
+	}
+	return 0;
+}
+
+struct ApplyReport
+{
+	unsigned int writes;
+	unsigned int zones;
+	unsigned int coalesced;
+	unsigned int failures;
+};
+
+// Folds the set commands into one update per zone and writes each GPU once, the commands are validated already
+static bool applySets(const std::vector<CliCommand> &commands, Topology &topology, bool useDefault, ApplyReport &report)
+{
+	static ZoneUpdate pending[NVAPI_MAX_PHYSICAL_GPUS][NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	uint32_t pendingMask[NVAPI_MAX_PHYSICAL_GPUS] = {0};
+	report = {0, 0, 0, 0};
+	for (const CliCommand &command : commands)
+	{
+		if (!command.isSet)
+			continue;
+		unsigned int firstGpu = command.gpuIndex == ALL_INDEXES ? 0 : command.gpuIndex;
+		unsigned int lastGpu = command.gpuIndex == ALL_INDEXES ? topology.gpuCount : command.gpuIndex + 1;
+		for (unsigned int gpu = firstGpu; gpu < lastGpu; ++gpu)
+		{
+			unsigned int firstZone = command.zoneIndex == ALL_INDEXES ? 0 : command.zoneIndex;
+			unsigned int lastZone = command.zoneIndex == ALL_INDEXES ? zonesOf(topology, gpu)->numZones : command.zoneIndex + 1;
+			for (unsigned int zone = firstZone; zone < lastZone; ++zone)
+			{
+				if (pendingMask[gpu] & (1u << zone))
+					report.coalesced++;
+				pendingMask[gpu] |= 1u << zone;
+				pending[gpu][zone] = command.update;
+				pending[gpu][zone].zoneIndex = zone;
+			}
+		}
+	}
+
+	for (unsigned int gpu = 0; gpu < topology.gpuCount; ++gpu)
+	{
+		if (!pendingMask[gpu])
+			continue;
+		ZoneUpdate updates[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+		unsigned int count = 0;
+		for (unsigned int zone = 0; zone < NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX; ++zone)
+			if (pendingMask[gpu] & (1u << zone))
+				updates[count++] = pending[gpu][zone];
+		NvAPI_Status results[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+		report.writes++;
+		report.zones += count;
+		if (SetIlluminationZonesBatch(gpu, updates, count, useDefault, results))
+			continue;
+		report.failures++;
+		for (unsigned int i = 0; i < count; ++i)
+			if (results[i] != NVAPI_OK)
+				fprintf(stderr, "gpu %u zone %u: %s\n", gpu, updates[i].zoneIndex, GetNvApiErrorMessage(results[i]));
+	}
+	return report.failures == 0;
+}
+
+static bool runGets(const std::vector<CliCommand> &commands, Topology &topology, bool useDefault)
+{
+	bool ok = true;
+	for (const CliCommand &command : commands)
+	{
+		if (command.isSet)
+			continue;
+		unsigned int firstGpu = command.gpuIndex == ALL_INDEXES ? 0 : command.gpuIndex;
+		unsigned int lastGpu = command.gpuIndex == ALL_INDEXES ? topology.gpuCount : command.gpuIndex + 1;
+		for (unsigned int gpu = firstGpu; gpu < lastGpu; ++gpu)
+		{
+			IlluminationZoneControlsV2 controls;
+			if (!GetIlluminationZonesControlV2(gpu, useDefault, &controls))
+			{
+				fprintf(stderr, "gpu %u: failed to read the zones\n", gpu);
+				ok = false;
+				continue;
+			}
+			if (command.zoneIndex == ALL_INDEXES)
+			{
+				for (unsigned int zone = 0; zone < controls.numZones; ++zone)
+					printZone(gpu, zone, controls.zones[zone]);
+			}
+			else if (command.zoneIndex < controls.numZones)
+				printZone(gpu, command.zoneIndex, controls.zones[command.zoneIndex]);
+			else
+			{
+				// the driver now reports fewer zones than when the commands were validated
+				reportMissing(command, gpu, command.zoneIndex);
+				ok = false;
+			}
+		}
+	}
+	return ok;
+}
+
+static void printUsage(const char *program)
+{
+	fprintf(stderr,
+			"usage: %s [--emulator] [--default] list\n"
+			"       %s [--emulator] [--default] get GPU [ZONE]\n"
+			"       %s [--emulator] [--default] set GPU ZONE COLOR [BRIGHTNESS]\n"
+			"       %s [--emulator] [--default] batch [FILE|-]\n",
+			program, program, program, program);
+}
+
+int main(int argc, char **argv)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	CliOptions options;
+	int arg = 1;
+	for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; ++arg)
+	{
+		if (strcmp(argv[arg], "--emulator") == 0)
+			options.emulator = true;
+		else if (strcmp(argv[arg], "--default") == 0)
+			options.useDefault = true;
+		else
+		{
+			printUsage(argv[0]);
+			return 2;
+		}
+	}
+	if (arg >= argc)
+	{
+		printUsage(argv[0]);
+		return 2;
+	}
+	std::string verb = argv[arg];
+
+	// the command line is parsed like one batch line, a batch reads its script first so a bad line fails before NvAPI loads
+	std::vector<CliCommand> commands;
+	if (verb == "set" || verb == "get")
+	{
+		std::vector<std::string> tokens(argv + arg, argv + argc);
+		CliCommand command;
+		std::string error;
+		if (!parseCommand(tokens, 0, command, error))
+		{
+			fprintf(stderr, "%s\n", error.c_str());
+			return 2;
+		}
+		commands.push_back(command);
+	}
+	else if (verb == "batch")
+	{
+		std::string text;
+		if (argc - arg > 2 || !readInput(arg + 1 < argc ? argv[arg + 1] : "-", text) || !parseScript(text, commands))
+			return 2;
+	}
+	else if (verb != "list" || argc - arg != 1)
+	{
+		printUsage(argv[0]);
+		return 2;
+	}
+	std::chrono::steady_clock::time_point parsed = std::chrono::steady_clock::now();
+
+	if (options.emulator)
+		SetNvApiBackend(NVAPI_BACKEND_EMULATOR);
+	if (!InitializeNvApi())
+	{
+		fprintf(stderr, "Failed to initialize NvAPI.\n");
+		return 1;
+	}
+	Topology *pTopology = new (std::nothrow) Topology();
+	if (!pTopology)
+		return 1;
+	pTopology->gpuCount = GetNumberOfGPUs();
+	std::chrono::steady_clock::time_point initialized = std::chrono::steady_clock::now();
+
+	int exitCode = 0;
+	ApplyReport report = {0, 0, 0, 0};
+	std::chrono::steady_clock::time_point applied = initialized;
+	if (verb == "list")
+		exitCode = runList(*pTopology);
+	else if (!validateCommands(commands, *pTopology))
+		exitCode = 2;
+	else
+	{
+		if (!applySets(commands, *pTopology, options.useDefault, report))
+			exitCode = 1;
+		applied = std::chrono::steady_clock::now();
+		if (!runGets(commands, *pTopology, options.useDefault))
+			exitCode = 1;
+	}
+	std::chrono::steady_clock::time_point finished = std::chrono::steady_clock::now();
+	fflush(stdout);
+
+	fprintf(stderr, "parse %.3f ms (%zu commands), init %.3f ms (%u GPUs), apply %.3f ms (%u GPU writes for %u zones, %u coalesced), "
+					"query %.3f ms, total %.3f ms\n",
+			elapsedMs(start, parsed), commands.size(), elapsedMs(parsed, initialized), pTopology->gpuCount, elapsedMs(initialized, applied),
+			report.writes, report.zones, report.coalesced, elapsedMs(applied, finished), elapsedMs(start, finished));
+	delete pTopology;
+	DeinitializeNvApi();
+	return exitCode;
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <stdint.h>
+
+// Wire protocol of NvApiLightingService. The service listens on a local stream socket (AF_UNIX, see the --socket option)
+// and every message in either direction is a LightingFrameHeader followed by length payload bytes, integers little
+// endian and structs packed as declared here.
+//
+// Clients may pipeline: any number of requests can be sent before reading responses. Requests of one connection are
+// executed in order and answered in order, each response echoes the opcode and requestId of its request and carries a
+// LIGHTING_STATUS_* in status. Responses to requests that arrived together are written back together.
+//
+// Requests and their payloads:
+//	PING			any bytes, echoed back
+//	INFO			none, answered with LightingInfo
+//	GET_ZONES		LightingGpuRequest, answered with LightingZonesHeader and zoneCount LightingZoneState
+//	SET_ZONES		LightingGpuRequest, then count LightingZoneUpdate applied to that GPU with a single write, answered
+//					with count int32 NvAPI statuses, one per update
+//	BATCH			uint32 count, then count LightingBatchEntry for any GPUs, later entries for a zone replace earlier
+//					ones and each GPU is written once, answered with LightingBatchResult
+//	STATS			none, answered with LightingStats
+//	SHUTDOWN		none, the service answers and stops
+// LIGHTING_FLAG_DEFAULT in flags makes GET_ZONES, SET_ZONES and BATCH use the default rather than the current state.
+
+#define LIGHTING_PROTOCOL_VERSION 1
+// Largest payload the service accepts, a longer frame closes the connection
+#define LIGHTING_MAX_PAYLOAD (1u << 20)
+// Most GPUs and zones per GPU the protocol describes
+#define LIGHTING_MAX_GPUS 64
+#define LIGHTING_MAX_ZONES 32
+
+enum LightingOpcode
+{
+	LIGHTING_OP_PING = 0,
+	LIGHTING_OP_INFO,
+	LIGHTING_OP_GET_ZONES,
+	LIGHTING_OP_SET_ZONES,
+	LIGHTING_OP_BATCH,
+	LIGHTING_OP_STATS,
+	LIGHTING_OP_SHUTDOWN,
+};
+
+enum LightingStatus
+{
+	LIGHTING_STATUS_OK = 0,
+	LIGHTING_STATUS_BAD_REQUEST,	// payload does not match the opcode
+	LIGHTING_STATUS_UNKNOWN_OPCODE,
+	LIGHTING_STATUS_NO_SUCH_GPU,
+	LIGHTING_STATUS_FAILED, // the driver rejected the call, SET_ZONES and BATCH still report per update results
+};
+
+#define LIGHTING_FLAG_DEFAULT 0x1u
+
+struct LightingFrameHeader
+{
+	uint32_t length; // payload bytes after the header
+	uint16_t opcode; // LightingOpcode
+	uint16_t status; // 0 in requests, LightingStatus in responses
+	uint32_t flags;	 // LIGHTING_FLAG_*, echoed in responses
+	uint32_t requestId; // chosen by the client, echoed in responses
+};
+
+struct LightingGpuRequest
+{
+	uint32_t gpuIndex;
+	uint32_t count; // SET_ZONES updates that follow, 0 for GET_ZONES
+};
+
+// Same layout as the wrapper's ZoneUpdate
+struct LightingZoneUpdate
+{
+	uint32_t zoneIndex;
+	uint32_t zoneType; // expected NV_GPU_CLIENT_ILLUM_ZONE_TYPE, 0 accepts any type
+	uint8_t r, g, b, w, brightness;
+	uint8_t padding[3];
+};
+
+struct LightingBatchEntry
+{
+	uint32_t gpuIndex;
+	LightingZoneUpdate update;
+};
+
+struct LightingBatchResult
+{
+	uint32_t applied;  // entries written after coalescing
+	uint32_t coalesced; // entries replaced by a later entry for the same zone
+	uint32_t writes;   // GPUs written
+	uint32_t failures; // GPUs whose write failed
+};
+
+struct LightingGpuInfo
+{
+	uint32_t zoneCount;
+	uint32_t busId;
+	uint8_t zoneTypes[LIGHTING_MAX_ZONES];	  // NV_GPU_CLIENT_ILLUM_ZONE_TYPE
+	uint8_t zoneLocations[LIGHTING_MAX_ZONES]; // NV_GPU_CLIENT_ILLUM_ZONE_LOCATION, truncated to a byte
+	char name[64];
+};
+
+// INFO response, gpuCount LightingGpuInfo follow it
+struct LightingInfo
+{
+	uint32_t protocolVersion;
+	uint32_t gpuCount;
+	uint32_t driverVersion;
+	uint32_t padding;
+};
+
+struct LightingZonesHeader
+{
+	uint32_t gpuIndex;
+	uint32_t zoneCount;
+};
+
+struct LightingZoneState
+{
+	uint32_t zoneType;
+	uint32_t ctrlMode; // NV_GPU_CLIENT_ILLUM_CTRL_MODE
+	uint8_t r, g, b, w, brightness;
+	uint8_t padding[3];
+};
+
+struct LightingStats
+{
+	uint64_t uptimeUs;
+	uint64_t connections;
+	uint64_t requests;
+	uint64_t zoneWrites; // SetIlluminationZonesBatch calls made for clients
+	uint64_t zoneReads;	 // GET_ZONES answered, served from the wrapper's shadow state when it is fresh
+	uint64_t protocolErrors;
+};
+
+static_assert(sizeof(LightingFrameHeader) == 16, "frame header layout is part of the protocol");
+static_assert(sizeof(LightingZoneUpdate) == 16, "zone update layout is part of the protocol");
+static_assert(sizeof(LightingBatchEntry) == 20, "batch entry layout is part of the protocol");
+static_assert(sizeof(LightingGpuInfo) == 136, "gpu info layout is part of the protocol");
+static_assert(sizeof(LightingZoneState) == 16, "zone state layout is part of the protocol");
+static_assert(sizeof(LightingStats) == 48, "stats layout is part of the protocol");
@@ -0,0 +1,1038 @@
+// Headless lighting service. It owns the NvAPI session for as long as it runs: the driver is initialized once, the GPU
+// topology and zone layout are read once at startup and zone state is served from the wrapper's shadow copy, so a
+// client pays for its own command and nothing else. Clients talk to it over a local stream socket with the binary
+// protocol described in LightingProtocol.h.
+//
+// The socket is AF_UNIX on every platform (Windows 10 1803 and later support it), by default nvapi-lighting.sock in
+// %TEMP% on Windows and in $XDG_RUNTIME_DIR or /tmp elsewhere. Each client gets a thread of its own, the requests a
+// client pipelines are executed in order and the responses to everything one read returned go back in one write.
+//
+// --self-test runs the service against the NvAPI emulator and drives it through a loopback client: it checks every
+// opcode and error path, then times round trips, pipelined commands and batches the way NvApiWrapperBench times exports.
+//
+// Usage: NvApiLightingService [--socket path] [--emulator] [--ready-timeout-ms N]
+//        NvApiLightingService --self-test [--socket path] [--iterations N] [--gpus N]
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET LightingSocket;
+#define SOCKET_SEND_FLAGS 0
+#else
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+typedef int LightingSocket;
+#define INVALID_SOCKET (-1)
+#define SOCKET_SEND_FLAGS MSG_NOSIGNAL
+#endif
+#include "NvApiDll.h"
+#include "LightingProtocol.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+static_assert(sizeof(LightingZoneUpdate) == sizeof(ZoneUpdate), "LightingZoneUpdate mirrors ZoneUpdate");
+static_assert(LIGHTING_MAX_ZONES == NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX, "protocol zone limit follows NvAPI");
+static_assert(LIGHTING_MAX_GPUS == NVAPI_MAX_PHYSICAL_GPUS, "protocol GPU limit follows NvAPI");
+
+struct ServiceOptions
+{
+	std::string socketPath;
+	bool emulator = false;
+	unsigned int readyTimeoutMs = 60000;
+	bool selfTest = false;
+	unsigned int iterations = 2000;
+	unsigned int gpuCount = 2;
+};
+
+// Topology read once at startup, the service does not follow GPUs that appear or vanish while it runs
+struct GpuTopology
+{
+	LightingGpuInfo info;
+	GpuPciIdentity identity;
+};
+static GpuTopology topology[LIGHTING_MAX_GPUS];
+static unsigned int topologyGpuCount = 0;
+static unsigned long driverVersion = 0;
+
+static std::atomic<bool> serviceStopping{false};
+static std::atomic<LightingSocket> listenSocket{INVALID_SOCKET};
+static std::mutex clientLock;
+static std::condition_variable clientsExited;
+static std::vector<LightingSocket> clientSockets;
+static std::chrono::steady_clock::time_point serviceStart;
+static std::atomic<unsigned long long> statConnections{0};
+static std::atomic<unsigned long long> statRequests{0};
+static std::atomic<unsigned long long> statZoneWrites{0};
+static std::atomic<unsigned long long> statZoneReads{0};
+static std::atomic<unsigned long long> statProtocolErrors{0};
+
+// Per connection buffers, kept across reads so a busy client does not allocate per request
+struct Connection
+{
+	std::vector<uint8_t> input;
+	std::vector<uint8_t> output;
+	// BATCH coalescing, last update of every zone and a bit per zone seen
+	ZoneUpdate pending[LIGHTING_MAX_GPUS][LIGHTING_MAX_ZONES];
+	uint32_t pendingMask[LIGHTING_MAX_GPUS];
+	bool stopRequested; // SHUTDOWN stops the service once its response is written
+};
+
+static void closeSocket(LightingSocket socket)
+{
+#ifdef _WIN32
+	closesocket(socket);
+#else
+	close(socket);
+#endif
+}
+
+static bool sendAll(LightingSocket socket, const uint8_t *pData, size_t size)
+{
+	while (size)
+	{
+		int chunk = static_cast<int>((std::min)(size, static_cast<size_t>(1) << 30));
+		int sent = static_cast<int>(send(socket, reinterpret_cast<const char *>(pData), chunk, SOCKET_SEND_FLAGS));
+		if (sent <= 0)
+			return false;
+		pData += sent;
+		size -= static_cast<size_t>(sent);
+	}
+	return true;
+}
+
+static bool makeSocketAddress(const std::string &path, sockaddr_un &address)
+{
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.empty() || path.size() >= sizeof(address.sun_path))
+		return false;
+	memcpy(address.sun_path, path.c_str(), path.size());
+	return true;
+}
+
+static LightingSocket connectSocket(const std::string &path)
+{
+	sockaddr_un address;
+	if (!makeSocketAddress(path, address))
+		return INVALID_SOCKET;
+	LightingSocket socketHandle = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (socketHandle == INVALID_SOCKET)
+		return INVALID_SOCKET;
+	if (connect(socketHandle, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+	{
+		closeSocket(socketHandle);
+		return INVALID_SOCKET;
+	}
+	return socketHandle;
+}
+
+static std::string defaultSocketPath()
+{
+#ifdef _WIN32
+	const char *directory = getenv("TEMP");
+	return std::string(directory ? directory : ".") + "\\nvapi-lighting.sock";
+#else
+	const char *directory = getenv("XDG_RUNTIME_DIR");
+	return std::string(directory && *directory ? directory : "/tmp") + "/nvapi-lighting.sock";
+#endif
+}
+
+template <typename T>
+static void appendPod(std::vector<uint8_t> &buffer, const T &value)
+{
+	size_t offset = buffer.size();
+	buffer.resize(offset + sizeof(T));
+	memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+static void appendFrame(std::vector<uint8_t> &buffer, uint16_t opcode, uint16_t status, uint32_t flags, uint32_t requestId, const void *pPayload, size_t size)
+{
+	LightingFrameHeader header = {static_cast<uint32_t>(size), opcode, status, flags, requestId};
+	appendPod(buffer, header);
+	if (size)
+	{
+		size_t offset = buffer.size();
+		buffer.resize(offset + size);
+		memcpy(buffer.data() + offset, pPayload, size);
+	}
+}
+
+// Reads the GPUs and their zone layout, the only enumeration the service does
+static void readTopology()
+{
+	driverVersion = GetDriverVersion();
+	topologyGpuCount = (std::min)(GetNumberOfGPUs(), static_cast<unsigned int>(LIGHTING_MAX_GPUS));
+	for (unsigned int i = 0; i < topologyGpuCount; ++i)
+	{
+		GpuTopology &gpu = topology[i];
+		memset(&gpu, 0, sizeof(gpu));
+		snprintf(gpu.info.name, sizeof(gpu.info.name), "%s", GetGPUName(i));
+		unsigned long busId = 0, deviceId = 0, subSystemId = 0;
+		GetGPUBusId(i, &busId);
+		GetGPUPCIIdentifiers(i, &deviceId, &subSystemId, nullptr, nullptr);
+		gpu.info.busId = static_cast<uint32_t>(busId);
+		gpu.identity = {static_cast<unsigned int>(busId), static_cast<unsigned int>(deviceId), static_cast<unsigned int>(subSystemId)};
+		IlluminationZonesInfoV2 zones;
+		if (!GetIlluminationZonesInfoV2(i, &zones))
+			continue;
+		gpu.info.zoneCount = zones.numZones;
+		for (unsigned int zone = 0; zone < zones.numZones; ++zone)
+		{
+			gpu.info.zoneTypes[zone] = static_cast<uint8_t>(zones.zones[zone].zoneType);
+			gpu.info.zoneLocations[zone] = static_cast<uint8_t>(zones.zones[zone].zoneLocation);
+		}
+	}
+}
+
+static uint16_t handleInfo(std::vector<uint8_t> &output)
+{
+	LightingInfo info = {LIGHTING_PROTOCOL_VERSION, topologyGpuCount, static_cast<uint32_t>(driverVersion), 0};
+	appendPod(output, info);
+	for (unsigned int i = 0; i < topologyGpuCount; ++i)
+		appendPod(output, topology[i].info);
+	return LIGHTING_STATUS_OK;
+}
+
+static uint16_t handleGetZones(const LightingFrameHeader &request, const uint8_t *pPayload, std::vector<uint8_t> &output)
+{
+	LightingGpuRequest gpuRequest;
+	if (request.length != sizeof(gpuRequest))
+		return LIGHTING_STATUS_BAD_REQUEST;
+	memcpy(&gpuRequest, pPayload, sizeof(gpuRequest));
+	if (gpuRequest.gpuIndex >= topologyGpuCount)
+		return LIGHTING_STATUS_NO_SUCH_GPU;
+	IlluminationZoneControlsV2 controls;
+	statZoneReads++;
+	if (!GetIlluminationZonesControlV2(gpuRequest.gpuIndex, (request.flags & LIGHTING_FLAG_DEFAULT) != 0, &controls))
+		return LIGHTING_STATUS_FAILED;
+	LightingZonesHeader header = {gpuRequest.gpuIndex, controls.numZones};
+	appendPod(output, header);
+	for (unsigned int zone = 0; zone < controls.numZones; ++zone)
+	{
+		const IlluminationZoneControlV2 &control = controls.zones[zone];
+		const IlluminationColorV2 &color = control.manualColor;
+		LightingZoneState state = {control.zoneType, control.ctrlMode, color.r, color.g, color.b, color.w, color.brightness, {0}};
+		appendPod(output, state);
+	}
+	return LIGHTING_STATUS_OK;
+}
+
+static uint16_t handleSetZones(const LightingFrameHeader &request, const uint8_t *pPayload, std::vector<uint8_t> &output)
+{
+	LightingGpuRequest gpuRequest;
+	if (request.length < sizeof(gpuRequest))
+		return LIGHTING_STATUS_BAD_REQUEST;
+	memcpy(&gpuRequest, pPayload, sizeof(gpuRequest));
+	if (gpuRequest.count == 0 || gpuRequest.count > LIGHTING_MAX_ZONES || request.length != sizeof(gpuRequest) + gpuRequest.count * sizeof(LightingZoneUpdate))
+		return LIGHTING_STATUS_BAD_REQUEST;
+	if (gpuRequest.gpuIndex >= topologyGpuCount)
+		return LIGHTING_STATUS_NO_SUCH_GPU;
+	ZoneUpdate updates[LIGHTING_MAX_ZONES];
+	memcpy(updates, pPayload + sizeof(gpuRequest), gpuRequest.count * sizeof(ZoneUpdate));
+	NvAPI_Status results[LIGHTING_MAX_ZONES];
+	statZoneWrites++;
+	bool applied = SetIlluminationZonesBatch(gpuRequest.gpuIndex, updates, gpuRequest.count, (request.flags & LIGHTING_FLAG_DEFAULT) != 0, results);
+	for (unsigned int i = 0; i < gpuRequest.count; ++i)
+		appendPod(output, static_cast<int32_t>(results[i]));
+	return applied ? LIGHTING_STATUS_OK : LIGHTING_STATUS_FAILED;
+}
+
+// Coalesces the entries per zone and writes every GPU they touch once, GPUs in parallel when there are several
+static uint16_t handleBatch(Connection &connection, const LightingFrameHeader &request, const uint8_t *pPayload, std::vector<uint8_t> &output)
+{
+	uint32_t count;
+	if (request.length < sizeof(count))
+		return LIGHTING_STATUS_BAD_REQUEST;
+	memcpy(&count, pPayload, sizeof(count));
+	if (request.length != sizeof(count) + static_cast<size_t>(count) * sizeof(LightingBatchEntry))
+		return LIGHTING_STATUS_BAD_REQUEST;
+	const uint8_t *pEntries = pPayload + sizeof(count);
+	// validate everything first so a bad entry applies nothing
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		LightingBatchEntry entry;
+		memcpy(&entry, pEntries + i * sizeof(entry), sizeof(entry));
+		if (entry.update.zoneIndex >= LIGHTING_MAX_ZONES)
+			return LIGHTING_STATUS_BAD_REQUEST;
+		if (entry.gpuIndex >= topologyGpuCount)
+			return LIGHTING_STATUS_NO_SUCH_GPU;
+	}
+
+	LightingBatchResult result = {0, 0, 0, 0};
+	memset(connection.pendingMask, 0, sizeof(connection.pendingMask));
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		LightingBatchEntry entry;
+		memcpy(&entry, pEntries + i * sizeof(entry), sizeof(entry));
+		uint32_t zoneBit = 1u << entry.update.zoneIndex;
+		if (connection.pendingMask[entry.gpuIndex] & zoneBit)
+			result.coalesced++;
+		connection.pendingMask[entry.gpuIndex] |= zoneBit;
+		memcpy(&connection.pending[entry.gpuIndex][entry.update.zoneIndex], &entry.update, sizeof(ZoneUpdate));
+	}
+
+	// lay the updates out GPU by GPU, the shape ApplyIlluminationZonesMultiGpu takes
+	ZoneUpdate updates[LIGHTING_MAX_GPUS * LIGHTING_MAX_ZONES];
+	GpuZoneBatch batches[LIGHTING_MAX_GPUS];
+	unsigned int gpuIndices[LIGHTING_MAX_GPUS];
+	unsigned int updateCount = 0;
+	for (unsigned int gpu = 0; gpu < topologyGpuCount; ++gpu)
+	{
+		uint32_t mask = connection.pendingMask[gpu];
+		if (!mask)
+			continue;
+		GpuZoneBatch &batch = batches[result.writes];
+		batch.identity = topology[gpu].identity;
+		batch.firstUpdate = updateCount;
+		for (unsigned int zone = 0; mask; ++zone, mask >>= 1)
+			if (mask & 1u)
+				updates[updateCount++] = connection.pending[gpu][zone];
+		batch.updateCount = updateCount - batch.firstUpdate;
+		gpuIndices[result.writes++] = gpu;
+	}
+	result.applied = updateCount;
+
+	bool useDefault = (request.flags & LIGHTING_FLAG_DEFAULT) != 0;
+	if (result.writes == 1)
+	{
+		statZoneWrites++;
+		if (!SetIlluminationZonesBatch(gpuIndices[0], updates, updateCount, useDefault, nullptr))
+			result.failures++;
+	}
+	else if (result.writes > 1)
+	{
+		NvAPI_Status gpuResults[LIGHTING_MAX_GPUS];
+		NvAPI_Status zoneResults[LIGHTING_MAX_GPUS * LIGHTING_MAX_ZONES];
+		statZoneWrites += result.writes;
+		ApplyIlluminationZonesMultiGpu(batches, result.writes, updates, updateCount, useDefault, gpuResults, zoneResults, nullptr);
+		for (unsigned int b = 0; b < result.writes; ++b)
+			if (gpuResults[b] != NVAPI_OK)
+				result.failures++;
+	}
+	appendPod(output, result);
+	return result.failures ? LIGHTING_STATUS_FAILED : LIGHTING_STATUS_OK;
+}
+
+static uint16_t handleStats(std::vector<uint8_t> &output)
+{
+	LightingStats stats;
+	stats.uptimeUs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - serviceStart).count());
+	stats.connections = statConnections.load();
+	stats.requests = statRequests.load();
+	stats.zoneWrites = statZoneWrites.load();
+	stats.zoneReads = statZoneReads.load();
+	stats.protocolErrors = statProtocolErrors.load();
+	appendPod(output, stats);
+	return LIGHTING_STATUS_OK;
+}
+
+// Wakes the accept loop, safe to call from a signal handler
+static void requestStop()
+{
+	serviceStopping = true;
+	LightingSocket listener = listenSocket.load();
+	if (listener == INVALID_SOCKET)
+		return;
+#ifdef _WIN32
+	// closing is what wakes accept on Windows, runService leaves the socket alone once it is taken
+	if (listenSocket.compare_exchange_strong(listener, INVALID_SOCKET))
+		closesocket(listener);
+#else
+	shutdown(listener, SHUT_RDWR);
+#endif
+}
+
+// Executes one request and appends its response to the connection output
+static void dispatchRequest(Connection &connection, const LightingFrameHeader &request, const uint8_t *pPayload)
+{
+	statRequests++;
+	std::vector<uint8_t> &output = connection.output;
+	size_t headerOffset = output.size();
+	output.resize(headerOffset + sizeof(LightingFrameHeader));
+	uint16_t status;
+	switch (request.opcode)
+	{
+	case LIGHTING_OP_PING:
+		output.insert(output.end(), pPayload, pPayload + request.length);
+		status = LIGHTING_STATUS_OK;
+		break;
+	case LIGHTING_OP_INFO:
+		status = handleInfo(output);
+		break;
+	case LIGHTING_OP_GET_ZONES:
+		status = handleGetZones(request, pPayload, output);
+		break;
+	case LIGHTING_OP_SET_ZONES:
+		status = handleSetZones(request, pPayload, output);
+		break;
+	case LIGHTING_OP_BATCH:
+		status = handleBatch(connection, request, pPayload, output);
+		break;
+	case LIGHTING_OP_STATS:
+		status = handleStats(output);
+		break;
+	case LIGHTING_OP_SHUTDOWN:
+		status = LIGHTING_STATUS_OK;
+		connection.stopRequested = true;
+		break;
+	default:
+		status = LIGHTING_STATUS_UNKNOWN_OPCODE;
+		break;
+	}
+	// rejected requests answer with the bare header, failed writes keep their per update results
+	if (status != LIGHTING_STATUS_OK && status != LIGHTING_STATUS_FAILED)
+	{
+		output.resize(headerOffset + sizeof(LightingFrameHeader));
+		statProtocolErrors++;
+	}
+	LightingFrameHeader response = {static_cast<uint32_t>(output.size() - headerOffset - sizeof(LightingFrameHeader)), request.opcode, status, request.flags,
+									request.requestId};
+	memcpy(output.data() + headerOffset, &response, sizeof(response));
+}
+
+static void serveConnection(LightingSocket socketHandle)
+{
+	std::unique_ptr<Connection> connection(new (std::nothrow) Connection());
+	if (connection)
+	{
+		std::vector<uint8_t> &input = connection->input;
+		size_t used = 0;
+		size_t needed = sizeof(LightingFrameHeader);
+		for (;;)
+		{
+			// room for at least the frame being assembled and a full read behind it
+			size_t wanted = (std::max)(needed, used + 64 * 1024);
+			if (input.size() < wanted)
+				input.resize(wanted);
+			int received = static_cast<int>(recv(socketHandle, reinterpret_cast<char *>(input.data() + used), static_cast<int>(input.size() - used), 0));
+			if (received <= 0)
+				break;
+			used += static_cast<size_t>(received);
+
+			size_t offset = 0;
+			bool malformed = false;
+			needed = sizeof(LightingFrameHeader);
+			while (used - offset >= sizeof(LightingFrameHeader))
+			{
+				LightingFrameHeader request;
+				memcpy(&request, input.data() + offset, sizeof(request));
+				if (request.length > LIGHTING_MAX_PAYLOAD)
+				{
+					malformed = true;
+					break;
+				}
+				if (used - offset < sizeof(request) + request.length)
+				{
+					needed = sizeof(request) + request.length;
+					break;
+				}
+				dispatchRequest(*connection, request, input.data() + offset + sizeof(request));
+				offset += sizeof(request) + request.length;
+			}
+			if (offset)
+			{
+				memmove(input.data(), input.data() + offset, used - offset);
+				used -= offset;
+			}
+			if (!connection->output.empty())
+			{
+				if (!sendAll(socketHandle, connection->output.data(), connection->output.size()))
+					break;
+				connection->output.clear();
+			}
+			if (connection->stopRequested)
+				requestStop();
+			if (malformed)
+			{
+				// the stream cannot be resynchronized past a bad length
+				statProtocolErrors++;
+				break;
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(clientLock);
+	clientSockets.erase(std::find(clientSockets.begin(), clientSockets.end(), socketHandle));
+	closeSocket(socketHandle);
+	clientsExited.notify_all();
+}
+
+// Removes what a service that did not shut down left at path. Only a socket endpoint is removed, anything else there is
+// a mistyped --socket the user has to look at.
+static bool removeStaleSocket(const std::string &path)
+{
+#ifdef _WIN32
+	DWORD attributes = GetFileAttributesA(path.c_str());
+	if (attributes == INVALID_FILE_ATTRIBUTES)
+		return GetLastError() == ERROR_FILE_NOT_FOUND;
+	// AF_UNIX endpoints are reparse points on Windows
+	if (!(attributes & FILE_ATTRIBUTE_REPARSE_POINT) || (attributes & FILE_ATTRIBUTE_DIRECTORY))
+		return false;
+	return DeleteFileA(path.c_str()) != 0;
+#else
+	struct stat status;
+	if (lstat(path.c_str(), &status) != 0)
+		return errno == ENOENT;
+	if (!S_ISSOCK(status.st_mode))
+		return false;
+	return unlink(path.c_str()) == 0 || errno == ENOENT;
+#endif
+}
+
+// Accepts clients until requestStop, then disconnects the remaining ones and waits for their threads
+static bool runService(const std::string &path)
+{
+	sockaddr_un address;
+	if (!makeSocketAddress(path, address))
+	{
+		fprintf(stderr, "Socket path too long: %s\n", path.c_str());
+		return false;
+	}
+	// a socket file nobody answers on is left over from a service that did not shut down
+	LightingSocket probe = connectSocket(path);
+	if (probe != INVALID_SOCKET)
+	{
+		closeSocket(probe);
+		fprintf(stderr, "Another service is listening on %s\n", path.c_str());
+		return false;
+	}
+	if (!removeStaleSocket(path))
+	{
+		fprintf(stderr, "%s exists and is not a stale socket, not replacing it\n", path.c_str());
+		return false;
+	}
+
+	LightingSocket listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener == INVALID_SOCKET)
+		return false;
+	if (bind(listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+	{
+		fprintf(stderr, "Failed to listen on %s\n", path.c_str());
+		closeSocket(listener);
+		return false;
+	}
+#ifndef _WIN32
+	// other users must not drive this user's lighting
+	chmod(path.c_str(), 0600);
+#endif
+	listenSocket = listener;
+	if (serviceStopping)
+		requestStop();
+
+	while (!serviceStopping)
+	{
+		LightingSocket client = accept(listener, nullptr, nullptr);
+		if (client == INVALID_SOCKET)
+		{
+			if (!serviceStopping)
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			continue;
+		}
+		std::lock_guard<std::mutex> lock(clientLock);
+		clientSockets.push_back(client);
+		statConnections++;
+		// detached, the wait below is what outlives them
+		std::thread(serveConnection, client).detach();
+	}
+
+#ifdef _WIN32
+	if (listenSocket.compare_exchange_strong(listener, INVALID_SOCKET))
+		closesocket(listener);
+#else
+	listenSocket = INVALID_SOCKET;
+	close(listener);
+#endif
+	remove(path.c_str());
+
+	std::unique_lock<std::mutex> lock(clientLock);
+	for (LightingSocket client : clientSockets)
+#ifdef _WIN32
+		shutdown(client, SD_BOTH);
+#else
+		shutdown(client, SHUT_RDWR);
+#endif
+	clientsExited.wait(lock, []
+					   { return clientSockets.empty(); });
+	return true;
+}
+
+#ifdef _WIN32
+static BOOL WINAPI consoleHandler(DWORD)
+{
+	requestStop();
+	return TRUE;
+}
+#else
+static void signalHandler(int)
+{
+	requestStop();
+}
+#endif
+
+// Loopback client of the self test
+struct TestClient
+{
+	LightingSocket socket = INVALID_SOCKET;
+	std::vector<uint8_t> input;
+	size_t used = 0;
+	uint32_t nextRequestId = 1;
+};
+
+// Reads the next response into header and payload, false if the connection closed
+static bool readResponse(TestClient &client, LightingFrameHeader &header, std::vector<uint8_t> &payload)
+{
+	for (;;)
+	{
+		if (client.used >= sizeof(header))
+		{
+			memcpy(&header, client.input.data(), sizeof(header));
+			size_t frameSize = sizeof(header) + header.length;
+			if (client.used >= frameSize)
+			{
+				payload.assign(client.input.begin() + sizeof(header), client.input.begin() + static_cast<std::ptrdiff_t>(frameSize));
+				memmove(client.input.data(), client.input.data() + frameSize, client.used - frameSize);
+				client.used -= frameSize;
+				return true;
+			}
+			if (client.input.size() < frameSize)
+				client.input.resize(frameSize);
+		}
+		if (client.input.size() - client.used < 64 * 1024)
+			client.input.resize(client.used + 64 * 1024);
+		int received = static_cast<int>(recv(client.socket, reinterpret_cast<char *>(client.input.data() + client.used), static_cast<int>(client.input.size() - client.used), 0));
+		if (received <= 0)
+			return false;
+		client.used += static_cast<size_t>(received);
+	}
+}
+
+// Sends one request and waits for its response, status is 0xFFFF if the exchange itself failed
+static uint16_t roundTrip(TestClient &client, uint16_t opcode, uint32_t flags, const void *pPayload, size_t size, std::vector<uint8_t> &response)
+{
+	std::vector<uint8_t> request;
+	uint32_t requestId = client.nextRequestId++;
+	appendFrame(request, opcode, 0, flags, requestId, pPayload, size);
+	LightingFrameHeader header;
+	if (!sendAll(client.socket, request.data(), request.size()) || !readResponse(client, header, response) || header.requestId != requestId ||
+		header.opcode != opcode)
+		return 0xFFFF;
+	return header.status;
+}
+
+static std::vector<uint8_t> setZonesPayload(uint32_t gpuIndex, const LightingZoneUpdate *pUpdates, uint32_t count)
+{
+	std::vector<uint8_t> payload;
+	LightingGpuRequest gpuRequest = {gpuIndex, count};
+	appendPod(payload, gpuRequest);
+	for (uint32_t i = 0; i < count; ++i)
+		appendPod(payload, pUpdates[i]);
+	return payload;
+}
+
+struct TestResult
+{
+	const char *name;
+	unsigned long long calls;
+	unsigned long long failures;
+	double p50Us;
+	double p99Us;
+	double maxUs;
+	double callsPerSecond;
+};
+
+static double percentileUs(std::vector<unsigned long long> samplesNs, double fraction)
+{
+	if (samplesNs.empty())
+		return 0.0;
+	size_t index = static_cast<size_t>(fraction * static_cast<double>(samplesNs.size() - 1));
+	std::nth_element(samplesNs.begin(), samplesNs.begin() + static_cast<std::ptrdiff_t>(index), samplesNs.end());
+	return static_cast<double>(samplesNs[index]) / 1000.0;
+}
+
+static TestResult sampledResult(const char *name, const std::vector<unsigned long long> &samplesNs, double elapsedSeconds, unsigned long long failures)
+{
+	TestResult result = {name, samplesNs.size(), failures, percentileUs(samplesNs, 0.50), percentileUs(samplesNs, 0.99), 0.0, 0.0};
+	result.maxUs = samplesNs.empty() ? 0.0 : static_cast<double>(*std::max_element(samplesNs.begin(), samplesNs.end())) / 1000.0;
+	result.callsPerSecond = elapsedSeconds > 0.0 ? static_cast<double>(result.calls) / elapsedSeconds : 0.0;
+	return result;
+}
+
+static unsigned long long elapsedNs(std::chrono::steady_clock::time_point from)
+{
+	return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - from).count());
+}
+
+// Checks the requests that must be answered without touching a zone, every answer has to match the expected status
+static unsigned long long checkProtocol(TestClient &client, const ServiceOptions &options)
+{
+	unsigned long long failures = 0;
+	std::vector<uint8_t> response;
+	const char ping[] = "ping";
+	if (roundTrip(client, LIGHTING_OP_PING, 0, ping, sizeof(ping), response) != LIGHTING_STATUS_OK || response.size() != sizeof(ping) ||
+		memcmp(response.data(), ping, sizeof(ping)) != 0)
+	{
+		fprintf(stderr, "PING was not echoed\n");
+		failures++;
+	}
+
+	LightingInfo info = {};
+	if (roundTrip(client, LIGHTING_OP_INFO, 0, nullptr, 0, response) != LIGHTING_STATUS_OK ||
+		response.size() != sizeof(info) + options.gpuCount * sizeof(LightingGpuInfo))
+	{
+		fprintf(stderr, "INFO answered with %zu bytes\n", response.size());
+		failures++;
+	}
+	else
+	{
+		memcpy(&info, response.data(), sizeof(info));
+		LightingGpuInfo gpu;
+		memcpy(&gpu, response.data() + sizeof(info), sizeof(gpu));
+		if (info.protocolVersion != LIGHTING_PROTOCOL_VERSION || info.gpuCount != options.gpuCount || gpu.zoneCount != 4 ||
+			gpu.zoneTypes[1] != NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW)
+		{
+			fprintf(stderr, "INFO reported version %u, %u GPUs, %u zones\n", info.protocolVersion, info.gpuCount, gpu.zoneCount);
+			failures++;
+		}
+	}
+
+	struct ErrorCase
+	{
+		const char *name;
+		uint16_t opcode;
+		std::vector<uint8_t> payload;
+		uint16_t status;
+	};
+	LightingZoneUpdate update = {0, 0, 1, 2, 3, 0, 50, {0}};
+	LightingGpuRequest missingGpu = {options.gpuCount, 0};
+	std::vector<uint8_t> truncated = setZonesPayload(0, &update, 1);
+	truncated.pop_back();
+	std::vector<uint8_t> badZone;
+	appendPod(badZone, static_cast<uint32_t>(1));
+	LightingBatchEntry badEntry = {0, {LIGHTING_MAX_ZONES, 0, 0, 0, 0, 0, 0, {0}}};
+	appendPod(badZone, badEntry);
+	const ErrorCase errorCases[] = {
+		{"unknown opcode", 0x7777, {}, LIGHTING_STATUS_UNKNOWN_OPCODE},
+		{"GET_ZONES of a missing GPU", LIGHTING_OP_GET_ZONES, std::vector<uint8_t>(reinterpret_cast<uint8_t *>(&missingGpu), reinterpret_cast<uint8_t *>(&missingGpu) + sizeof(missingGpu)), LIGHTING_STATUS_NO_SUCH_GPU},
+		{"SET_ZONES of a missing GPU", LIGHTING_OP_SET_ZONES, setZonesPayload(options.gpuCount, &update, 1), LIGHTING_STATUS_NO_SUCH_GPU},
+		{"truncated SET_ZONES", LIGHTING_OP_SET_ZONES, truncated, LIGHTING_STATUS_BAD_REQUEST},
+		{"BATCH with a zone out of range", LIGHTING_OP_BATCH, badZone, LIGHTING_STATUS_BAD_REQUEST},
+	};
+	for (const ErrorCase &errorCase : errorCases)
+	{
+		uint16_t status = roundTrip(client, errorCase.opcode, 0, errorCase.payload.data(), errorCase.payload.size(), response);
+		if (status != errorCase.status || !response.empty())
+		{
+			fprintf(stderr, "%s answered status %u with %zu bytes, expected status %u\n", errorCase.name, status, response.size(), errorCase.status);
+			failures++;
+		}
+	}
+	return failures;
+}
+
+// Zone state of one GPU as the service reports it
+static bool readZoneStates(TestClient &client, uint32_t gpuIndex, LightingZoneState (&states)[LIGHTING_MAX_ZONES], uint32_t &zoneCount)
+{
+	std::vector<uint8_t> response;
+	LightingGpuRequest gpuRequest = {gpuIndex, 0};
+	if (roundTrip(client, LIGHTING_OP_GET_ZONES, 0, &gpuRequest, sizeof(gpuRequest), response) != LIGHTING_STATUS_OK || response.size() < sizeof(LightingZonesHeader))
+		return false;
+	LightingZonesHeader header;
+	memcpy(&header, response.data(), sizeof(header));
+	if (header.zoneCount > LIGHTING_MAX_ZONES || response.size() != sizeof(header) + header.zoneCount * sizeof(LightingZoneState))
+		return false;
+	zoneCount = header.zoneCount;
+	memcpy(states, response.data() + sizeof(header), zoneCount * sizeof(LightingZoneState));
+	return true;
+}
+
+static void runSelfTestCases(TestClient &client, const ServiceOptions &options, std::vector<TestResult> &results)
+{
+	unsigned long long protocolFailures = checkProtocol(client, options);
+	std::vector<unsigned long long> samplesNs(options.iterations);
+	std::vector<uint8_t> response;
+
+	// one SET_ZONES at a time, the latency a script sees per color
+	unsigned long long failures = protocolFailures;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < options.iterations; ++i)
+	{
+		LightingZoneUpdate update = {0, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB, static_cast<uint8_t>(i), 0, 255, 0, static_cast<uint8_t>(i % 101), {0}};
+		std::vector<uint8_t> payload = setZonesPayload(i % options.gpuCount, &update, 1);
+		std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+		if (roundTrip(client, LIGHTING_OP_SET_ZONES, 0, payload.data(), payload.size(), response) != LIGHTING_STATUS_OK)
+			failures++;
+		samplesNs[i] = elapsedNs(callStart);
+	}
+	results.push_back(sampledResult("SET_ZONES round trip", samplesNs, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), failures));
+
+	failures = 0;
+	start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < options.iterations; ++i)
+	{
+		LightingZoneState states[LIGHTING_MAX_ZONES];
+		uint32_t zoneCount = 0;
+		std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+		if (!readZoneStates(client, i % options.gpuCount, states, zoneCount) || zoneCount != 4)
+			failures++;
+		samplesNs[i] = elapsedNs(callStart);
+	}
+	results.push_back(sampledResult("GET_ZONES round trip", samplesNs, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), failures));
+
+	// requests are written without waiting for responses, each sample is the time from writing a request to reading
+	// its response while the others queue up around it
+	std::vector<uint8_t> pipeline;
+	std::vector<size_t> frameEnds(options.iterations);
+	uint32_t firstRequestId = client.nextRequestId;
+	for (unsigned int i = 0; i < options.iterations; ++i)
+	{
+		LightingZoneUpdate update = {1, 0, static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8), 0, static_cast<uint8_t>(i), 100, {0}};
+		std::vector<uint8_t> payload = setZonesPayload(0, &update, 1);
+		appendFrame(pipeline, LIGHTING_OP_SET_ZONES, 0, 0, client.nextRequestId++, payload.data(), payload.size());
+		frameEnds[i] = pipeline.size();
+	}
+	std::vector<std::chrono::steady_clock::time_point> sentAt(options.iterations);
+	std::vector<std::chrono::steady_clock::time_point> answeredAt(options.iterations);
+	unsigned int answered = 0;
+	failures = 0;
+	start = std::chrono::steady_clock::now();
+	// the writer runs on its own thread so a pipeline larger than the socket buffers cannot deadlock the test
+	std::thread writer([&]()
+					   {
+		size_t offset = 0;
+		for (unsigned int i = 0; i < options.iterations; ++i)
+		{
+			sentAt[i] = std::chrono::steady_clock::now();
+			if (!sendAll(client.socket, pipeline.data() + offset, frameEnds[i] - offset))
+				break;
+			offset = frameEnds[i];
+		} });
+	for (; answered < options.iterations; ++answered)
+	{
+		LightingFrameHeader header;
+		if (!readResponse(client, header, response))
+		{
+			failures += options.iterations - answered;
+			break;
+		}
+		answeredAt[answered] = std::chrono::steady_clock::now();
+		if (header.requestId != firstRequestId + answered || header.status != LIGHTING_STATUS_OK)
+			failures++;
+	}
+	writer.join();
+	unsigned long long pipelineNs = elapsedNs(start);
+	LightingZoneState states[LIGHTING_MAX_ZONES];
+	uint32_t zoneCount = 0;
+	uint8_t last = static_cast<uint8_t>(options.iterations - 1);
+	if (!readZoneStates(client, 0, states, zoneCount) || states[1].r != last || states[1].w != last)
+	{
+		fprintf(stderr, "Pipelined SET_ZONES left zone 1 at r %u w %u, expected %u\n", states[1].r, states[1].w, last);
+		failures++;
+	}
+	std::vector<unsigned long long> pipelineSamples(answered);
+	for (unsigned int i = 0; i < answered; ++i)
+		pipelineSamples[i] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(answeredAt[i] - sentAt[i]).count());
+	results.push_back(sampledResult("SET_ZONES pipelined", pipelineSamples, static_cast<double>(pipelineNs) * 1e-9, failures));
+
+	// a batch rewrites every zone of every GPU several times over, only the last entry of each zone may land
+	const unsigned int repeats = 8;
+	failures = 0;
+	start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < options.iterations; ++i)
+	{
+		std::vector<uint8_t> payload;
+		appendPod(payload, static_cast<uint32_t>(repeats * options.gpuCount * 4));
+		for (unsigned int r = 0; r < repeats; ++r)
+			for (uint32_t gpu = 0; gpu < options.gpuCount; ++gpu)
+				for (uint32_t zone = 0; zone < 4; ++zone)
+				{
+					LightingBatchEntry entry = {gpu, {zone, 0, static_cast<uint8_t>(r), static_cast<uint8_t>(gpu), static_cast<uint8_t>(zone), 0,
+													  static_cast<uint8_t>((i + r) % 101), {0}}};
+					appendPod(payload, entry);
+				}
+		std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+		uint16_t status = roundTrip(client, LIGHTING_OP_BATCH, 0, payload.data(), payload.size(), response);
+		samplesNs[i] = elapsedNs(callStart);
+		LightingBatchResult result = {};
+		if (response.size() == sizeof(result))
+			memcpy(&result, response.data(), sizeof(result));
+		if (status != LIGHTING_STATUS_OK || result.applied != options.gpuCount * 4 || result.coalesced != (repeats - 1) * options.gpuCount * 4 ||
+			result.writes != options.gpuCount || result.failures)
+			failures++;
+	}
+	for (uint32_t gpu = 0; gpu < options.gpuCount; ++gpu)
+		if (!readZoneStates(client, gpu, states, zoneCount) || states[0].r != repeats - 1 || states[0].g != gpu ||
+			states[3].brightness != (options.iterations - 1 + repeats - 1) % 101)
+		{
+			fprintf(stderr, "BATCH left GPU %u zone 0 at r %u g %u\n", gpu, states[0].r, states[0].g);
+			failures++;
+		}
+	results.push_back(sampledResult("BATCH round trip", samplesNs, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), failures));
+}
+
+static void configureEmulator(const ServiceOptions &options)
+{
+	std::vector<EmulatorGpuConfig> gpus(options.gpuCount);
+	for (unsigned int i = 0; i < options.gpuCount; ++i)
+	{
+		EmulatorGpuConfig &gpu = gpus[i];
+		memset(&gpu, 0, sizeof(gpu));
+		snprintf(gpu.name, sizeof(gpu.name), "Self Test GPU %u", i);
+		gpu.busId = 1 + i;
+		gpu.deviceId = 0x268410DE;
+		gpu.subSystemId = 0x167C10DE + (i << 16);
+		gpu.zoneCount = 4;
+		gpu.zoneTypes[0] = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB;
+		gpu.zoneTypes[1] = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW;
+		gpu.zoneTypes[2] = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR;
+		gpu.zoneTypes[3] = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED;
+	}
+	ConfigureNvApiEmulator(gpus.data(), options.gpuCount);
+}
+
+// Serves on a thread of its own and drives the service through a loopback client, then shuts it down over the protocol
+static int runSelfTest(const ServiceOptions &options)
+{
+	bool served = false;
+	std::thread service([&]()
+						{ served = runService(options.socketPath); });
+	TestClient client;
+	for (int attempt = 0; attempt < 200 && client.socket == INVALID_SOCKET; ++attempt)
+	{
+		client.socket = connectSocket(options.socketPath);
+		if (client.socket == INVALID_SOCKET)
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	if (client.socket == INVALID_SOCKET)
+	{
+		fprintf(stderr, "Could not connect to %s\n", options.socketPath.c_str());
+		requestStop();
+		service.join();
+		return 1;
+	}
+
+	std::vector<TestResult> results;
+	runSelfTestCases(client, options, results);
+
+	std::vector<uint8_t> response;
+	unsigned long long shutdownFailures = 0;
+	if (roundTrip(client, LIGHTING_OP_SHUTDOWN, 0, nullptr, 0, response) != LIGHTING_STATUS_OK)
+		shutdownFailures++;
+	LightingFrameHeader header;
+	// the service closes the connection once it stops
+	if (readResponse(client, header, response))
+		shutdownFailures++;
+	closeSocket(client.socket);
+	service.join();
+	if (!served)
+		shutdownFailures++;
+	if (shutdownFailures)
+		fprintf(stderr, "SHUTDOWN did not stop the service\n");
+
+	unsigned long long failures = shutdownFailures;
+	printf("%-24s %8s %10s %10s %10s %12s %8s\n", "case", "calls", "p50 us", "p99 us", "max us", "calls/s", "failed");
+	for (const TestResult &r : results)
+	{
+		printf("%-24s %8llu %10.3f %10.3f %10.3f %12.0f %8llu\n", r.name, r.calls, r.p50Us, r.p99Us, r.maxUs, r.callsPerSecond, r.failures);
+		failures += r.failures;
+	}
+	printf("%s\n", failures ? "FAILED" : "passed");
+	return failures ? 1 : 0;
+}
+
+static bool parseOptions(int argc, char **argv, ServiceOptions &options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *arg = argv[i];
+		if (strcmp(arg, "--emulator") == 0)
+		{
+			options.emulator = true;
+			continue;
+		}
+		if (strcmp(arg, "--self-test") == 0)
+		{
+			options.selfTest = true;
+			continue;
+		}
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value)
+			return false;
+		if (strcmp(arg, "--socket") == 0)
+			options.socketPath = value;
+		else if (strcmp(arg, "--ready-timeout-ms") == 0)
+			options.readyTimeoutMs = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+		else if (strcmp(arg, "--iterations") == 0)
+			options.iterations = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+		else if (strcmp(arg, "--gpus") == 0)
+			options.gpuCount = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+		else
+			return false;
+		++i;
+	}
+	if (options.socketPath.empty())
+		options.socketPath = defaultSocketPath();
+	return options.iterations > 0 && options.gpuCount > 0 && options.gpuCount <= LIGHTING_MAX_GPUS;
+}
+
+int main(int argc, char **argv)
+{
+	ServiceOptions options;
+	if (!parseOptions(argc, argv, options))
+	{
+		fprintf(stderr, "usage: %s [--socket path] [--emulator] [--ready-timeout-ms N]\n"
+						"       %s --self-test [--socket path] [--iterations N] [--gpus N]\n",
+				argv[0], argv[0]);
+		return 2;
+	}
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		fprintf(stderr, "Failed to initialize Winsock.\n");
+		return 1;
+	}
+	SetConsoleCtrlHandler(consoleHandler, TRUE);
+#else
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, signalHandler);
+	signal(SIGTERM, signalHandler);
+#endif
+
+	if (options.emulator || options.selfTest)
+		SetNvApiBackend(NVAPI_BACKEND_EMULATOR);
+	if (options.selfTest)
+		configureEmulator(options);
+	IlluminationReadyReport report;
+	if (!WaitForIlluminationReady(options.readyTimeoutMs, &report))
+	{
+		fprintf(stderr, "NvAPI did not become ready within %u ms: %s\n", options.readyTimeoutMs, GetNvApiErrorMessage(report.lastStatus));
+		return 1;
+	}
+	serviceStart = std::chrono::steady_clock::now();
+	readTopology();
+
+	int exitCode;
+	if (options.selfTest)
+		exitCode = runSelfTest(options);
+	else
+	{
+		printf("Serving %u GPUs on %s, ready after %llu us\n", topologyGpuCount, options.socketPath.c_str(), report.totalUs);
+		fflush(stdout);
+		exitCode = runService(options.socketPath) ? 0 : 1;
+	}
+	DeinitializeNvApi();
+#ifdef _WIN32
+	WSACleanup();
+#endif
+	return exitCode;
+}
@@ -0,0 +1,362 @@
+#include "pch.h"
+#include "NvApiColor.h"
+#include "NvApiPerf.h"
+#include <cmath>
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Ambient sampler. A frame is first downsampled into a fixed grid of cell sums, reading at most AMBIENT_SAMPLED_ROWS
+// rows so a 4K frame costs about 2 MB of memory traffic. Every region is then resolved from the cells whose center it
+// covers, so the cost of a frame barely depends on the number or size of the regions. The sums are integer, so the
+// AVX2 and scalar kernels give the same colors. Smoothed colors go through SetIlluminationZonesBatch, which means the
+// zone color pipelines and the shadow apply, and frames that do not change any zone are not written at all.
+
+static const unsigned int AMBIENT_GRID = 64; // cells per row and per column
+static const unsigned int AMBIENT_SAMPLED_ROWS = 128; // two per cell row
+static const unsigned int AMBIENT_MAX_FRAME_SIZE = 1 << 16;
+static const unsigned int AMBIENT_DOMINANT_BINS = 512; // 3 bits per channel
+static const unsigned int AMBIENT_DARK_BIN = 0;		   // every channel under 32
+
+struct AmbientCell
+{
+	uint32_t b, g, r, count;
+};
+
+struct AmbientBin
+{
+	uint64_t b, g, r, count;
+};
+
+struct AmbientGpuState
+{
+	AmbientZoneRegion regions[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	unsigned int count;
+	unsigned int smoothingMs;
+	uint8_t brightness;
+	unsigned int generation; // bumped by SetAmbientRegions so frames sampled with old regions are dropped
+	bool primed;			 // smoothed holds a color, the next frame blends into it
+	unsigned long long lastTimestampUs;
+	float smoothed[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX][3];
+	bool hasWritten;
+	ZoneUpdate written[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+};
+
+static std::mutex ambientLock;
+static AmbientGpuState ambientStates[NVAPI_MAX_PHYSICAL_GPUS];
+static AmbientStats ambientStats = {0};
+static thread_local AmbientCell ambientGrid[AMBIENT_GRID * AMBIENT_GRID];
+static thread_local AmbientBin ambientBins[AMBIENT_DOMINANT_BINS];
+
+static bool validRegion(const AmbientZoneRegion &region)
+{
+	return region.zoneIndex < NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX && region.mode <= AMBIENT_MODE_DOMINANT &&
+		   region.left >= 0.0f && region.left < region.right && region.right <= 1.0f &&
+		   region.top >= 0.0f && region.top < region.bottom && region.bottom <= 1.0f;
+}
+
+static bool validFrame(const void *pFrame, unsigned int width, unsigned int height, int stride)
+{
+	if (!pFrame || width == 0 || height == 0 || width > AMBIENT_MAX_FRAME_SIZE || height > AMBIENT_MAX_FRAME_SIZE)
+		return false;
+	// negative strides walk a bottom-up bitmap
+	long long rowBytes = stride < 0 ? -static_cast<long long>(stride) : stride;
+	return rowBytes >= static_cast<long long>(width) * 4;
+}
+
+static void addPixels(const uint8_t *pixel, unsigned int count, AmbientCell &cell)
+{
+	for (unsigned int i = 0; i < count; ++i, pixel += 4)
+	{
+		cell.b += pixel[0];
+		cell.g += pixel[1];
+		cell.r += pixel[2];
+	}
+	cell.count += count;
+}
+
+static void sampleRowScalar(const uint8_t *row, const unsigned int *edges, AmbientCell *cells)
+{
+	for (unsigned int cx = 0; cx < AMBIENT_GRID; ++cx)
+		addPixels(row + edges[cx] * 4, edges[cx + 1] - edges[cx], cells[cx]);
+}
+
+#if COLOR_KERNELS_X86
+
+COLOR_TARGET("avx2")
+static uint32_t sumLanes(__m256i sums)
+{
+	alignas(32) uint64_t lanes[4];
+	_mm256_store_si256(reinterpret_cast<__m256i *>(lanes), sums);
+	return static_cast<uint32_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+
+// 8 pixels per step, each channel is masked out of the BGRA bytes and summed with one SAD against zero
+COLOR_TARGET("avx2")
+static void sampleRowAvx2(const uint8_t *row, const unsigned int *edges, AmbientCell *cells)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i maskB = _mm256_set1_epi32(0x000000FF);
+	const __m256i maskG = _mm256_set1_epi32(0x0000FF00);
+	const __m256i maskR = _mm256_set1_epi32(0x00FF0000);
+	for (unsigned int cx = 0; cx < AMBIENT_GRID; ++cx)
+	{
+		const uint8_t *pixel = row + edges[cx] * 4;
+		unsigned int count = edges[cx + 1] - edges[cx];
+		__m256i sumB = zero, sumG = zero, sumR = zero;
+		unsigned int i = 0;
+		for (; i + 8 <= count; i += 8, pixel += 32)
+		{
+			__m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixel));
+			sumB = _mm256_add_epi64(sumB, _mm256_sad_epu8(_mm256_and_si256(pixels, maskB), zero));
+			sumG = _mm256_add_epi64(sumG, _mm256_sad_epu8(_mm256_and_si256(pixels, maskG), zero));
+			sumR = _mm256_add_epi64(sumR, _mm256_sad_epu8(_mm256_and_si256(pixels, maskR), zero));
+		}
+		AmbientCell &cell = cells[cx];
+		cell.b += sumLanes(sumB);
+		cell.g += sumLanes(sumG);
+		cell.r += sumLanes(sumR);
+		cell.count += i;
+		addPixels(pixel, count - i, cell);
+	}
+}
+
+#endif
+
+// Fills ambientGrid with the sums of every cell, rows are sampled evenly with the first one half a step down
+static void sampleFrame(const void *pFrame, unsigned int width, unsigned int height, int stride)
+{
+	memset(ambientGrid, 0, sizeof(ambientGrid));
+	unsigned int edges[AMBIENT_GRID + 1];
+	for (unsigned int cx = 0; cx <= AMBIENT_GRID; ++cx)
+		edges[cx] = cx * width / AMBIENT_GRID;
+	bool avx2 = COLOR_KERNELS_X86 && activeColorIsa() == COLOR_PIPELINE_ISA_AVX2;
+	unsigned int rowStep = (height + AMBIENT_SAMPLED_ROWS - 1) / AMBIENT_SAMPLED_ROWS;
+	const uint8_t *frame = static_cast<const uint8_t *>(pFrame);
+	for (unsigned int y = rowStep / 2; y < height; y += rowStep)
+	{
+		const uint8_t *row = frame + static_cast<ptrdiff_t>(y) * stride;
+		AmbientCell *cells = ambientGrid + (y * AMBIENT_GRID / height) * AMBIENT_GRID;
+#if COLOR_KERNELS_X86
+		if (avx2)
+		{
+			sampleRowAvx2(row, edges, cells);
+			continue;
+		}
+#endif
+		sampleRowScalar(row, edges, cells);
+	}
+	(void)avx2;
+}
+
+// Cells whose center lies in [from, to), or the cell under the middle of the range when it is narrower than a cell
+static void cellRange(float from, float to, unsigned int &first, unsigned int &end)
+{
+	float grid = static_cast<float>(AMBIENT_GRID);
+	first = static_cast<unsigned int>((std::max)(0.0f, std::ceil(from * grid - 0.5f)));
+	end = static_cast<unsigned int>((std::min)(grid, std::ceil(to * grid - 0.5f)));
+	if (end <= first)
+	{
+		first = (std::min)(AMBIENT_GRID - 1, static_cast<unsigned int>((from + to) * 0.5f * grid));
+		end = first + 1;
+	}
+}
+
+static uint8_t averageOf(uint64_t sum, uint64_t count)
+{
+	return static_cast<uint8_t>(count ? (sum + count / 2) / count : 0);
+}
+
+static void resolveRegion(const AmbientZoneRegion &region, uint8_t (&color)[3])
+{
+	unsigned int firstX, endX, firstY, endY;
+	cellRange(region.left, region.right, firstX, endX);
+	cellRange(region.top, region.bottom, firstY, endY);
+
+	AmbientBin total = {0, 0, 0, 0};
+	if (region.mode == AMBIENT_MODE_DOMINANT)
+		memset(ambientBins, 0, sizeof(ambientBins));
+	for (unsigned int cy = firstY; cy < endY; ++cy)
+	{
+		for (unsigned int cx = firstX; cx < endX; ++cx)
+		{
+			const AmbientCell &cell = ambientGrid[cy * AMBIENT_GRID + cx];
+			if (cell.count == 0)
+				continue;
+			AmbientBin *bin = &total;
+			if (region.mode == AMBIENT_MODE_DOMINANT)
+			{
+				// cells vote with their pixel count for the bin of their average color
+				unsigned int r = cell.r / cell.count, g = cell.g / cell.count, b = cell.b / cell.count;
+				bin = &ambientBins[((r >> 5) << 6) | ((g >> 5) << 3) | (b >> 5)];
+			}
+			bin->b += cell.b;
+			bin->g += cell.g;
+			bin->r += cell.r;
+			bin->count += cell.count;
+		}
+	}
+	if (region.mode == AMBIENT_MODE_DOMINANT)
+	{
+		// letterboxing and dark UI would win most frames, so near black only counts when nothing else is there
+		unsigned int winner = AMBIENT_DARK_BIN;
+		for (unsigned int bin = 0; bin < AMBIENT_DOMINANT_BINS; ++bin)
+		{
+			if (bin == AMBIENT_DARK_BIN || ambientBins[bin].count == 0)
+				continue;
+			if (winner == AMBIENT_DARK_BIN || ambientBins[bin].count > ambientBins[winner].count)
+				winner = bin;
+		}
+		total = ambientBins[winner];
+	}
+	color[0] = averageOf(total.r, total.count);
+	color[1] = averageOf(total.g, total.count);
+	color[2] = averageOf(total.b, total.count);
+}
+
+static void fillAmbientUpdate(const AmbientZoneRegion &region, const uint8_t (&color)[3], uint8_t brightness, ZoneUpdate &update)
+{
+	memset(&update, 0, sizeof(update));
+	update.zoneIndex = region.zoneIndex;
+	update.zoneType = region.zoneType;
+	if (region.zoneType == NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR || region.zoneType == NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED)
+	{
+		unsigned int luma = (77u * color[0] + 150u * color[1] + 29u * color[2]) >> 8;
+		update.brightness = static_cast<uint8_t>((luma * brightness + 127) / 255);
+		return;
+	}
+	update.r = color[0];
+	update.g = color[1];
+	update.b = color[2];
+	update.brightness = brightness;
+}
+
+// Colors the regions would get from one frame, without smoothing and without writing anything
+NVAPI_DLL bool ComputeAmbientColors(const void *pFrame, unsigned int width, unsigned int height, int stride, const AmbientZoneRegion *pRegions, unsigned int count, uint8_t brightness, ZoneUpdate *pUpdates)
+{
+	if (!validFrame(pFrame, width, height, stride) || !pRegions || !pUpdates || count > NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX)
+		return false;
+	for (unsigned int i = 0; i < count; ++i)
+		if (!validRegion(pRegions[i]))
+			return false;
+	sampleFrame(pFrame, width, height, stride);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		uint8_t color[3];
+		resolveRegion(pRegions[i], color);
+		fillAmbientUpdate(pRegions[i], color, brightness, pUpdates[i]);
+	}
+	return true;
+}
+
+// Replaces the regions of a GPU, count 0 stops driving it. smoothingMs is the time constant of the exponential
+// smoothing between frames, 0 writes every frame's colors as they are.
+NVAPI_DLL bool SetAmbientRegions(unsigned int gpuIndex, const AmbientZoneRegion *pRegions, unsigned int count, unsigned int smoothingMs, uint8_t brightness)
+{
+	if (gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS || count > NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX || (count && !pRegions) || brightness > 100)
+		return false;
+	for (unsigned int i = 0; i < count; ++i)
+		if (!validRegion(pRegions[i]))
+			return false;
+	std::lock_guard<std::mutex> lock(ambientLock);
+	AmbientGpuState &state = ambientStates[gpuIndex];
+	if (count)
+		memcpy(state.regions, pRegions, count * sizeof(AmbientZoneRegion));
+	state.count = count;
+	state.smoothingMs = smoothingMs;
+	state.brightness = brightness;
+	state.generation++;
+	state.primed = false;
+	state.hasWritten = false;
+	return true;
+}
+
+// Samples one frame for the regions of a GPU and writes the smoothed colors. timestampUs is the frame's presentation
+// time on any monotonic clock and drives the smoothing. Frames of one GPU are expected from a single capture thread.
+NVAPI_DLL bool SubmitAmbientFrame(unsigned int gpuIndex, const void *pFrame, unsigned int width, unsigned int height, int stride, unsigned long long timestampUs)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_SUBMIT_AMBIENT_FRAME);
+	if (gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS || !validFrame(pFrame, width, height, stride))
+		return false;
+
+	// regions are copied so sampling runs without the lock
+	AmbientZoneRegion regions[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	unsigned int count, generation;
+	{
+		std::lock_guard<std::mutex> lock(ambientLock);
+		const AmbientGpuState &state = ambientStates[gpuIndex];
+		count = state.count;
+		generation = state.generation;
+		memcpy(regions, state.regions, count * sizeof(AmbientZoneRegion));
+	}
+	if (count == 0)
+		return false;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	sampleFrame(pFrame, width, height, stride);
+	uint8_t colors[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX][3];
+	for (unsigned int i = 0; i < count; ++i)
+		resolveRegion(regions[i], colors[i]);
+	unsigned int sampleUs = static_cast<unsigned int>(
+		std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+
+	ZoneUpdate updates[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	bool changed = false;
+	{
+		std::lock_guard<std::mutex> lock(ambientLock);
+		ambientStats.frames++;
+		ambientStats.sampleTimeUs += sampleUs;
+		ambientStats.lastSampleUs = sampleUs;
+		if (sampleUs > ambientStats.maxSampleUs)
+			ambientStats.maxSampleUs = sampleUs;
+
+		AmbientGpuState &state = ambientStates[gpuIndex];
+		if (state.generation != generation)
+			return true; // the regions changed while sampling, the next frame uses the new ones
+		float blend = 1.0f;
+		if (state.primed && state.smoothingMs)
+		{
+			double elapsedUs = timestampUs > state.lastTimestampUs ? static_cast<double>(timestampUs - state.lastTimestampUs) : 0.0;
+			blend = static_cast<float>(1.0 - std::exp(-elapsedUs / (state.smoothingMs * 1000.0)));
+		}
+		state.primed = true;
+		state.lastTimestampUs = timestampUs;
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			uint8_t smoothedColor[3];
+			for (int c = 0; c < 3; ++c)
+			{
+				float &smoothed = state.smoothed[i][c];
+				smoothed += blend * (static_cast<float>(colors[i][c]) - smoothed);
+				smoothedColor[c] = static_cast<uint8_t>(std::lround((std::min)(255.0f, (std::max)(0.0f, smoothed))));
+			}
+			fillAmbientUpdate(regions[i], smoothedColor, state.brightness, updates[i]);
+		}
+		changed = !state.hasWritten || memcmp(state.written, updates, count * sizeof(ZoneUpdate)) != 0;
+		if (changed)
+		{
+			memcpy(state.written, updates, count * sizeof(ZoneUpdate));
+			state.hasWritten = true;
+		}
+	}
+	if (!changed)
+		return true;
+
+	bool written = SetIlluminationZonesBatch(gpuIndex, updates, count, false, nullptr);
+	std::lock_guard<std::mutex> lock(ambientLock);
+	ambientStats.writes++;
+	if (!written)
+	{
+		ambientStats.writeFailures++;
+		// write the colors again with the next frame even if they do not change
+		if (ambientStates[gpuIndex].generation == generation)
+			ambientStates[gpuIndex].hasWritten = false;
+	}
+	return written;
+}
+
+NVAPI_DLL void GetAmbientStats(AmbientStats *pStats)
+{
+	if (!pStats)
+		return;
+	std::lock_guard<std::mutex> lock(ambientLock);
+	*pStats = ambientStats;
+}
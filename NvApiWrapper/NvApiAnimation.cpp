@@ -0,0 +1,336 @@
+#include "pch.h"
+#include "NvApiTimeline.h"
+#include <math.h>
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Software animation engine. A single tick thread renders every animated GPU once per frame and commits it with one
+// batched write per GPU. Scheduling is deadline based: when a frame is late the missed deadlines are dropped instead
+// of being rendered back to back, so latency never builds up. Nothing on the frame path allocates. A GPU with a
+// timeline plays it from the frame it was picked up on instead of its effect.
+
+struct GpuAnimation
+{
+	std::mutex lock; // guards pending, the tick thread only ever try_locks it
+	AnimationParams pending;
+	IlluminationTimeline *pendingTimeline; // each slot holds a reference of its own
+	std::atomic<bool> dirty;
+	AnimationParams active;
+	IlluminationTimeline *activeTimeline;
+	unsigned long long timelineStartUs;
+};
+static GpuAnimation gpuAnimations[NVAPI_MAX_PHYSICAL_GPUS];
+
+static unsigned long long defaultAnimationClock(void *)
+{
+	return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+											   std::chrono::steady_clock::now().time_since_epoch())
+											   .count());
+}
+
+static bool defaultAnimationCommit(unsigned int gpuIndex, const ZoneUpdate *pUpdates, unsigned int count, void *)
+{
+	return SetIlluminationZonesBatch(gpuIndex, pUpdates, count, false, nullptr);
+}
+
+static AnimationClockFn animationClock = defaultAnimationClock;
+static AnimationCommitFn animationCommit = defaultAnimationCommit;
+static void *animationHookContext = nullptr;
+
+static std::mutex animationEngineLock;
+static std::condition_variable animationEngineExited;
+static std::atomic<bool> animationRunning{false};
+static std::atomic<bool> animationStopping{false};
+static bool animationThreadAlive = false;
+static unsigned long long animationFrameIntervalUs = 16667;
+static unsigned long long animationStartUs = 0;
+static unsigned long long animationNextDeadlineUs = 0;
+static AnimationStats animationStats = {0};
+
+static uint8_t lerpChannel(uint8_t a, uint8_t b, float t)
+{
+	return static_cast<uint8_t>(a + (static_cast<float>(b) - a) * t + 0.5f);
+}
+
+static void hueToRgb(float hue, uint8_t &r, uint8_t &g, uint8_t &b)
+{
+	// hue in [0, 1), full saturation and value
+	float h = (hue - floorf(hue)) * 6.0f;
+	int sector = static_cast<int>(h);
+	float f = h - sector;
+	uint8_t rise = static_cast<uint8_t>(f * 255.0f + 0.5f);
+	uint8_t fall = static_cast<uint8_t>((1.0f - f) * 255.0f + 0.5f);
+	switch (sector)
+	{
+	case 0: r = 255, g = rise, b = 0; break;
+	case 1: r = fall, g = 255, b = 0; break;
+	case 2: r = 0, g = 255, b = rise; break;
+	case 3: r = 0, g = fall, b = 255; break;
+	case 4: r = rise, g = 0, b = 255; break;
+	default: r = 255, g = 0, b = fall; break;
+	}
+}
+
+// Evaluates the effect at the given time for every zone in the mask, returns the number of updates written
+static unsigned int renderAnimationFrame(const AnimationParams &params, unsigned long long elapsedUs, ZoneUpdate *pUpdates)
+{
+	unsigned long long periodUs = (params.periodMs ? params.periodMs : 1000) * 1000ull;
+	float phase = static_cast<float>(elapsedUs % periodUs) / static_cast<float>(periodUs);
+
+	unsigned int zoneCount = 0;
+	for (unsigned int zone = 0; zone < NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX; ++zone)
+		if (params.zoneMask & (1u << zone))
+			++zoneCount;
+
+	unsigned int count = 0;
+	for (unsigned int zone = 0; zone < NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX; ++zone)
+	{
+		if (!(params.zoneMask & (1u << zone)))
+			continue;
+		ZoneUpdate &update = pUpdates[count];
+		update = {0};
+		update.zoneIndex = zone;
+		update.zoneType = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID; // brightness-only zones just ignore the color
+		const CustomRGBW &a = params.colorA;
+		const CustomRGBW &b = params.colorB;
+		switch (params.effect)
+		{
+		case ANIMATION_EFFECT_BREATHING:
+		{
+			float level = 0.5f - 0.5f * cosf(phase * 6.2831853f);
+			update.r = a.r, update.g = a.g, update.b = a.b, update.w = a.w;
+			update.brightness = static_cast<uint8_t>(a.brightness * level + 0.5f);
+			break;
+		}
+		case ANIMATION_EFFECT_COLOR_CYCLE:
+			hueToRgb(phase, update.r, update.g, update.b);
+			update.brightness = a.brightness;
+			break;
+		case ANIMATION_EFFECT_RAINBOW_WAVE:
+			hueToRgb(phase + static_cast<float>(count) / static_cast<float>(zoneCount), update.r, update.g, update.b);
+			update.brightness = a.brightness;
+			break;
+		case ANIMATION_EFFECT_STROBE:
+		{
+			const CustomRGBW &c = phase * 100.0f < params.dutyPct ? a : b;
+			update.r = c.r, update.g = c.g, update.b = c.b, update.w = c.w, update.brightness = c.brightness;
+			break;
+		}
+		case ANIMATION_EFFECT_CROSSFADE:
+		{
+			// fade A to B over the first half of the period and back over the second half
+			float t = phase < 0.5f ? phase * 2.0f : 2.0f - phase * 2.0f;
+			update.r = lerpChannel(a.r, b.r, t);
+			update.g = lerpChannel(a.g, b.g, t);
+			update.b = lerpChannel(a.b, b.b, t);
+			update.w = lerpChannel(a.w, b.w, t);
+			update.brightness = lerpChannel(a.brightness, b.brightness, t);
+			break;
+		}
+		default:
+			continue;
+		}
+		++count;
+	}
+	return count;
+}
+
+// Runs one scheduler iteration, caller must hold animationEngineLock through lock. Each GPU is rendered under the lock
+// and committed without it, so the exports never wait behind a driver write.
+static void animationTick(unsigned long long nowUs, std::unique_lock<std::mutex> &lock)
+{
+	if (nowUs < animationNextDeadlineUs)
+		return;
+
+	// skip every deadline we already missed rather than rendering stale frames
+	unsigned long long missed = (nowUs - animationNextDeadlineUs) / animationFrameIntervalUs;
+	animationStats.framesDropped += missed;
+	animationNextDeadlineUs += (missed + 1) * animationFrameIntervalUs;
+
+	ZoneUpdate updates[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	for (unsigned int gpuIndex = 0; gpuIndex < NVAPI_MAX_PHYSICAL_GPUS; ++gpuIndex)
+	{
+		GpuAnimation &animation = gpuAnimations[gpuIndex];
+		if (animation.dirty.load() && animation.lock.try_lock())
+		{
+			animation.active = animation.pending;
+			IlluminationTimeline *previous = animation.activeTimeline;
+			if (animation.pendingTimeline != previous)
+			{
+				retainTimeline(animation.pendingTimeline);
+				animation.activeTimeline = animation.pendingTimeline;
+				animation.timelineStartUs = nowUs;
+			}
+			else
+				previous = nullptr;
+			animation.dirty = false;
+			animation.lock.unlock();
+			// after the unlock, dropping the last reference frees the timeline
+			releaseTimeline(previous);
+		}
+		unsigned int count;
+		if (animation.activeTimeline)
+			count = evaluateTimeline(*animation.activeTimeline, nowUs - animation.timelineStartUs, updates);
+		else if (animation.active.effect != ANIMATION_EFFECT_NONE)
+			count = renderAnimationFrame(animation.active, nowUs - animationStartUs, updates);
+		else
+			continue;
+		if (count == 0)
+			continue;
+		animationStats.commits++;
+		AnimationCommitFn commit = animationCommit;
+		void *context = animationHookContext;
+		lock.unlock();
+		bool committed = commit(gpuIndex, updates, count, context);
+		lock.lock();
+		if (!committed)
+			animationStats.commitFailures++;
+	}
+	animationStats.framesRendered++;
+
+	unsigned long long frameUs = animationClock(animationHookContext) - nowUs;
+	animationStats.lastFrameUs = static_cast<unsigned int>(frameUs);
+	if (animationStats.lastFrameUs > animationStats.maxFrameUs)
+		animationStats.maxFrameUs = animationStats.lastFrameUs;
+}
+
+static void animationThread()
+{
+#ifdef _WIN32
+	// the default timer resolution is far too coarse for frame pacing, ask for a high resolution timer first
+	HANDLE timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!timer)
+		timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+#endif
+	std::unique_lock<std::mutex> lock(animationEngineLock);
+	while (!animationStopping.load())
+	{
+		unsigned long long nowUs = animationClock(animationHookContext);
+		if (nowUs < animationNextDeadlineUs)
+		{
+			unsigned long long waitUs = animationNextDeadlineUs - nowUs;
+			lock.unlock();
+#ifdef _WIN32
+			LARGE_INTEGER dueTime;
+			dueTime.QuadPart = -static_cast<LONGLONG>(waitUs * 10); // relative, in 100 ns units
+			if (timer && SetWaitableTimer(timer, &dueTime, 0, nullptr, nullptr, FALSE))
+				WaitForSingleObject(timer, INFINITE);
+			else
+				Sleep(static_cast<DWORD>((waitUs + 999) / 1000)); // rounded up, Sleep(0) would spin on sub-millisecond waits
+#else
+			std::this_thread::sleep_for(std::chrono::microseconds(waitUs));
+#endif
+			lock.lock();
+			continue;
+		}
+		animationTick(nowUs, lock);
+	}
+#ifdef _WIN32
+	if (timer)
+		CloseHandle(timer);
+#endif
+	animationThreadAlive = false;
+	animationEngineExited.notify_all();
+}
+
+NVAPI_DLL bool StartAnimationEngine(unsigned int frameRateHz)
+{
+	if (frameRateHz == 0 || frameRateHz > 1000)
+		return false;
+	std::lock_guard<std::mutex> lock(animationEngineLock);
+	if (animationRunning.load())
+		return false;
+	animationFrameIntervalUs = 1000000ull / frameRateHz;
+	animationStartUs = animationClock(animationHookContext);
+	animationNextDeadlineUs = animationStartUs;
+	animationStats = {0};
+	animationStopping = false;
+	animationRunning = true;
+	animationThreadAlive = true;
+	// detached so process exit never trips over a joinable std::thread, StopAnimationEngine waits for it instead
+	std::thread(animationThread).detach();
+	return true;
+}
+
+NVAPI_DLL void StopAnimationEngine()
+{
+	std::unique_lock<std::mutex> lock(animationEngineLock);
+	if (!animationRunning.load())
+		return;
+	animationStopping = true;
+	animationEngineExited.wait(lock, []
+							   { return !animationThreadAlive; });
+	animationRunning = false;
+}
+
+NVAPI_DLL bool SetAnimationEffect(unsigned int gpuIndex, const AnimationParams *pParams)
+{
+	if (gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS || !pParams || pParams->effect > ANIMATION_EFFECT_CROSSFADE)
+		return false;
+	GpuAnimation &animation = gpuAnimations[gpuIndex];
+	std::lock_guard<std::mutex> lock(animation.lock);
+	animation.pending = *pParams;
+	animation.dirty = true;
+	return true;
+}
+
+// Plays the timeline on the GPU from the next frame on, in place of its effect, null goes back to the effect. The
+// engine keeps its own reference, so the caller may free the timeline right away.
+NVAPI_DLL bool SetAnimationTimeline(unsigned int gpuIndex, IlluminationTimeline *pTimeline)
+{
+	if (gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS)
+		return false;
+	GpuAnimation &animation = gpuAnimations[gpuIndex];
+	retainTimeline(pTimeline);
+	IlluminationTimeline *previous;
+	{
+		std::lock_guard<std::mutex> lock(animation.lock);
+		previous = animation.pendingTimeline;
+		animation.pendingTimeline = pTimeline;
+		animation.dirty = true;
+	}
+	releaseTimeline(previous);
+	return true;
+}
+
+NVAPI_DLL bool SetAnimationHooks(AnimationClockFn clock, AnimationCommitFn commit, void *context)
+{
+	// hooks may only be swapped while the tick thread is not running
+	std::lock_guard<std::mutex> lock(animationEngineLock);
+	if (animationRunning.load())
+		return false;
+	animationClock = clock ? clock : defaultAnimationClock;
+	animationCommit = commit ? commit : defaultAnimationCommit;
+	animationHookContext = context;
+	return true;
+}
+
+NVAPI_DLL bool StepAnimationEngine(unsigned int frameRateHz, unsigned long long nowUs, bool restart)
+{
+	// drives the scheduler without the tick thread so frame pacing can be checked against an injected clock
+	if (frameRateHz == 0 || frameRateHz > 1000)
+		return false;
+	std::unique_lock<std::mutex> lock(animationEngineLock);
+	if (animationRunning.load())
+		return false;
+	if (restart)
+	{
+		animationFrameIntervalUs = 1000000ull / frameRateHz;
+		animationStartUs = nowUs;
+		animationNextDeadlineUs = nowUs;
+		animationStats = {0};
+	}
+	animationTick(nowUs, lock);
+	return true;
+}
+
+NVAPI_DLL void GetAnimationStats(AnimationStats *pStats)
+{
+	if (!pStats)
+		return;
+	std::lock_guard<std::mutex> lock(animationEngineLock);
+	*pStats = animationStats;
+}
@@ -0,0 +1,536 @@
+#include "pch.h"
+#include "NvApiColor.h"
+#include <cmath>
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Audio reactive stage. The audio thread hands interleaved PCM to SubmitAudioSamples, which mixes it down to mono into
+// a single producer single consumer ring, so the producer never takes a lock or waits on the lighting side. The
+// lighting thread wakes at the configured update rate, drains the ring and analyses every hop of fftSize / 2 samples:
+// Hann window, real FFT, band energies relative to their recent peak, and spectral flux for beats. The band envelopes
+// are rendered into zone colors once per tick and only written through SetIlluminationZonesBatch when a color changed,
+// so the driver sees at most updateRateHz writes. Every buffer is static and sized for the largest FFT, nothing on the
+// sample or tick path allocates.
+
+static const unsigned int AUDIO_MIN_FFT = 256;
+static const unsigned int AUDIO_MAX_FFT = 4096;
+static const unsigned int AUDIO_MAX_CHANNELS = 8;
+static const unsigned int AUDIO_RING_SAMPLES = 1 << 18; // over a second at 192 kHz, the lowest update rate is 1 Hz
+static const unsigned int AUDIO_FLUX_HISTORY = 64;		// analyses the beat threshold is averaged over
+static const unsigned int AUDIO_FLUX_MIN_HISTORY = 8;
+static const float AUDIO_BEAT_MIN_FLUX = 1e-3f;	   // about -60 dB, keeps noise in quiet passages from counting
+static const float AUDIO_BEAT_REFRACTORY_S = 0.2f; // one beat per onset, even when it spans two analyses
+static const float AUDIO_PEAK_DECAY_DB_PER_S = 6.0f;
+static const float AUDIO_PEAK_FLOOR_DB = -50.0f; // quieter bands are not scaled up any further
+
+// Ring between SubmitAudioSamples and the lighting side, each index is only written by its own side
+static float audioRing[AUDIO_RING_SAMPLES];
+static std::atomic<unsigned long long> audioRingHead{0};
+static std::atomic<unsigned long long> audioRingTail{0};
+static std::atomic<unsigned long long> audioSamplesIn{0};
+static std::atomic<unsigned long long> audioSamplesDropped{0};
+
+struct AudioBand
+{
+	unsigned int firstBin, endBin;
+	float attack, release; // envelope blend per analysis
+	float peakDb;
+	float envelope;
+};
+
+// Everything below is guarded by audioLock, which the lighting thread holds while it ticks
+static std::mutex audioLock;
+static std::condition_variable audioWake;
+static std::condition_variable audioExited;
+static std::atomic<bool> audioRunning{false};
+static bool audioStopping = false;
+static bool audioThreadAlive = false;
+static bool audioConfigured = false;
+static AudioReactiveConfig audioConfig = {0};
+static AudioBandMapping audioMappings[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+static AudioBand audioBands[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+static unsigned int audioMappingCount = 0;
+static AudioReactiveStats audioStats = {0};
+
+// Analysis state, sized for AUDIO_MAX_FFT and used up to the configured size
+static float audioWindow[AUDIO_MAX_FFT];
+static float audioInput[AUDIO_MAX_FFT]; // last fftSize samples, oldest first
+static unsigned int audioHopFill = 0;	// samples received since the last analysis
+static float audioRe[AUDIO_MAX_FFT / 2];
+static float audioIm[AUDIO_MAX_FFT / 2];
+static float audioTwiddleRe[AUDIO_MAX_FFT / 2]; // stage with half size h uses entries h - 1 to 2h - 2
+static float audioTwiddleIm[AUDIO_MAX_FFT / 2];
+static float audioSplitRe[AUDIO_MAX_FFT / 2]; // e^(-2 pi i k / fftSize) for the real FFT split
+static float audioSplitIm[AUDIO_MAX_FFT / 2];
+static uint16_t audioBitReverse[AUDIO_MAX_FFT / 2];
+static float audioPower[AUDIO_MAX_FFT / 2 + 1];
+static float audioMagnitude[AUDIO_MAX_FFT / 2 + 1]; // previous analysis, for the flux
+static float audioPowerScale = 0.0f;				// full scale sine in a band reads about 0 dB
+static float audioFluxHistory[AUDIO_FLUX_HISTORY];
+static unsigned int audioFluxCount = 0;
+static float audioFluxSum = 0.0f;
+static unsigned int audioRefractoryHops = 0;
+static unsigned int audioHopsSinceBeat = 0;
+static bool audioHasWritten = false;
+static ZoneUpdate audioWritten[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+
+// Radix 2 butterflies of one stage over split complex arrays. Every kernel does the same float operations per element
+// in the same order, so the spectra and therefore the beats and colors do not depend on the kernel.
+static void fftStageScalar(float *re, float *im, unsigned int size, unsigned int half, const float *twRe, const float *twIm)
+{
+	for (unsigned int start = 0; start < size; start += 2 * half)
+	{
+		for (unsigned int k = 0; k < half; ++k)
+		{
+			unsigned int a = start + k, b = a + half;
+			float tr = re[b] * twRe[k] - im[b] * twIm[k];
+			float ti = re[b] * twIm[k] + im[b] * twRe[k];
+			re[b] = re[a] - tr;
+			im[b] = im[a] - ti;
+			re[a] = re[a] + tr;
+			im[a] = im[a] + ti;
+		}
+	}
+}
+
+#if COLOR_KERNELS_X86
+
+// half must be a multiple of 4
+COLOR_TARGET("sse2")
+static void fftStageSse(float *re, float *im, unsigned int size, unsigned int half, const float *twRe, const float *twIm)
+{
+	for (unsigned int start = 0; start < size; start += 2 * half)
+	{
+		for (unsigned int k = 0; k < half; k += 4)
+		{
+			unsigned int a = start + k, b = a + half;
+			__m128 wr = _mm_loadu_ps(twRe + k), wi = _mm_loadu_ps(twIm + k);
+			__m128 br = _mm_loadu_ps(re + b), bi = _mm_loadu_ps(im + b);
+			__m128 ar = _mm_loadu_ps(re + a), ai = _mm_loadu_ps(im + a);
+			__m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+			__m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+			_mm_storeu_ps(re + b, _mm_sub_ps(ar, tr));
+			_mm_storeu_ps(im + b, _mm_sub_ps(ai, ti));
+			_mm_storeu_ps(re + a, _mm_add_ps(ar, tr));
+			_mm_storeu_ps(im + a, _mm_add_ps(ai, ti));
+		}
+	}
+}
+
+// half must be a multiple of 8
+COLOR_TARGET("avx2")
+static void fftStageAvx2(float *re, float *im, unsigned int size, unsigned int half, const float *twRe, const float *twIm)
+{
+	for (unsigned int start = 0; start < size; start += 2 * half)
+	{
+		for (unsigned int k = 0; k < half; k += 8)
+		{
+			unsigned int a = start + k, b = a + half;
+			__m256 wr = _mm256_loadu_ps(twRe + k), wi = _mm256_loadu_ps(twIm + k);
+			__m256 br = _mm256_loadu_ps(re + b), bi = _mm256_loadu_ps(im + b);
+			__m256 ar = _mm256_loadu_ps(re + a), ai = _mm256_loadu_ps(im + a);
+			__m256 tr = _mm256_sub_ps(_mm256_mul_ps(br, wr), _mm256_mul_ps(bi, wi));
+			__m256 ti = _mm256_add_ps(_mm256_mul_ps(br, wi), _mm256_mul_ps(bi, wr));
+			_mm256_storeu_ps(re + b, _mm256_sub_ps(ar, tr));
+			_mm256_storeu_ps(im + b, _mm256_sub_ps(ai, ti));
+			_mm256_storeu_ps(re + a, _mm256_add_ps(ar, tr));
+			_mm256_storeu_ps(im + a, _mm256_add_ps(ai, ti));
+		}
+	}
+	_mm256_zeroupper();
+}
+
+#endif
+
+// In place complex FFT of audioRe/audioIm, which must already hold the input in bit reversed order
+static void runFft(unsigned int size, unsigned int isa)
+{
+	for (unsigned int half = 1; half < size; half *= 2)
+	{
+		const float *twRe = audioTwiddleRe + half - 1, *twIm = audioTwiddleIm + half - 1;
+#if COLOR_KERNELS_X86
+		if (isa >= COLOR_PIPELINE_ISA_AVX2 && half >= 8)
+		{
+			fftStageAvx2(audioRe, audioIm, size, half, twRe, twIm);
+			continue;
+		}
+		if (isa >= COLOR_PIPELINE_ISA_SSE41 && half >= 4)
+		{
+			fftStageSse(audioRe, audioIm, size, half, twRe, twIm);
+			continue;
+		}
+#endif
+		fftStageScalar(audioRe, audioIm, size, half, twRe, twIm);
+	}
+	(void)isa;
+}
+
+// Fills audioPower with the power spectrum of audioInput. The real input is packed into a complex FFT of half the
+// size, even samples as the real part and odd samples as the imaginary part, and split into the real spectrum after.
+static void computePowerSpectrum(unsigned int isa)
+{
+	unsigned int fftSize = audioConfig.fftSize, half = fftSize / 2;
+	for (unsigned int j = 0; j < half; ++j)
+	{
+		unsigned int to = audioBitReverse[j];
+		audioRe[to] = audioInput[2 * j] * audioWindow[2 * j];
+		audioIm[to] = audioInput[2 * j + 1] * audioWindow[2 * j + 1];
+	}
+	runFft(half, isa);
+
+	float dc = audioRe[0] + audioIm[0], nyquist = audioRe[0] - audioIm[0];
+	audioPower[0] = dc * dc * audioPowerScale;
+	audioPower[half] = nyquist * nyquist * audioPowerScale;
+	for (unsigned int k = 1; k < half; ++k)
+	{
+		// X[k] = E + W^k O with E = (Z[k] + conj(Z[half - k])) / 2 and O = (Z[k] - conj(Z[half - k])) / 2i
+		float ar = audioRe[k], ai = audioIm[k], br = audioRe[half - k], bi = -audioIm[half - k];
+		float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+		float orr = 0.5f * (ai - bi), oi = -0.5f * (ar - br);
+		float xr = er + audioSplitRe[k] * orr - audioSplitIm[k] * oi;
+		float xi = ei + audioSplitRe[k] * oi + audioSplitIm[k] * orr;
+		audioPower[k] = (xr * xr + xi * xi) * audioPowerScale;
+	}
+}
+
+// Positive spectral flux against the previous analysis, high when energy appears at once as on a drum hit
+static float spectralFlux()
+{
+	unsigned int half = audioConfig.fftSize / 2;
+	float flux = 0.0f;
+	for (unsigned int k = 0; k <= half; ++k)
+	{
+		float magnitude = std::sqrt(audioPower[k]);
+		float rise = magnitude - audioMagnitude[k];
+		flux += rise > 0.0f ? rise : 0.0f;
+		audioMagnitude[k] = magnitude;
+	}
+	return flux;
+}
+
+// Compares the flux with its recent mean, one beat per AUDIO_BEAT_REFRACTORY_S at most
+static bool detectBeat(float flux)
+{
+	bool beat = audioFluxCount >= AUDIO_FLUX_MIN_HISTORY && audioHopsSinceBeat >= audioRefractoryHops &&
+				flux > AUDIO_BEAT_MIN_FLUX &&
+				flux > audioConfig.beatSensitivity * audioFluxSum / static_cast<float>((std::min)(audioFluxCount, AUDIO_FLUX_HISTORY));
+	unsigned int slot = audioFluxCount % AUDIO_FLUX_HISTORY;
+	if (audioFluxCount >= AUDIO_FLUX_HISTORY)
+		audioFluxSum -= audioFluxHistory[slot];
+	audioFluxHistory[slot] = flux;
+	audioFluxSum += flux;
+	audioFluxCount++;
+	audioHopsSinceBeat = beat ? 0 : audioHopsSinceBeat + 1;
+	return beat;
+}
+
+// One analysis of audioInput, moves every band envelope towards its level
+static void analyseHop(unsigned int isa)
+{
+	computePowerSpectrum(isa);
+	bool beat = detectBeat(spectralFlux());
+	if (beat)
+		audioStats.beats++;
+
+	float hopSeconds = static_cast<float>(audioConfig.fftSize / 2) / static_cast<float>(audioConfig.sampleRate);
+	for (unsigned int i = 0; i < audioMappingCount; ++i)
+	{
+		AudioBand &band = audioBands[i];
+		float energy = 0.0f;
+		for (unsigned int k = band.firstBin; k < band.endBin; ++k)
+			energy += audioPower[k];
+		float db = 10.0f * std::log10(energy + 1e-12f);
+		// the level is relative to a slowly falling peak, so quiet and loud sources both use the whole range
+		band.peakDb = (std::max)((std::max)(db, band.peakDb - AUDIO_PEAK_DECAY_DB_PER_S * hopSeconds), AUDIO_PEAK_FLOOR_DB);
+		float level = (db - band.peakDb) / audioConfig.dynamicRangeDb + 1.0f;
+		level = level < 0.0f ? 0.0f : level;
+		if (beat && (audioMappings[i].flags & AUDIO_BAND_BEAT))
+			level = 1.0f;
+		band.envelope += (level - band.envelope) * (level > band.envelope ? band.attack : band.release);
+	}
+	audioStats.analyses++;
+}
+
+// Moves every queued sample into audioInput and analyses each completed hop
+static void drainAudioRing()
+{
+	unsigned int isa = activeColorIsa();
+	unsigned int fftSize = audioConfig.fftSize, hop = fftSize / 2;
+	unsigned long long tail = audioRingTail.load(std::memory_order_relaxed);
+	unsigned long long head = audioRingHead.load(std::memory_order_acquire);
+	while (tail != head)
+	{
+		unsigned int count = static_cast<unsigned int>((std::min)(head - tail, static_cast<unsigned long long>(hop - audioHopFill)));
+		for (unsigned int i = 0; i < count; ++i)
+			audioInput[hop + audioHopFill + i] = audioRing[(tail + i) & (AUDIO_RING_SAMPLES - 1)];
+		tail += count;
+		audioHopFill += count;
+		if (audioHopFill < hop)
+			break;
+		analyseHop(isa);
+		memmove(audioInput, audioInput + hop, hop * sizeof(float));
+		audioHopFill = 0;
+	}
+	audioRingTail.store(tail, std::memory_order_release);
+}
+
+static uint8_t lerpChannel(uint8_t a, uint8_t b, float t)
+{
+	return static_cast<uint8_t>(a + (static_cast<float>(b) - a) * t + 0.5f);
+}
+
+// One lighting update: analyse what arrived since the last tick and write the zones whose color changed
+static void audioTick()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	drainAudioRing();
+	unsigned int analysisUs = static_cast<unsigned int>(
+		std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+	audioStats.analysisTimeUs += analysisUs;
+	if (analysisUs > audioStats.maxAnalysisUs)
+		audioStats.maxAnalysisUs = analysisUs;
+
+	ZoneUpdate updates[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	for (unsigned int i = 0; i < audioMappingCount; ++i)
+	{
+		const AudioBandMapping &mapping = audioMappings[i];
+		float t = audioBands[i].envelope;
+		ZoneUpdate &update = updates[i];
+		update = {0};
+		update.zoneIndex = mapping.zoneIndex;
+		update.zoneType = mapping.zoneType;
+		update.r = lerpChannel(mapping.quiet.r, mapping.loud.r, t);
+		update.g = lerpChannel(mapping.quiet.g, mapping.loud.g, t);
+		update.b = lerpChannel(mapping.quiet.b, mapping.loud.b, t);
+		update.w = lerpChannel(mapping.quiet.w, mapping.loud.w, t);
+		update.brightness = lerpChannel(mapping.quiet.brightness, mapping.loud.brightness, t);
+	}
+	if (audioHasWritten && memcmp(updates, audioWritten, audioMappingCount * sizeof(ZoneUpdate)) == 0)
+		return;
+	audioStats.writes++;
+	if (SetIlluminationZonesBatch(audioConfig.gpuIndex, updates, audioMappingCount, false, nullptr))
+	{
+		memcpy(audioWritten, updates, audioMappingCount * sizeof(ZoneUpdate));
+		audioHasWritten = true;
+	}
+	else
+	{
+		// write everything again on the next tick rather than trusting a half applied batch
+		audioStats.writeFailures++;
+		audioHasWritten = false;
+	}
+}
+
+static void audioThread()
+{
+	std::unique_lock<std::mutex> lock(audioLock);
+	std::chrono::microseconds interval(1000000 / audioConfig.updateRateHz);
+	std::chrono::steady_clock::time_point nextTick = std::chrono::steady_clock::now();
+	while (!audioStopping)
+	{
+		audioWake.wait_until(lock, nextTick, []
+							 { return audioStopping; });
+		if (audioStopping)
+			break;
+		audioTick();
+		// missed ticks are dropped, the next one analyses everything that queued up meanwhile
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		nextTick += interval;
+		if (nextTick < now)
+			nextTick = now + interval;
+	}
+	audioThreadAlive = false;
+	audioExited.notify_all();
+}
+
+static bool validAudioConfig(const AudioReactiveConfig &config, const AudioBandMapping *pMappings, unsigned int count)
+{
+	if (config.gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS || config.sampleRate < 8000 || config.sampleRate > 192000 ||
+		config.fftSize < AUDIO_MIN_FFT || config.fftSize > AUDIO_MAX_FFT || (config.fftSize & (config.fftSize - 1)) ||
+		config.updateRateHz == 0 || config.updateRateHz > 120 || !(config.dynamicRangeDb >= 6.0f && config.dynamicRangeDb <= 96.0f) ||
+		!(config.beatSensitivity > 1.0f && config.beatSensitivity <= 100.0f))
+		return false;
+	if (count == 0 || count > NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX || !pMappings)
+		return false;
+	unsigned int zoneMask = 0;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const AudioBandMapping &mapping = pMappings[i];
+		if (mapping.zoneIndex >= NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX || (zoneMask & (1u << mapping.zoneIndex)) ||
+			!(mapping.lowHz >= 0.0f && mapping.lowHz < mapping.highHz && mapping.highHz <= config.sampleRate * 0.5f) ||
+			!(mapping.attackMs >= 0.0f && mapping.attackMs <= 60000.0f) || !(mapping.releaseMs >= 0.0f && mapping.releaseMs <= 60000.0f) ||
+			mapping.quiet.brightness > 100 || mapping.loud.brightness > 100)
+			return false;
+		zoneMask |= 1u << mapping.zoneIndex;
+	}
+	return true;
+}
+
+static float envelopeBlend(float timeMs, float hopSeconds)
+{
+	return timeMs > 0.0f ? 1.0f - std::exp(-hopSeconds * 1000.0f / timeMs) : 1.0f;
+}
+
+// Builds the tables of the configured FFT size and clears all analysis state, caller must hold audioLock
+static void prepareAudioAnalysis()
+{
+	const double pi = 3.14159265358979323846;
+	unsigned int fftSize = audioConfig.fftSize, half = fftSize / 2;
+	for (unsigned int n = 0; n < fftSize; ++n)
+		audioWindow[n] = static_cast<float>(0.5 - 0.5 * cos(2.0 * pi * n / fftSize));
+	for (unsigned int h = 1; h < half; h *= 2)
+	{
+		for (unsigned int k = 0; k < h; ++k)
+		{
+			audioTwiddleRe[h - 1 + k] = static_cast<float>(cos(-pi * k / h));
+			audioTwiddleIm[h - 1 + k] = static_cast<float>(sin(-pi * k / h));
+		}
+	}
+	for (unsigned int k = 0; k < half; ++k)
+	{
+		audioSplitRe[k] = static_cast<float>(cos(-2.0 * pi * k / fftSize));
+		audioSplitIm[k] = static_cast<float>(sin(-2.0 * pi * k / fftSize));
+	}
+	unsigned int bits = 0;
+	while ((1u << bits) < half)
+		++bits;
+	for (unsigned int j = 0; j < half; ++j)
+	{
+		unsigned int reversed = 0;
+		for (unsigned int bit = 0; bit < bits; ++bit)
+			reversed |= ((j >> bit) & 1u) << (bits - 1 - bit);
+		audioBitReverse[j] = static_cast<uint16_t>(reversed);
+	}
+	// a Hann windowed full scale sine puts N / 4 into its bin and N / 8 into both neighbours
+	audioPowerScale = 8.0f / (3.0f * static_cast<float>(fftSize) * static_cast<float>(fftSize));
+
+	float hopSeconds = static_cast<float>(half) / static_cast<float>(audioConfig.sampleRate);
+	for (unsigned int i = 0; i < audioMappingCount; ++i)
+	{
+		const AudioBandMapping &mapping = audioMappings[i];
+		AudioBand &band = audioBands[i];
+		band.firstBin = (std::max)(1u, static_cast<unsigned int>(mapping.lowHz * fftSize / audioConfig.sampleRate + 0.5f));
+		band.endBin = (std::min)(half + 1, static_cast<unsigned int>(mapping.highHz * fftSize / audioConfig.sampleRate + 0.5f));
+		band.endBin = (std::max)(band.endBin, (std::min)(band.firstBin + 1, half + 1));
+		band.attack = envelopeBlend(mapping.attackMs, hopSeconds);
+		band.release = envelopeBlend(mapping.releaseMs, hopSeconds);
+		band.peakDb = AUDIO_PEAK_FLOOR_DB;
+		band.envelope = 0.0f;
+	}
+	audioRefractoryHops = static_cast<unsigned int>(AUDIO_BEAT_REFRACTORY_S / hopSeconds + 0.5f);
+
+	memset(audioInput, 0, sizeof(audioInput));
+	memset(audioMagnitude, 0, sizeof(audioMagnitude));
+	audioHopFill = 0;
+	audioFluxCount = 0;
+	audioFluxSum = 0.0f;
+	audioHopsSinceBeat = 0;
+	audioHasWritten = false;
+	// only the lighting side moves the tail, dropping whatever was queued for the previous configuration
+	audioRingTail.store(audioRingHead.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+// Sets the GPU, analysis and band mappings of the audio stage, only while its thread is stopped
+NVAPI_DLL bool SetAudioReactiveConfig(const AudioReactiveConfig *pConfig, const AudioBandMapping *pMappings, unsigned int count)
+{
+	if (!pConfig || !validAudioConfig(*pConfig, pMappings, count))
+		return false;
+	std::lock_guard<std::mutex> lock(audioLock);
+	if (audioRunning.load())
+		return false;
+	audioConfig = *pConfig;
+	memcpy(audioMappings, pMappings, count * sizeof(AudioBandMapping));
+	audioMappingCount = count;
+	prepareAudioAnalysis();
+	audioStats = {0};
+	audioSamplesIn = 0;
+	audioSamplesDropped = 0;
+	audioConfigured = true;
+	return true;
+}
+
+NVAPI_DLL bool StartAudioReactive()
+{
+	std::lock_guard<std::mutex> lock(audioLock);
+	if (audioRunning.load() || !audioConfigured)
+		return false;
+	audioRingTail.store(audioRingHead.load(std::memory_order_acquire), std::memory_order_release);
+	audioStopping = false;
+	audioRunning = true;
+	audioThreadAlive = true;
+	// detached so process exit never trips over a joinable std::thread, StopAudioReactive waits for it instead
+	std::thread(audioThread).detach();
+	return true;
+}
+
+NVAPI_DLL void StopAudioReactive()
+{
+	std::unique_lock<std::mutex> lock(audioLock);
+	if (!audioRunning.load())
+		return;
+	audioStopping = true;
+	audioWake.notify_all();
+	audioExited.wait(lock, []
+					 { return !audioThreadAlive; });
+	audioRunning = false;
+}
+
+// Queues interleaved PCM from one producer thread without locking, e.g. straight from a WASAPI loopback callback.
+// Returns false when the block is invalid or did not fit, the frames that did not fit are counted as dropped.
+NVAPI_DLL bool SubmitAudioSamples(const void *pSamples, unsigned int frameCount, unsigned int channels, unsigned int format)
+{
+	if ((!pSamples && frameCount) || channels == 0 || channels > AUDIO_MAX_CHANNELS || format > AUDIO_FORMAT_INT16)
+		return false;
+	unsigned long long head = audioRingHead.load(std::memory_order_relaxed);
+	unsigned long long free = AUDIO_RING_SAMPLES - (head - audioRingTail.load(std::memory_order_acquire));
+	unsigned int accepted = static_cast<unsigned int>((std::min)(static_cast<unsigned long long>(frameCount), free));
+	if (format == AUDIO_FORMAT_FLOAT32)
+	{
+		const float *samples = static_cast<const float *>(pSamples);
+		float scale = 1.0f / static_cast<float>(channels);
+		for (unsigned int i = 0; i < accepted; ++i, samples += channels)
+		{
+			float sum = 0.0f;
+			for (unsigned int c = 0; c < channels; ++c)
+				sum += samples[c];
+			audioRing[(head + i) & (AUDIO_RING_SAMPLES - 1)] = sum * scale;
+		}
+	}
+	else
+	{
+		const int16_t *samples = static_cast<const int16_t *>(pSamples);
+		float scale = 1.0f / (32768.0f * static_cast<float>(channels));
+		for (unsigned int i = 0; i < accepted; ++i, samples += channels)
+		{
+			int sum = 0;
+			for (unsigned int c = 0; c < channels; ++c)
+				sum += samples[c];
+			audioRing[(head + i) & (AUDIO_RING_SAMPLES - 1)] = static_cast<float>(sum) * scale;
+		}
+	}
+	audioRingHead.store(head + accepted, std::memory_order_release);
+	audioSamplesIn.fetch_add(accepted, std::memory_order_relaxed);
+	if (accepted < frameCount)
+		audioSamplesDropped.fetch_add(frameCount - accepted, std::memory_order_relaxed);
+	return accepted == frameCount;
+}
+
+// Runs one lighting update on the calling thread, so recordings can be played through the stage offline and
+// deterministically. Fails while the stage thread runs.
+NVAPI_DLL bool StepAudioReactive()
+{
+	std::lock_guard<std::mutex> lock(audioLock);
+	if (audioRunning.load() || !audioConfigured)
+		return false;
+	audioTick();
+	return true;
+}
+
+NVAPI_DLL void GetAudioReactiveStats(AudioReactiveStats *pStats)
+{
+	if (!pStats)
+		return;
+	std::lock_guard<std::mutex> lock(audioLock);
+	*pStats = audioStats;
+	pStats->samples = audioSamplesIn.load(std::memory_order_relaxed);
+	pStats->dropped = audioSamplesDropped.load(std::memory_order_relaxed);
+}
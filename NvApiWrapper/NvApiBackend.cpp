@@ -0,0 +1,615 @@
+#include "pch.h"
+#include "NvApiBackend.h"
+#include "NvApiPerf.h"
+#include <vector>
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+#ifdef _WIN32
+const NvApiBackend driverBackend = {
+	NvAPI_Initialize,
+	NvAPI_Unload,
+	NvAPI_GetErrorMessage,
+	NvAPI_GetInterfaceVersionString,
+	NvAPI_SYS_GetDriverAndBranchVersion,
+	NvAPI_EnumPhysicalGPUs,
+	NvAPI_GPU_GetFullName,
+	NvAPI_GPU_GetGPUInfo,
+	NvAPI_GPU_GetSystemType,
+	NvAPI_GPU_GetPCIIdentifiers,
+	NvAPI_GPU_GetBusId,
+	NvAPI_GPU_ClientIllumZonesGetInfo,
+	NvAPI_GPU_ClientIllumZonesGetControl,
+	NvAPI_GPU_ClientIllumZonesSetControl,
+	NvAPI_GPU_GetThermalSettings,
+	NvAPI_GPU_GetDynamicPstatesInfoEx,
+};
+#define DEFAULT_NVAPI_BACKEND driverBackend
+#else
+// no driver outside Windows, everything runs against the emulator
+#define DEFAULT_NVAPI_BACKEND emulatorBackend
+#endif
+
+static std::atomic<const NvApiBackend *> activeBackend{&DEFAULT_NVAPI_BACKEND};
+
+#if NVAPI_PERF_COUNTERS
+// Times every call on its way to the active backend, so the counters cover the driver, emulator and replay alike
+
+#define PERF_TIMED_CALL(call, invocation)                                 \
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(); \
+	NvAPI_Status status = activeBackend.load()->invocation;               \
+	perfRecordCall(call, status, start);                                  \
+	return status;
+
+static NvAPI_Status perfInitialize()
+{
+	PERF_TIMED_CALL(NVAPI_CALL_INITIALIZE, Initialize());
+}
+static NvAPI_Status perfUnload()
+{
+	PERF_TIMED_CALL(NVAPI_CALL_UNLOAD, Unload());
+}
+static NvAPI_Status perfGetErrorMessage(NvAPI_Status errorStatus, NvAPI_ShortString message)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_GET_ERROR_MESSAGE, GetErrorMessage(errorStatus, message));
+}
+static NvAPI_Status perfGetInterfaceVersionString(NvAPI_ShortString version)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_GET_INTERFACE_VERSION_STRING, GetInterfaceVersionString(version));
+}
+static NvAPI_Status perfGetDriverAndBranchVersion(NvU32 *pDriverVersion, NvAPI_ShortString buildBranch)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_GET_DRIVER_AND_BRANCH_VERSION, SYS_GetDriverAndBranchVersion(pDriverVersion, buildBranch));
+}
+static NvAPI_Status perfEnumPhysicalGPUs(NvPhysicalGpuHandle gpuHandles[NVAPI_MAX_PHYSICAL_GPUS], NvU32 *pGpuCount)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_ENUM_PHYSICAL_GPUS, EnumPhysicalGPUs(gpuHandles, pGpuCount));
+}
+static NvAPI_Status perfGetFullName(NvPhysicalGpuHandle gpuHandle, NvAPI_ShortString name)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_GET_FULL_NAME, GPU_GetFullName(gpuHandle, name));
+}
+static NvAPI_Status perfGetGPUInfo(NvPhysicalGpuHandle gpuHandle, NV_GPU_INFO *pGpuInfo)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_GET_GPU_INFO, GPU_GetGPUInfo(gpuHandle, pGpuInfo));
+}
+static NvAPI_Status perfGetSystemType(NvPhysicalGpuHandle gpuHandle, NV_SYSTEM_TYPE *pSystemType)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_GET_SYSTEM_TYPE, GPU_GetSystemType(gpuHandle, pSystemType));
+}
+static NvAPI_Status perfGetPCIIdentifiers(NvPhysicalGpuHandle gpuHandle, NvU32 *pDeviceId, NvU32 *pSubSystemId, NvU32 *pRevisionId, NvU32 *pExtDeviceId)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_GET_PCI_IDENTIFIERS, GPU_GetPCIIdentifiers(gpuHandle, pDeviceId, pSubSystemId, pRevisionId, pExtDeviceId));
+}
+static NvAPI_Status perfGetBusId(NvPhysicalGpuHandle gpuHandle, NvU32 *pBusId)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_GET_BUS_ID, GPU_GetBusId(gpuHandle, pBusId));
+}
+static NvAPI_Status perfIllumZonesGetInfo(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS *pParams)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_ILLUM_ZONES_GET_INFO, GPU_ClientIllumZonesGetInfo(gpuHandle, pParams));
+}
+static NvAPI_Status perfIllumZonesGetControl(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_ILLUM_ZONES_GET_CONTROL, GPU_ClientIllumZonesGetControl(gpuHandle, pParams));
+}
+static NvAPI_Status perfIllumZonesSetControl(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_ILLUM_ZONES_SET_CONTROL, GPU_ClientIllumZonesSetControl(gpuHandle, pParams));
+}
+static NvAPI_Status perfGetThermalSettings(NvPhysicalGpuHandle gpuHandle, NvU32 sensorIndex, NV_GPU_THERMAL_SETTINGS *pThermalSettings)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_GET_THERMAL_SETTINGS, GPU_GetThermalSettings(gpuHandle, sensorIndex, pThermalSettings));
+}
+static NvAPI_Status perfGetDynamicPstatesInfoEx(NvPhysicalGpuHandle gpuHandle, NV_GPU_DYNAMIC_PSTATES_INFO_EX *pDynamicPstatesInfoEx)
+{
+	PERF_TIMED_CALL(NVAPI_CALL_GET_DYNAMIC_PSTATES_INFO_EX, GPU_GetDynamicPstatesInfoEx(gpuHandle, pDynamicPstatesInfoEx));
+}
+
+static const NvApiBackend perfBackend = {
+	perfInitialize,
+	perfUnload,
+	perfGetErrorMessage,
+	perfGetInterfaceVersionString,
+	perfGetDriverAndBranchVersion,
+	perfEnumPhysicalGPUs,
+	perfGetFullName,
+	perfGetGPUInfo,
+	perfGetSystemType,
+	perfGetPCIIdentifiers,
+	perfGetBusId,
+	perfIllumZonesGetInfo,
+	perfIllumZonesGetControl,
+	perfIllumZonesSetControl,
+	perfGetThermalSettings,
+	perfGetDynamicPstatesInfoEx,
+};
+
+const NvApiBackend &nvapi()
+{
+	return perfBackend;
+}
+#else
+const NvApiBackend &nvapi()
+{
+	return *activeBackend.load();
+}
+#endif
+
+bool nvapiIsDriverBackend()
+{
+#ifdef _WIN32
+	return activeBackend.load() == &driverBackend;
+#else
+	return false;
+#endif
+}
+
+// Handles of one backend mean nothing to another, so everything cached from the old backend has to go once a new one is
+// published. Never call this with traceLock held: it takes the handle cache and shadow locks, and exports holding those
+// enter recordCall.
+static void dropBackendState()
+{
+	InvalidateGPUHandleCache();
+	InvalidateIlluminationShadow(NVAPI_MAX_PHYSICAL_GPUS);
+}
+
+static FILE *openTraceFile(const char *path, const char *mode)
+{
+#ifdef _WIN32
+	FILE *file = nullptr;
+	return fopen_s(&file, path, mode) == 0 ? file : nullptr;
+#else
+	return fopen(path, mode);
+#endif
+}
+
+// Trace format: "NVTR", version, then one record per call. A record is the call id, its status, the index of the GPU
+// the handle referred to (TRACE_NO_GPU for global calls) and the call's output, which is only stored on success.
+// SetControl stores its input instead so traces can be inspected.
+static const char traceMagic[4] = {'N', 'V', 'T', 'R'};
+static const uint32_t traceVersion = 1;
+static const uint32_t TRACE_NO_GPU = 0xFFFFFFFFu;
+struct TraceRecordHeader
+{
+	uint32_t call;
+	int32_t status;
+	uint32_t gpuIndex;
+	uint32_t payloadSize;
+};
+
+// Recording wraps whatever backend was active when the recording started
+
+static std::mutex traceLock;
+static FILE *traceFile = nullptr;
+static const NvApiBackend *recordedBackend = nullptr;
+static NvPhysicalGpuHandle traceHandles[NVAPI_MAX_PHYSICAL_GPUS] = {0};
+static NvU32 traceHandleCount = 0;
+
+static uint32_t traceGpuIndex(NvPhysicalGpuHandle gpuHandle)
+{
+	for (NvU32 i = 0; i < traceHandleCount; ++i)
+		if (traceHandles[i] == gpuHandle)
+			return i;
+	return TRACE_NO_GPU;
+}
+
+static NvAPI_Status recordCall(NvApiCall call, NvAPI_Status status, uint32_t gpuIndex, const void *pPayload, size_t payloadSize)
+{
+	std::lock_guard<std::mutex> lock(traceLock);
+	if (!traceFile)
+		return status;
+	if (status != NVAPI_OK && call != NVAPI_CALL_ILLUM_ZONES_SET_CONTROL)
+		payloadSize = 0;
+	TraceRecordHeader header = {static_cast<uint32_t>(call), static_cast<int32_t>(status), gpuIndex, static_cast<uint32_t>(payloadSize)};
+	fwrite(&header, sizeof(header), 1, traceFile);
+	if (payloadSize)
+		fwrite(pPayload, payloadSize, 1, traceFile);
+	return status;
+}
+
+static NvAPI_Status traceInitialize()
+{
+	return recordCall(NVAPI_CALL_INITIALIZE, recordedBackend->Initialize(), TRACE_NO_GPU, nullptr, 0);
+}
+static NvAPI_Status traceUnload()
+{
+	return recordCall(NVAPI_CALL_UNLOAD, recordedBackend->Unload(), TRACE_NO_GPU, nullptr, 0);
+}
+static NvAPI_Status traceGetErrorMessage(NvAPI_Status status, NvAPI_ShortString message)
+{
+	return recordCall(NVAPI_CALL_GET_ERROR_MESSAGE, recordedBackend->GetErrorMessage(status, message), TRACE_NO_GPU, message, sizeof(NvAPI_ShortString));
+}
+static NvAPI_Status traceGetInterfaceVersionString(NvAPI_ShortString version)
+{
+	return recordCall(NVAPI_CALL_GET_INTERFACE_VERSION_STRING, recordedBackend->GetInterfaceVersionString(version), TRACE_NO_GPU, version, sizeof(NvAPI_ShortString));
+}
+struct TraceDriverVersion
+{
+	NvU32 driverVersion;
+	NvAPI_ShortString buildBranch;
+};
+static NvAPI_Status traceGetDriverAndBranchVersion(NvU32 *pDriverVersion, NvAPI_ShortString buildBranch)
+{
+	NvAPI_Status status = recordedBackend->SYS_GetDriverAndBranchVersion(pDriverVersion, buildBranch);
+	TraceDriverVersion payload = {0};
+	if (status == NVAPI_OK)
+	{
+		payload.driverVersion = *pDriverVersion;
+		memcpy(payload.buildBranch, buildBranch, sizeof(payload.buildBranch));
+	}
+	return recordCall(NVAPI_CALL_GET_DRIVER_AND_BRANCH_VERSION, status, TRACE_NO_GPU, &payload, sizeof(payload));
+}
+static NvAPI_Status traceEnumPhysicalGPUs(NvPhysicalGpuHandle gpuHandles[NVAPI_MAX_PHYSICAL_GPUS], NvU32 *pGpuCount)
+{
+	NvAPI_Status status = recordedBackend->EnumPhysicalGPUs(gpuHandles, pGpuCount);
+	if (status == NVAPI_OK)
+	{
+		// remember the handle order so later records can refer to GPUs by index
+		std::lock_guard<std::mutex> lock(traceLock);
+		traceHandleCount = *pGpuCount;
+		memcpy(traceHandles, gpuHandles, sizeof(NvPhysicalGpuHandle) * traceHandleCount);
+	}
+	return recordCall(NVAPI_CALL_ENUM_PHYSICAL_GPUS, status, TRACE_NO_GPU, pGpuCount, sizeof(NvU32));
+}
+static NvAPI_Status traceGetFullName(NvPhysicalGpuHandle gpuHandle, NvAPI_ShortString name)
+{
+	return recordCall(NVAPI_CALL_GET_FULL_NAME, recordedBackend->GPU_GetFullName(gpuHandle, name), traceGpuIndex(gpuHandle), name, sizeof(NvAPI_ShortString));
+}
+static NvAPI_Status traceGetGPUInfo(NvPhysicalGpuHandle gpuHandle, NV_GPU_INFO *pGpuInfo)
+{
+	return recordCall(NVAPI_CALL_GET_GPU_INFO, recordedBackend->GPU_GetGPUInfo(gpuHandle, pGpuInfo), traceGpuIndex(gpuHandle), pGpuInfo, sizeof(*pGpuInfo));
+}
+static NvAPI_Status traceGetSystemType(NvPhysicalGpuHandle gpuHandle, NV_SYSTEM_TYPE *pSystemType)
+{
+	return recordCall(NVAPI_CALL_GET_SYSTEM_TYPE, recordedBackend->GPU_GetSystemType(gpuHandle, pSystemType), traceGpuIndex(gpuHandle), pSystemType, sizeof(*pSystemType));
+}
+static NvAPI_Status traceGetPCIIdentifiers(NvPhysicalGpuHandle gpuHandle, NvU32 *pDeviceId, NvU32 *pSubSystemId, NvU32 *pRevisionId, NvU32 *pExtDeviceId)
+{
+	NvAPI_Status status = recordedBackend->GPU_GetPCIIdentifiers(gpuHandle, pDeviceId, pSubSystemId, pRevisionId, pExtDeviceId);
+	NvU32 payload[4] = {0};
+	if (status == NVAPI_OK)
+	{
+		payload[0] = *pDeviceId;
+		payload[1] = *pSubSystemId;
+		payload[2] = *pRevisionId;
+		payload[3] = *pExtDeviceId;
+	}
+	return recordCall(NVAPI_CALL_GET_PCI_IDENTIFIERS, status, traceGpuIndex(gpuHandle), payload, sizeof(payload));
+}
+static NvAPI_Status traceGetBusId(NvPhysicalGpuHandle gpuHandle, NvU32 *pBusId)
+{
+	return recordCall(NVAPI_CALL_GET_BUS_ID, recordedBackend->GPU_GetBusId(gpuHandle, pBusId), traceGpuIndex(gpuHandle), pBusId, sizeof(*pBusId));
+}
+static NvAPI_Status traceIllumZonesGetInfo(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS *pParams)
+{
+	return recordCall(NVAPI_CALL_ILLUM_ZONES_GET_INFO, recordedBackend->GPU_ClientIllumZonesGetInfo(gpuHandle, pParams), traceGpuIndex(gpuHandle), pParams, sizeof(*pParams));
+}
+static NvAPI_Status traceIllumZonesGetControl(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams)
+{
+	return recordCall(NVAPI_CALL_ILLUM_ZONES_GET_CONTROL, recordedBackend->GPU_ClientIllumZonesGetControl(gpuHandle, pParams), traceGpuIndex(gpuHandle), pParams, sizeof(*pParams));
+}
+static NvAPI_Status traceIllumZonesSetControl(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams)
+{
+	return recordCall(NVAPI_CALL_ILLUM_ZONES_SET_CONTROL, recordedBackend->GPU_ClientIllumZonesSetControl(gpuHandle, pParams), traceGpuIndex(gpuHandle), pParams, sizeof(*pParams));
+}
+static NvAPI_Status traceGetThermalSettings(NvPhysicalGpuHandle gpuHandle, NvU32 sensorIndex, NV_GPU_THERMAL_SETTINGS *pThermalSettings)
+{
+	return recordCall(NVAPI_CALL_GET_THERMAL_SETTINGS, recordedBackend->GPU_GetThermalSettings(gpuHandle, sensorIndex, pThermalSettings), traceGpuIndex(gpuHandle), pThermalSettings, sizeof(*pThermalSettings));
+}
+static NvAPI_Status traceGetDynamicPstatesInfoEx(NvPhysicalGpuHandle gpuHandle, NV_GPU_DYNAMIC_PSTATES_INFO_EX *pDynamicPstatesInfoEx)
+{
+	return recordCall(NVAPI_CALL_GET_DYNAMIC_PSTATES_INFO_EX, recordedBackend->GPU_GetDynamicPstatesInfoEx(gpuHandle, pDynamicPstatesInfoEx), traceGpuIndex(gpuHandle), pDynamicPstatesInfoEx, sizeof(*pDynamicPstatesInfoEx));
+}
+
+static const NvApiBackend traceBackend = {
+	traceInitialize,
+	traceUnload,
+	traceGetErrorMessage,
+	traceGetInterfaceVersionString,
+	traceGetDriverAndBranchVersion,
+	traceEnumPhysicalGPUs,
+	traceGetFullName,
+	traceGetGPUInfo,
+	traceGetSystemType,
+	traceGetPCIIdentifiers,
+	traceGetBusId,
+	traceIllumZonesGetInfo,
+	traceIllumZonesGetControl,
+	traceIllumZonesSetControl,
+	traceGetThermalSettings,
+	traceGetDynamicPstatesInfoEx,
+};
+
+// Replay answers every call from a recorded trace. Records are consumed in order per GPU, so calls on different GPUs
+// may interleave differently than during the recording without derailing the replay. SetControl has to write exactly
+// what was recorded, so a wrapper that computes different zone state fails the replay instead of passing it.
+
+struct ReplayRecord
+{
+	TraceRecordHeader header;
+	std::vector<uint8_t> payload;
+};
+struct ReplayStream
+{
+	std::vector<size_t> records;
+	size_t cursor;
+};
+static std::mutex replayLock;
+static std::vector<ReplayRecord> replayRecords;
+static ReplayStream replayGlobalStream;
+static ReplayStream replayGpuStreams[NVAPI_MAX_PHYSICAL_GPUS];
+static char replayHandleSlots[NVAPI_MAX_PHYSICAL_GPUS]; // replay handles point into this array
+
+static uint32_t replayGpuIndex(NvPhysicalGpuHandle gpuHandle)
+{
+	const char *slot = reinterpret_cast<const char *>(gpuHandle);
+	if (slot < replayHandleSlots || slot >= replayHandleSlots + NVAPI_MAX_PHYSICAL_GPUS)
+		return TRACE_NO_GPU;
+	return static_cast<uint32_t>(slot - replayHandleSlots);
+}
+
+static NvAPI_Status replayCall(NvApiCall call, uint32_t gpuIndex, void *pOutput, size_t outputSize)
+{
+	std::lock_guard<std::mutex> lock(replayLock);
+	ReplayStream &stream = gpuIndex == TRACE_NO_GPU ? replayGlobalStream : replayGpuStreams[gpuIndex];
+	if (stream.cursor >= stream.records.size())
+		return NVAPI_ERROR; // the wrapper made more calls than the trace holds
+	const ReplayRecord &record = replayRecords[stream.records[stream.cursor++]];
+	if (record.header.call != static_cast<uint32_t>(call))
+		return NVAPI_ERROR; // the wrapper diverged from the recorded call sequence
+	NvAPI_Status status = static_cast<NvAPI_Status>(record.header.status);
+	if (call == NVAPI_CALL_ILLUM_ZONES_SET_CONTROL)
+	{
+		if (record.payload.size() != outputSize || memcmp(pOutput, record.payload.data(), outputSize) != 0)
+			return NVAPI_ERROR; // the wrapper wrote different zone state than during the recording
+		return status;
+	}
+	if (status == NVAPI_OK && pOutput)
+	{
+		if (record.payload.size() != outputSize)
+			return NVAPI_INCOMPATIBLE_STRUCT_VERSION;
+		memcpy(pOutput, record.payload.data(), outputSize);
+	}
+	return status;
+}
+
+static NvAPI_Status replayInitialize()
+{
+	return replayCall(NVAPI_CALL_INITIALIZE, TRACE_NO_GPU, nullptr, 0);
+}
+static NvAPI_Status replayUnload()
+{
+	return replayCall(NVAPI_CALL_UNLOAD, TRACE_NO_GPU, nullptr, 0);
+}
+static NvAPI_Status replayGetErrorMessage(NvAPI_Status, NvAPI_ShortString message)
+{
+	return replayCall(NVAPI_CALL_GET_ERROR_MESSAGE, TRACE_NO_GPU, message, sizeof(NvAPI_ShortString));
+}
+static NvAPI_Status replayGetInterfaceVersionString(NvAPI_ShortString version)
+{
+	return replayCall(NVAPI_CALL_GET_INTERFACE_VERSION_STRING, TRACE_NO_GPU, version, sizeof(NvAPI_ShortString));
+}
+static NvAPI_Status replayGetDriverAndBranchVersion(NvU32 *pDriverVersion, NvAPI_ShortString buildBranch)
+{
+	TraceDriverVersion payload;
+	NvAPI_Status status = replayCall(NVAPI_CALL_GET_DRIVER_AND_BRANCH_VERSION, TRACE_NO_GPU, &payload, sizeof(payload));
+	if (status == NVAPI_OK)
+	{
+		*pDriverVersion = payload.driverVersion;
+		memcpy(buildBranch, payload.buildBranch, sizeof(payload.buildBranch));
+	}
+	return status;
+}
+static NvAPI_Status replayEnumPhysicalGPUs(NvPhysicalGpuHandle gpuHandles[NVAPI_MAX_PHYSICAL_GPUS], NvU32 *pGpuCount)
+{
+	NvU32 gpuCount = 0;
+	NvAPI_Status status = replayCall(NVAPI_CALL_ENUM_PHYSICAL_GPUS, TRACE_NO_GPU, &gpuCount, sizeof(gpuCount));
+	if (status != NVAPI_OK)
+		return status;
+	if (gpuCount > NVAPI_MAX_PHYSICAL_GPUS)
+		return NVAPI_ERROR;
+	for (NvU32 i = 0; i < gpuCount; ++i)
+		gpuHandles[i] = reinterpret_cast<NvPhysicalGpuHandle>(&replayHandleSlots[i]);
+	*pGpuCount = gpuCount;
+	return NVAPI_OK;
+}
+
+// handle based calls fail like the driver does when handed a handle the trace never enumerated
+#define REPLAY_GPU_INDEX(gpuHandle)          \
+	uint32_t gpuIndex = replayGpuIndex(gpuHandle); \
+	if (gpuIndex == TRACE_NO_GPU)            \
+		return NVAPI_INVALID_HANDLE;
+
+static NvAPI_Status replayGetFullName(NvPhysicalGpuHandle gpuHandle, NvAPI_ShortString name)
+{
+	REPLAY_GPU_INDEX(gpuHandle);
+	return replayCall(NVAPI_CALL_GET_FULL_NAME, gpuIndex, name, sizeof(NvAPI_ShortString));
+}
+static NvAPI_Status replayGetGPUInfo(NvPhysicalGpuHandle gpuHandle, NV_GPU_INFO *pGpuInfo)
+{
+	REPLAY_GPU_INDEX(gpuHandle);
+	return replayCall(NVAPI_CALL_GET_GPU_INFO, gpuIndex, pGpuInfo, sizeof(*pGpuInfo));
+}
+static NvAPI_Status replayGetSystemType(NvPhysicalGpuHandle gpuHandle, NV_SYSTEM_TYPE *pSystemType)
+{
+	REPLAY_GPU_INDEX(gpuHandle);
+	return replayCall(NVAPI_CALL_GET_SYSTEM_TYPE, gpuIndex, pSystemType, sizeof(*pSystemType));
+}
+static NvAPI_Status replayGetPCIIdentifiers(NvPhysicalGpuHandle gpuHandle, NvU32 *pDeviceId, NvU32 *pSubSystemId, NvU32 *pRevisionId, NvU32 *pExtDeviceId)
+{
+	REPLAY_GPU_INDEX(gpuHandle);
+	NvU32 payload[4];
+	NvAPI_Status status = replayCall(NVAPI_CALL_GET_PCI_IDENTIFIERS, gpuIndex, payload, sizeof(payload));
+	if (status == NVAPI_OK)
+	{
+		*pDeviceId = payload[0];
+		*pSubSystemId = payload[1];
+		*pRevisionId = payload[2];
+		*pExtDeviceId = payload[3];
+	}
+	return status;
+}
+static NvAPI_Status replayGetBusId(NvPhysicalGpuHandle gpuHandle, NvU32 *pBusId)
+{
+	REPLAY_GPU_INDEX(gpuHandle);
+	return replayCall(NVAPI_CALL_GET_BUS_ID, gpuIndex, pBusId, sizeof(*pBusId));
+}
+static NvAPI_Status replayIllumZonesGetInfo(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS *pParams)
+{
+	REPLAY_GPU_INDEX(gpuHandle);
+	return replayCall(NVAPI_CALL_ILLUM_ZONES_GET_INFO, gpuIndex, pParams, sizeof(*pParams));
+}
+static NvAPI_Status replayIllumZonesGetControl(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams)
+{
+	REPLAY_GPU_INDEX(gpuHandle);
+	return replayCall(NVAPI_CALL_ILLUM_ZONES_GET_CONTROL, gpuIndex, pParams, sizeof(*pParams));
+}
+static NvAPI_Status replayIllumZonesSetControl(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams)
+{
+	REPLAY_GPU_INDEX(gpuHandle);
+	return replayCall(NVAPI_CALL_ILLUM_ZONES_SET_CONTROL, gpuIndex, pParams, sizeof(*pParams));
+}
+static NvAPI_Status replayGetThermalSettings(NvPhysicalGpuHandle gpuHandle, NvU32, NV_GPU_THERMAL_SETTINGS *pThermalSettings)
+{
+	REPLAY_GPU_INDEX(gpuHandle);
+	return replayCall(NVAPI_CALL_GET_THERMAL_SETTINGS, gpuIndex, pThermalSettings, sizeof(*pThermalSettings));
+}
+static NvAPI_Status replayGetDynamicPstatesInfoEx(NvPhysicalGpuHandle gpuHandle, NV_GPU_DYNAMIC_PSTATES_INFO_EX *pDynamicPstatesInfoEx)
+{
+	REPLAY_GPU_INDEX(gpuHandle);
+	return replayCall(NVAPI_CALL_GET_DYNAMIC_PSTATES_INFO_EX, gpuIndex, pDynamicPstatesInfoEx, sizeof(*pDynamicPstatesInfoEx));
+}
+
+static const NvApiBackend replayBackend = {
+	replayInitialize,
+	replayUnload,
+	replayGetErrorMessage,
+	replayGetInterfaceVersionString,
+	replayGetDriverAndBranchVersion,
+	replayEnumPhysicalGPUs,
+	replayGetFullName,
+	replayGetGPUInfo,
+	replayGetSystemType,
+	replayGetPCIIdentifiers,
+	replayGetBusId,
+	replayIllumZonesGetInfo,
+	replayIllumZonesGetControl,
+	replayIllumZonesSetControl,
+	replayGetThermalSettings,
+	replayGetDynamicPstatesInfoEx,
+};
+
+NVAPI_DLL bool SetNvApiBackend(unsigned int backend)
+{
+	const NvApiBackend *pBackend = nullptr;
+	switch (backend)
+	{
+#ifdef _WIN32
+	case NVAPI_BACKEND_DRIVER:
+		pBackend = &driverBackend;
+		break;
+#endif
+	case NVAPI_BACKEND_EMULATOR:
+		pBackend = &emulatorBackend;
+		break;
+	default:
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> lock(traceLock);
+		if (traceFile)
+			return false; // stop the recording first, it holds on to the backend it wraps
+		activeBackend = pBackend;
+	}
+	dropBackendState();
+	return true;
+}
+
+NVAPI_DLL bool StartNvApiTraceRecording(const char *path)
+{
+	if (!path)
+		return false;
+	{
+		std::lock_guard<std::mutex> lock(traceLock);
+		if (traceFile)
+			return false;
+		traceFile = openTraceFile(path, "wb");
+		if (!traceFile)
+			return false;
+		fwrite(traceMagic, sizeof(traceMagic), 1, traceFile);
+		fwrite(&traceVersion, sizeof(traceVersion), 1, traceFile);
+		recordedBackend = activeBackend.load();
+		traceHandleCount = 0;
+		activeBackend = &traceBackend;
+	}
+	// start from an empty handle cache so the enumeration that maps handles to indices is part of the trace
+	dropBackendState();
+	return true;
+}
+
+NVAPI_DLL bool StopNvApiTraceRecording()
+{
+	std::lock_guard<std::mutex> lock(traceLock);
+	if (!traceFile)
+		return false;
+	activeBackend = recordedBackend;
+	fclose(traceFile);
+	traceFile = nullptr;
+	return true;
+}
+
+NVAPI_DLL bool LoadNvApiTraceReplay(const char *path)
+{
+	if (!path)
+		return false;
+	FILE *file = openTraceFile(path, "rb");
+	if (!file)
+		return false;
+
+	char magic[4] = {0};
+	uint32_t version = 0;
+	bool valid = fread(magic, sizeof(magic), 1, file) == 1 && fread(&version, sizeof(version), 1, file) == 1 &&
+				 memcmp(magic, traceMagic, sizeof(magic)) == 0 && version == traceVersion;
+	std::vector<ReplayRecord> records;
+	TraceRecordHeader header;
+	while (valid && fread(&header, sizeof(header), 1, file) == 1)
+	{
+		if (header.call >= NVAPI_CALL_COUNT || (header.gpuIndex != TRACE_NO_GPU && header.gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS) ||
+			header.payloadSize > sizeof(NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS))
+		{
+			valid = false;
+			break;
+		}
+		ReplayRecord record = {header, std::vector<uint8_t>(header.payloadSize)};
+		if (header.payloadSize && fread(record.payload.data(), header.payloadSize, 1, file) != 1)
+		{
+			valid = false;
+			break;
+		}
+		records.push_back(std::move(record));
+	}
+	fclose(file);
+	if (!valid)
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(replayLock);
+		replayRecords = std::move(records);
+		replayGlobalStream = {};
+		for (auto &stream : replayGpuStreams)
+			stream = {};
+		for (size_t i = 0; i < replayRecords.size(); ++i)
+		{
+			uint32_t gpuIndex = replayRecords[i].header.gpuIndex;
+			(gpuIndex == TRACE_NO_GPU ? replayGlobalStream : replayGpuStreams[gpuIndex]).records.push_back(i);
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(traceLock);
+		if (traceFile)
+			return false;
+		activeBackend = &replayBackend;
+	}
+	dropBackendState();
+	return true;
+}
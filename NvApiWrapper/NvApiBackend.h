@@ -0,0 +1,34 @@
+#pragma once
+#include "NvApiDll.h"
+
+// Function table for every NvAPI entry point the wrapper uses. NvApiDll.cpp only ever calls through nvapi(), so the
+// driver can be swapped for the emulator, or wrapped by the trace recorder, without touching the wrapper logic.
+struct NvApiBackend
+{
+	NvAPI_Status (*Initialize)();
+	NvAPI_Status (*Unload)();
+	NvAPI_Status (*GetErrorMessage)(NvAPI_Status status, NvAPI_ShortString message);
+	NvAPI_Status (*GetInterfaceVersionString)(NvAPI_ShortString version);
+	NvAPI_Status (*SYS_GetDriverAndBranchVersion)(NvU32 *pDriverVersion, NvAPI_ShortString buildBranch);
+	NvAPI_Status (*EnumPhysicalGPUs)(NvPhysicalGpuHandle gpuHandles[NVAPI_MAX_PHYSICAL_GPUS], NvU32 *pGpuCount);
+	NvAPI_Status (*GPU_GetFullName)(NvPhysicalGpuHandle gpuHandle, NvAPI_ShortString name);
+	NvAPI_Status (*GPU_GetGPUInfo)(NvPhysicalGpuHandle gpuHandle, NV_GPU_INFO *pGpuInfo);
+	NvAPI_Status (*GPU_GetSystemType)(NvPhysicalGpuHandle gpuHandle, NV_SYSTEM_TYPE *pSystemType);
+	NvAPI_Status (*GPU_GetPCIIdentifiers)(NvPhysicalGpuHandle gpuHandle, NvU32 *pDeviceId, NvU32 *pSubSystemId, NvU32 *pRevisionId, NvU32 *pExtDeviceId);
+	NvAPI_Status (*GPU_GetBusId)(NvPhysicalGpuHandle gpuHandle, NvU32 *pBusId);
+	NvAPI_Status (*GPU_ClientIllumZonesGetInfo)(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS *pParams);
+	NvAPI_Status (*GPU_ClientIllumZonesGetControl)(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams);
+	NvAPI_Status (*GPU_ClientIllumZonesSetControl)(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams);
+	NvAPI_Status (*GPU_GetThermalSettings)(NvPhysicalGpuHandle gpuHandle, NvU32 sensorIndex, NV_GPU_THERMAL_SETTINGS *pThermalSettings);
+	NvAPI_Status (*GPU_GetDynamicPstatesInfoEx)(NvPhysicalGpuHandle gpuHandle, NV_GPU_DYNAMIC_PSTATES_INFO_EX *pDynamicPstatesInfoEx);
+};
+
+// Backend all wrapper calls currently go through
+const NvApiBackend &nvapi();
+// True when nvapi() talks to real hardware, used to skip the hardware settle delays elsewhere
+bool nvapiIsDriverBackend();
+
+#ifdef _WIN32
+extern const NvApiBackend driverBackend;
+#endif
+extern const NvApiBackend emulatorBackend;
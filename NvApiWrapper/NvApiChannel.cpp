@@ -0,0 +1,337 @@
+#include "pch.h"
+#include "NvApiDll.h"
+#include "NvApiChannel.h"
+#ifndef _WIN32
+#include <errno.h>
+#include <signal.h>
+#endif
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Owner side of the illumination channel. The process that opens the channel creates the shared memory ring and drains
+// it, either on its own thread every drainIntervalMs or when DrainIlluminationChannel is called. A drain takes at most
+// one lap of records, keeps only the last update of every zone and writes each GPU with one SetIlluminationZonesBatch,
+// so a producer flooding one zone costs the driver one write per drain however fast it pushes. Producers share the
+// mapping and may scribble over the header, so the owner keeps the ring geometry to itself and never reads it back.
+
+static_assert(sizeof(IlluminationChannelRecord) == sizeof(ZoneUpdate) + 2 * sizeof(uint32_t), "channel records carry a ZoneUpdate");
+
+static std::mutex channelLock;
+static std::condition_variable channelWake;
+static std::condition_variable channelExited;
+static bool channelOpen = false;
+static bool channelStopping = false;
+static bool channelThreadAlive = false;
+static unsigned int channelDrainIntervalMs = 0;
+static IlluminationChannelHeader *channelHeader = nullptr;
+static IlluminationChannelSlot *channelSlots = nullptr;
+static uint32_t channelCapacity = 0;
+static uint64_t channelDequeuePosition = 0; // published to the header, never read back from it
+static size_t channelMappedSize = 0;
+#ifdef _WIN32
+static HANDLE channelMapping = nullptr;
+#else
+static char channelName[256];
+#endif
+static IlluminationChannelStats channelStats = {0};
+
+// Last update of every zone seen by the current drain
+static ZoneUpdate channelPending[NVAPI_MAX_PHYSICAL_GPUS][NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+static uint32_t channelPendingMask[NVAPI_MAX_PHYSICAL_GPUS];
+
+static void unmapChannel()
+{
+#ifdef _WIN32
+	if (channelHeader)
+		UnmapViewOfFile(channelHeader);
+	if (channelMapping)
+		CloseHandle(channelMapping);
+	channelMapping = nullptr;
+#else
+	if (channelHeader)
+	{
+		munmap(channelHeader, channelMappedSize);
+		shm_unlink(channelName);
+	}
+#endif
+	channelHeader = nullptr;
+	channelSlots = nullptr;
+	channelCapacity = 0;
+	channelMappedSize = 0;
+}
+
+#ifndef _WIN32
+// True if name holds a ring whose owner is gone, since an owner that crashed never unlinks it. A ring that may still
+// belong to a live owner, one still being set up included, is not stale.
+static bool channelIsStale(const char *name)
+{
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return false;
+	bool stale = false;
+	struct stat info;
+	if (fstat(fd, &info) == 0 && info.st_size >= static_cast<off_t>(sizeof(IlluminationChannelHeader)))
+	{
+		void *view = mmap(nullptr, sizeof(IlluminationChannelHeader), PROT_READ, MAP_SHARED, fd, 0);
+		if (view != MAP_FAILED)
+		{
+			const IlluminationChannelHeader *pHeader = static_cast<const IlluminationChannelHeader *>(view);
+			if (pHeader->magic.load(std::memory_order_acquire) == ILLUMINATION_CHANNEL_MAGIC && pHeader->ownerProcessId)
+			{
+				pid_t owner = static_cast<pid_t>(pHeader->ownerProcessId);
+				stale = !pHeader->ownerOpen.load(std::memory_order_relaxed) || (kill(owner, 0) != 0 && errno == ESRCH);
+			}
+			munmap(view, sizeof(IlluminationChannelHeader));
+		}
+	}
+	close(fd);
+	return stale;
+}
+#endif
+
+static bool mapChannel(const char *name, size_t size)
+{
+	void *view = nullptr;
+#ifdef _WIN32
+	channelMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<unsigned long long>(size) >> 32),
+										static_cast<DWORD>(size), name);
+	// another owner already serves this name
+	if (!channelMapping || GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		if (channelMapping)
+			CloseHandle(channelMapping);
+		channelMapping = nullptr;
+		return false;
+	}
+	view = MapViewOfFile(channelMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, size);
+	if (!view)
+	{
+		CloseHandle(channelMapping);
+		channelMapping = nullptr;
+		return false;
+	}
+#else
+	if (strlen(name) >= sizeof(channelName))
+		return false;
+	strncpy_s(channelName, sizeof(channelName), name, _TRUNCATE);
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	// a ring left behind by an owner that crashed has nobody draining it and is replaced, a live owner keeps its name
+	if (fd < 0 && errno == EEXIST && channelIsStale(name))
+	{
+		shm_unlink(name);
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	}
+	if (fd < 0)
+		return false;
+	if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+	{
+		view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (view == MAP_FAILED)
+			view = nullptr;
+	}
+	close(fd);
+	if (!view)
+	{
+		shm_unlink(name);
+		return false;
+	}
+#endif
+	channelHeader = static_cast<IlluminationChannelHeader *>(view);
+	channelMappedSize = size;
+	return true;
+}
+
+// Moves every published record into channelPending, caller must hold channelLock. Returns the number of records read.
+static unsigned int drainChannelRecords()
+{
+	uint32_t capacity = channelCapacity;
+	uint64_t mask = capacity - 1;
+	uint64_t position = channelDequeuePosition;
+	unsigned int count = 0;
+	for (; count < capacity; ++count, ++position)
+	{
+		IlluminationChannelSlot &slot = channelSlots[position & mask];
+		if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+			break;
+		IlluminationChannelRecord record = slot.record;
+		slot.sequence.store(position + capacity, std::memory_order_release);
+
+		if (record.gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS || record.zoneIndex >= NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX || record.flags != 0)
+		{
+			channelStats.rejected++;
+			continue;
+		}
+		uint32_t zoneBit = 1u << record.zoneIndex;
+		if (channelPendingMask[record.gpuIndex] & zoneBit)
+			channelStats.coalesced++;
+		channelPendingMask[record.gpuIndex] |= zoneBit;
+		memcpy(&channelPending[record.gpuIndex][record.zoneIndex], &record.zoneIndex, sizeof(ZoneUpdate));
+	}
+	channelDequeuePosition = position;
+	channelHeader->dequeuePosition.store(position, std::memory_order_relaxed);
+	channelStats.received += count;
+	return count;
+}
+
+// One drain, caller must hold channelLock
+static unsigned int drainChannel()
+{
+	if (!channelHeader)
+		return 0;
+	unsigned int count = drainChannelRecords();
+	ZoneUpdate updates[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	for (unsigned int gpuIndex = 0; gpuIndex < NVAPI_MAX_PHYSICAL_GPUS; ++gpuIndex)
+	{
+		uint32_t mask = channelPendingMask[gpuIndex];
+		if (!mask)
+			continue;
+		channelPendingMask[gpuIndex] = 0;
+		unsigned int updateCount = 0;
+		for (; mask; mask &= mask - 1)
+		{
+#ifdef _MSC_VER
+			unsigned long zoneIndex;
+			_BitScanForward(&zoneIndex, mask);
+#else
+			unsigned int zoneIndex = static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+			updates[updateCount++] = channelPending[gpuIndex][zoneIndex];
+		}
+		channelStats.writes++;
+		if (!SetIlluminationZonesBatch(gpuIndex, updates, updateCount, false, nullptr))
+			channelStats.writeFailures++;
+	}
+	channelStats.dropped = channelHeader->dropped.load(std::memory_order_relaxed);
+	return count;
+}
+
+static void channelThread()
+{
+	std::unique_lock<std::mutex> lock(channelLock);
+	std::chrono::steady_clock::time_point nextDrain = std::chrono::steady_clock::now();
+	while (!channelStopping)
+	{
+		channelWake.wait_until(lock, nextDrain, []
+							   { return channelStopping; });
+		if (channelStopping)
+			break;
+		drainChannel();
+		nextDrain = std::chrono::steady_clock::now() + std::chrono::milliseconds(channelDrainIntervalMs);
+	}
+	channelThreadAlive = false;
+	channelExited.notify_all();
+}
+
+// Creates the channel other processes push zone updates into, capacity a power of two. With drainIntervalMs 0 nothing
+// drains it until DrainIlluminationChannel is called. One channel per process, and none may already exist under name.
+NVAPI_DLL bool OpenIlluminationChannel(const char *name, unsigned int capacity, unsigned int drainIntervalMs)
+{
+	if (!name || !*name || capacity < 2 || capacity > ILLUMINATION_CHANNEL_MAX_CAPACITY || (capacity & (capacity - 1)) != 0)
+		return false;
+	std::lock_guard<std::mutex> lock(channelLock);
+	if (channelOpen || !mapChannel(name, illuminationChannelSize(capacity)))
+		return false;
+
+	IlluminationChannelHeader *pHeader = channelHeader;
+	pHeader->version = ILLUMINATION_CHANNEL_VERSION;
+	pHeader->headerSize = sizeof(IlluminationChannelHeader);
+	pHeader->capacity = capacity;
+	pHeader->slotSize = sizeof(IlluminationChannelSlot);
+#ifdef _WIN32
+	pHeader->ownerProcessId = GetCurrentProcessId();
+#else
+	pHeader->ownerProcessId = static_cast<uint32_t>(getpid());
+#endif
+	pHeader->dropped.store(0, std::memory_order_relaxed);
+	pHeader->enqueuePosition.store(0, std::memory_order_relaxed);
+	pHeader->dequeuePosition.store(0, std::memory_order_relaxed);
+	channelSlots = reinterpret_cast<IlluminationChannelSlot *>(reinterpret_cast<uint8_t *>(pHeader) + sizeof(IlluminationChannelHeader));
+	channelCapacity = capacity;
+	channelDequeuePosition = 0;
+	for (uint32_t i = 0; i < capacity; ++i)
+		channelSlots[i].sequence.store(i, std::memory_order_relaxed);
+	pHeader->ownerOpen.store(1, std::memory_order_relaxed);
+	pHeader->magic.store(ILLUMINATION_CHANNEL_MAGIC, std::memory_order_release);
+
+	memset(channelPendingMask, 0, sizeof(channelPendingMask));
+	channelStats = {0};
+	channelDrainIntervalMs = drainIntervalMs;
+	channelStopping = false;
+	channelOpen = true;
+	if (drainIntervalMs)
+	{
+		channelThreadAlive = true;
+		// detached so process exit never trips over a joinable std::thread, CloseIlluminationChannel waits for it instead
+		std::thread(channelThread).detach();
+	}
+	return true;
+}
+
+// Stops the drain thread, applies what producers already published and removes the channel
+NVAPI_DLL void CloseIlluminationChannel()
+{
+	std::unique_lock<std::mutex> lock(channelLock);
+	if (!channelOpen)
+		return;
+	channelStopping = true;
+	channelWake.notify_all();
+	channelExited.wait(lock, []
+					   { return !channelThreadAlive; });
+	channelHeader->ownerOpen.store(0, std::memory_order_relaxed);
+	drainChannel();
+	unmapChannel();
+	channelOpen = false;
+}
+
+// Drains the channel on the calling thread, returns the number of records read
+NVAPI_DLL unsigned int DrainIlluminationChannel()
+{
+	std::lock_guard<std::mutex> lock(channelLock);
+	return drainChannel();
+}
+
+NVAPI_DLL void GetIlluminationChannelStats(IlluminationChannelStats *pStats)
+{
+	if (!pStats)
+		return;
+	std::lock_guard<std::mutex> lock(channelLock);
+	*pStats = channelStats;
+	if (channelHeader)
+		pStats->dropped = channelHeader->dropped.load(std::memory_order_relaxed);
+}
+
+// Producer exports for processes that load the wrapper anyway, they map the channel and never initialize NvAPI
+NVAPI_DLL IlluminationChannelProducer *ConnectIlluminationChannel(const char *name)
+{
+	if (!name)
+		return nullptr;
+	IlluminationChannelProducer *pProducer = new (std::nothrow) IlluminationChannelProducer();
+	if (pProducer && !connectIlluminationChannel(name, *pProducer))
+	{
+		delete pProducer;
+		pProducer = nullptr;
+	}
+	return pProducer;
+}
+
+NVAPI_DLL bool PushIlluminationChannelUpdate(IlluminationChannelProducer *pProducer, unsigned int gpuIndex, const ZoneUpdate *pUpdate)
+{
+	if (!pProducer || !pUpdate)
+		return false;
+	uint64_t position;
+	IlluminationChannelRecord *pRecord = beginIlluminationChannelPush(*pProducer, position);
+	if (!pRecord)
+		return false;
+	pRecord->gpuIndex = gpuIndex;
+	pRecord->flags = 0;
+	memcpy(&pRecord->zoneIndex, pUpdate, sizeof(ZoneUpdate));
+	commitIlluminationChannelPush(*pProducer, position);
+	return true;
+}
+
+NVAPI_DLL void DisconnectIlluminationChannel(IlluminationChannelProducer *pProducer)
+{
+	if (!pProducer)
+		return;
+	disconnectIlluminationChannel(*pProducer);
+	delete pProducer;
+}
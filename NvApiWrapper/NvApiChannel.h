@@ -0,0 +1,195 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Shared memory protocol of the illumination channel, see OpenIlluminationChannel. This header does not depend on
+// NvAPI or the wrapper, so other processes can include it and push zone updates without loading NvApiWrapper.dll.
+//
+// The mapping is an IlluminationChannelHeader followed by capacity slots, capacity a power of two. It is a bounded
+// multi producer single consumer ring in which every slot carries a sequence number:
+//	- a slot at position p is free for the producer that claims p when its sequence is p,
+//	- a producer claims p by advancing enqueuePosition from p to p + 1, fills the record in place and publishes it by
+//	  storing p + 1 into the sequence,
+//	- the owner reads the record once the sequence is dequeuePosition + 1 and frees the slot for the next lap by storing
+//	  dequeuePosition + capacity.
+// Pushing is a compare exchange and two stores, with no lock and no system call. A full ring fails the push instead of
+// waiting for the owner. A producer that dies between claiming and publishing a slot stalls the ring at that slot
+// until the owner reopens the channel.
+
+#define ILLUMINATION_CHANNEL_MAGIC 0x434C564Eu // "NVLC"
+#define ILLUMINATION_CHANNEL_VERSION 1
+// Most slots a channel can have
+#define ILLUMINATION_CHANNEL_MAX_CAPACITY (1u << 20)
+
+// One zone update, laid out like the wrapper's ZoneUpdate after the GPU index
+struct IlluminationChannelRecord
+{
+	uint32_t gpuIndex;
+	uint32_t flags; // reserved, 0
+	uint32_t zoneIndex;
+	uint32_t zoneType; // expected NV_GPU_CLIENT_ILLUM_ZONE_TYPE, 0 accepts any type
+	uint8_t r, g, b, w, brightness;
+	uint8_t padding[3];
+};
+
+struct IlluminationChannelSlot
+{
+	std::atomic<uint64_t> sequence;
+	IlluminationChannelRecord record;
+};
+
+// The owner stores magic last, a producer that sees it may use the rest. Positions sit on cache lines of their own so
+// producers claiming slots do not contend with the owner freeing them.
+struct IlluminationChannelHeader
+{
+	std::atomic<uint32_t> magic;
+	uint16_t version;
+	uint16_t headerSize; // slots start right after the header
+	uint32_t capacity;
+	uint32_t slotSize;
+	std::atomic<uint32_t> ownerOpen; // cleared when the owner closes the channel
+	uint32_t ownerProcessId;		 // lets a new owner tell a ring left by a crashed owner from a live one
+	std::atomic<uint64_t> dropped; // pushes that found the ring full
+	alignas(64) std::atomic<uint64_t> enqueuePosition;
+	alignas(64) std::atomic<uint64_t> dequeuePosition;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory atomics must not fall back to a process local lock");
+static_assert(sizeof(IlluminationChannelSlot) == 32, "slot layout is part of the protocol");
+static_assert(sizeof(IlluminationChannelHeader) == 192, "header layout is part of the protocol");
+
+// Size of the mapping of a channel with capacity slots
+inline size_t illuminationChannelSize(uint32_t capacity)
+{
+	return sizeof(IlluminationChannelHeader) + static_cast<size_t>(capacity) * sizeof(IlluminationChannelSlot);
+}
+
+inline IlluminationChannelSlot *illuminationChannelSlots(IlluminationChannelHeader *pHeader)
+{
+	return reinterpret_cast<IlluminationChannelSlot *>(reinterpret_cast<uint8_t *>(pHeader) + pHeader->headerSize);
+}
+
+// Producer side of one mapped channel
+struct IlluminationChannelProducer
+{
+	IlluminationChannelHeader *header;
+	IlluminationChannelSlot *slots;
+	size_t mappedSize;
+};
+
+inline void disconnectIlluminationChannel(IlluminationChannelProducer &producer)
+{
+	if (producer.header)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(producer.header);
+#else
+		munmap(producer.header, producer.mappedSize);
+#endif
+	}
+	producer = {nullptr, nullptr, 0};
+}
+
+// Maps the channel the owner created under name, false if there is none or it speaks another version. On Windows name
+// is a kernel object name such as Local\NvApiLighting, elsewhere a shm_open name such as /NvApiLighting.
+inline bool connectIlluminationChannel(const char *name, IlluminationChannelProducer &producer)
+{
+	producer = {nullptr, nullptr, 0};
+	void *view = nullptr;
+	size_t mappedSize = 0;
+#ifdef _WIN32
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, name);
+	if (!mapping)
+		return false;
+	// the view keeps the mapping alive once mapped
+	view = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!view)
+		return false;
+	MEMORY_BASIC_INFORMATION region;
+	mappedSize = VirtualQuery(view, &region, sizeof(region)) ? region.RegionSize : 0;
+#else
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	if (fstat(fd, &info) == 0 && info.st_size >= static_cast<off_t>(sizeof(IlluminationChannelHeader)))
+	{
+		mappedSize = static_cast<size_t>(info.st_size);
+		view = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (view == MAP_FAILED)
+			view = nullptr;
+	}
+	close(fd);
+	if (!view)
+		return false;
+#endif
+	producer.header = static_cast<IlluminationChannelHeader *>(view);
+	producer.mappedSize = mappedSize;
+	IlluminationChannelHeader *pHeader = producer.header;
+	if (pHeader->magic.load(std::memory_order_acquire) != ILLUMINATION_CHANNEL_MAGIC || pHeader->version != ILLUMINATION_CHANNEL_VERSION ||
+		pHeader->slotSize != sizeof(IlluminationChannelSlot) || pHeader->headerSize < sizeof(IlluminationChannelHeader) ||
+		pHeader->capacity == 0 || (pHeader->capacity & (pHeader->capacity - 1)) != 0 ||
+		mappedSize < pHeader->headerSize + static_cast<size_t>(pHeader->capacity) * sizeof(IlluminationChannelSlot))
+	{
+		disconnectIlluminationChannel(producer);
+		return false;
+	}
+	producer.slots = illuminationChannelSlots(pHeader);
+	return true;
+}
+
+// Claims the next slot and returns its record to fill in place, null if the ring is full or the owner closed it.
+// position identifies the claim for commitIlluminationChannelPush, which must follow without delay.
+inline IlluminationChannelRecord *beginIlluminationChannelPush(IlluminationChannelProducer &producer, uint64_t &position)
+{
+	IlluminationChannelHeader *pHeader = producer.header;
+	if (!pHeader || !pHeader->ownerOpen.load(std::memory_order_relaxed))
+		return nullptr;
+	uint64_t mask = pHeader->capacity - 1;
+	position = pHeader->enqueuePosition.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		IlluminationChannelSlot &slot = producer.slots[position & mask];
+		int64_t lag = static_cast<int64_t>(slot.sequence.load(std::memory_order_acquire) - position);
+		if (lag == 0)
+		{
+			if (pHeader->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				return &slot.record;
+		}
+		else if (lag < 0)
+		{
+			// the owner has not freed this slot from the previous lap yet
+			pHeader->dropped.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		else
+			position = pHeader->enqueuePosition.load(std::memory_order_relaxed);
+	}
+}
+
+inline void commitIlluminationChannelPush(IlluminationChannelProducer &producer, uint64_t position)
+{
+	producer.slots[position & (producer.header->capacity - 1)].sequence.store(position + 1, std::memory_order_release);
+}
+
+inline bool pushIlluminationChannelRecord(IlluminationChannelProducer &producer, const IlluminationChannelRecord &record)
+{
+	uint64_t position;
+	IlluminationChannelRecord *pRecord = beginIlluminationChannelPush(producer, position);
+	if (!pRecord)
+		return false;
+	*pRecord = record;
+	commitIlluminationChannelPush(producer, position);
+	return true;
+}
@@ -0,0 +1,420 @@
+#include "pch.h"
+#include "NvApiColor.h"
+#include <cmath>
+#include <memory>
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Zone color pipelines. A pipeline runs white balance (3x3 matrix on r,g,b), white extraction (part of min(r,g,b) moved
+// to w on RGBW zones), then per channel curves that fold gamma and the calibration LUTs into one table. Configs are
+// compiled to Q12 coefficients and byte tables when set, so the kernels only do integer math and the scalar kernel
+// doubles as the reference the SSE4.1 and AVX2 kernels must match byte for byte (NvApiWrapperBench checks this).
+
+#if COLOR_KERNELS_X86 && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+static const int COLOR_MATRIX_SHIFT = 12;
+static const int COLOR_MATRIX_ROUNDING = 1 << (COLOR_MATRIX_SHIFT - 1);
+static const unsigned int COLOR_PIPELINE_FLAGS = COLOR_PIPELINE_WHITE_BALANCE | COLOR_PIPELINE_EXTRACT_WHITE | COLOR_PIPELINE_GAMMA | COLOR_PIPELINE_CALIBRATION;
+static const unsigned int COLOR_ISA_UNKNOWN = 0xFFFFFFFFu;
+
+static std::shared_mutex colorBankLock;
+static std::unique_ptr<ColorPipelineBank> colorBanks[NVAPI_MAX_PHYSICAL_GPUS];
+static std::atomic<unsigned int> colorActiveMasks[NVAPI_MAX_PHYSICAL_GPUS];
+static std::atomic<unsigned int> colorIsa{COLOR_ISA_UNKNOWN};
+
+static int32_t packInt16Pair(int low, int high)
+{
+	return static_cast<int32_t>(static_cast<uint32_t>(static_cast<uint16_t>(low)) | (static_cast<uint32_t>(static_cast<uint16_t>(high)) << 16));
+}
+static int lowInt16(int32_t pair)
+{
+	return static_cast<int16_t>(static_cast<uint32_t>(pair) & 0xFFFF);
+}
+static int highInt16(int32_t pair)
+{
+	return static_cast<int16_t>(static_cast<uint32_t>(pair) >> 16);
+}
+
+static bool inRange(float value, float low, float high)
+{
+	return value >= low && value <= high; // false for NaN
+}
+
+bool compileColorPipeline(const ColorPipelineConfig &config, unsigned int zoneIndex, ColorPipelineBank &bank)
+{
+	static const float identity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+	if (zoneIndex >= NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX || (config.flags & ~COLOR_PIPELINE_FLAGS))
+		return false;
+	bool whiteBalance = (config.flags & COLOR_PIPELINE_WHITE_BALANCE) != 0;
+	bool extractWhite = (config.flags & COLOR_PIPELINE_EXTRACT_WHITE) != 0;
+	bool gamma = (config.flags & COLOR_PIPELINE_GAMMA) != 0;
+	bool calibration = (config.flags & COLOR_PIPELINE_CALIBRATION) != 0;
+
+	// check everything first so a rejected config leaves the previous pipeline in place
+	const float *matrix = whiteBalance ? config.whiteBalance : identity;
+	for (int k = 0; k < 9; ++k)
+		if (!(matrix[k] > -8.0f && matrix[k] < 8.0f))
+			return false;
+	if (extractWhite && !inRange(config.whiteExtraction, 0.0f, 1.0f))
+		return false;
+	if (gamma && (!inRange(config.gamma, 0.05f, 8.0f) || !inRange(config.brightnessGamma, 0.05f, 8.0f)))
+		return false;
+
+	for (int c = 0; c < 3; ++c)
+	{
+		int coefficients[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			long scaled = std::lround(static_cast<double>(matrix[c * 3 + k]) * (1 << COLOR_MATRIX_SHIFT));
+			coefficients[k] = static_cast<int>((std::max)(-32768L, (std::min)(32767L, scaled)));
+		}
+		bank.matrixRG[c][zoneIndex] = packInt16Pair(coefficients[0], coefficients[1]);
+		bank.matrixB[c][zoneIndex] = packInt16Pair(coefficients[2], COLOR_MATRIX_ROUNDING);
+	}
+	bank.extraction[zoneIndex] = extractWhite ? static_cast<int32_t>(std::lround(config.whiteExtraction * 256.0)) : 0;
+
+	uint8_t *lut = bank.lut + zoneIndex * COLOR_LUT_STRIDE;
+	for (int channel = 0; channel < 4; ++channel)
+	{
+		for (int value = 0; value < 256; ++value)
+		{
+			int out = value;
+			if (gamma)
+				out = static_cast<int>(std::lround(255.0 * std::pow(value / 255.0, static_cast<double>(config.gamma))));
+			if (calibration)
+				out = config.calibration[channel][out];
+			lut[channel * 256 + value] = static_cast<uint8_t>(out);
+		}
+	}
+	// brightness is a percent, values above 100 are invalid for the driver and passed through
+	for (int value = 0; value < 256; ++value)
+	{
+		int out = value;
+		if (gamma && value <= 100)
+			out = static_cast<int>(std::lround(100.0 * std::pow(value / 100.0, static_cast<double>(config.brightnessGamma))));
+		lut[4 * 256 + value] = static_cast<uint8_t>(out);
+	}
+	bank.activeMask |= 1u << zoneIndex;
+	return true;
+}
+
+static int clampByte(int value)
+{
+	return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+// Reference kernel, the SIMD kernels run it for the colors left over after their last full vector
+static void colorKernelScalar(const ColorPipelineBank &bank, const ColorPlanes &planes, unsigned int first)
+{
+	for (unsigned int i = first; i < planes.count; ++i)
+	{
+		unsigned int zone = planes.zone[i];
+		int r = planes.r[i], g = planes.g[i], b = planes.b[i];
+		int balanced[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			int32_t rg = bank.matrixRG[c][zone], bRounding = bank.matrixB[c][zone];
+			int sum = r * lowInt16(rg) + g * highInt16(rg) + b * lowInt16(bRounding) + highInt16(bRounding);
+			balanced[c] = clampByte(sum >> COLOR_MATRIX_SHIFT);
+		}
+
+		int extraction = planes.extractWhite[i] ? bank.extraction[zone] : 0;
+		int lowest = (std::min)(balanced[0], (std::min)(balanced[1], balanced[2]));
+		int extracted = (lowest * extraction + 128) >> 8;
+		int w = (std::min)(planes.w[i] + extracted, 255);
+
+		const uint8_t *lut = bank.lut + zone * COLOR_LUT_STRIDE;
+		planes.r[i] = lut[balanced[0] - extracted];
+		planes.g[i] = lut[256 + balanced[1] - extracted];
+		planes.b[i] = lut[512 + balanced[2] - extracted];
+		planes.w[i] = lut[768 + w];
+		planes.brightness[i] = lut[1024 + planes.brightness[i]];
+	}
+}
+
+#if COLOR_KERNELS_X86
+
+// 4 colors per step. SSE4.1 has no gather, so per lane parameters and table lookups are loaded one lane at a time.
+COLOR_TARGET("sse4.1")
+static __m128i loadBytes4(const uint8_t *p)
+{
+	int32_t bytes;
+	memcpy(&bytes, p, sizeof(bytes));
+	return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+}
+
+COLOR_TARGET("sse4.1")
+static __m128i gather4(const int32_t *table, const uint8_t *zone)
+{
+	return _mm_setr_epi32(table[zone[0]], table[zone[1]], table[zone[2]], table[zone[3]]);
+}
+
+COLOR_TARGET("sse4.1")
+static void lookupBytes4(const uint8_t *lut, const uint8_t *zone, unsigned int offset, __m128i values, uint8_t *out)
+{
+	alignas(16) int32_t lanes[4];
+	_mm_store_si128(reinterpret_cast<__m128i *>(lanes), values);
+	for (int k = 0; k < 4; ++k)
+		out[k] = lut[zone[k] * COLOR_LUT_STRIDE + offset + lanes[k]];
+}
+
+COLOR_TARGET("sse4.1")
+static void colorKernelSse41(const ColorPipelineBank &bank, const ColorPlanes &planes)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i byteMax = _mm_set1_epi32(255);
+	const __m128i one = _mm_set1_epi32(0x10000);
+	const __m128i extractRounding = _mm_set1_epi32(128);
+	unsigned int i = 0;
+	for (; i + 4 <= planes.count; i += 4)
+	{
+		const uint8_t *zone = planes.zone + i;
+		// r,g and b,1 as int16 pairs so one madd per pair does two multiplies and the add
+		__m128i rg = _mm_or_si128(loadBytes4(planes.r + i), _mm_slli_epi32(loadBytes4(planes.g + i), 16));
+		__m128i bOne = _mm_or_si128(loadBytes4(planes.b + i), one);
+		__m128i balanced[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			__m128i sum = _mm_add_epi32(_mm_madd_epi16(rg, gather4(bank.matrixRG[c], zone)), _mm_madd_epi16(bOne, gather4(bank.matrixB[c], zone)));
+			balanced[c] = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(sum, COLOR_MATRIX_SHIFT), zero), byteMax);
+		}
+
+		__m128i extraction = _mm_andnot_si128(_mm_cmpeq_epi32(loadBytes4(planes.extractWhite + i), zero), gather4(bank.extraction, zone));
+		__m128i lowest = _mm_min_epi32(balanced[0], _mm_min_epi32(balanced[1], balanced[2]));
+		__m128i extracted = _mm_srai_epi32(_mm_add_epi32(_mm_mullo_epi32(lowest, extraction), extractRounding), 8);
+		__m128i w = _mm_min_epi32(_mm_add_epi32(loadBytes4(planes.w + i), extracted), byteMax);
+
+		lookupBytes4(bank.lut, zone, 0, _mm_sub_epi32(balanced[0], extracted), planes.r + i);
+		lookupBytes4(bank.lut, zone, 256, _mm_sub_epi32(balanced[1], extracted), planes.g + i);
+		lookupBytes4(bank.lut, zone, 512, _mm_sub_epi32(balanced[2], extracted), planes.b + i);
+		lookupBytes4(bank.lut, zone, 768, w, planes.w + i);
+		lookupBytes4(bank.lut, zone, 1024, loadBytes4(planes.brightness + i), planes.brightness + i);
+	}
+	colorKernelScalar(bank, planes, i);
+}
+
+// 8 colors per step, per lane parameters and table lookups are gathers
+COLOR_TARGET("avx2")
+static __m256i loadBytes8(const uint8_t *p)
+{
+	return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+}
+
+// values must already be 0 to 255
+COLOR_TARGET("avx2")
+static void storeBytes8(uint8_t *p, __m256i values)
+{
+	__m128i words = _mm_packus_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+	_mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_packus_epi16(words, words));
+}
+
+COLOR_TARGET("avx2")
+static __m256i lookupBytes8(const uint8_t *lut, __m256i lutBase, int offset, __m256i values)
+{
+	__m256i index = _mm256_add_epi32(lutBase, _mm256_add_epi32(values, _mm256_set1_epi32(offset)));
+	return _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int *>(lut), index, 1), _mm256_set1_epi32(0xFF));
+}
+
+COLOR_TARGET("avx2")
+static void colorKernelAvx2(const ColorPipelineBank &bank, const ColorPlanes &planes)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i byteMax = _mm256_set1_epi32(255);
+	const __m256i one = _mm256_set1_epi32(0x10000);
+	const __m256i extractRounding = _mm256_set1_epi32(128);
+	const __m256i lutStride = _mm256_set1_epi32(COLOR_LUT_STRIDE);
+	unsigned int i = 0;
+	for (; i + 8 <= planes.count; i += 8)
+	{
+		__m256i zone = loadBytes8(planes.zone + i);
+		__m256i rg = _mm256_or_si256(loadBytes8(planes.r + i), _mm256_slli_epi32(loadBytes8(planes.g + i), 16));
+		__m256i bOne = _mm256_or_si256(loadBytes8(planes.b + i), one);
+		__m256i balanced[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			__m256i matrixRG = _mm256_i32gather_epi32(reinterpret_cast<const int *>(bank.matrixRG[c]), zone, 4);
+			__m256i matrixB = _mm256_i32gather_epi32(reinterpret_cast<const int *>(bank.matrixB[c]), zone, 4);
+			__m256i sum = _mm256_add_epi32(_mm256_madd_epi16(rg, matrixRG), _mm256_madd_epi16(bOne, matrixB));
+			balanced[c] = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(sum, COLOR_MATRIX_SHIFT), zero), byteMax);
+		}
+
+		__m256i extraction = _mm256_i32gather_epi32(reinterpret_cast<const int *>(bank.extraction), zone, 4);
+		extraction = _mm256_andnot_si256(_mm256_cmpeq_epi32(loadBytes8(planes.extractWhite + i), zero), extraction);
+		__m256i lowest = _mm256_min_epi32(balanced[0], _mm256_min_epi32(balanced[1], balanced[2]));
+		__m256i extracted = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(lowest, extraction), extractRounding), 8);
+		__m256i w = _mm256_min_epi32(_mm256_add_epi32(loadBytes8(planes.w + i), extracted), byteMax);
+
+		__m256i lutBase = _mm256_mullo_epi32(zone, lutStride);
+		storeBytes8(planes.r + i, lookupBytes8(bank.lut, lutBase, 0, _mm256_sub_epi32(balanced[0], extracted)));
+		storeBytes8(planes.g + i, lookupBytes8(bank.lut, lutBase, 256, _mm256_sub_epi32(balanced[1], extracted)));
+		storeBytes8(planes.b + i, lookupBytes8(bank.lut, lutBase, 512, _mm256_sub_epi32(balanced[2], extracted)));
+		storeBytes8(planes.w + i, lookupBytes8(bank.lut, lutBase, 768, w));
+		storeBytes8(planes.brightness + i, lookupBytes8(bank.lut, lutBase, 1024, loadBytes8(planes.brightness + i)));
+	}
+	colorKernelScalar(bank, planes, i);
+}
+
+#endif
+
+unsigned int detectColorIsa()
+{
+#if COLOR_KERNELS_X86
+	unsigned int leaf1[4] = {0}, leaf7[4] = {0};
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	memcpy(leaf1, info, sizeof(leaf1));
+	if (maxLeaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		memcpy(leaf7, info, sizeof(leaf7));
+	}
+#else
+	unsigned int maxLeaf = __get_cpuid_max(0, nullptr);
+	__cpuid(1, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+	if (maxLeaf >= 7)
+		__cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+#endif
+	bool sse41 = (leaf1[2] & (1u << 19)) != 0;
+	// AVX2 also needs the OS to save the YMM registers, checked through OSXSAVE and XCR0
+	bool avx2 = false;
+	if ((leaf1[2] & (1u << 27)) && (leaf1[2] & (1u << 28)) && (leaf7[1] & (1u << 5)))
+	{
+#ifdef _MSC_VER
+		unsigned long long xcr0 = _xgetbv(0);
+#else
+		unsigned int xcr0Low, xcr0High;
+		__asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+		unsigned long long xcr0 = xcr0Low;
+#endif
+		avx2 = (xcr0 & 6) == 6;
+	}
+	if (avx2)
+		return COLOR_PIPELINE_ISA_AVX2;
+	if (sse41)
+		return COLOR_PIPELINE_ISA_SSE41;
+#endif
+	return COLOR_PIPELINE_ISA_SCALAR;
+}
+
+void runColorKernel(const ColorPipelineBank &bank, const ColorPlanes &planes, unsigned int isa)
+{
+#if COLOR_KERNELS_X86
+	if (isa == COLOR_PIPELINE_ISA_AVX2)
+		return colorKernelAvx2(bank, planes);
+	if (isa == COLOR_PIPELINE_ISA_SSE41)
+		return colorKernelSse41(bank, planes);
+#else
+	(void)isa;
+#endif
+	colorKernelScalar(bank, planes, 0);
+}
+
+unsigned int activeColorIsa()
+{
+	unsigned int isa = colorIsa.load();
+	if (isa == COLOR_ISA_UNKNOWN)
+	{
+		isa = detectColorIsa();
+		colorIsa = isa;
+	}
+	return isa;
+}
+
+bool hasColorPipelines(unsigned int gpuIndex)
+{
+	return gpuIndex < NVAPI_MAX_PHYSICAL_GPUS && colorActiveMasks[gpuIndex].load() != 0;
+}
+
+void processZoneColors(unsigned int gpuIndex, const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams, ZoneUpdate *pUpdates, unsigned int count)
+{
+	if (!hasColorPipelines(gpuIndex))
+		return;
+	std::shared_lock<std::shared_mutex> lock(colorBankLock);
+	const ColorPipelineBank *bank = colorBanks[gpuIndex].get();
+	if (!bank || !bank->activeMask)
+		return;
+	unsigned int isa = activeColorIsa();
+
+	// gather the colors of zones with a pipeline into planes, a zone batch at a time
+	const unsigned int CHUNK = NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX;
+	uint8_t r[CHUNK], g[CHUNK], b[CHUNK], w[CHUNK], brightness[CHUNK], zone[CHUNK], extractWhite[CHUNK];
+	ZoneUpdate *pending[CHUNK];
+	ColorPlanes planes = {r, g, b, w, brightness, zone, extractWhite, 0};
+	for (unsigned int next = 0; next < count;)
+	{
+		planes.count = 0;
+		for (; next < count && planes.count < CHUNK; ++next)
+		{
+			ZoneUpdate &update = pUpdates[next];
+			if (update.zoneIndex >= NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX || !(bank->activeMask & (1u << update.zoneIndex)))
+				continue;
+			unsigned int zoneType = update.zoneType;
+			if (pParams && update.zoneIndex < pParams->numIllumZonesControl)
+				zoneType = static_cast<unsigned int>(pParams->zones[update.zoneIndex].type);
+			unsigned int lane = planes.count++;
+			r[lane] = update.r;
+			g[lane] = update.g;
+			b[lane] = update.b;
+			w[lane] = update.w;
+			brightness[lane] = update.brightness;
+			zone[lane] = static_cast<uint8_t>(update.zoneIndex);
+			extractWhite[lane] = zoneType == NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW ? 1 : 0;
+			pending[lane] = &update;
+		}
+		if (planes.count == 0)
+			continue;
+		runColorKernel(*bank, planes, isa);
+		for (unsigned int lane = 0; lane < planes.count; ++lane)
+		{
+			pending[lane]->r = r[lane];
+			pending[lane]->g = g[lane];
+			pending[lane]->b = b[lane];
+			pending[lane]->w = w[lane];
+			pending[lane]->brightness = brightness[lane];
+		}
+	}
+}
+
+// Sets or, with a null config, removes the pipeline of one zone. It applies from the next write of the zone on, the
+// state already on the GPU is left as is.
+NVAPI_DLL bool SetZoneColorPipeline(unsigned int gpuIndex, unsigned int zoneIndex, const ColorPipelineConfig *pConfig)
+{
+	if (gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS || zoneIndex >= NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX)
+		return false;
+	std::unique_lock<std::shared_mutex> lock(colorBankLock);
+	std::unique_ptr<ColorPipelineBank> &bank = colorBanks[gpuIndex];
+	if (!pConfig)
+	{
+		if (bank)
+		{
+			bank->activeMask &= ~(1u << zoneIndex);
+			colorActiveMasks[gpuIndex] = bank->activeMask;
+		}
+		return true;
+	}
+	if (!bank)
+		bank.reset(new (std::nothrow) ColorPipelineBank());
+	if (!bank || !compileColorPipeline(*pConfig, zoneIndex, *bank))
+		return false;
+	colorActiveMasks[gpuIndex] = bank->activeMask;
+	return true;
+}
+
+NVAPI_DLL unsigned int GetColorPipelineIsa()
+{
+	return activeColorIsa();
+}
+
+// Forces the kernel of the color pipelines, the ambient sampler and the audio FFT, e.g. to compare them, fails for kernels
+// the CPU cannot run
+NVAPI_DLL bool SetColorPipelineIsa(unsigned int isa)
+{
+	if (isa > detectColorIsa())
+		return false;
+	colorIsa = isa;
+	return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "NvApiDll.h"
+
+// SIMD kernels are x86 only and compiled per function, so the rest of the DLL keeps the baseline instruction set.
+// COLOR_TARGET marks a function that may use the given instruction set, MSVC accepts the intrinsics without it.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define COLOR_KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define COLOR_TARGET(isa)
+#else
+#define COLOR_TARGET(isa) __attribute__((target(isa)))
+#endif
+#else
+#define COLOR_KERNELS_X86 0
+#endif
+
+// Lookup tables of one zone pipeline: r, g, b, w, then brightness
+#define COLOR_LUT_CHANNELS 5
+#define COLOR_LUT_STRIDE (COLOR_LUT_CHANNELS * 256)
+
+// Compiled pipelines of one GPU indexed by zone. Everything is integer once compiled so the scalar and SIMD kernels
+// produce the same bytes, and each table is indexed by zone so a kernel can gather a different zone in every lane.
+struct ColorPipelineBank
+{
+	uint32_t activeMask;												// zones with a pipeline
+	int32_t matrixRG[3][NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];		// int16 pair per output channel, r and g coefficients in Q12
+	int32_t matrixB[3][NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];			// int16 pair per output channel, b coefficient in Q12 and the rounding term
+	int32_t extraction[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];			// Q8, 256 moves all of min(r,g,b) to w
+	uint8_t lut[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX * COLOR_LUT_STRIDE + 4]; // padded so a 32-bit gather of the last entry stays inside
+};
+
+// Colors in planar form, every array holds count entries
+struct ColorPlanes
+{
+	uint8_t *r, *g, *b, *w, *brightness;
+	const uint8_t *zone;		 // pipeline applied to each color
+	const uint8_t *extractWhite; // nonzero for colors of RGBW zones
+	unsigned int count;
+};
+
+// Converts config to fixed point and stores it as the pipeline of zoneIndex, false if any field is out of range
+bool compileColorPipeline(const ColorPipelineConfig &config, unsigned int zoneIndex, ColorPipelineBank &bank);
+// Best COLOR_PIPELINE_ISA_* the CPU and OS support
+unsigned int detectColorIsa();
+// Kernel the color pipelines, the ambient sampler and the audio FFT run, detected on first use unless SetColorPipelineIsa
+// forced one
+unsigned int activeColorIsa();
+// Runs the bank over every color with the given COLOR_PIPELINE_ISA_* kernel, which the CPU must support
+void runColorKernel(const ColorPipelineBank &bank, const ColorPlanes &planes, unsigned int isa);
+// True if any zone of the GPU has a pipeline, lock free so writers can skip the copy for GPUs without pipelines
+bool hasColorPipelines(unsigned int gpuIndex);
+// Runs the GPU's pipelines over updates in place, updates of zones without a pipeline are left alone. Zone types come
+// from params when given, otherwise from the updates themselves.
+void processZoneColors(unsigned int gpuIndex, const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams, ZoneUpdate *pUpdates, unsigned int count);
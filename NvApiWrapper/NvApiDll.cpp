@@ -1,24 +1,394 @@
 #include "pch.h"
-#include "NvApiDll.h"
+#include "NvApiBackend.h"
+#include "NvApiColor.h"
+#include "NvApiNotify.h"
+#include "NvApiPerf.h"
+#include "NvApiProfile.h"
+#include "NvApiReconciler.h"
+#include "NvApiTelemetry.h"
+#include <random>
 #pragma warning(disable : 5045) // suppress spectre warnings in this file
 
 NVAPI_DLL const char *GetNvApiErrorMessage(NvAPI_Status status)
 {
-	static char errorMessage[256];
+	static thread_local char errorMessage[256];
 	if (status == NVAPI_OK)
 		return "No error";
 	NvAPI_ShortString message;
-	NvAPI_GetErrorMessage(status, message);
+	nvapi().GetErrorMessage(status, message);
 	snprintf(errorMessage, sizeof(errorMessage), "Error: %s", message);
 	return errorMessage;
 }
 
+// Physical GPU handle cache, built once by InitializeNvApi and dropped by DeinitializeNvApi.
+// It is only rebuilt when a driver call reports an invalidated handle or a lost GPU.
+static std::shared_mutex gpuHandleCacheLock;
+static NvPhysicalGpuHandle gpuHandleCache[NVAPI_MAX_PHYSICAL_GPUS] = {0};
+static NvU32 gpuHandleCacheCount = 0;
+static bool gpuHandleCacheValid = false;
+static std::atomic<unsigned long long> gpuEnumerationsAvoided{0};
+static std::atomic<unsigned long long> gpuEnumerationsPerformed{0};
+static std::atomic<unsigned int> gpuHandleCacheGeneration{0}; // bumped whenever the handle table may have changed order
+
+// caller must hold gpuHandleCacheLock exclusively
+static NvAPI_Status rebuildGpuHandleCache()
+{
+	NvPhysicalGpuHandle gpuHandles[NVAPI_MAX_PHYSICAL_GPUS] = {0};
+	NvU32 gpuCount = 0;
+	NvAPI_Status status = nvapi().EnumPhysicalGPUs(gpuHandles, &gpuCount);
+	gpuEnumerationsPerformed++;
+	if (status != NVAPI_OK)
+	{
+		gpuHandleCacheCount = 0;
+		gpuHandleCacheValid = false;
+		return status;
+	}
+	memcpy(gpuHandleCache, gpuHandles, sizeof(gpuHandleCache));
+	gpuHandleCacheCount = gpuCount;
+	gpuHandleCacheValid = true;
+	gpuHandleCacheGeneration++;
+	return NVAPI_OK;
+}
+
+static void dropGpuHandleCache()
+{
+	std::unique_lock<std::shared_mutex> lock(gpuHandleCacheLock);
+	memset(gpuHandleCache, 0, sizeof(gpuHandleCache));
+	gpuHandleCacheCount = 0;
+	gpuHandleCacheValid = false;
+}
+
+// Looks up a handle (and/or the GPU count) from the cache, enumerating only if the cache is invalid
+static NvAPI_Status readGpuHandleCache(unsigned int index, NvPhysicalGpuHandle *pHandle, NvU32 *pCount)
+{
+	{
+		std::shared_lock<std::shared_mutex> lock(gpuHandleCacheLock);
+		if (gpuHandleCacheValid)
+		{
+			gpuEnumerationsAvoided++;
+			if (pCount)
+				*pCount = gpuHandleCacheCount;
+			if (pHandle)
+				*pHandle = index < gpuHandleCacheCount ? gpuHandleCache[index] : nullptr;
+			return NVAPI_OK;
+		}
+	}
+
+	std::unique_lock<std::shared_mutex> lock(gpuHandleCacheLock);
+	// another thread may have rebuilt the cache while we waited for the exclusive lock
+	if (gpuHandleCacheValid)
+		gpuEnumerationsAvoided++;
+	else
+	{
+		NvAPI_Status status = rebuildGpuHandleCache();
+		if (status != NVAPI_OK)
+			return status;
+	}
+	if (pCount)
+		*pCount = gpuHandleCacheCount;
+	if (pHandle)
+		*pHandle = index < gpuHandleCacheCount ? gpuHandleCache[index] : nullptr;
+	return NVAPI_OK;
+}
+
+// Copies the whole handle table, so a pass over every GPU takes the cache lock once instead of once per GPU
+static NvAPI_Status readGpuHandleSet(NvPhysicalGpuHandle (&handles)[NVAPI_MAX_PHYSICAL_GPUS], NvU32 &count)
+{
+	NvAPI_Status status = readGpuHandleCache(0, nullptr, &count);
+	if (status != NVAPI_OK)
+		return status;
+	std::shared_lock<std::shared_mutex> lock(gpuHandleCacheLock);
+	// an invalidation between the two locks leaves an empty set, the next pass enumerates again
+	count = gpuHandleCacheValid ? gpuHandleCacheCount : 0;
+	memcpy(handles, gpuHandleCache, sizeof(handles));
+	return NVAPI_OK;
+}
+
+// Invalidates the handle cache if the status says a handle went stale or the GPU is gone, charges failures to the
+// running export's counters and returns the status unchanged
+static NvAPI_Status checkGpuStatus(NvAPI_Status status)
+{
+	perfRecordStatus(status);
+	switch (status)
+	{
+	case NVAPI_INVALID_HANDLE:
+	case NVAPI_HANDLE_INVALIDATED:
+	case NVAPI_EXPECTED_PHYSICAL_GPU_HANDLE:
+	case NVAPI_NVIDIA_DEVICE_NOT_FOUND:
+		InvalidateGPUHandleCache();
+		break;
+	default:
+		break;
+	}
+	return status;
+}
+
+// Last piecewise effect seen on a zone, restored when the zone is switched back to piecewise control
+struct PiecewiseZoneState
+{
+	unsigned int zoneType;
+	CustomRGBW endpoints[NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS];
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_DATA_PIECEWISE_LINEAR timing;
+};
+
+// Shadow copy of the last known zone control state of a GPU, slot 0 is the active state and slot 1 the default state.
+// Setters patch the shadow instead of re-reading the driver, and skip SetControl when nothing changed.
+struct GpuShadowState
+{
+	std::mutex lock; // per-GPU lock, held around every driver call and read-modify-write sequence on this GPU
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS params[2];
+	bool valid[2];
+	unsigned int generation[2];
+	std::chrono::steady_clock::time_point readTime[2];
+	ZoneUpdate desired[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX]; // active state the reconciler keeps the zones at
+	std::atomic<unsigned int> desiredMask;						// bit per zone index in desired, written under lock
+	PiecewiseZoneState piecewise[2][NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	unsigned int piecewiseMask[2]; // bit per zone index with a piecewise effect in piecewise
+};
+static GpuShadowState gpuShadowStates[NVAPI_MAX_PHYSICAL_GPUS];
+static std::atomic<unsigned int> shadowMaxAgeMs{SHADOW_MAX_AGE_NEVER_EXPIRES};
+static std::atomic<bool> shadowInvalidateOnError{true};
+static std::atomic<unsigned long long> shadowHits{0};
+static std::atomic<unsigned long long> shadowMisses{0};
+static std::atomic<unsigned long long> shadowSkippedWrites{0};
+
+// GPUs are independent, so driver access is serialized per GPU and work on different GPUs runs in parallel
+static std::mutex &gpuLock(unsigned int index)
+{
+	return gpuShadowStates[index].lock;
+}
+
+static void invalidateShadow(GpuShadowState &shadow)
+{
+	shadow.valid[0] = false;
+	shadow.valid[1] = false;
+}
+
+// Manual color of a zone as a ZoneUpdate, false if the zone is not under manual control
+static bool readManualZone(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_V1 &zone, ZoneUpdate &update)
+{
+	if (zone.ctrlMode != NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL)
+		return false;
+	update.zoneType = static_cast<unsigned int>(zone.type);
+	update.r = update.g = update.b = update.w = 0;
+	switch (zone.type)
+	{
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
+	{
+		const auto &rgbData = zone.data.rgb.data.manualRGB.rgbParams;
+		update.r = rgbData.colorR;
+		update.g = rgbData.colorG;
+		update.b = rgbData.colorB;
+		update.brightness = rgbData.brightnessPct;
+		return true;
+	}
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
+	{
+		const auto &rgbwData = zone.data.rgbw.data.manualRGBW.rgbwParams;
+		update.r = rgbwData.colorR;
+		update.g = rgbwData.colorG;
+		update.b = rgbwData.colorB;
+		update.w = rgbwData.colorW;
+		update.brightness = rgbwData.brightnessPct;
+		return true;
+	}
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
+		update.brightness = zone.data.singleColor.data.manualSingleColor.singleColorParams.brightnessPct;
+		return true;
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
+		update.brightness = zone.data.colorFixed.data.manualColorFixed.colorFixedParams.brightnessPct;
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Piecewise endpoints and timing of a zone, whatever its control mode. False for zone types without piecewise data.
+static bool readPiecewiseZone(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_V1 &zone, PiecewiseZoneState &state)
+{
+	state.zoneType = static_cast<unsigned int>(zone.type);
+	memset(state.endpoints, 0, sizeof(state.endpoints));
+	for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+	{
+		CustomRGBW &endpoint = state.endpoints[j];
+		switch (zone.type)
+		{
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
+		{
+			const auto &rgbData = zone.data.rgb.data.piecewiseLinearRGB.rgbParams[j];
+			endpoint = {rgbData.colorR, rgbData.colorG, rgbData.colorB, 0, rgbData.brightnessPct};
+			state.timing = zone.data.rgb.data.piecewiseLinearRGB.piecewiseLinearData;
+			break;
+		}
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
+		{
+			const auto &rgbwData = zone.data.rgbw.data.piecewiseLinearRGBW.rgbwParams[j];
+			endpoint = {rgbwData.colorR, rgbwData.colorG, rgbwData.colorB, rgbwData.colorW, rgbwData.brightnessPct};
+			state.timing = zone.data.rgbw.data.piecewiseLinearRGBW.piecewiseLinearData;
+			break;
+		}
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
+			endpoint.brightness = zone.data.singleColor.data.piecewiseLinearSingleColor.singleColorParams[j].brightnessPct;
+			state.timing = zone.data.singleColor.data.piecewiseLinearSingleColor.piecewiseLinearData;
+			break;
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
+			endpoint.brightness = zone.data.colorFixed.data.piecewiseLinearColorFixed.colorFixedParams[j].brightnessPct;
+			state.timing = zone.data.colorFixed.data.piecewiseLinearColorFixed.piecewiseLinearData;
+			break;
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+// Inverse of readPiecewiseZone, the zone must be of state.zoneType
+static void writePiecewiseZone(const PiecewiseZoneState &state, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_V1 &zone)
+{
+	for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+	{
+		const CustomRGBW &endpoint = state.endpoints[j];
+		switch (zone.type)
+		{
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
+		{
+			auto &rgbData = zone.data.rgb.data.piecewiseLinearRGB.rgbParams[j];
+			rgbData.colorR = endpoint.r;
+			rgbData.colorG = endpoint.g;
+			rgbData.colorB = endpoint.b;
+			rgbData.brightnessPct = endpoint.brightness;
+			zone.data.rgb.data.piecewiseLinearRGB.piecewiseLinearData = state.timing;
+			break;
+		}
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
+		{
+			auto &rgbwData = zone.data.rgbw.data.piecewiseLinearRGBW.rgbwParams[j];
+			rgbwData.colorR = endpoint.r;
+			rgbwData.colorG = endpoint.g;
+			rgbwData.colorB = endpoint.b;
+			rgbwData.colorW = endpoint.w;
+			rgbwData.brightnessPct = endpoint.brightness;
+			zone.data.rgbw.data.piecewiseLinearRGBW.piecewiseLinearData = state.timing;
+			break;
+		}
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
+			zone.data.singleColor.data.piecewiseLinearSingleColor.singleColorParams[j].brightnessPct = endpoint.brightness;
+			zone.data.singleColor.data.piecewiseLinearSingleColor.piecewiseLinearData = state.timing;
+			break;
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
+			zone.data.colorFixed.data.piecewiseLinearColorFixed.colorFixedParams[j].brightnessPct = endpoint.brightness;
+			zone.data.colorFixed.data.piecewiseLinearColorFixed.piecewiseLinearData = state.timing;
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+// Writes made through the wrapper move the desired state along so the reconciler never reverts them. A tracked zone
+// that is switched away from manual control is no longer reconciled. Caller must hold shadow.lock.
+static void adoptDesiredState(GpuShadowState &shadow, const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS &params)
+{
+	unsigned int mask = shadow.desiredMask.load();
+	for (unsigned int zone = 0; zone < params.numIllumZonesControl; ++zone)
+	{
+		if (!(mask & (1u << zone)))
+			continue;
+		unsigned int zoneIndex = shadow.desired[zone].zoneIndex;
+		if (!readManualZone(params.zones[zone], shadow.desired[zone]))
+			mask &= ~(1u << zone);
+		shadow.desired[zone].zoneIndex = zoneIndex;
+	}
+	shadow.desiredMask = mask;
+}
+
+// caller must hold shadow.lock
+static void storeShadowControl(GpuShadowState &shadow, bool useDefault, const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS &params)
+{
+	int slot = useDefault ? 1 : 0;
+	shadow.params[slot] = params;
+	shadow.params[slot].bDefault = useDefault ? NV_TRUE : NV_FALSE;
+	shadow.valid[slot] = true;
+	shadow.generation[slot] = gpuHandleCacheGeneration.load();
+	shadow.readTime[slot] = std::chrono::steady_clock::now();
+	// manual control reuses the piecewise storage, so remember every effect seen while it is still intact
+	for (unsigned int zone = 0; zone < params.numIllumZonesControl && zone < NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX; ++zone)
+		if (params.zones[zone].ctrlMode == NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR && readPiecewiseZone(params.zones[zone], shadow.piecewise[slot][zone]))
+			shadow.piecewiseMask[slot] |= 1u << zone;
+}
+
+// Fills params from the shadow if it is still fresh, otherwise from the driver. Caller must hold shadow.lock.
+static NvAPI_Status readShadowControl(GpuShadowState &shadow, NvPhysicalGpuHandle gpuHandle, bool useDefault, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS &params)
+{
+	int slot = useDefault ? 1 : 0;
+	unsigned int maxAgeMs = shadowMaxAgeMs.load();
+	bool fresh = shadow.valid[slot] && shadow.generation[slot] == gpuHandleCacheGeneration.load();
+	if (fresh && maxAgeMs != SHADOW_MAX_AGE_NEVER_EXPIRES)
+		fresh = std::chrono::steady_clock::now() - shadow.readTime[slot] < std::chrono::milliseconds(maxAgeMs);
+	if (fresh)
+	{
+		shadowHits++;
+		params = shadow.params[slot];
+		return NVAPI_OK;
+	}
+
+	shadowMisses++;
+	memset(&params, 0, sizeof(params));
+	params.version = NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS_VER;
+	params.bDefault = useDefault ? NV_TRUE : NV_FALSE;
+	NvAPI_Status status = checkGpuStatus(nvapi().GPU_ClientIllumZonesGetControl(gpuHandle, &params));
+	if (status != NVAPI_OK)
+	{
+		if (shadowInvalidateOnError.load())
+			invalidateShadow(shadow);
+		return status;
+	}
+	storeShadowControl(shadow, useDefault, params);
+	return NVAPI_OK;
+}
+
+// Writes params unless they match the shadow, then updates the shadow. Caller must hold shadow.lock.
+static NvAPI_Status writeShadowControl(GpuShadowState &shadow, NvPhysicalGpuHandle gpuHandle, bool useDefault, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS &params)
+{
+	int slot = useDefault ? 1 : 0;
+	params.bDefault = useDefault ? NV_TRUE : NV_FALSE;
+	if (shadow.valid[slot] && memcmp(&shadow.params[slot], &params, sizeof(params)) == 0)
+	{
+		shadowSkippedWrites++;
+		return NVAPI_OK;
+	}
+
+	NvAPI_Status status = checkGpuStatus(nvapi().GPU_ClientIllumZonesSetControl(gpuHandle, &params));
+	if (status != NVAPI_OK)
+	{
+		if (shadowInvalidateOnError.load())
+			invalidateShadow(shadow);
+		return status;
+	}
+	// keep the original read time, the age limit bounds how long we trust state we did not read back
+	std::chrono::steady_clock::time_point readTime = shadow.readTime[slot];
+	storeShadowControl(shadow, useDefault, params);
+	shadow.readTime[slot] = readTime;
+	if (!useDefault)
+		adoptDesiredState(shadow, params);
+	return NVAPI_OK;
+}
+
 NVAPI_DLL bool InitializeNvApi()
 {
-	NvAPI_Status status = NvAPI_Initialize();
+	PERF_EXPORT_SCOPE(PERF_EXPORT_INITIALIZE_NVAPI);
+	NvAPI_Status status = nvapi().Initialize();
+	if (status != NVAPI_OK)
+	{
+		perfRecordStatus(status);
+		return false;
+	}
+	std::unique_lock<std::shared_mutex> lock(gpuHandleCacheLock);
+	// NvAPI stays loaded, the cache is left invalid and the next call that needs a handle enumerates again
+	status = rebuildGpuHandleCache();
 	if (status != NVAPI_OK)
 	{
-		GetNvApiErrorMessage(status);
+		perfRecordStatus(status);
 		return false;
 	}
 	return status == NVAPI_OK;
@@ -26,10 +396,16 @@ NVAPI_DLL bool InitializeNvApi()
 
 NVAPI_DLL bool DeinitializeNvApi()
 {
-	NvAPI_Status status = NvAPI_Unload();
+	PERF_EXPORT_SCOPE(PERF_EXPORT_DEINITIALIZE_NVAPI);
+	StopAnimationEngine();
+	StopIlluminationReconciler();
+	stopZoneChangeSampler();
+	StopIlluminationQueue();
+	dropGpuHandleCache();
+	NvAPI_Status status = nvapi().Unload();
 	if (status != NVAPI_OK)
 	{
-		GetNvApiErrorMessage(status);
+		perfRecordStatus(status);
 		return false;
 	}
 	return status == NVAPI_OK;
@@ -37,10 +413,12 @@ NVAPI_DLL bool DeinitializeNvApi()
 
 NVAPI_DLL const char *GetInterfaceVersionString()
 {
-	static char version[256];
-	NvAPI_Status status = NvAPI_GetInterfaceVersionString(version);
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_INTERFACE_VERSION_STRING);
+	static thread_local char version[256];
+	NvAPI_Status status = nvapi().GetInterfaceVersionString(version);
 	if (status != NVAPI_OK)
 	{
+		perfRecordStatus(status);
 		const char *errorMessage = GetNvApiErrorMessage(status);
 		return errorMessage;
 	}
@@ -49,28 +427,27 @@ NVAPI_DLL const char *GetInterfaceVersionString()
 
 NVAPI_DLL unsigned long GetDriverVersion()
 {
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_DRIVER_VERSION);
 	NvU32 DriverVersion = 0;
 	NvAPI_ShortString BuildBranch;
-	NvAPI_Status status = NvAPI_SYS_GetDriverAndBranchVersion(&DriverVersion, BuildBranch);
+	NvAPI_Status status = nvapi().SYS_GetDriverAndBranchVersion(&DriverVersion, BuildBranch);
 	if (status != NVAPI_OK)
 	{
-		GetNvApiErrorMessage(status);
+		perfRecordStatus(status);
 		return 0;
 	}
-	printf("Driver Version: %lu, BuildBranch : %s\n", DriverVersion, BuildBranch);
-
 	return DriverVersion;
 }
 
 NVAPI_DLL unsigned int GetNumberOfGPUs()
 {
-	NvPhysicalGpuHandle gpuHandles[NVAPI_MAX_PHYSICAL_GPUS] = {0};
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_NUMBER_OF_GPUS);
 	NvU32 gpuCount = 0;
-	NvAPI_Status status = NvAPI_EnumPhysicalGPUs(gpuHandles, &gpuCount);
+	NvAPI_Status status = readGpuHandleCache(0, nullptr, &gpuCount);
 
 	if (status != NVAPI_OK)
 	{
-		GetNvApiErrorMessage(status);
+		perfRecordStatus(status);
 		return 0;
 	}
 
@@ -79,28 +456,98 @@ NVAPI_DLL unsigned int GetNumberOfGPUs()
 
 NVAPI_DLL NvPhysicalGpuHandle GetGPUHandle(unsigned int index)
 {
-	NvPhysicalGpuHandle gpuHandles[NVAPI_MAX_PHYSICAL_GPUS] = {0};
-	NvU32 gpuCount = 0;
-	NvAPI_Status status = NvAPI_EnumPhysicalGPUs(gpuHandles, &gpuCount);
-	if (status != NVAPI_OK || index >= static_cast<int>(gpuCount))
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_GPU_HANDLE);
+	NvPhysicalGpuHandle gpuHandle = nullptr;
+	NvAPI_Status status = readGpuHandleCache(index, &gpuHandle, nullptr);
+	if (status != NVAPI_OK || !gpuHandle)
 	{
-		GetNvApiErrorMessage(status);
+		perfRecordStatus(status != NVAPI_OK ? status : NVAPI_INVALID_ARGUMENT); // no GPU at this index
 		return nullptr;
 	}
-	return gpuHandles[index];
+	return gpuHandle;
+}
+
+NVAPI_DLL void InvalidateGPUHandleCache()
+{
+	std::unique_lock<std::shared_mutex> lock(gpuHandleCacheLock);
+	gpuHandleCacheValid = false;
+}
+
+NVAPI_DLL void GetGPUHandleCacheStats(unsigned long long *pEnumerationsAvoided, unsigned long long *pEnumerationsPerformed)
+{
+	if (pEnumerationsAvoided)
+		*pEnumerationsAvoided = gpuEnumerationsAvoided.load();
+	if (pEnumerationsPerformed)
+		*pEnumerationsPerformed = gpuEnumerationsPerformed.load();
+}
+
+NVAPI_DLL void SetIlluminationShadowPolicy(unsigned int maxAgeMs, bool invalidateOnError)
+{
+	shadowMaxAgeMs = maxAgeMs;
+	shadowInvalidateOnError = invalidateOnError;
+}
+
+NVAPI_DLL void InvalidateIlluminationShadow(unsigned int gpuIndex)
+{
+	for (unsigned int i = 0; i < NVAPI_MAX_PHYSICAL_GPUS; ++i)
+	{
+		if (gpuIndex != i && gpuIndex < NVAPI_MAX_PHYSICAL_GPUS)
+			continue;
+		std::lock_guard<std::mutex> lock(gpuShadowStates[i].lock);
+		invalidateShadow(gpuShadowStates[i]);
+	}
+}
+
+NVAPI_DLL bool SetIlluminationDesiredState(unsigned int gpuIndex, const ZoneUpdate *pUpdates, unsigned int count)
+{
+	if (gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS || count > NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX || (count && !pUpdates))
+		return false;
+	for (unsigned int i = 0; i < count; ++i)
+		if (pUpdates[i].zoneIndex >= NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX)
+			return false;
+	GpuShadowState &shadow = gpuShadowStates[gpuIndex];
+	std::lock_guard<std::mutex> lock(shadow.lock);
+	// the desired state holds what the GPU should show, i.e. the colors after the zone color pipelines
+	ZoneUpdate processed[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	if (count)
+		memcpy(processed, pUpdates, count * sizeof(ZoneUpdate));
+	processZoneColors(gpuIndex, shadow.valid[0] ? &shadow.params[0] : nullptr, processed, count);
+	unsigned int mask = 0;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		shadow.desired[processed[i].zoneIndex] = processed[i];
+		mask |= 1u << processed[i].zoneIndex;
+	}
+	shadow.desiredMask = mask;
+	return true;
+}
+
+NVAPI_DLL void GetIlluminationShadowStats(unsigned long long *pHits, unsigned long long *pMisses, unsigned long long *pSkippedWrites)
+{
+	if (pHits)
+		*pHits = shadowHits.load();
+	if (pMisses)
+		*pMisses = shadowMisses.load();
+	if (pSkippedWrites)
+		*pSkippedWrites = shadowSkippedWrites.load();
 }
 
 NVAPI_DLL const char *GetGPUName(unsigned int index)
 {
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_GPU_NAME);
 	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(index);
 	if (!gpuHandle)
 	{
 		const char *errorMessage = GetNvApiErrorMessage(NVAPI_ACCESS_DENIED);
 		return errorMessage;
 	}
-	static char gpuName[256];
+	static thread_local char gpuName[256];
 	NvAPI_ShortString name;
-	NvAPI_Status status = NvAPI_GPU_GetFullName(gpuHandle, name);
+	NvAPI_Status status;
+	{
+		std::lock_guard<std::mutex> lock(gpuLock(index));
+		status = checkGpuStatus(nvapi().GPU_GetFullName(gpuHandle, name));
+	}
 	if (status != NVAPI_OK)
 	{
 		const char *errorMessage = GetNvApiErrorMessage(status);
@@ -112,16 +559,21 @@ NVAPI_DLL const char *GetGPUName(unsigned int index)
 
 NVAPI_DLL const char *GetGPUInfo(unsigned int index)
 {
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_GPU_INFO);
 	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(index);
 	if (!gpuHandle)
 	{
 		const char *errorMessage = GetNvApiErrorMessage(NVAPI_ACCESS_DENIED);
 		return errorMessage;
 	}
-	static char info[256];
+	static thread_local char info[256];
 	NV_GPU_INFO gpuInfo = {0};
 	gpuInfo.version = NV_GPU_INFO_VER;
-	NvAPI_Status status = NvAPI_GPU_GetGPUInfo(gpuHandle, &gpuInfo);
+	NvAPI_Status status;
+	{
+		std::lock_guard<std::mutex> lock(gpuLock(index));
+		status = checkGpuStatus(nvapi().GPU_GetGPUInfo(gpuHandle, &gpuInfo));
+	}
 	if (status != NVAPI_OK)
 	{
 		const char *errorMessage = GetNvApiErrorMessage(status);
@@ -138,15 +590,20 @@ NVAPI_DLL const char *GetGPUInfo(unsigned int index)
 
 NVAPI_DLL const char *GetSystemType(unsigned int index)
 {
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_SYSTEM_TYPE);
 	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(index);
 	if (!gpuHandle)
 	{
 		const char *errorMessage = GetNvApiErrorMessage(NVAPI_ACCESS_DENIED);
 		return errorMessage;
 	}
-	static char systemType[256];
+	static thread_local char systemType[256];
 	NV_SYSTEM_TYPE systemTypeInfo = NV_SYSTEM_TYPE_UNKNOWN;
-	NvAPI_Status status = NvAPI_GPU_GetSystemType(gpuHandle, &systemTypeInfo);
+	NvAPI_Status status;
+	{
+		std::lock_guard<std::mutex> lock(gpuLock(index));
+		status = checkGpuStatus(nvapi().GPU_GetSystemType(gpuHandle, &systemTypeInfo));
+	}
 	if (status != NVAPI_OK)
 	{
 		const char *errorMessage = GetNvApiErrorMessage(status);
@@ -169,16 +626,21 @@ NVAPI_DLL const char *GetSystemType(unsigned int index)
 
 NVAPI_DLL bool GetGPUPCIIdentifiers(unsigned int index, unsigned long *pDeviceId, unsigned long *pSubSystemId, unsigned long *pRevisionId, unsigned long *pExtDeviceId)
 {
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_GPU_PCI_IDENTIFIERS);
 	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(index);
 	if (!gpuHandle)
 		return false;
 
 	NvU32 deviceId = 0, subSystemId = 0, revisionId = 0, extDeviceId = 0;
-	NvAPI_Status status = NvAPI_GPU_GetPCIIdentifiers(gpuHandle, &deviceId, &subSystemId, &revisionId, &extDeviceId);
+	NvAPI_Status status;
+	{
+		std::lock_guard<std::mutex> lock(gpuLock(index));
+		status = checkGpuStatus(nvapi().GPU_GetPCIIdentifiers(gpuHandle, &deviceId, &subSystemId, &revisionId, &extDeviceId));
+	}
 
 	if (status != NVAPI_OK)
 	{
-		GetNvApiErrorMessage(status);
+		perfRecordStatus(status);
 		return false;
 	}
 
@@ -196,16 +658,21 @@ NVAPI_DLL bool GetGPUPCIIdentifiers(unsigned int index, unsigned long *pDeviceId
 
 NVAPI_DLL bool GetGPUBusId(unsigned int index, unsigned long *pBusId)
 {
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_GPU_BUS_ID);
 	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(index);
 	if (!gpuHandle)
 		return false;
 
 	NvU32 busId = 0;
-	NvAPI_Status status = NvAPI_GPU_GetBusId(gpuHandle, &busId);
+	NvAPI_Status status;
+	{
+		std::lock_guard<std::mutex> lock(gpuLock(index));
+		status = checkGpuStatus(nvapi().GPU_GetBusId(gpuHandle, &busId));
+	}
 
 	if (status != NVAPI_OK)
 	{
-		GetNvApiErrorMessage(status);
+		perfRecordStatus(status);
 		return false;
 	}
 
@@ -215,474 +682,1178 @@ NVAPI_DLL bool GetGPUBusId(unsigned int index, unsigned long *pBusId)
 	return true;
 }
 
-NVAPI_DLL const char *GetIlluminationZonesInfo(unsigned int index, CustomIlluminationZonesInfo *pCustomIlluminationZonesInfo)
+// Reads the metrics in metricMask of one GPU with at most one thermal and one utilization call, caller must hold the
+// GPU's lock. Metrics the GPU does not report are left out of validMask.
+static NvAPI_Status readGpuTelemetry(NvPhysicalGpuHandle gpuHandle, unsigned int metricMask, TelemetrySample &sample, unsigned long long &driverCalls)
 {
-	if (!pCustomIlluminationZonesInfo)
-		return nullptr;
-	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(index);
-	if (!gpuHandle)
-		return nullptr;
-
-	static char info[4096];
-	std::stringstream infoStream;
-	NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS illuminationZonesInfo = {0};
-	illuminationZonesInfo.version = NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS_VER;
-	NvAPI_Status status = NvAPI_GPU_ClientIllumZonesGetInfo(gpuHandle, &illuminationZonesInfo);
-
-	if (status == NVAPI_OK)
+	memset(&sample, 0, sizeof(sample));
+	if (metricMask & (1u << TELEMETRY_METRIC_GPU_TEMPERATURE))
 	{
-		pCustomIlluminationZonesInfo->numIllumZones = illuminationZonesInfo.numIllumZones;
-		infoStream << "Number of Illumination Zones: " << illuminationZonesInfo.numIllumZones << "\n";
-
-		for (unsigned int i = 0; i < illuminationZonesInfo.numIllumZones; ++i)
+		NV_GPU_THERMAL_SETTINGS thermal;
+		memset(&thermal, 0, sizeof(thermal));
+		thermal.version = NV_GPU_THERMAL_SETTINGS_VER;
+		driverCalls++;
+		NvAPI_Status status = checkGpuStatus(nvapi().GPU_GetThermalSettings(gpuHandle, NVAPI_THERMAL_TARGET_ALL, &thermal));
+		if (status != NVAPI_OK)
+			return status;
+		for (NvU32 i = 0; i < thermal.count && i < NVAPI_MAX_THERMAL_SENSORS_PER_GPU; ++i)
 		{
-			const auto &illuminationZone = illuminationZonesInfo.zones[i];
-			auto &zoneData = pCustomIlluminationZonesInfo->zones[i];
-
-			// Zone Type
-			const char *zoneType = "Reserved or Unknown";
-			switch (illuminationZone.type)
-			{
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
-				zoneType = "RGB";
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
-				zoneType = "Color Fixed";
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
-				zoneType = "RGBW";
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
-				zoneType = "Single Color";
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID:
-				zoneType = "Invalid";
-				break;
-			}
-			strncpy_s(zoneData.zoneType, sizeof(zoneData.zoneType), zoneType, _TRUNCATE);
-			infoStream << "\tType: " << zoneType << "\n";
-
-			// Zone Location
-			const char *zoneLocation = "Reserved or Unknown";
-			switch (illuminationZone.zoneLocation)
-			{
-			case NV_GPU_CLIENT_ILLUM_ZONE_LOCATION_GPU_TOP_0:
-				zoneLocation = "GPU Top";
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_LOCATION_GPU_FRONT_0:
-				zoneLocation = "GPU Front";
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_LOCATION_GPU_BACK_0:
-				zoneLocation = "GPU Back";
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_LOCATION_SLI_TOP_0:
-				zoneLocation = "SLI Top";
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_LOCATION_INVALID:
-				zoneLocation = "Invalid";
-				break;
-			}
-			strncpy_s(zoneData.zoneLocation, sizeof(zoneData.zoneLocation), zoneLocation, _TRUNCATE);
-			infoStream << "\tLocation: " << zoneLocation << "\n";
+			if (thermal.sensor[i].target != NVAPI_THERMAL_TARGET_GPU)
+				continue;
+			sample.values[TELEMETRY_METRIC_GPU_TEMPERATURE] = static_cast<float>(thermal.sensor[i].currentTemp);
+			sample.validMask |= 1u << TELEMETRY_METRIC_GPU_TEMPERATURE;
+			break;
 		}
 	}
-	else
+	if (metricMask & ~(1u << TELEMETRY_METRIC_GPU_TEMPERATURE))
 	{
-		infoStream << "Failed to get Illumination Zones Info: " << GetNvApiErrorMessage(status);
-		pCustomIlluminationZonesInfo->numIllumZones = 0;
+		NV_GPU_DYNAMIC_PSTATES_INFO_EX pstates;
+		memset(&pstates, 0, sizeof(pstates));
+		pstates.version = NV_GPU_DYNAMIC_PSTATES_INFO_EX_VER;
+		driverCalls++;
+		NvAPI_Status status = checkGpuStatus(nvapi().GPU_GetDynamicPstatesInfoEx(gpuHandle, &pstates));
+		if (status != NVAPI_OK)
+			return status;
+		// utilization domains 0 to 2 are graphics, frame buffer and video, in the order of the metrics
+		for (unsigned int domain = 0; domain < 3; ++domain)
+		{
+			unsigned int metric = TELEMETRY_METRIC_GPU_UTILIZATION + domain;
+			if (!(metricMask & (1u << metric)) || !pstates.utilization[domain].bIsPresent)
+				continue;
+			sample.values[metric] = static_cast<float>(pstates.utilization[domain].percentage);
+			sample.validMask |= 1u << metric;
+		}
 	}
-	strncpy_s(info, sizeof(info), infoStream.str().c_str(), _TRUNCATE);
-	return info;
+	return NVAPI_OK;
 }
 
-NVAPI_DLL void printManualSingleColorData(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_DATA_MANUAL_SINGLE_COLOR_PARAMS *singleColorParams, std::stringstream &infoStream)
+void sampleGpuTelemetry(const unsigned int (&metricMasks)[NVAPI_MAX_PHYSICAL_GPUS], TelemetrySample (&samples)[NVAPI_MAX_PHYSICAL_GPUS],
+						NvAPI_Status (&statuses)[NVAPI_MAX_PHYSICAL_GPUS], unsigned long long &driverCalls)
 {
-	infoStream << "brightnessPct: " << (int)singleColorParams->brightnessPct << "\n";
+	NvPhysicalGpuHandle handles[NVAPI_MAX_PHYSICAL_GPUS];
+	NvU32 count = 0;
+	NvAPI_Status setStatus = readGpuHandleSet(handles, count);
+	for (unsigned int gpuIndex = 0; gpuIndex < NVAPI_MAX_PHYSICAL_GPUS; ++gpuIndex)
+	{
+		if (!metricMasks[gpuIndex])
+			continue;
+		if (setStatus != NVAPI_OK || gpuIndex >= count)
+		{
+			statuses[gpuIndex] = setStatus != NVAPI_OK ? setStatus : NVAPI_NVIDIA_DEVICE_NOT_FOUND;
+			continue;
+		}
+		std::lock_guard<std::mutex> lock(gpuLock(gpuIndex));
+		statuses[gpuIndex] = readGpuTelemetry(handles[gpuIndex], metricMasks[gpuIndex], samples[gpuIndex], driverCalls);
+	}
 }
-NVAPI_DLL void printManualRGBWData(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_DATA_MANUAL_RGBW_PARAMS *rgbwParams, std::stringstream &infoStream)
+
+// Reads every telemetry metric of the GPU in two driver calls
+NVAPI_DLL bool GetGpuTelemetry(unsigned int gpuIndex, TelemetrySample *pSample)
 {
-	infoStream << "colorR: " << (int)rgbwParams->colorR << ", "
-			   << "colorG: " << (int)rgbwParams->colorG << ", "
-			   << "colorB: " << (int)rgbwParams->colorB << ", "
-			   << "colorW: " << (int)rgbwParams->colorW << ", "
-			   << "brightnessPct: " << (int)rgbwParams->brightnessPct << "\n";
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_GPU_TELEMETRY);
+	if (!pSample)
+		return false;
+	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(gpuIndex);
+	if (!gpuHandle)
+		return false;
+	unsigned long long driverCalls = 0;
+	std::lock_guard<std::mutex> lock(gpuLock(gpuIndex));
+	return readGpuTelemetry(gpuHandle, (1u << TELEMETRY_METRIC_COUNT) - 1, *pSample, driverCalls) == NVAPI_OK;
 }
-NVAPI_DLL void printManualRGBData(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_DATA_MANUAL_RGB_PARAMS *rgbParams, std::stringstream &infoStream)
+
+static const char *zoneTypeName(NV_GPU_CLIENT_ILLUM_ZONE_TYPE type)
 {
-	infoStream << "colorR: " << (int)rgbParams->colorR << ", "
-			   << "colorG: " << (int)rgbParams->colorG << ", "
-			   << "colorB: " << (int)rgbParams->colorB << ", "
-			   << "brightnessPct: " << (int)rgbParams->brightnessPct << "\n";
+	switch (type)
+	{
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
+		return "RGB";
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
+		return "Color Fixed";
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
+		return "RGBW";
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
+		return "Single Color";
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID:
+		return "Invalid";
+	default:
+		return "Reserved or Unknown";
+	}
 }
-NVAPI_DLL void printPiecewiseLinearData(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_DATA_PIECEWISE_LINEAR *piecewiseLinearData, std::stringstream &infoStream)
+static const char *zoneLocationName(NV_GPU_CLIENT_ILLUM_ZONE_LOCATION location)
 {
-	infoStream << "cycleType: " << (int)piecewiseLinearData->cycleType << ", "
-			   << "grpCount: " << (int)piecewiseLinearData->grpCount << ", "
-			   << "riseTimems: " << (int)piecewiseLinearData->riseTimems << ", "
-			   << "fallTimems: " << (int)piecewiseLinearData->fallTimems << ", "
-			   << "ATimems: " << (int)piecewiseLinearData->ATimems << ", "
-			   << "BTimems: " << (int)piecewiseLinearData->BTimems << ", "
-			   << "grpIdleTimems: " << (int)piecewiseLinearData->grpIdleTimems << ", "
-			   << "phaseOffsetms: " << (int)piecewiseLinearData->phaseOffsetms << "\n";
+	switch (location)
+	{
+	case NV_GPU_CLIENT_ILLUM_ZONE_LOCATION_GPU_TOP_0:
+		return "GPU Top";
+	case NV_GPU_CLIENT_ILLUM_ZONE_LOCATION_GPU_FRONT_0:
+		return "GPU Front";
+	case NV_GPU_CLIENT_ILLUM_ZONE_LOCATION_GPU_BACK_0:
+		return "GPU Back";
+	case NV_GPU_CLIENT_ILLUM_ZONE_LOCATION_SLI_TOP_0:
+		return "SLI Top";
+	case NV_GPU_CLIENT_ILLUM_ZONE_LOCATION_INVALID:
+		return "Invalid";
+	default:
+		return "Reserved or Unknown";
+	}
 }
-NVAPI_DLL void parsePiecewiseLinearData(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_DATA_PIECEWISE_LINEAR *src, CustomPiecewiseLinear *dst)
+static const char *controlModeName(NV_GPU_CLIENT_ILLUM_CTRL_MODE ctrlMode)
+{
+	switch (ctrlMode)
+	{
+	case NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL:
+		return "Manual";
+	case NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR:
+		return "Piecewise Linear";
+	case NV_GPU_CLIENT_ILLUM_CTRL_MODE_INVALID:
+		return "Invalid";
+	default:
+		return "Reserved or Unknown";
+	}
+}
+static const char *cycleTypeName(NV_GPU_CLIENT_ILLUM_PIECEWISE_LINEAR_CYCLE_TYPE cycleType)
 {
-	const char *cycleType = "Reserved or Unknown";
-	switch (src->cycleType)
+	switch (cycleType)
 	{
 	case NV_GPU_CLIENT_ILLUM_PIECEWISE_LINEAR_CYCLE_HALF_HALT:
-		cycleType = "Half Halt";
-		break;
+		return "Half Halt";
 	case NV_GPU_CLIENT_ILLUM_PIECEWISE_LINEAR_CYCLE_FULL_HALT:
-		cycleType = "Full Halt";
-		break;
+		return "Full Halt";
 	case NV_GPU_CLIENT_ILLUM_PIECEWISE_LINEAR_CYCLE_FULL_REPEAT:
-		cycleType = "Full Repeat";
-		break;
+		return "Full Repeat";
 	case NV_GPU_CLIENT_ILLUM_PIECEWISE_LINEAR_CYCLE_INVALID:
-		cycleType = "Invalid";
-		break;
+		return "Invalid";
+	default:
+		return "Reserved or Unknown";
 	}
-	strncpy_s(dst->cycleType, sizeof(dst->cycleType), cycleType, _TRUNCATE);
-	dst->grpCount = src->grpCount;
-	dst->riseTimeMs = src->riseTimems;
-	dst->fallTimeMs = src->fallTimems;
-	dst->aTimeMs = src->ATimems;
-	dst->bTimeMs = src->BTimems;
-	dst->idleTimeMs = src->grpIdleTimems;
-	dst->phaseOffsetMs = src->phaseOffsetms;
 }
 
-NVAPI_DLL const char *GetIlluminationZonesControl(unsigned int index, bool useDefault, CustomIlluminationZoneControls *pCustomIlluminationZoneControls)
+// Bounded text writer for the diagnostic dumps, keeps counting past the end of the buffer so callers learn the
+// size they would have needed
+struct TextSink
 {
-	if (!pCustomIlluminationZoneControls)
-		return nullptr;
-	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(index);
-	if (!gpuHandle)
-		return nullptr;
+	char *buffer;
+	size_t size;
+	size_t length;
+};
+static void appendText(TextSink &sink, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	bool hasRoom = sink.buffer && sink.length < sink.size;
+	int written = vsnprintf(hasRoom ? sink.buffer + sink.length : nullptr, hasRoom ? sink.size - sink.length : 0, format, args);
+	va_end(args);
+	if (written > 0)
+		sink.length += static_cast<size_t>(written);
+}
+// Terminates the text and reports the required size including the terminator, false if the text was truncated
+static bool finishText(TextSink &sink, size_t *pRequired)
+{
+	if (pRequired)
+		*pRequired = sink.length + 1;
+	if (sink.buffer && sink.size > 0 && sink.length >= sink.size)
+		sink.buffer[sink.size - 1] = '\0';
+	return sink.buffer && sink.length < sink.size;
+}
 
-	static char info[4096];
-	std::stringstream infoStream;
-	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS controlParams = {0};
-	controlParams.version = NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS_VER;
-	controlParams.bDefault = useDefault ? NV_TRUE : NV_FALSE;
+static void fillZonesInfo(const NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS &illuminationZonesInfo, CustomIlluminationZonesInfo *pCustomIlluminationZonesInfo)
+{
+	pCustomIlluminationZonesInfo->numIllumZones = illuminationZonesInfo.numIllumZones;
+	for (unsigned int i = 0; i < illuminationZonesInfo.numIllumZones; ++i)
+	{
+		const auto &illuminationZone = illuminationZonesInfo.zones[i];
+		auto &zoneData = pCustomIlluminationZonesInfo->zones[i];
+		strncpy_s(zoneData.zoneType, sizeof(zoneData.zoneType), zoneTypeName(illuminationZone.type), _TRUNCATE);
+		strncpy_s(zoneData.zoneLocation, sizeof(zoneData.zoneLocation), zoneLocationName(illuminationZone.zoneLocation), _TRUNCATE);
+	}
+}
 
-	NvAPI_Status status = NvAPI_GPU_ClientIllumZonesGetControl(gpuHandle, &controlParams);
+static void formatZonesInfo(NvAPI_Status status, const NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS &illuminationZonesInfo, TextSink &sink)
+{
 	if (status != NVAPI_OK)
 	{
-		pCustomIlluminationZoneControls->numZones = 0;
-		infoStream << "Failed to get Illumination Zones Control: " << GetNvApiErrorMessage(status);
-		strncpy_s(info, sizeof(info), infoStream.str().c_str(), sizeof(info) - 1);
-		return info;
+		appendText(sink, "Failed to get Illumination Zones Info: %s", GetNvApiErrorMessage(status));
+		return;
 	}
+	appendText(sink, "Number of Illumination Zones: %u\n", illuminationZonesInfo.numIllumZones);
+	for (unsigned int i = 0; i < illuminationZonesInfo.numIllumZones; ++i)
+	{
+		const auto &illuminationZone = illuminationZonesInfo.zones[i];
+		appendText(sink, "\tType: %s\n", zoneTypeName(illuminationZone.type));
+		appendText(sink, "\tLocation: %s\n", zoneLocationName(illuminationZone.zoneLocation));
+	}
+}
 
-	pCustomIlluminationZoneControls->numZones = controlParams.numIllumZonesControl;
-	infoStream << "Number of Illumination Zones Control: " << pCustomIlluminationZoneControls->numZones << "\n";
+static NvAPI_Status queryZonesInfo(unsigned int index, NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS &illuminationZonesInfo)
+{
+	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(index);
+	if (!gpuHandle)
+		return NVAPI_NVIDIA_DEVICE_NOT_FOUND;
+	memset(&illuminationZonesInfo, 0, sizeof(illuminationZonesInfo));
+	illuminationZonesInfo.version = NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS_VER;
+	std::lock_guard<std::mutex> lock(gpuLock(index));
+	return checkGpuStatus(nvapi().GPU_ClientIllumZonesGetInfo(gpuHandle, &illuminationZonesInfo));
+}
 
-	for (unsigned int i = 0; i < controlParams.numIllumZonesControl; ++i)
+NVAPI_DLL bool GetIlluminationZonesInfoData(unsigned int index, CustomIlluminationZonesInfo *pCustomIlluminationZonesInfo)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_ILLUMINATION_ZONES_INFO_DATA);
+	if (!pCustomIlluminationZonesInfo)
+		return false;
+	NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS illuminationZonesInfo;
+	if (queryZonesInfo(index, illuminationZonesInfo) != NVAPI_OK)
 	{
-		{
-			const auto &src = controlParams.zones[i];
-			auto &dst = pCustomIlluminationZoneControls->zones[i];
+		pCustomIlluminationZonesInfo->numIllumZones = 0;
+		return false;
+	}
+	fillZonesInfo(illuminationZonesInfo, pCustomIlluminationZonesInfo);
+	return true;
+}
 
-			// Zone Type
-			const char *zoneType = "Reserved or Unknown";
-			switch (src.type)
-			{
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
-				zoneType = "RGB";
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
-				zoneType = "Color Fixed";
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
-				zoneType = "RGBW";
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
-				zoneType = "Single Color";
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID:
-				zoneType = "Invalid";
-				break;
-			}
-			strncpy_s(dst.zoneType, sizeof(dst.zoneType), zoneType, _TRUNCATE);
-			infoStream << "Zone: " << i << " Type: " << zoneType << "\n";
+NVAPI_DLL bool FormatIlluminationZonesInfo(unsigned int index, char *buffer, size_t bufferSize, size_t *pRequired)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_FORMAT_ILLUMINATION_ZONES_INFO);
+	NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS illuminationZonesInfo;
+	NvAPI_Status status = queryZonesInfo(index, illuminationZonesInfo);
+	TextSink sink = {buffer, bufferSize, 0};
+	formatZonesInfo(status, illuminationZonesInfo, sink);
+	return finishText(sink, pRequired);
+}
 
-			// Control Mode
-			const char *controlMode = "Reserved or Unknown";
-			dst.isPiecewise = false;
-			switch (src.ctrlMode)
-			{
-			case NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL:
-				controlMode = "Manual";
-				break;
-			case NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR:
-				controlMode = "Piecewise Linear";
-				dst.isPiecewise = true;
-				break;
-			case NV_GPU_CLIENT_ILLUM_CTRL_MODE_INVALID:
-				controlMode = "Invalid";
-				break;
+NVAPI_DLL const char *GetIlluminationZonesInfo(unsigned int index, CustomIlluminationZonesInfo *pCustomIlluminationZonesInfo)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_ILLUMINATION_ZONES_INFO);
+	// Legacy entry point, fills the struct and also returns the dump. Prefer GetIlluminationZonesInfoData
+	if (!pCustomIlluminationZonesInfo)
+		return nullptr;
+	if (!GetGPUHandle(index))
+		return nullptr;
+
+	static thread_local char info[4096];
+	NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS illuminationZonesInfo;
+	NvAPI_Status status = queryZonesInfo(index, illuminationZonesInfo);
+	if (status == NVAPI_OK)
+		fillZonesInfo(illuminationZonesInfo, pCustomIlluminationZonesInfo);
+	else
+		pCustomIlluminationZonesInfo->numIllumZones = 0;
+	TextSink sink = {info, sizeof(info), 0};
+	formatZonesInfo(status, illuminationZonesInfo, sink);
+	finishText(sink, nullptr);
+	return info;
+}
+
+NVAPI_DLL bool GetIlluminationZonesInfoV2(unsigned int index, IlluminationZonesInfoV2 *pInfo)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_ILLUMINATION_ZONES_INFO_V2);
+	if (!pInfo)
+		return false;
+	NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS illuminationZonesInfo;
+	if (queryZonesInfo(index, illuminationZonesInfo) != NVAPI_OK)
+	{
+		pInfo->numZones = 0;
+		return false;
+	}
+	pInfo->numZones = illuminationZonesInfo.numIllumZones;
+	for (unsigned int i = 0; i < illuminationZonesInfo.numIllumZones; ++i)
+	{
+		pInfo->zones[i].zoneType = illuminationZonesInfo.zones[i].type;
+		pInfo->zones[i].zoneLocation = illuminationZonesInfo.zones[i].zoneLocation;
+	}
+	return true;
+}
+
+// Right after logon the driver may not be loaded yet, enumerate no GPUs or fail zone queries. Each step is retried
+// with exponential backoff until it succeeds or the timeout runs out, instead of sleeping a fixed time up front.
+static const unsigned int READY_BACKOFF_MIN_MS = 10;
+static const unsigned int READY_BACKOFF_MAX_MS = 500;
+
+struct ReadyBackoff
+{
+	unsigned int delayMs;
+	std::chrono::steady_clock::time_point deadline;
+	std::minstd_rand random;
+};
+
+// Sleeps for the current step with jitter so processes polling the driver at logon do not retry in lockstep, then
+// doubles the step. Returns false once the deadline has passed.
+static bool waitReadyBackoff(ReadyBackoff &backoff)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now >= backoff.deadline)
+		return false;
+	unsigned int sleepMs = backoff.delayMs / 2 + static_cast<unsigned int>(backoff.random() % (backoff.delayMs / 2 + 1));
+	std::this_thread::sleep_until((std::min)(now + std::chrono::milliseconds(sleepMs), backoff.deadline));
+	backoff.delayMs = (std::min)(backoff.delayMs * 2, READY_BACKOFF_MAX_MS);
+	return true;
+}
+
+static unsigned long long elapsedUs(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+{
+	return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count());
+}
+
+// Initializes NvAPI like InitializeNvApi once the driver and the zones answer. On failure NvAPI is left unloaded.
+NVAPI_DLL bool WaitForIlluminationReady(unsigned int timeoutMs, IlluminationReadyReport *pReport)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_WAIT_FOR_ILLUMINATION_READY);
+	IlluminationReadyReport report;
+	memset(&report, 0, sizeof(report));
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	ReadyBackoff backoff = {READY_BACKOFF_MIN_MS, start + std::chrono::milliseconds(timeoutMs),
+							std::minstd_rand(static_cast<unsigned int>(start.time_since_epoch().count()))};
+
+	NvAPI_Status status;
+	for (;;)
+	{
+		++report.initializeAttempts;
+		status = nvapi().Initialize();
+		if (status == NVAPI_OK)
+			break;
+		report.lastStatus = status;
+		if (!waitReadyBackoff(backoff))
+			break;
+	}
+	bool initialized = status == NVAPI_OK;
+	std::chrono::steady_clock::time_point phaseStart = std::chrono::steady_clock::now();
+	report.initializeUs = elapsedUs(start, phaseStart);
+
+	NvU32 gpuCount = 0;
+	if (initialized)
+	{
+		backoff.delayMs = READY_BACKOFF_MIN_MS;
+		for (;;)
+		{
+			++report.enumerateAttempts;
+			{
+				std::unique_lock<std::shared_mutex> lock(gpuHandleCacheLock);
+				status = rebuildGpuHandleCache();
+				gpuCount = gpuHandleCacheCount;
 			}
-			strncpy_s(dst.controlMode, sizeof(dst.controlMode), controlMode, _TRUNCATE);
-			infoStream << "\tControl Mode: " << controlMode << "\n";
+			if (status == NVAPI_OK && gpuCount > 0)
+				break;
+			report.lastStatus = status != NVAPI_OK ? status : NVAPI_NVIDIA_DEVICE_NOT_FOUND;
+			if (!waitReadyBackoff(backoff))
+				break;
+		}
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		report.enumerateUs = elapsedUs(phaseStart, now);
+		phaseStart = now;
+	}
 
-			// Data
-			switch (src.type)
+	if (gpuCount > 0)
+	{
+		// GPUs without lighting answer NVAPI_NOT_SUPPORTED, that is an answer too and is not retried
+		bool answered[NVAPI_MAX_PHYSICAL_GPUS] = {false};
+		backoff.delayMs = READY_BACKOFF_MIN_MS;
+		for (;;)
+		{
+			++report.zonesAttempts;
+			unsigned int pending = 0;
+			for (unsigned int i = 0; i < gpuCount; ++i)
 			{
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
-				switch (src.ctrlMode)
+				if (answered[i])
+					continue;
+				NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS illuminationZonesInfo;
+				status = queryZonesInfo(i, illuminationZonesInfo);
+				if (status == NVAPI_OK || status == NVAPI_NOT_SUPPORTED)
 				{
-				case NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL:
-					infoStream << "\tManual RGB, Data: ";
-					printManualRGBData(&src.data.rgb.data.manualRGB.rgbParams, infoStream);
-					dst.manualColorData.rgb = {src.data.rgb.data.manualRGB.rgbParams.colorR,
-											   src.data.rgb.data.manualRGB.rgbParams.colorG,
-											   src.data.rgb.data.manualRGB.rgbParams.colorB,
-											   src.data.rgb.data.manualRGB.rgbParams.brightnessPct};
-					break;
-				case NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR:
-					infoStream << "\tPiecewise Linear RGB, Data: ";
-					for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
-					{
-						infoStream << "\t\tEndpoint " << j << ":\n";
-						dst.piecewiseColorData[j].rgb = {src.data.rgb.data.piecewiseLinearRGB.rgbParams[j].colorR,
-														 src.data.rgb.data.piecewiseLinearRGB.rgbParams[j].colorG,
-														 src.data.rgb.data.piecewiseLinearRGB.rgbParams[j].colorB,
-														 src.data.rgb.data.piecewiseLinearRGB.rgbParams[j].brightnessPct};
-						printManualRGBData(&src.data.rgb.data.piecewiseLinearRGB.rgbParams[j], infoStream);
-					}
-					parsePiecewiseLinearData(&src.data.rgb.data.piecewiseLinearRGB.piecewiseLinearData, &dst.piecewiseData);
-					printPiecewiseLinearData(&src.data.rgb.data.piecewiseLinearRGB.piecewiseLinearData, infoStream);
-					break;
-				default:
-					break;
+					answered[i] = true;
+					if (status == NVAPI_OK && illuminationZonesInfo.numIllumZones > 0)
+						++report.readyGpuCount;
+					continue;
 				}
+				report.lastStatus = status;
+				++pending;
+			}
+			if (pending == 0 || !waitReadyBackoff(backoff))
 				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
-				switch (src.ctrlMode)
+		}
+		report.zonesUs = elapsedUs(phaseStart, std::chrono::steady_clock::now());
+	}
+
+	report.gpuCount = gpuCount;
+	report.totalUs = elapsedUs(start, std::chrono::steady_clock::now());
+	// GPUs that answered are usable even if another one timed out
+	bool ready = report.readyGpuCount > 0;
+	if (!ready)
+	{
+		// every GPU answered, none of them has lighting
+		if (report.lastStatus == NVAPI_OK)
+			report.lastStatus = NVAPI_NOT_SUPPORTED;
+		perfRecordStatus(report.lastStatus);
+		if (initialized)
+		{
+			dropGpuHandleCache();
+			nvapi().Unload();
+		}
+	}
+	if (pReport)
+		*pReport = report;
+	return ready;
+}
+
+static void printManualSingleColorData(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_DATA_MANUAL_SINGLE_COLOR_PARAMS *singleColorParams, TextSink &sink)
+{
+	appendText(sink, "brightnessPct: %d\n", (int)singleColorParams->brightnessPct);
+}
+static void printManualRGBWData(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_DATA_MANUAL_RGBW_PARAMS *rgbwParams, TextSink &sink)
+{
+	appendText(sink, "colorR: %d, colorG: %d, colorB: %d, colorW: %d, brightnessPct: %d\n",
+			   (int)rgbwParams->colorR, (int)rgbwParams->colorG, (int)rgbwParams->colorB, (int)rgbwParams->colorW, (int)rgbwParams->brightnessPct);
+}
+static void printManualRGBData(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_DATA_MANUAL_RGB_PARAMS *rgbParams, TextSink &sink)
+{
+	appendText(sink, "colorR: %d, colorG: %d, colorB: %d, brightnessPct: %d\n",
+			   (int)rgbParams->colorR, (int)rgbParams->colorG, (int)rgbParams->colorB, (int)rgbParams->brightnessPct);
+}
+static void printPiecewiseLinearData(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_DATA_PIECEWISE_LINEAR *piecewiseLinearData, TextSink &sink)
+{
+	appendText(sink, "cycleType: %d, grpCount: %d, riseTimems: %d, fallTimems: %d, ATimems: %d, BTimems: %d, grpIdleTimems: %d, phaseOffsetms: %d\n",
+			   (int)piecewiseLinearData->cycleType, (int)piecewiseLinearData->grpCount,
+			   (int)piecewiseLinearData->riseTimems, (int)piecewiseLinearData->fallTimems,
+			   (int)piecewiseLinearData->ATimems, (int)piecewiseLinearData->BTimems,
+			   (int)piecewiseLinearData->grpIdleTimems, (int)piecewiseLinearData->phaseOffsetms);
+}
+NVAPI_DLL void parsePiecewiseLinearData(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_DATA_PIECEWISE_LINEAR *src, CustomPiecewiseLinear *dst)
+{
+	strncpy_s(dst->cycleType, sizeof(dst->cycleType), cycleTypeName(src->cycleType), _TRUNCATE);
+	dst->grpCount = src->grpCount;
+	dst->riseTimeMs = src->riseTimems;
+	dst->fallTimeMs = src->fallTimems;
+	dst->aTimeMs = src->ATimems;
+	dst->bTimeMs = src->BTimems;
+	dst->idleTimeMs = src->grpIdleTimems;
+	dst->phaseOffsetMs = src->phaseOffsetms;
+}
+// Inverse of parsePiecewiseLinearData, fails on cycle types the driver cannot be asked to run
+static bool buildPiecewiseLinearData(const CustomPiecewiseLinear *src, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_DATA_PIECEWISE_LINEAR *dst)
+{
+	if (strcmp(src->cycleType, "Half Halt") == 0)
+		dst->cycleType = NV_GPU_CLIENT_ILLUM_PIECEWISE_LINEAR_CYCLE_HALF_HALT;
+	else if (strcmp(src->cycleType, "Full Halt") == 0)
+		dst->cycleType = NV_GPU_CLIENT_ILLUM_PIECEWISE_LINEAR_CYCLE_FULL_HALT;
+	else if (strcmp(src->cycleType, "Full Repeat") == 0)
+		dst->cycleType = NV_GPU_CLIENT_ILLUM_PIECEWISE_LINEAR_CYCLE_FULL_REPEAT;
+	else
+		return false;
+	dst->grpCount = src->grpCount;
+	dst->riseTimems = src->riseTimeMs;
+	dst->fallTimems = src->fallTimeMs;
+	dst->ATimems = src->aTimeMs;
+	dst->BTimems = src->bTimeMs;
+	dst->grpIdleTimems = src->idleTimeMs;
+	dst->phaseOffsetms = src->phaseOffsetMs;
+	return true;
+}
+
+static void fillZonesControl(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS &controlParams, CustomIlluminationZoneControls *pCustomIlluminationZoneControls)
+{
+	pCustomIlluminationZoneControls->numZones = controlParams.numIllumZonesControl;
+	for (unsigned int i = 0; i < controlParams.numIllumZonesControl; ++i)
+	{
+		const auto &src = controlParams.zones[i];
+		auto &dst = pCustomIlluminationZoneControls->zones[i];
+		strncpy_s(dst.zoneType, sizeof(dst.zoneType), zoneTypeName(src.type), _TRUNCATE);
+		strncpy_s(dst.controlMode, sizeof(dst.controlMode), controlModeName(src.ctrlMode), _TRUNCATE);
+		dst.isPiecewise = src.ctrlMode == NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR;
+
+		switch (src.type)
+		{
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
+			if (src.ctrlMode == NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL)
+			{
+				const auto &rgbParams = src.data.rgb.data.manualRGB.rgbParams;
+				dst.manualColorData.rgb = {rgbParams.colorR, rgbParams.colorG, rgbParams.colorB, rgbParams.brightnessPct};
+			}
+			else if (dst.isPiecewise)
+			{
+				const auto &piecewiseRGB = src.data.rgb.data.piecewiseLinearRGB;
+				for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+					dst.piecewiseColorData[j].rgb = {piecewiseRGB.rgbParams[j].colorR, piecewiseRGB.rgbParams[j].colorG,
+													 piecewiseRGB.rgbParams[j].colorB, piecewiseRGB.rgbParams[j].brightnessPct};
+				parsePiecewiseLinearData(&piecewiseRGB.piecewiseLinearData, &dst.piecewiseData);
+			}
+			break;
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
+			if (src.ctrlMode == NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL)
+				dst.manualColorData.singleColor = {src.data.colorFixed.data.manualColorFixed.colorFixedParams.brightnessPct};
+			else if (dst.isPiecewise)
+			{
+				const auto &piecewiseColorFixed = src.data.colorFixed.data.piecewiseLinearColorFixed;
+				for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+					dst.piecewiseColorData[j].singleColor = {piecewiseColorFixed.colorFixedParams[j].brightnessPct};
+				parsePiecewiseLinearData(&piecewiseColorFixed.piecewiseLinearData, &dst.piecewiseData);
+			}
+			break;
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
+			if (src.ctrlMode == NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL)
+			{
+				const auto &rgbwParams = src.data.rgbw.data.manualRGBW.rgbwParams;
+				dst.manualColorData.rgbw = {rgbwParams.colorR, rgbwParams.colorG, rgbwParams.colorB, rgbwParams.colorW, rgbwParams.brightnessPct};
+			}
+			else if (dst.isPiecewise)
+			{
+				const auto &piecewiseRGBW = src.data.rgbw.data.piecewiseLinearRGBW;
+				for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+					dst.piecewiseColorData[j].rgbw = {piecewiseRGBW.rgbwParams[j].colorR, piecewiseRGBW.rgbwParams[j].colorG,
+													  piecewiseRGBW.rgbwParams[j].colorB, piecewiseRGBW.rgbwParams[j].colorW,
+													  piecewiseRGBW.rgbwParams[j].brightnessPct};
+				parsePiecewiseLinearData(&piecewiseRGBW.piecewiseLinearData, &dst.piecewiseData);
+			}
+			break;
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
+			if (src.ctrlMode == NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL)
+				dst.manualColorData.singleColor = {src.data.singleColor.data.manualSingleColor.singleColorParams.brightnessPct};
+			else if (dst.isPiecewise)
+			{
+				const auto &piecewiseSingleColor = src.data.singleColor.data.piecewiseLinearSingleColor;
+				for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+					dst.piecewiseColorData[j].singleColor = {piecewiseSingleColor.singleColorParams[j].brightnessPct};
+				parsePiecewiseLinearData(&piecewiseSingleColor.piecewiseLinearData, &dst.piecewiseData);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void formatZonesControl(NvAPI_Status status, const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS &controlParams, TextSink &sink)
+{
+	if (status != NVAPI_OK)
+	{
+		appendText(sink, "Failed to get Illumination Zones Control: %s", GetNvApiErrorMessage(status));
+		return;
+	}
+	appendText(sink, "Number of Illumination Zones Control: %u\n", controlParams.numIllumZonesControl);
+	for (unsigned int i = 0; i < controlParams.numIllumZonesControl; ++i)
+	{
+		const auto &src = controlParams.zones[i];
+		appendText(sink, "Zone: %u Type: %s\n", i, zoneTypeName(src.type));
+		appendText(sink, "\tControl Mode: %s\n", controlModeName(src.ctrlMode));
+
+		bool isManual = src.ctrlMode == NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL;
+		bool isPiecewise = src.ctrlMode == NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR;
+		switch (src.type)
+		{
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
+			if (isManual)
+			{
+				appendText(sink, "\tManual RGB, Data: ");
+				printManualRGBData(&src.data.rgb.data.manualRGB.rgbParams, sink);
+			}
+			else if (isPiecewise)
+			{
+				appendText(sink, "\tPiecewise Linear RGB, Data: ");
+				for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
 				{
-				case NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL:
-					infoStream << "\tManual Color Fixed, Data: Brightness: "
-							   << (int)src.data.colorFixed.data.manualColorFixed.colorFixedParams.brightnessPct << "\n";
-					dst.manualColorData.singleColor = {src.data.colorFixed.data.manualColorFixed.colorFixedParams.brightnessPct};
-					break;
-				case NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR:
-					infoStream << "\tPiecewise Linear Color Fixed, Data: ";
-					for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
-					{
-						if (j != 0)
-							infoStream << "\t";
-						infoStream << "\t\tEndpoint " << j << ":\n"
-								   << "Brightness: "
-								   << (int)src.data.colorFixed.data.piecewiseLinearColorFixed.colorFixedParams[j].brightnessPct << "\n";
-						dst.piecewiseColorData[j].singleColor = {src.data.colorFixed.data.piecewiseLinearColorFixed.colorFixedParams[j].brightnessPct};
-					}
-					parsePiecewiseLinearData(&src.data.colorFixed.data.piecewiseLinearColorFixed.piecewiseLinearData, &dst.piecewiseData);
-					printPiecewiseLinearData(&src.data.colorFixed.data.piecewiseLinearColorFixed.piecewiseLinearData, infoStream);
-					break;
-				default:
-					break;
+					appendText(sink, "\t\tEndpoint %d:\n", j);
+					printManualRGBData(&src.data.rgb.data.piecewiseLinearRGB.rgbParams[j], sink);
 				}
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
-				switch (src.ctrlMode)
+				printPiecewiseLinearData(&src.data.rgb.data.piecewiseLinearRGB.piecewiseLinearData, sink);
+			}
+			break;
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
+			if (isManual)
+				appendText(sink, "\tManual Color Fixed, Data: Brightness: %d\n", (int)src.data.colorFixed.data.manualColorFixed.colorFixedParams.brightnessPct);
+			else if (isPiecewise)
+			{
+				appendText(sink, "\tPiecewise Linear Color Fixed, Data: ");
+				for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+					appendText(sink, "%s\t\tEndpoint %d:\nBrightness: %d\n", j != 0 ? "\t" : "", j,
+							   (int)src.data.colorFixed.data.piecewiseLinearColorFixed.colorFixedParams[j].brightnessPct);
+				printPiecewiseLinearData(&src.data.colorFixed.data.piecewiseLinearColorFixed.piecewiseLinearData, sink);
+			}
+			break;
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
+			if (isManual)
+			{
+				appendText(sink, "\tManual RGBW, Data: ");
+				printManualRGBWData(&src.data.rgbw.data.manualRGBW.rgbwParams, sink);
+			}
+			else if (isPiecewise)
+			{
+				appendText(sink, "\tPiecewise Linear RGBW, Data: ");
+				for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
 				{
-				case NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL:
-					infoStream << "\tManual RGBW, Data: ";
-					printManualRGBWData(&src.data.rgbw.data.manualRGBW.rgbwParams, infoStream);
-					dst.manualColorData.rgbw = {src.data.rgbw.data.manualRGBW.rgbwParams.colorR,
-												src.data.rgbw.data.manualRGBW.rgbwParams.colorG,
-												src.data.rgbw.data.manualRGBW.rgbwParams.colorB,
-												src.data.rgbw.data.manualRGBW.rgbwParams.colorW,
-												src.data.rgbw.data.manualRGBW.rgbwParams.brightnessPct};
-					break;
-				case NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR:
-					infoStream << "\tPiecewise Linear RGBW, Data: ";
-					for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
-					{
-						if (j != 0)
-							infoStream << "\t";
-						infoStream << "\t\tEndpoint " << j << ":\n";
-						printManualRGBWData(&src.data.rgbw.data.piecewiseLinearRGBW.rgbwParams[j], infoStream);
-						dst.piecewiseColorData[j].rgbw = {src.data.rgbw.data.piecewiseLinearRGBW.rgbwParams[j].colorR,
-														  src.data.rgbw.data.piecewiseLinearRGBW.rgbwParams[j].colorG,
-														  src.data.rgbw.data.piecewiseLinearRGBW.rgbwParams[j].colorB,
-														  src.data.rgbw.data.piecewiseLinearRGBW.rgbwParams[j].colorW,
-														  src.data.rgbw.data.piecewiseLinearRGBW.rgbwParams[j].brightnessPct};
-					}
-					parsePiecewiseLinearData(&src.data.rgbw.data.piecewiseLinearRGBW.piecewiseLinearData, &dst.piecewiseData);
-					printPiecewiseLinearData(&src.data.rgbw.data.piecewiseLinearRGBW.piecewiseLinearData, infoStream);
-					break;
-				default:
-					break;
+					appendText(sink, "%s\t\tEndpoint %d:\n", j != 0 ? "\t" : "", j);
+					printManualRGBWData(&src.data.rgbw.data.piecewiseLinearRGBW.rgbwParams[j], sink);
 				}
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
-				switch (src.ctrlMode)
+				printPiecewiseLinearData(&src.data.rgbw.data.piecewiseLinearRGBW.piecewiseLinearData, sink);
+			}
+			break;
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
+			if (isManual)
+			{
+				appendText(sink, "\tManual Single Color, Data: ");
+				printManualSingleColorData(&src.data.singleColor.data.manualSingleColor.singleColorParams, sink);
+			}
+			else if (isPiecewise)
+			{
+				appendText(sink, "\tPiecewise Linear Single Color, Data: ");
+				for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
 				{
-				case NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL:
-					infoStream << "\tManual Single Color, Data: ";
-					printManualSingleColorData(&src.data.singleColor.data.manualSingleColor.singleColorParams, infoStream);
-					dst.manualColorData.singleColor = {src.data.singleColor.data.manualSingleColor.singleColorParams.brightnessPct};
-					break;
-				case NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR:
-					infoStream << "\tPiecewise Linear Single Color, Data: ";
-					for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
-					{
-						if (j != 0)
-							infoStream << "\t";
-						infoStream << "\t\tEndpoint " << j << ":\n";
-						printManualSingleColorData(&src.data.singleColor.data.piecewiseLinearSingleColor.singleColorParams[j], infoStream);
-						dst.piecewiseColorData[j].singleColor = {src.data.singleColor.data.piecewiseLinearSingleColor.singleColorParams[j].brightnessPct};
-					}
-					parsePiecewiseLinearData(&src.data.singleColor.data.piecewiseLinearSingleColor.piecewiseLinearData, &dst.piecewiseData);
-					printPiecewiseLinearData(&src.data.singleColor.data.piecewiseLinearSingleColor.piecewiseLinearData, infoStream);
-					break;
-				default:
-					break;
+					appendText(sink, "%s\t\tEndpoint %d:\n", j != 0 ? "\t" : "", j);
+					printManualSingleColorData(&src.data.singleColor.data.piecewiseLinearSingleColor.singleColorParams[j], sink);
 				}
-				break;
-			case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID:
-				infoStream << "Invalid Type.\n";
-				break;
-			default:
-				infoStream << "Reserved or Unknown type.\n";
-				break;
+				printPiecewiseLinearData(&src.data.singleColor.data.piecewiseLinearSingleColor.piecewiseLinearData, sink);
 			}
+			break;
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID:
+			appendText(sink, "Invalid Type.\n");
+			break;
+		default:
+			appendText(sink, "Reserved or Unknown type.\n");
+			break;
 		}
 	}
-	infoStream << "\n";
-	strncpy_s(info, sizeof(info), infoStream.str().c_str(), sizeof(info) - 1);
-	return info;
+	appendText(sink, "\n");
 }
 
-NVAPI_DLL bool SetIlluminationZoneManualRGB(unsigned int gpuIndex, unsigned int zoneIndex, uint8_t red, uint8_t green, uint8_t blue, uint8_t brightness, bool Default = false)
+static NvAPI_Status queryZonesControl(unsigned int index, bool useDefault, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS &controlParams)
 {
-	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(gpuIndex);
+	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(index);
 	if (!gpuHandle)
-		return false;
+		return NVAPI_NVIDIA_DEVICE_NOT_FOUND;
+	memset(&controlParams, 0, sizeof(controlParams));
+	controlParams.version = NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS_VER;
+	controlParams.bDefault = useDefault ? NV_TRUE : NV_FALSE;
+	std::lock_guard<std::mutex> lock(gpuLock(index));
+	NvAPI_Status status = checkGpuStatus(nvapi().GPU_ClientIllumZonesGetControl(gpuHandle, &controlParams));
+	// an explicit query is the freshest state we have, keep the shadow in sync with it
+	if (status == NVAPI_OK)
+		storeShadowControl(gpuShadowStates[index], useDefault, controlParams);
+	return status;
+}
 
-	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS illumControlParams = {0};
-	illumControlParams.version = NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS_VER;
-	illumControlParams.bDefault = NV_FALSE;
+NvAPI_Status sampleIlluminationControl(unsigned int gpuIndex, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS &params)
+{
+	return queryZonesControl(gpuIndex, false, params);
+}
 
-	// Read the current zone configuration to preserve other zones configuration
-	if (NvAPI_GPU_ClientIllumZonesGetControl(gpuHandle, &illumControlParams) != NVAPI_OK)
+NVAPI_DLL bool GetIlluminationZonesControlData(unsigned int index, bool useDefault, CustomIlluminationZoneControls *pCustomIlluminationZoneControls)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_ILLUMINATION_ZONES_CONTROL_DATA);
+	if (!pCustomIlluminationZoneControls)
 		return false;
-	if (zoneIndex >= illumControlParams.numIllumZonesControl)
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS controlParams;
+	if (queryZonesControl(index, useDefault, controlParams) != NVAPI_OK)
+	{
+		pCustomIlluminationZoneControls->numZones = 0;
 		return false;
+	}
+	fillZonesControl(controlParams, pCustomIlluminationZoneControls);
+	return true;
+}
 
-	// check if the zone is actually manual control RGB
-	auto &illuminationZoneControl = illumControlParams.zones[zoneIndex];
-	if (illuminationZoneControl.type != NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB)
-		return false;
-	if (illuminationZoneControl.ctrlMode != NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL)
-		return false;
+NVAPI_DLL bool FormatIlluminationZonesControl(unsigned int index, bool useDefault, char *buffer, size_t bufferSize, size_t *pRequired)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_FORMAT_ILLUMINATION_ZONES_CONTROL);
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS controlParams;
+	NvAPI_Status status = queryZonesControl(index, useDefault, controlParams);
+	TextSink sink = {buffer, bufferSize, 0};
+	formatZonesControl(status, controlParams, sink);
+	return finishText(sink, pRequired);
+}
 
-	// Populate RGB Data
-	auto &rgbData = illuminationZoneControl.data.rgb.data.manualRGB.rgbParams;
-	rgbData.colorR = red;
-	rgbData.colorG = green;
-	rgbData.colorB = blue;
-	rgbData.brightnessPct = brightness;
+NVAPI_DLL const char *GetIlluminationZonesControl(unsigned int index, bool useDefault, CustomIlluminationZoneControls *pCustomIlluminationZoneControls)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_ILLUMINATION_ZONES_CONTROL);
+	// Legacy entry point, fills the struct and also returns the dump. Prefer GetIlluminationZonesControlData
+	if (!pCustomIlluminationZoneControls)
+		return nullptr;
+	if (!GetGPUHandle(index))
+		return nullptr;
 
-	if (Default)
-		illumControlParams.bDefault = NV_TRUE;
+	static thread_local char info[4096];
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS controlParams;
+	NvAPI_Status status = queryZonesControl(index, useDefault, controlParams);
+	if (status == NVAPI_OK)
+		fillZonesControl(controlParams, pCustomIlluminationZoneControls);
 	else
-		illumControlParams.bDefault = NV_FALSE;
-	return NvAPI_GPU_ClientIllumZonesSetControl(gpuHandle, &illumControlParams) == NVAPI_OK;
+		pCustomIlluminationZoneControls->numZones = 0;
+	TextSink sink = {info, sizeof(info), 0};
+	formatZonesControl(status, controlParams, sink);
+	finishText(sink, nullptr);
+	return info;
 }
-NVAPI_DLL bool SetIlluminationZoneManualRGBW(unsigned int gpuIndex, unsigned int zoneIndex, uint8_t red, uint8_t green, uint8_t blue, uint8_t white, uint8_t brightness, bool Default = false)
+
+void fillZoneControlV2(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_V1 &src, IlluminationZoneControlV2 &dst)
 {
-	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(gpuIndex);
-	if (!gpuHandle)
-		return false;
-	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS illumControlParams = {0};
-	illumControlParams.version = NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS_VER;
-	if (NvAPI_GPU_ClientIllumZonesGetControl(gpuHandle, &illumControlParams) != NVAPI_OK)
+	memset(&dst, 0, sizeof(dst));
+	dst.zoneType = src.type;
+	dst.ctrlMode = src.ctrlMode;
+	bool manual = src.ctrlMode == NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL;
+	bool piecewise = src.ctrlMode == NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR;
+	const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_DATA_PIECEWISE_LINEAR *pPiecewise = nullptr;
+	switch (src.type)
+	{
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
+		if (manual)
+		{
+			const auto &rgbParams = src.data.rgb.data.manualRGB.rgbParams;
+			dst.manualColor = {rgbParams.colorR, rgbParams.colorG, rgbParams.colorB, 0, rgbParams.brightnessPct, {}};
+		}
+		else if (piecewise)
+		{
+			const auto &piecewiseRGB = src.data.rgb.data.piecewiseLinearRGB;
+			for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+				dst.piecewiseColors[j] = {piecewiseRGB.rgbParams[j].colorR, piecewiseRGB.rgbParams[j].colorG,
+										  piecewiseRGB.rgbParams[j].colorB, 0, piecewiseRGB.rgbParams[j].brightnessPct, {}};
+			pPiecewise = &piecewiseRGB.piecewiseLinearData;
+		}
+		break;
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
+		if (manual)
+			dst.manualColor.brightness = src.data.colorFixed.data.manualColorFixed.colorFixedParams.brightnessPct;
+		else if (piecewise)
+		{
+			const auto &piecewiseColorFixed = src.data.colorFixed.data.piecewiseLinearColorFixed;
+			for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+				dst.piecewiseColors[j].brightness = piecewiseColorFixed.colorFixedParams[j].brightnessPct;
+			pPiecewise = &piecewiseColorFixed.piecewiseLinearData;
+		}
+		break;
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
+		if (manual)
+		{
+			const auto &rgbwParams = src.data.rgbw.data.manualRGBW.rgbwParams;
+			dst.manualColor = {rgbwParams.colorR, rgbwParams.colorG, rgbwParams.colorB, rgbwParams.colorW, rgbwParams.brightnessPct, {}};
+		}
+		else if (piecewise)
+		{
+			const auto &piecewiseRGBW = src.data.rgbw.data.piecewiseLinearRGBW;
+			for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+				dst.piecewiseColors[j] = {piecewiseRGBW.rgbwParams[j].colorR, piecewiseRGBW.rgbwParams[j].colorG,
+										  piecewiseRGBW.rgbwParams[j].colorB, piecewiseRGBW.rgbwParams[j].colorW,
+										  piecewiseRGBW.rgbwParams[j].brightnessPct, {}};
+			pPiecewise = &piecewiseRGBW.piecewiseLinearData;
+		}
+		break;
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
+		if (manual)
+			dst.manualColor.brightness = src.data.singleColor.data.manualSingleColor.singleColorParams.brightnessPct;
+		else if (piecewise)
+		{
+			const auto &piecewiseSingleColor = src.data.singleColor.data.piecewiseLinearSingleColor;
+			for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+				dst.piecewiseColors[j].brightness = piecewiseSingleColor.singleColorParams[j].brightnessPct;
+			pPiecewise = &piecewiseSingleColor.piecewiseLinearData;
+		}
+		break;
+	default:
+		break;
+	}
+	if (pPiecewise)
+	{
+		dst.piecewise.cycleType = pPiecewise->cycleType;
+		dst.piecewise.grpCount = pPiecewise->grpCount;
+		dst.piecewise.riseTimeMs = pPiecewise->riseTimems;
+		dst.piecewise.fallTimeMs = pPiecewise->fallTimems;
+		dst.piecewise.aTimeMs = pPiecewise->ATimems;
+		dst.piecewise.bTimeMs = pPiecewise->BTimems;
+		dst.piecewise.idleTimeMs = pPiecewise->grpIdleTimems;
+		dst.piecewise.phaseOffsetMs = pPiecewise->phaseOffsetms;
+	}
+}
+
+NVAPI_DLL bool GetIlluminationZonesControlV2(unsigned int index, bool useDefault, IlluminationZoneControlsV2 *pControls)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_GET_ILLUMINATION_ZONES_CONTROL_V2);
+	if (!pControls)
 		return false;
-	if (zoneIndex >= illumControlParams.numIllumZonesControl)
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS controlParams;
+	if (queryZonesControl(index, useDefault, controlParams) != NVAPI_OK)
+	{
+		pControls->numZones = 0;
 		return false;
+	}
+	pControls->numZones = controlParams.numIllumZonesControl;
+	for (unsigned int i = 0; i < controlParams.numIllumZonesControl; ++i)
+		fillZoneControlV2(controlParams.zones[i], pControls->zones[i]);
+	return true;
+}
 
-	// check if the zone is actually manual control RGBW
-	auto &illuminationZoneControl = illumControlParams.zones[zoneIndex];
-	if (illuminationZoneControl.type != NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW)
-		return false;
+// Display names for the enum values in the v2 structs, the same names the v1 structs carry
+NVAPI_DLL const char *GetIlluminationZoneTypeName(unsigned int zoneType)
+{
+	return zoneTypeName(static_cast<NV_GPU_CLIENT_ILLUM_ZONE_TYPE>(zoneType));
+}
+
+NVAPI_DLL const char *GetIlluminationZoneLocationName(unsigned int zoneLocation)
+{
+	return zoneLocationName(static_cast<NV_GPU_CLIENT_ILLUM_ZONE_LOCATION>(zoneLocation));
+}
+
+NVAPI_DLL const char *GetIlluminationControlModeName(unsigned int ctrlMode)
+{
+	return controlModeName(static_cast<NV_GPU_CLIENT_ILLUM_CTRL_MODE>(ctrlMode));
+}
+
+NVAPI_DLL const char *GetIlluminationCycleTypeName(unsigned int cycleType)
+{
+	return cycleTypeName(static_cast<NV_GPU_CLIENT_ILLUM_PIECEWISE_LINEAR_CYCLE_TYPE>(cycleType));
+}
+
+// Validates one update against a GetControl snapshot and patches it in place, returns the per-zone status
+static NvAPI_Status applyZoneUpdate(NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS &illumControlParams, const ZoneUpdate &update)
+{
+	if (update.zoneIndex >= illumControlParams.numIllumZonesControl)
+		return NVAPI_INVALID_ARGUMENT;
+
+	// check if the zone is of the expected type and under manual control
+	auto &illuminationZoneControl = illumControlParams.zones[update.zoneIndex];
+	if (update.zoneType != NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID && update.zoneType != static_cast<unsigned int>(illuminationZoneControl.type))
+		return NVAPI_INVALID_ARGUMENT;
 	if (illuminationZoneControl.ctrlMode != NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL)
-		return false;
+		return NVAPI_NOT_SUPPORTED;
 
-	if (Default)
-		illumControlParams.bDefault = NV_TRUE;
-	else
-		illumControlParams.bDefault = NV_FALSE;
-	auto &rgbwData = illumControlParams.zones[zoneIndex].data.rgbw.data.manualRGBW.rgbwParams;
-	rgbwData.colorR = red;
-	rgbwData.colorG = green;
-	rgbwData.colorB = blue;
-	rgbwData.colorW = white;
-	rgbwData.brightnessPct = brightness;
+	switch (illuminationZoneControl.type)
+	{
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
+	{
+		auto &rgbData = illuminationZoneControl.data.rgb.data.manualRGB.rgbParams;
+		rgbData.colorR = update.r;
+		rgbData.colorG = update.g;
+		rgbData.colorB = update.b;
+		rgbData.brightnessPct = update.brightness;
+		break;
+	}
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
+	{
+		auto &rgbwData = illuminationZoneControl.data.rgbw.data.manualRGBW.rgbwParams;
+		rgbwData.colorR = update.r;
+		rgbwData.colorG = update.g;
+		rgbwData.colorB = update.b;
+		rgbwData.colorW = update.w;
+		rgbwData.brightnessPct = update.brightness;
+		break;
+	}
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
+		illuminationZoneControl.data.singleColor.data.manualSingleColor.singleColorParams.brightnessPct = update.brightness;
+		break;
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
+		illuminationZoneControl.data.colorFixed.data.manualColorFixed.colorFixedParams.brightnessPct = update.brightness;
+		break;
+	default:
+		return NVAPI_NOT_SUPPORTED;
+	}
+	return NVAPI_OK;
+}
 
-	return NvAPI_GPU_ClientIllumZonesSetControl(gpuHandle, &illumControlParams) == NVAPI_OK;
+// Patches updates into params after running them through the GPU's zone color pipelines, the caller's updates are left
+// untouched. Returns how many updates were valid and the status of each one in pResults.
+static unsigned int applyZoneUpdates(unsigned int gpuIndex, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS &illumControlParams, const ZoneUpdate *pUpdates, unsigned int count, NvAPI_Status *pResults)
+{
+	bool colorPipelines = hasColorPipelines(gpuIndex);
+	ZoneUpdate processed[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	unsigned int validCount = 0;
+	for (unsigned int first = 0; first < count; first += NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX)
+	{
+		unsigned int chunk = (std::min)(count - first, static_cast<unsigned int>(NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX));
+		const ZoneUpdate *pChunk = pUpdates + first;
+		if (colorPipelines)
+		{
+			memcpy(processed, pChunk, chunk * sizeof(ZoneUpdate));
+			processZoneColors(gpuIndex, &illumControlParams, processed, chunk);
+			pChunk = processed;
+		}
+		for (unsigned int i = 0; i < chunk; ++i)
+		{
+			NvAPI_Status zoneStatus = applyZoneUpdate(illumControlParams, pChunk[i]);
+			if (zoneStatus == NVAPI_OK)
+				++validCount;
+			if (pResults)
+				pResults[first + i] = zoneStatus;
+		}
+	}
+	return validCount;
 }
-NVAPI_DLL bool SetIlluminationZoneManualSingleColor(unsigned int gpuIndex, unsigned int zoneIndex, uint8_t brightness, bool Default = false)
+
+NVAPI_DLL bool SetIlluminationZonesBatch(unsigned int gpuIndex, const ZoneUpdate *pUpdates, unsigned int count, bool Default, NvAPI_Status *pResults)
 {
+	PERF_EXPORT_SCOPE(PERF_EXPORT_SET_ILLUMINATION_ZONES_BATCH);
+	if (!pUpdates || count == 0)
+		return false;
 	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(gpuIndex);
 	if (!gpuHandle)
+	{
+		if (pResults)
+			for (unsigned int i = 0; i < count; ++i)
+				pResults[i] = NVAPI_NVIDIA_DEVICE_NOT_FOUND;
 		return false;
+	}
 
-	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS illumControlParams = {0};
-	illumControlParams.version = NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS_VER;
+	GpuShadowState &shadow = gpuShadowStates[gpuIndex];
+	std::lock_guard<std::mutex> lock(shadow.lock);
 
-	if (NvAPI_GPU_ClientIllumZonesGetControl(gpuHandle, &illumControlParams) != NVAPI_OK)
-		return false;
-	if (zoneIndex >= illumControlParams.numIllumZonesControl)
+	// Start from the shadowed zone configuration to preserve zones that are not part of the batch
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS illumControlParams;
+	NvAPI_Status status = readShadowControl(shadow, gpuHandle, Default, illumControlParams);
+	if (status != NVAPI_OK)
+	{
+		if (pResults)
+			for (unsigned int i = 0; i < count; ++i)
+				pResults[i] = status;
 		return false;
+	}
 
-	auto &illuminationZoneControl = illumControlParams.zones[zoneIndex];
-	if (illuminationZoneControl.type != NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR)
+	// Invalid updates are reported but do not prevent the valid ones from being committed
+	unsigned int validCount = applyZoneUpdates(gpuIndex, illumControlParams, pUpdates, count, pResults);
+	if (validCount == 0)
 		return false;
-	if (illuminationZoneControl.ctrlMode != NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL)
+
+	status = writeShadowControl(shadow, gpuHandle, Default, illumControlParams);
+	if (status != NVAPI_OK && pResults)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+			if (pResults[i] == NVAPI_OK)
+				pResults[i] = status;
+	}
+	return status == NVAPI_OK && validCount == count;
+}
+
+static bool manualZoneMatches(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_V1 &zone, const ZoneUpdate &desired)
+{
+	ZoneUpdate current;
+	if (!readManualZone(zone, current))
 		return false;
+	switch (zone.type)
+	{
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
+		return current.r == desired.r && current.g == desired.g && current.b == desired.b && current.brightness == desired.brightness;
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
+		return current.r == desired.r && current.g == desired.g && current.b == desired.b && current.w == desired.w &&
+			   current.brightness == desired.brightness;
+	default:
+		return current.brightness == desired.brightness;
+	}
+}
 
-	auto &singleColorData = illuminationZoneControl.data.singleColor.data.manualSingleColor.singleColorParams;
-	singleColorData.brightnessPct = brightness;
+bool hasIlluminationDesiredState(unsigned int gpuIndex)
+{
+	return gpuIndex < NVAPI_MAX_PHYSICAL_GPUS && gpuShadowStates[gpuIndex].desiredMask.load() != 0;
+}
 
-	if (Default)
-		illumControlParams.bDefault = NV_TRUE;
-	else
-		illumControlParams.bDefault = NV_FALSE;
-	return NvAPI_GPU_ClientIllumZonesSetControl(gpuHandle, &illumControlParams) == NVAPI_OK;
+NvAPI_Status reconcileIlluminationState(unsigned int gpuIndex, unsigned int *pDriftMask)
+{
+	*pDriftMask = 0;
+	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(gpuIndex);
+	if (!gpuHandle)
+		return NVAPI_NVIDIA_DEVICE_NOT_FOUND;
+
+	GpuShadowState &shadow = gpuShadowStates[gpuIndex];
+	std::lock_guard<std::mutex> lock(shadow.lock);
+
+	// always read the driver, the shadow cannot see writes made by other tools
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS illumControlParams;
+	memset(&illumControlParams, 0, sizeof(illumControlParams));
+	illumControlParams.version = NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS_VER;
+	illumControlParams.bDefault = NV_FALSE;
+	NvAPI_Status status = checkGpuStatus(nvapi().GPU_ClientIllumZonesGetControl(gpuHandle, &illumControlParams));
+	if (status != NVAPI_OK)
+	{
+		if (shadowInvalidateOnError.load())
+			invalidateShadow(shadow);
+		return status;
+	}
+	storeShadowControl(shadow, false, illumControlParams);
+
+	// zones that still match keep the driver's data, only drifted zones are patched back into manual control
+	unsigned int mask = shadow.desiredMask.load();
+	unsigned int driftMask = 0;
+	for (unsigned int zone = 0; zone < illumControlParams.numIllumZonesControl; ++zone)
+	{
+		if (!(mask & (1u << zone)))
+			continue;
+		auto &illuminationZoneControl = illumControlParams.zones[zone];
+		const ZoneUpdate &desired = shadow.desired[zone];
+		if (desired.zoneType != NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID && desired.zoneType != static_cast<unsigned int>(illuminationZoneControl.type))
+			continue;
+		if (manualZoneMatches(illuminationZoneControl, desired))
+			continue;
+		illuminationZoneControl.ctrlMode = NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL;
+		if (applyZoneUpdate(illumControlParams, desired) == NVAPI_OK)
+			driftMask |= 1u << zone;
+	}
+	*pDriftMask = driftMask;
+	if (driftMask == 0)
+		return NVAPI_OK;
+	return writeShadowControl(shadow, gpuHandle, false, illumControlParams);
+}
+
+NvAPI_Status commitProfileZones(unsigned int gpuIndex, const ZoneUpdate *pUpdates, unsigned int count, unsigned int gpuZoneCount, bool Default)
+{
+	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(gpuIndex);
+	if (!gpuHandle)
+		return NVAPI_NVIDIA_DEVICE_NOT_FOUND;
+
+	GpuShadowState &shadow = gpuShadowStates[gpuIndex];
+	std::lock_guard<std::mutex> lock(shadow.lock);
+
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS illumControlParams;
+	NvAPI_Status status = readShadowControl(shadow, gpuHandle, Default, illumControlParams);
+	if (status != NVAPI_OK)
+		return status;
+	if (illumControlParams.numIllumZonesControl != gpuZoneCount)
+		return NVAPI_INVALID_ARGUMENT;
+
+	// patch a copy so a rejected profile leaves the shadow untouched
+	NvAPI_Status results[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	if (count > NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX)
+		return NVAPI_INVALID_ARGUMENT;
+	if (applyZoneUpdates(gpuIndex, illumControlParams, pUpdates, count, results) != count)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+			if (results[i] != NVAPI_OK)
+				return results[i];
+	}
+	return writeShadowControl(shadow, gpuHandle, Default, illumControlParams);
+}
+
+NVAPI_DLL bool SetIlluminationZoneManualRGB(unsigned int gpuIndex, unsigned int zoneIndex, uint8_t red, uint8_t green, uint8_t blue, uint8_t brightness, bool Default = false)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_SET_ILLUMINATION_ZONE_MANUAL_RGB);
+	ZoneUpdate update = {zoneIndex, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB, red, green, blue, 0, brightness};
+	return SetIlluminationZonesBatch(gpuIndex, &update, 1, Default, nullptr);
+}
+NVAPI_DLL bool SetIlluminationZoneManualRGBW(unsigned int gpuIndex, unsigned int zoneIndex, uint8_t red, uint8_t green, uint8_t blue, uint8_t white, uint8_t brightness, bool Default = false)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_SET_ILLUMINATION_ZONE_MANUAL_RGBW);
+	ZoneUpdate update = {zoneIndex, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW, red, green, blue, white, brightness};
+	return SetIlluminationZonesBatch(gpuIndex, &update, 1, Default, nullptr);
+}
+NVAPI_DLL bool SetIlluminationZoneManualSingleColor(unsigned int gpuIndex, unsigned int zoneIndex, uint8_t brightness, bool Default = false)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_SET_ILLUMINATION_ZONE_MANUAL_SINGLE_COLOR);
+	ZoneUpdate update = {zoneIndex, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR, 0, 0, 0, 0, brightness};
+	return SetIlluminationZonesBatch(gpuIndex, &update, 1, Default, nullptr);
 }
 
 NVAPI_DLL bool SetIlluminationZoneManualColorFixed(unsigned int gpuIndex, unsigned int zoneIndex, uint8_t brightness, bool Default = false)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_SET_ILLUMINATION_ZONE_MANUAL_COLOR_FIXED);
+	ZoneUpdate update = {zoneIndex, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED, 0, 0, 0, 0, brightness};
+	return SetIlluminationZonesBatch(gpuIndex, &update, 1, Default, nullptr);
+}
+
+// Read-modify-write of a single zone through the shadow, the patch switches the control mode and fills the data
+template <typename Patch>
+static bool patchZoneControl(unsigned int gpuIndex, unsigned int zoneIndex, unsigned int zoneType, bool Default, Patch patch)
 {
 	NvPhysicalGpuHandle gpuHandle = GetGPUHandle(gpuIndex);
 	if (!gpuHandle)
 		return false;
 
-	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS illumControlParams = {0};
-	illumControlParams.version = NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS_VER;
-
-	if (NvAPI_GPU_ClientIllumZonesGetControl(gpuHandle, &illumControlParams) != NVAPI_OK)
+	GpuShadowState &shadow = gpuShadowStates[gpuIndex];
+	std::lock_guard<std::mutex> lock(shadow.lock);
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS illumControlParams;
+	if (readShadowControl(shadow, gpuHandle, Default, illumControlParams) != NVAPI_OK)
 		return false;
 	if (zoneIndex >= illumControlParams.numIllumZonesControl)
 		return false;
-
 	auto &illuminationZoneControl = illumControlParams.zones[zoneIndex];
-	if (illuminationZoneControl.type != NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED)
+	if (zoneType != NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID && zoneType != static_cast<unsigned int>(illuminationZoneControl.type))
 		return false;
-	if (illuminationZoneControl.ctrlMode != NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL)
+	if (!patch(illuminationZoneControl))
 		return false;
+	return writeShadowControl(shadow, gpuHandle, Default, illumControlParams) == NVAPI_OK;
+}
 
-	auto &colorFixedData = illuminationZoneControl.data.colorFixed.data.manualColorFixed.colorFixedParams;
-	colorFixedData.brightnessPct = brightness;
+// Piecewise endpoints are written as given rather than through the zone's color pipeline, so they read back unchanged
+NVAPI_DLL bool SetIlluminationZonePiecewiseLinearRGB(unsigned int gpuIndex, unsigned int zoneIndex, const CustomRGB *pEndpoints, const CustomPiecewiseLinear *pPiecewiseData, bool Default)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_SET_ILLUMINATION_ZONE_PIECEWISE_LINEAR);
+	if (!pEndpoints || !pPiecewiseData)
+		return false;
+	return patchZoneControl(gpuIndex, zoneIndex, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB, Default, [&](auto &zone)
+							{
+		auto &piecewiseRGB = zone.data.rgb.data.piecewiseLinearRGB;
+		if (!buildPiecewiseLinearData(pPiecewiseData, &piecewiseRGB.piecewiseLinearData))
+			return false;
+		for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+		{
+			piecewiseRGB.rgbParams[j].colorR = pEndpoints[j].r;
+			piecewiseRGB.rgbParams[j].colorG = pEndpoints[j].g;
+			piecewiseRGB.rgbParams[j].colorB = pEndpoints[j].b;
+			piecewiseRGB.rgbParams[j].brightnessPct = pEndpoints[j].brightness;
+		}
+		zone.ctrlMode = NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR;
+		return true; });
+}
+NVAPI_DLL bool SetIlluminationZonePiecewiseLinearRGBW(unsigned int gpuIndex, unsigned int zoneIndex, const CustomRGBW *pEndpoints, const CustomPiecewiseLinear *pPiecewiseData, bool Default)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_SET_ILLUMINATION_ZONE_PIECEWISE_LINEAR);
+	if (!pEndpoints || !pPiecewiseData)
+		return false;
+	return patchZoneControl(gpuIndex, zoneIndex, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW, Default, [&](auto &zone)
+							{
+		auto &piecewiseRGBW = zone.data.rgbw.data.piecewiseLinearRGBW;
+		if (!buildPiecewiseLinearData(pPiecewiseData, &piecewiseRGBW.piecewiseLinearData))
+			return false;
+		for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+		{
+			piecewiseRGBW.rgbwParams[j].colorR = pEndpoints[j].r;
+			piecewiseRGBW.rgbwParams[j].colorG = pEndpoints[j].g;
+			piecewiseRGBW.rgbwParams[j].colorB = pEndpoints[j].b;
+			piecewiseRGBW.rgbwParams[j].colorW = pEndpoints[j].w;
+			piecewiseRGBW.rgbwParams[j].brightnessPct = pEndpoints[j].brightness;
+		}
+		zone.ctrlMode = NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR;
+		return true; });
+}
+NVAPI_DLL bool SetIlluminationZonePiecewiseLinearSingleColor(unsigned int gpuIndex, unsigned int zoneIndex, const CustomSingleColor *pEndpoints, const CustomPiecewiseLinear *pPiecewiseData, bool Default)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_SET_ILLUMINATION_ZONE_PIECEWISE_LINEAR);
+	if (!pEndpoints || !pPiecewiseData)
+		return false;
+	return patchZoneControl(gpuIndex, zoneIndex, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR, Default, [&](auto &zone)
+							{
+		auto &piecewiseSingleColor = zone.data.singleColor.data.piecewiseLinearSingleColor;
+		if (!buildPiecewiseLinearData(pPiecewiseData, &piecewiseSingleColor.piecewiseLinearData))
+			return false;
+		for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+			piecewiseSingleColor.singleColorParams[j].brightnessPct = pEndpoints[j].brightness;
+		zone.ctrlMode = NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR;
+		return true; });
+}
+NVAPI_DLL bool SetIlluminationZonePiecewiseLinearColorFixed(unsigned int gpuIndex, unsigned int zoneIndex, const CustomSingleColor *pEndpoints, const CustomPiecewiseLinear *pPiecewiseData, bool Default)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_SET_ILLUMINATION_ZONE_PIECEWISE_LINEAR);
+	if (!pEndpoints || !pPiecewiseData)
+		return false;
+	return patchZoneControl(gpuIndex, zoneIndex, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED, Default, [&](auto &zone)
+							{
+		auto &piecewiseColorFixed = zone.data.colorFixed.data.piecewiseLinearColorFixed;
+		if (!buildPiecewiseLinearData(pPiecewiseData, &piecewiseColorFixed.piecewiseLinearData))
+			return false;
+		for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+			piecewiseColorFixed.colorFixedParams[j].brightnessPct = pEndpoints[j].brightness;
+		zone.ctrlMode = NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR;
+		return true; });
+}
 
-	if (Default)
-		illumControlParams.bDefault = NV_TRUE;
-	else
-		illumControlParams.bDefault = NV_FALSE;
-	return NvAPI_GPU_ClientIllumZonesSetControl(gpuHandle, &illumControlParams) == NVAPI_OK;
+NVAPI_DLL bool SetIlluminationZoneControlMode(unsigned int gpuIndex, unsigned int zoneIndex, unsigned int ctrlMode, bool Default)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_SET_ILLUMINATION_ZONE_CONTROL_MODE);
+	// Manual and piecewise data share the same storage, switching back to manual keeps endpoint 0 as the static color.
+	// Switching to piecewise restores the last piecewise effect seen on the zone and fails if it never had one.
+	if (ctrlMode != NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL && ctrlMode != NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR)
+		return false;
+	return patchZoneControl(gpuIndex, zoneIndex, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID, Default, [&](auto &zone)
+							{
+		if (ctrlMode == NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR && zone.ctrlMode != NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR)
+		{
+			// patchZoneControl holds the shadow lock
+			const GpuShadowState &shadow = gpuShadowStates[gpuIndex];
+			int slot = Default ? 1 : 0;
+			const PiecewiseZoneState &state = shadow.piecewise[slot][zoneIndex];
+			if (!(shadow.piecewiseMask[slot] & (1u << zoneIndex)) || state.zoneType != static_cast<unsigned int>(zone.type))
+				return false;
+			writePiecewiseZone(state, zone);
+		}
+		zone.ctrlMode = static_cast<NV_GPU_CLIENT_ILLUM_CTRL_MODE>(ctrlMode);
+		return true; });
 }
 
 NVAPI_DLL void Testing()
@@ -713,7 +1884,7 @@ NVAPI_DLL void Testing()
 		uint8_t blue = 255;
 		uint8_t white = 255;
 		bool Default = false;
-		unsigned int sleepTime = 3;
+		unsigned int sleepTime = nvapiIsDriverBackend() ? 3 : 0; // the emulator applies changes instantly
 
 		// Hardcode 2 zones for testing
 		for (unsigned int j = 0; j < 2; ++j)
@@ -2,19 +2,67 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sstream>
+#include <stdarg.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #pragma warning(push)
 #pragma warning(disable : 4820) // suppress padding warning for nvapi.h
 #include "nvapi.h"
 #pragma warning(pop)
 
-#ifdef NVAPIWRAPPER_EXPORTS
+#if defined(NVAPIWRAPPER_STATIC) // wrapper sources compiled straight into an executable, e.g. the benchmark
+#define NVAPI_DLL extern "C"
+#elif !defined(_WIN32)
+#define NVAPI_DLL extern "C" __attribute__((visibility("default")))
+#elif defined(NVAPIWRAPPER_EXPORTS)
 #define NVAPI_DLL extern "C" __declspec(dllexport)
 #else
 #define NVAPI_DLL extern "C" __declspec(dllimport)
 #endif
 
+// SetIlluminationShadowPolicy maxAgeMs value that keeps the shadow state until it is invalidated
+#define SHADOW_MAX_AGE_NEVER_EXPIRES 0xFFFFFFFFu
+// ApplyProfileFile gpuIndex that applies the profile to the GPU matching the PCI identity stored in it
+#define PROFILE_MATCH_GPU_IDENTITY 0xFFFFFFFFu
+// Latency histogram size of a PerfCounterSnapshot, bucket 0 counts calls under 128 ns and bucket i calls under 128 ns << i
+#define PERF_HISTOGRAM_BUCKETS 24
+// Error slots of a PerfCounterSnapshot, the last slot collects every status without a slot of its own
+#define PERF_STATUS_SLOTS 16
+// statusCodes value of the catch-all error slot
+#define PERF_STATUS_OTHER 1
+// Stages of a ColorPipelineConfig, a zone runs white balance, then white extraction, then the curves
+#define COLOR_PIPELINE_WHITE_BALANCE 0x1u
+#define COLOR_PIPELINE_EXTRACT_WHITE 0x2u
+#define COLOR_PIPELINE_GAMMA 0x4u
+#define COLOR_PIPELINE_CALIBRATION 0x8u
+// How an AmbientZoneRegion turns its part of the frame into one color
+#define AMBIENT_MODE_AVERAGE 0
+#define AMBIENT_MODE_DOMINANT 1 // most common color, near black is only picked when nothing else is on screen
+// Kernels that can run the color pipelines, see SetColorPipelineIsa
+#define COLOR_PIPELINE_ISA_SCALAR 0
+#define COLOR_PIPELINE_ISA_SSE41 1
+#define COLOR_PIPELINE_ISA_AVX2 2
+// Interleaved sample layouts accepted by SubmitAudioSamples
+#define AUDIO_FORMAT_FLOAT32 0
+#define AUDIO_FORMAT_INT16 1
+// AudioBandMapping.flags, beats push the band to its loud color before it releases
+#define AUDIO_BAND_BEAT 0x1u
+// Metrics of a TelemetrySample, the telemetry sampler maps them to zone colors
+#define TELEMETRY_METRIC_GPU_TEMPERATURE 0	 // degrees Celsius of the GPU sensor
+#define TELEMETRY_METRIC_GPU_UTILIZATION 1	 // percent, graphics engine
+#define TELEMETRY_METRIC_MEMORY_UTILIZATION 2 // percent, frame buffer
+#define TELEMETRY_METRIC_VIDEO_UTILIZATION 3	 // percent, video engine
+#define TELEMETRY_METRIC_COUNT 4
+// Most points of a TelemetryZoneMapping curve
+#define TELEMETRY_CURVE_POINTS 8
+
 // struct declarations
 // custom return struct for Illumination Zones Info Data, contain char arrays for type and location
 struct CustomIlluminationZonesInfoData
@@ -77,24 +125,429 @@ struct CustomIlluminationZoneControls
 	unsigned int numZones;
 	CustomIlluminationZoneControl zones[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
 };
+// v2 structs carry the NvAPI enum values instead of names and use natural alignment without bools, so managed callers
+// can pass a pinned buffer straight through. Names for display come from the Get*Name lookups.
+// Struct describing one illumination zone
+struct IlluminationZoneInfoV2
+{
+	uint32_t zoneType;	   // NV_GPU_CLIENT_ILLUM_ZONE_TYPE
+	uint32_t zoneLocation; // NV_GPU_CLIENT_ILLUM_ZONE_LOCATION
+};
+struct IlluminationZonesInfoV2
+{
+	uint32_t numZones;
+	IlluminationZoneInfoV2 zones[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+};
+// Struct holding one color of any zone type, RGB zones leave w at 0 and single color zones only use brightness
+struct IlluminationColorV2
+{
+	uint8_t r, g, b, w, brightness;
+	uint8_t padding[3];
+};
+// Struct for piecewise linear animation data
+struct IlluminationPiecewiseV2
+{
+	uint32_t cycleType; // NV_GPU_CLIENT_ILLUM_PIECEWISE_LINEAR_CYCLE_TYPE
+	uint16_t riseTimeMs, fallTimeMs;
+	uint16_t aTimeMs, bTimeMs;
+	uint16_t idleTimeMs, phaseOffsetMs;
+	uint8_t grpCount;
+	uint8_t padding[3];
+};
+// Struct to represent a single illumination zone's control info, only the data of ctrlMode is filled
+struct IlluminationZoneControlV2
+{
+	uint32_t zoneType; // NV_GPU_CLIENT_ILLUM_ZONE_TYPE
+	uint32_t ctrlMode; // NV_GPU_CLIENT_ILLUM_CTRL_MODE
+	IlluminationColorV2 manualColor;
+	IlluminationColorV2 piecewiseColors[NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS];
+	IlluminationPiecewiseV2 piecewise;
+};
+struct IlluminationZoneControlsV2
+{
+	uint32_t numZones;
+	IlluminationZoneControlV2 zones[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+};
+// Struct describing one zone whose control state changed, see RegisterZoneChangeCallback
+struct IlluminationZoneChange
+{
+	uint32_t zoneIndex;
+	IlluminationZoneControlV2 control; // state after the change
+};
+// Struct describing one manual zone update for the batched setter
+struct ZoneUpdate
+{
+	unsigned int zoneIndex;
+	unsigned int zoneType; // expected NV_GPU_CLIENT_ILLUM_ZONE_TYPE, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID accepts any type
+	uint8_t r, g, b, w, brightness;
+	uint8_t padding[3];
+};
+// Struct identifying a GPU by PCI identity, matched on bus, device and subsystem id like the app's GpuIdentifier
+struct GpuPciIdentity
+{
+	unsigned int busId;
+	unsigned int deviceId;
+	unsigned int subSystemId;
+};
+// Struct describing one GPU of a multi-GPU apply, its updates and results are a slice of the shared arrays. Batches
+// must name distinct GPUs and their slices must not overlap.
+struct GpuZoneBatch
+{
+	GpuPciIdentity identity;
+	unsigned int firstUpdate;
+	unsigned int updateCount;
+};
+// Struct reporting how long each step of WaitForIlluminationReady took, each phase starts when the previous one ended
+struct IlluminationReadyReport
+{
+	unsigned long long initializeUs; // until NvAPI_Initialize succeeded
+	unsigned long long enumerateUs;	 // until at least one GPU was enumerated
+	unsigned long long zonesUs;		 // until every GPU answered its zone query
+	unsigned long long totalUs;
+	unsigned int initializeAttempts;
+	unsigned int enumerateAttempts;
+	unsigned int zonesAttempts;
+	unsigned int gpuCount;
+	unsigned int readyGpuCount; // GPUs with illumination zones
+	NvAPI_Status lastStatus;	// last failure seen while retrying, NVAPI_OK if nothing failed
+};
+// Struct holding the reconciler counters, see StartIlluminationReconciler
+struct IlluminationReconcilerStats
+{
+	unsigned long long polls;		  // GetControl reads of GPUs with a desired state
+	unsigned long long pollTimeUs;	  // total time spent reading and repairing
+	unsigned long long maxPollUs;
+	unsigned long long drifts;		  // polls that found at least one drifted zone
+	unsigned long long zonesRepaired;
+	unsigned long long repairFailures; // polls whose read or repair failed
+	unsigned long long powerEvents;
+	unsigned int currentIntervalMs;
+	unsigned int padding;
+};
+// Struct describing the color processing of one zone, converted to fixed point when set so every kernel gives the same bytes
+struct ColorPipelineConfig
+{
+	uint32_t flags;			 // COLOR_PIPELINE_*
+	float whiteBalance[9];	 // row-major 3x3 applied to r,g,b, coefficients within (-8, 8)
+	float whiteExtraction;	 // share of min(r,g,b) moved to the white channel of RGBW zones, 0 to 1
+	float gamma;			 // exponent applied to r,g,b,w
+	float brightnessGamma;	 // exponent applied to the brightness percent
+	uint8_t calibration[4][256]; // r,g,b,w lookup applied after gamma
+};
+// Struct describing the part of the screen that drives one zone, edges are fractions of the frame from its top left corner
+struct AmbientZoneRegion
+{
+	unsigned int zoneIndex;
+	unsigned int zoneType; // NV_GPU_CLIENT_ILLUM_ZONE_TYPE, single color and color fixed zones get the luma as brightness
+	unsigned int mode;	   // AMBIENT_MODE_*
+	float left, top, right, bottom;
+};
+// Struct holding the ambient sampler counters, see SubmitAmbientFrame
+struct AmbientStats
+{
+	unsigned long long frames;
+	unsigned long long writes;		   // frames whose colors changed and were written
+	unsigned long long writeFailures;
+	unsigned long long sampleTimeUs;   // total time spent reading frames
+	unsigned int lastSampleUs;
+	unsigned int maxSampleUs;
+};
+// Reports zones the reconciler found changed behind the wrapper's back, called from the reconciler thread
+typedef void (*IlluminationDriftFn)(unsigned int gpuIndex, unsigned int driftedZoneMask, NvAPI_Status repairStatus, void *context);
+// Called on the sampler thread with the zones that changed since the last notification, pChanges is only valid during the call
+typedef void (*ZoneChangeFn)(unsigned int gpuIndex, const IlluminationZoneChange *pChanges, unsigned int count, void *context);
+// Backends the wrapper can route its NvAPI calls through
+enum NvApiBackendKind
+{
+	NVAPI_BACKEND_DRIVER = 0, // the real nvapi64.dll, Windows only
+	NVAPI_BACKEND_EMULATOR,	  // deterministic software model, see ConfigureNvApiEmulator
+};
+// NvAPI entry points used by the wrapper, indexes the emulator latency/failure tables and tags trace records
+enum NvApiCall
+{
+	NVAPI_CALL_INITIALIZE = 0,
+	NVAPI_CALL_UNLOAD,
+	NVAPI_CALL_GET_ERROR_MESSAGE,
+	NVAPI_CALL_GET_INTERFACE_VERSION_STRING,
+	NVAPI_CALL_GET_DRIVER_AND_BRANCH_VERSION,
+	NVAPI_CALL_ENUM_PHYSICAL_GPUS,
+	NVAPI_CALL_GET_FULL_NAME,
+	NVAPI_CALL_GET_GPU_INFO,
+	NVAPI_CALL_GET_SYSTEM_TYPE,
+	NVAPI_CALL_GET_PCI_IDENTIFIERS,
+	NVAPI_CALL_GET_BUS_ID,
+	NVAPI_CALL_ILLUM_ZONES_GET_INFO,
+	NVAPI_CALL_ILLUM_ZONES_GET_CONTROL,
+	NVAPI_CALL_ILLUM_ZONES_SET_CONTROL,
+	NVAPI_CALL_GET_THERMAL_SETTINGS,
+	NVAPI_CALL_GET_DYNAMIC_PSTATES_INFO_EX,
+	NVAPI_CALL_COUNT
+};
+// Struct describing one emulated GPU and its illumination zones
+struct EmulatorGpuConfig
+{
+	char name[64];
+	unsigned int busId, deviceId, subSystemId, revisionId, extDeviceId;
+	unsigned int zoneCount;
+	unsigned int zoneTypes[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];	   // NV_GPU_CLIENT_ILLUM_ZONE_TYPE
+	unsigned int zoneLocations[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX]; // NV_GPU_CLIENT_ILLUM_ZONE_LOCATION
+};
+// What a performance counter measures
+enum PerfCounterKind
+{
+	PERF_COUNTER_NVAPI_CALL = 0, // one NvAPI entry point, time spent in the driver
+	PERF_COUNTER_EXPORT,		 // one wrapper export, time spent in the DLL including its NvAPI calls
+};
+// Snapshot of one performance counter, see GetPerfCounters
+struct PerfCounterSnapshot
+{
+	char name[48];
+	unsigned int kind; // PerfCounterKind
+	unsigned int padding;
+	unsigned long long calls;
+	unsigned long long errors; // calls that saw a failing NvAPI_Status
+	unsigned long long totalNs;
+	unsigned long long maxNs;
+	unsigned long long histogram[PERF_HISTOGRAM_BUCKETS];
+	int statusCodes[PERF_STATUS_SLOTS]; // NvAPI_Status counted by each slot of statusCounts
+	unsigned long long statusCounts[PERF_STATUS_SLOTS];
+};
+// Effects run by the software animation engine
+enum AnimationEffect
+{
+	ANIMATION_EFFECT_NONE = 0,
+	ANIMATION_EFFECT_BREATHING,
+	ANIMATION_EFFECT_COLOR_CYCLE,
+	ANIMATION_EFFECT_RAINBOW_WAVE,
+	ANIMATION_EFFECT_STROBE,
+	ANIMATION_EFFECT_CROSSFADE,
+};
+// Struct describing the effect animated on one GPU
+struct AnimationParams
+{
+	unsigned int effect; // AnimationEffect
+	unsigned int periodMs;
+	unsigned int zoneMask; // bit per zone index driven by the effect
+	CustomRGBW colorA;	   // breathing/strobe color, crossfade start
+	CustomRGBW colorB;	   // strobe off color, crossfade end
+	uint8_t dutyPct;	   // strobe on time in percent of the period
+	uint8_t padding[3];
+};
+// Struct holding the animation engine frame counters
+struct AnimationStats
+{
+	unsigned long long framesRendered;
+	unsigned long long framesDropped;
+	unsigned long long commits;
+	unsigned long long commitFailures;
+	unsigned int lastFrameUs;
+	unsigned int maxFrameUs;
+};
+// Struct configuring the audio reactive stage, see SetAudioReactiveConfig
+struct AudioReactiveConfig
+{
+	unsigned int gpuIndex;
+	unsigned int sampleRate;   // 8000 to 192000 Hz
+	unsigned int fftSize;	   // power of two from 256 to 4096, analysed every fftSize / 2 samples
+	unsigned int updateRateHz; // lighting updates per second and so the most writes per second, 1 to 120
+	float dynamicRangeDb;	   // band levels below their recent peak that still light up, 6 to 96
+	float beatSensitivity;	   // spectral flux over its recent mean that counts as a beat, above 1
+};
+// Struct driving one zone from a frequency band, the zone fades from quiet to loud as the band level rises. The same
+// color at two brightness values maps the band to brightness, two colors at one brightness map it to color.
+struct AudioBandMapping
+{
+	unsigned int zoneIndex;
+	unsigned int zoneType; // NV_GPU_CLIENT_ILLUM_ZONE_TYPE, 0 accepts any type
+	unsigned int flags;	   // AUDIO_BAND_*
+	float lowHz, highHz;
+	float attackMs, releaseMs; // envelope time constants while the level rises and falls
+	CustomRGBW quiet;
+	CustomRGBW loud;
+	uint8_t padding[2];
+};
+// Struct holding the audio reactive stage counters
+struct AudioReactiveStats
+{
+	unsigned long long samples; // mono frames queued by SubmitAudioSamples
+	unsigned long long dropped; // frames that did not fit because the lighting side fell behind
+	unsigned long long analyses;
+	unsigned long long beats;
+	unsigned long long writes;
+	unsigned long long writeFailures;
+	unsigned long long analysisTimeUs;
+	unsigned int maxAnalysisUs;
+	unsigned int padding;
+};
+// Struct holding one reading of the telemetry metrics of a GPU
+struct TelemetrySample
+{
+	float values[TELEMETRY_METRIC_COUNT]; // indexed by TELEMETRY_METRIC_*
+	unsigned int validMask;				  // bit per metric the GPU reported
+};
+// One point of a telemetry color curve, colors between two points are interpolated
+struct TelemetryCurvePoint
+{
+	float value;
+	CustomRGBW color;
+	uint8_t padding[3];
+};
+// Struct mapping one telemetry metric of a GPU to the color of one of its zones
+struct TelemetryZoneMapping
+{
+	unsigned int gpuIndex;
+	unsigned int zoneIndex;
+	unsigned int zoneType; // NV_GPU_CLIENT_ILLUM_ZONE_TYPE, 0 accepts any type
+	unsigned int metric;   // TELEMETRY_METRIC_*
+	float hysteresis;	   // how far the metric has to move before the color follows it
+	unsigned int pointCount;
+	TelemetryCurvePoint points[TELEMETRY_CURVE_POINTS]; // ascending values, colors clamp outside the first and last
+};
+// Struct holding the telemetry sampler counters
+struct TelemetryStats
+{
+	unsigned long long samples;		   // ticks that read every mapped GPU once
+	unsigned long long driverCalls;	   // NvAPI telemetry calls made by those ticks
+	unsigned long long sampleFailures; // GPUs whose metrics could not be read
+	unsigned long long writes;		   // zone writes, only made when a mapped color changed
+	unsigned long long writeFailures;
+	unsigned int currentIntervalMs;
+	unsigned int padding;
+};
+// Compiled keyframe timeline, see CompileIlluminationTimeline
+struct IlluminationTimeline;
+// Struct describing a compiled timeline
+struct IlluminationTimelineInfo
+{
+	unsigned int durationMs; // loop period, or the time the last frame is held from
+	unsigned int zoneMask;	 // bit per zone index with a track
+	unsigned int keyframeCount;
+	unsigned int loop; // nonzero if the timeline repeats
+};
+// Struct holding the illumination channel counters
+struct IlluminationChannelStats
+{
+	unsigned long long received;	  // records drained from the channel
+	unsigned long long coalesced;	  // records replaced by a later update of the same zone in the same drain
+	unsigned long long writes;		  // SetIlluminationZonesBatch calls, one per GPU per drain
+	unsigned long long writeFailures;
+	unsigned long long rejected;	  // records naming a GPU or zone index out of range, or setting reserved flags
+	unsigned long long dropped;		  // pushes that found the channel full
+};
+// Producer end of an illumination channel, see NvApiChannel.h
+struct IlluminationChannelProducer;
+// Injectable clock (microseconds, monotonic) and per-GPU frame commit used by the animation engine
+typedef unsigned long long (*AnimationClockFn)(void *context);
+typedef bool (*AnimationCommitFn)(unsigned int gpuIndex, const ZoneUpdate *pUpdates, unsigned int count, void *context);
 
 // Function declarations
 NVAPI_DLL const char *GetNvApiErrorMessage(NvAPI_Status status);
 NVAPI_DLL bool InitializeNvApi();
 NVAPI_DLL bool DeinitializeNvApi();
+NVAPI_DLL bool WaitForIlluminationReady(unsigned int timeoutMs, IlluminationReadyReport *pReport);
 NVAPI_DLL const char *GetInterfaceVersionString();
 NVAPI_DLL unsigned long GetDriverVersion();
 NVAPI_DLL unsigned int GetNumberOfGPUs();
 NVAPI_DLL NvPhysicalGpuHandle GetGPUHandle(unsigned int index);
+NVAPI_DLL void InvalidateGPUHandleCache();
+NVAPI_DLL void GetGPUHandleCacheStats(unsigned long long *pEnumerationsAvoided, unsigned long long *pEnumerationsPerformed);
+NVAPI_DLL void SetIlluminationShadowPolicy(unsigned int maxAgeMs, bool invalidateOnError);
+NVAPI_DLL void InvalidateIlluminationShadow(unsigned int gpuIndex);
+NVAPI_DLL void GetIlluminationShadowStats(unsigned long long *pHits, unsigned long long *pMisses, unsigned long long *pSkippedWrites);
+NVAPI_DLL bool SetIlluminationDesiredState(unsigned int gpuIndex, const ZoneUpdate *pUpdates, unsigned int count);
+NVAPI_DLL bool StartIlluminationReconciler(unsigned int minIntervalMs, unsigned int maxIntervalMs);
+NVAPI_DLL void StopIlluminationReconciler();
+NVAPI_DLL void NotifyIlluminationPowerEvent();
+NVAPI_DLL bool SetIlluminationDriftCallback(IlluminationDriftFn callback, void *context);
+NVAPI_DLL void GetIlluminationReconcilerStats(IlluminationReconcilerStats *pStats);
+NVAPI_DLL unsigned int RegisterZoneChangeCallback(unsigned int gpuIndex, ZoneChangeFn callback, void *context);
+NVAPI_DLL bool UnregisterZoneChangeCallback(unsigned int subscription);
+NVAPI_DLL bool SetZoneChangeSamplerTiming(unsigned int pollIntervalMs, unsigned int coalesceWindowMs);
+NVAPI_DLL void GetZoneChangeSamplerStats(unsigned long long *pSamples, unsigned long long *pNotifications, unsigned long long *pCoalesced);
 NVAPI_DLL const char *GetGPUName(unsigned int index);
 NVAPI_DLL const char *GetGPUInfo(unsigned int index);
 NVAPI_DLL const char *GetSystemType(unsigned int index);
 NVAPI_DLL bool GetGPUPCIIdentifiers(unsigned int index, unsigned long *pDeviceId, unsigned long *pSubSystemId, unsigned long *pRevisionId, unsigned long *pExtDeviceId);
 NVAPI_DLL bool GetGPUBusId(unsigned int index, unsigned long *pBusId);
+NVAPI_DLL bool GetIlluminationZonesInfoData(unsigned int index, CustomIlluminationZonesInfo *pCustomIlluminationZonesInfo);
+NVAPI_DLL bool GetIlluminationZonesControlData(unsigned int index, bool useDefault, CustomIlluminationZoneControls *pCustomIlluminationZoneControls);
+NVAPI_DLL bool FormatIlluminationZonesInfo(unsigned int index, char *buffer, size_t bufferSize, size_t *pRequired);
+NVAPI_DLL bool FormatIlluminationZonesControl(unsigned int index, bool useDefault, char *buffer, size_t bufferSize, size_t *pRequired);
 NVAPI_DLL const char *GetIlluminationZonesInfo(unsigned int index, CustomIlluminationZonesInfo *pCustomIlluminationZonesInfo);
+NVAPI_DLL bool GetIlluminationZonesInfoV2(unsigned int index, IlluminationZonesInfoV2 *pInfo);
+NVAPI_DLL bool GetIlluminationZonesControlV2(unsigned int index, bool useDefault, IlluminationZoneControlsV2 *pControls);
+NVAPI_DLL const char *GetIlluminationZoneTypeName(unsigned int zoneType);
+NVAPI_DLL const char *GetIlluminationZoneLocationName(unsigned int zoneLocation);
+NVAPI_DLL const char *GetIlluminationControlModeName(unsigned int ctrlMode);
+NVAPI_DLL const char *GetIlluminationCycleTypeName(unsigned int cycleType);
 NVAPI_DLL const char *GetIlluminationZonesControl(unsigned int index, bool Default, CustomIlluminationZoneControls *pCustomIlluminationZoneControls);
 NVAPI_DLL bool SetIlluminationZoneManualRGB(unsigned int gpuIndex, unsigned int zoneIndex, uint8_t red, uint8_t green, uint8_t blue, uint8_t brightness, bool Default);
 NVAPI_DLL bool SetIlluminationZoneManualRGBW(unsigned int gpuIndex, unsigned int zoneIndex, uint8_t red, uint8_t green, uint8_t blue, uint8_t white, uint8_t brightness, bool Default);
 NVAPI_DLL bool SetIlluminationZoneManualSingleColor(unsigned int gpuIndex, unsigned int zoneIndex, uint8_t brightness, bool Default);
 NVAPI_DLL bool SetIlluminationZoneManualColorFixed(unsigned int gpuIndex, unsigned int zoneIndex, uint8_t brightness, bool Default);
+NVAPI_DLL bool SetIlluminationZonePiecewiseLinearRGB(unsigned int gpuIndex, unsigned int zoneIndex, const CustomRGB *pEndpoints, const CustomPiecewiseLinear *pPiecewiseData, bool Default);
+NVAPI_DLL bool SetIlluminationZonePiecewiseLinearRGBW(unsigned int gpuIndex, unsigned int zoneIndex, const CustomRGBW *pEndpoints, const CustomPiecewiseLinear *pPiecewiseData, bool Default);
+NVAPI_DLL bool SetIlluminationZonePiecewiseLinearSingleColor(unsigned int gpuIndex, unsigned int zoneIndex, const CustomSingleColor *pEndpoints, const CustomPiecewiseLinear *pPiecewiseData, bool Default);
+NVAPI_DLL bool SetIlluminationZonePiecewiseLinearColorFixed(unsigned int gpuIndex, unsigned int zoneIndex, const CustomSingleColor *pEndpoints, const CustomPiecewiseLinear *pPiecewiseData, bool Default);
+NVAPI_DLL bool SetIlluminationZoneControlMode(unsigned int gpuIndex, unsigned int zoneIndex, unsigned int ctrlMode, bool Default);
+NVAPI_DLL bool SetZoneColorPipeline(unsigned int gpuIndex, unsigned int zoneIndex, const ColorPipelineConfig *pConfig);
+NVAPI_DLL unsigned int GetColorPipelineIsa();
+NVAPI_DLL bool SetColorPipelineIsa(unsigned int isa);
+NVAPI_DLL bool SetAmbientRegions(unsigned int gpuIndex, const AmbientZoneRegion *pRegions, unsigned int count, unsigned int smoothingMs, uint8_t brightness);
+NVAPI_DLL bool ComputeAmbientColors(const void *pFrame, unsigned int width, unsigned int height, int stride, const AmbientZoneRegion *pRegions, unsigned int count, uint8_t brightness, ZoneUpdate *pUpdates);
+NVAPI_DLL bool SubmitAmbientFrame(unsigned int gpuIndex, const void *pFrame, unsigned int width, unsigned int height, int stride, unsigned long long timestampUs);
+NVAPI_DLL void GetAmbientStats(AmbientStats *pStats);
+NVAPI_DLL bool SetIlluminationZonesBatch(unsigned int gpuIndex, const ZoneUpdate *pUpdates, unsigned int count, bool Default, NvAPI_Status *pResults);
+NVAPI_DLL bool FindGPUByPciIdentity(const GpuPciIdentity *pIdentity, unsigned int *pIndex);
+NVAPI_DLL bool ApplyIlluminationZonesMultiGpu(const GpuZoneBatch *pBatches, unsigned int batchCount, const ZoneUpdate *pUpdates, unsigned int updateCount, bool Default, NvAPI_Status *pGpuResults, NvAPI_Status *pZoneResults, unsigned long long *pWallTimeUs);
+NVAPI_DLL bool EnqueueIlluminationZoneUpdate(unsigned int gpuIndex, const ZoneUpdate *pUpdate, bool Default);
+NVAPI_DLL void SetIlluminationQueueInterval(unsigned int minIntervalMs);
+NVAPI_DLL bool FlushIlluminationQueue(unsigned int gpuIndex, unsigned int timeoutMs);
+NVAPI_DLL bool GetIlluminationQueueStats(unsigned int gpuIndex, unsigned int *pDepth, unsigned long long *pCoalesced, unsigned long long *pDispatched, unsigned long long *pFailed);
+NVAPI_DLL void StopIlluminationQueue();
+NVAPI_DLL bool ApplyProfileFile(const wchar_t *path, unsigned int gpuIndex, NvAPI_Status *pStatus);
+NVAPI_DLL bool SetNvApiBackend(unsigned int backend);
+NVAPI_DLL bool ConfigureNvApiEmulator(const EmulatorGpuConfig *pGpus, unsigned int gpuCount);
+NVAPI_DLL bool SetNvApiEmulatorLatency(unsigned int call, unsigned int latencyUs);
+NVAPI_DLL bool SetNvApiEmulatorFailure(unsigned int call, NvAPI_Status status, unsigned int everyNthCall);
+NVAPI_DLL bool GetNvApiEmulatorCallCount(unsigned int call, unsigned long long *pCount);
+NVAPI_DLL bool SetNvApiEmulatorTelemetry(unsigned int gpuIndex, const TelemetrySample *pSample);
+NVAPI_DLL bool StartNvApiTraceRecording(const char *path);
+NVAPI_DLL bool StopNvApiTraceRecording();
+NVAPI_DLL bool LoadNvApiTraceReplay(const char *path);
+NVAPI_DLL bool GetPerfCountersEnabled();
+NVAPI_DLL unsigned int GetPerfCounterCount();
+NVAPI_DLL unsigned int GetPerfCounters(PerfCounterSnapshot *pSnapshots, unsigned int capacity);
+NVAPI_DLL void ResetPerfCounters();
+NVAPI_DLL bool StartAnimationEngine(unsigned int frameRateHz);
+NVAPI_DLL void StopAnimationEngine();
+NVAPI_DLL bool SetAnimationEffect(unsigned int gpuIndex, const AnimationParams *pParams);
+NVAPI_DLL bool SetAnimationHooks(AnimationClockFn clock, AnimationCommitFn commit, void *context);
+NVAPI_DLL bool StepAnimationEngine(unsigned int frameRateHz, unsigned long long nowUs, bool restart);
+NVAPI_DLL void GetAnimationStats(AnimationStats *pStats);
+NVAPI_DLL bool SetAnimationTimeline(unsigned int gpuIndex, IlluminationTimeline *pTimeline);
+NVAPI_DLL IlluminationTimeline *CompileIlluminationTimeline(const char *json, size_t length, char *errorBuffer, size_t errorBufferSize);
+NVAPI_DLL void FreeIlluminationTimeline(IlluminationTimeline *pTimeline);
+NVAPI_DLL bool GetIlluminationTimelineInfo(const IlluminationTimeline *pTimeline, IlluminationTimelineInfo *pInfo);
+NVAPI_DLL unsigned int EvaluateIlluminationTimeline(const IlluminationTimeline *pTimeline, unsigned long long timeUs, ZoneUpdate *pUpdates, unsigned int capacity);
+NVAPI_DLL bool RenderIlluminationTimelineFrame(const IlluminationTimeline *pTimeline, unsigned long long timeUs, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams);
+NVAPI_DLL bool SetAudioReactiveConfig(const AudioReactiveConfig *pConfig, const AudioBandMapping *pMappings, unsigned int count);
+NVAPI_DLL bool StartAudioReactive();
+NVAPI_DLL void StopAudioReactive();
+NVAPI_DLL bool SubmitAudioSamples(const void *pSamples, unsigned int frameCount, unsigned int channels, unsigned int format);
+NVAPI_DLL bool StepAudioReactive();
+NVAPI_DLL void GetAudioReactiveStats(AudioReactiveStats *pStats);
+NVAPI_DLL bool GetGpuTelemetry(unsigned int gpuIndex, TelemetrySample *pSample);
+NVAPI_DLL bool SetTelemetryMappings(const TelemetryZoneMapping *pMappings, unsigned int count);
+NVAPI_DLL bool StartTelemetrySampler(unsigned int minIntervalMs, unsigned int maxIntervalMs);
+NVAPI_DLL void StopTelemetrySampler();
+NVAPI_DLL bool StepTelemetrySampler(unsigned int minIntervalMs, unsigned int maxIntervalMs, unsigned long long nowUs, unsigned int *pNextIntervalMs);
+NVAPI_DLL void GetTelemetryStats(TelemetryStats *pStats);
+NVAPI_DLL bool OpenIlluminationChannel(const char *name, unsigned int capacity, unsigned int drainIntervalMs);
+NVAPI_DLL void CloseIlluminationChannel();
+NVAPI_DLL unsigned int DrainIlluminationChannel();
+NVAPI_DLL void GetIlluminationChannelStats(IlluminationChannelStats *pStats);
+NVAPI_DLL IlluminationChannelProducer *ConnectIlluminationChannel(const char *name);
+NVAPI_DLL bool PushIlluminationChannelUpdate(IlluminationChannelProducer *pProducer, unsigned int gpuIndex, const ZoneUpdate *pUpdate);
+NVAPI_DLL void DisconnectIlluminationChannel(IlluminationChannelProducer *pProducer);
 NVAPI_DLL void Testing();
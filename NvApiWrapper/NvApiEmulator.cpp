@@ -0,0 +1,440 @@
+#include "pch.h"
+#include "NvApiBackend.h"
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Deterministic software model of the NvAPI illumination surface. Topology, telemetry, per call latency and injected
+// failures are configured through the exports below, so the wrapper can be exercised and timed without an NVIDIA GPU.
+
+struct EmulatedGpu
+{
+	std::mutex lock;
+	EmulatorGpuConfig config;
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS current;
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS defaults;
+	TelemetrySample telemetry; // reported by the thermal and utilization calls, see SetNvApiEmulatorTelemetry
+};
+struct EmulatorCallConfig
+{
+	std::atomic<unsigned int> latencyUs;
+	std::atomic<unsigned int> failEveryNth; // 0 never fails
+	std::atomic<int> failStatus;
+	std::atomic<unsigned long long> count;
+};
+
+static std::shared_mutex emulatorTopologyLock; // exclusive while ConfigureNvApiEmulator rebuilds the GPU table
+static EmulatedGpu emulatedGpus[NVAPI_MAX_PHYSICAL_GPUS];
+static unsigned int emulatedGpuCount = 0;
+static bool emulatorConfigured = false;
+static std::atomic<bool> emulatorInitialized{false};
+static EmulatorCallConfig emulatorCalls[NVAPI_CALL_COUNT];
+
+// Manual mode at full brightness, white where the zone has color
+static void resetZoneControl(NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_V1 &zone, unsigned int zoneType)
+{
+	memset(&zone, 0, sizeof(zone));
+	zone.type = static_cast<NV_GPU_CLIENT_ILLUM_ZONE_TYPE>(zoneType);
+	zone.ctrlMode = NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL;
+	switch (zoneType)
+	{
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
+	{
+		auto &rgb = zone.data.rgb.data.manualRGB.rgbParams;
+		rgb.colorR = rgb.colorG = rgb.colorB = 255;
+		rgb.brightnessPct = 100;
+		break;
+	}
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
+	{
+		auto &rgbw = zone.data.rgbw.data.manualRGBW.rgbwParams;
+		rgbw.colorR = rgbw.colorG = rgbw.colorB = rgbw.colorW = 255;
+		rgbw.brightnessPct = 100;
+		break;
+	}
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
+		zone.data.singleColor.data.manualSingleColor.singleColorParams.brightnessPct = 100;
+		break;
+	case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
+		zone.data.colorFixed.data.manualColorFixed.colorFixedParams.brightnessPct = 100;
+		break;
+	}
+}
+
+static void resetEmulatedGpu(EmulatedGpu &gpu, const EmulatorGpuConfig &config)
+{
+	gpu.config = config;
+	memset(&gpu.current, 0, sizeof(gpu.current));
+	gpu.current.version = NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS_VER;
+	gpu.current.numIllumZonesControl = config.zoneCount;
+	for (unsigned int z = 0; z < config.zoneCount; ++z)
+		resetZoneControl(gpu.current.zones[z], config.zoneTypes[z]);
+	gpu.defaults = gpu.current;
+	gpu.defaults.bDefault = 1;
+	// an idle card at desktop temperature
+	memset(&gpu.telemetry, 0, sizeof(gpu.telemetry));
+	gpu.telemetry.values[TELEMETRY_METRIC_GPU_TEMPERATURE] = 40.0f;
+	gpu.telemetry.validMask = (1u << TELEMETRY_METRIC_COUNT) - 1;
+}
+
+// One Founders Edition card with the logo and the front strip, used until ConfigureNvApiEmulator is called
+static void ensureDefaultTopology()
+{
+	if (emulatorConfigured)
+		return;
+	EmulatorGpuConfig config = {};
+	strncpy_s(config.name, sizeof(config.name), "NVIDIA GeForce RTX 4090 (Emulated)", _TRUNCATE);
+	config.busId = 1;
+	config.deviceId = 0x268410DE;
+	config.subSystemId = 0x167C10DE;
+	config.revisionId = 0xA1;
+	config.extDeviceId = 0x2684;
+	config.zoneCount = 2;
+	config.zoneTypes[0] = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW;
+	config.zoneLocations[0] = NV_GPU_CLIENT_ILLUM_ZONE_LOCATION_GPU_TOP_0;
+	config.zoneTypes[1] = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR;
+	config.zoneLocations[1] = NV_GPU_CLIENT_ILLUM_ZONE_LOCATION_GPU_FRONT_0;
+	resetEmulatedGpu(emulatedGpus[0], config);
+	emulatedGpuCount = 1;
+	emulatorConfigured = true;
+}
+
+// Counts the call, waits out its configured latency and reports the injected failure if this call is due one
+static NvAPI_Status beginEmulatedCall(NvApiCall call)
+{
+	EmulatorCallConfig &config = emulatorCalls[call];
+	unsigned long long count = ++config.count;
+	unsigned int latencyUs = config.latencyUs.load(std::memory_order_relaxed);
+	if (latencyUs)
+		std::this_thread::sleep_for(std::chrono::microseconds(latencyUs));
+	unsigned int everyNth = config.failEveryNth.load(std::memory_order_relaxed);
+	if (everyNth && count % everyNth == 0)
+		return static_cast<NvAPI_Status>(config.failStatus.load(std::memory_order_relaxed));
+	if (call != NVAPI_CALL_INITIALIZE && call != NVAPI_CALL_GET_ERROR_MESSAGE && !emulatorInitialized)
+		return NVAPI_API_NOT_INITIALIZED;
+	return NVAPI_OK;
+}
+
+// Handles are the addresses of the GPU slots, anything else is rejected like a stale driver handle
+static EmulatedGpu *emulatedGpu(NvPhysicalGpuHandle gpuHandle)
+{
+	EmulatedGpu *gpu = reinterpret_cast<EmulatedGpu *>(gpuHandle);
+	for (unsigned int i = 0; i < emulatedGpuCount; ++i)
+		if (&emulatedGpus[i] == gpu)
+			return gpu;
+	return nullptr;
+}
+
+#define EMULATED_CALL(call)                          \
+	NvAPI_Status callStatus = beginEmulatedCall(call); \
+	if (callStatus != NVAPI_OK)                      \
+		return callStatus;
+
+#define EMULATED_GPU_CALL(call, gpuHandle, pOutput)            \
+	EMULATED_CALL(call);                                       \
+	if (!(pOutput))                                            \
+		return NVAPI_INVALID_ARGUMENT;                         \
+	std::shared_lock<std::shared_mutex> topology(emulatorTopologyLock); \
+	EmulatedGpu *gpu = emulatedGpu(gpuHandle);                 \
+	if (!gpu)                                                  \
+		return NVAPI_EXPECTED_PHYSICAL_GPU_HANDLE;
+
+static NvAPI_Status emulatorInitialize()
+{
+	EMULATED_CALL(NVAPI_CALL_INITIALIZE);
+	std::unique_lock<std::shared_mutex> topology(emulatorTopologyLock);
+	ensureDefaultTopology();
+	emulatorInitialized = true;
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorUnload()
+{
+	EMULATED_CALL(NVAPI_CALL_UNLOAD);
+	emulatorInitialized = false;
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorGetErrorMessage(NvAPI_Status status, NvAPI_ShortString message)
+{
+	EMULATED_CALL(NVAPI_CALL_GET_ERROR_MESSAGE);
+	switch (status)
+	{
+#define EMULATOR_ERROR_NAME(name)                                        \
+	case name:                                                           \
+		strncpy_s(message, NVAPI_SHORT_STRING_MAX, #name, _TRUNCATE); \
+		break;
+		EMULATOR_ERROR_NAME(NVAPI_OK)
+		EMULATOR_ERROR_NAME(NVAPI_ERROR)
+		EMULATOR_ERROR_NAME(NVAPI_API_NOT_INITIALIZED)
+		EMULATOR_ERROR_NAME(NVAPI_INVALID_ARGUMENT)
+		EMULATOR_ERROR_NAME(NVAPI_NVIDIA_DEVICE_NOT_FOUND)
+		EMULATOR_ERROR_NAME(NVAPI_INVALID_HANDLE)
+		EMULATOR_ERROR_NAME(NVAPI_INCOMPATIBLE_STRUCT_VERSION)
+		EMULATOR_ERROR_NAME(NVAPI_HANDLE_INVALIDATED)
+		EMULATOR_ERROR_NAME(NVAPI_EXPECTED_PHYSICAL_GPU_HANDLE)
+		EMULATOR_ERROR_NAME(NVAPI_NOT_SUPPORTED)
+		EMULATOR_ERROR_NAME(NVAPI_ACCESS_DENIED)
+#undef EMULATOR_ERROR_NAME
+	default:
+		snprintf(message, NVAPI_SHORT_STRING_MAX, "NVAPI_STATUS_%d", static_cast<int>(status));
+		break;
+	}
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorGetInterfaceVersionString(NvAPI_ShortString version)
+{
+	EMULATED_CALL(NVAPI_CALL_GET_INTERFACE_VERSION_STRING);
+	strncpy_s(version, NVAPI_SHORT_STRING_MAX, "NVidia Complete Version 1.10 (Emulated)", _TRUNCATE);
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorGetDriverAndBranchVersion(NvU32 *pDriverVersion, NvAPI_ShortString buildBranch)
+{
+	EMULATED_CALL(NVAPI_CALL_GET_DRIVER_AND_BRANCH_VERSION);
+	if (!pDriverVersion)
+		return NVAPI_INVALID_ARGUMENT;
+	*pDriverVersion = 58100;
+	strncpy_s(buildBranch, NVAPI_SHORT_STRING_MAX, "r580_00-emulated", _TRUNCATE);
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorEnumPhysicalGPUs(NvPhysicalGpuHandle gpuHandles[NVAPI_MAX_PHYSICAL_GPUS], NvU32 *pGpuCount)
+{
+	EMULATED_CALL(NVAPI_CALL_ENUM_PHYSICAL_GPUS);
+	if (!pGpuCount)
+		return NVAPI_INVALID_ARGUMENT;
+	std::shared_lock<std::shared_mutex> topology(emulatorTopologyLock);
+	if (emulatedGpuCount == 0)
+		return NVAPI_NVIDIA_DEVICE_NOT_FOUND;
+	for (unsigned int i = 0; i < emulatedGpuCount; ++i)
+		gpuHandles[i] = reinterpret_cast<NvPhysicalGpuHandle>(&emulatedGpus[i]);
+	*pGpuCount = emulatedGpuCount;
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorGetFullName(NvPhysicalGpuHandle gpuHandle, NvAPI_ShortString name)
+{
+	EMULATED_GPU_CALL(NVAPI_CALL_GET_FULL_NAME, gpuHandle, name);
+	strncpy_s(name, NVAPI_SHORT_STRING_MAX, gpu->config.name, _TRUNCATE);
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorGetGPUInfo(NvPhysicalGpuHandle gpuHandle, NV_GPU_INFO *pGpuInfo)
+{
+	EMULATED_GPU_CALL(NVAPI_CALL_GET_GPU_INFO, gpuHandle, pGpuInfo);
+	if (pGpuInfo->version != NV_GPU_INFO_VER)
+		return NVAPI_INCOMPATIBLE_STRUCT_VERSION;
+	memset(pGpuInfo, 0, sizeof(*pGpuInfo));
+	pGpuInfo->version = NV_GPU_INFO_VER;
+	pGpuInfo->rayTracingCores = 128;
+	pGpuInfo->tensorCores = 512;
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorGetSystemType(NvPhysicalGpuHandle gpuHandle, NV_SYSTEM_TYPE *pSystemType)
+{
+	EMULATED_GPU_CALL(NVAPI_CALL_GET_SYSTEM_TYPE, gpuHandle, pSystemType);
+	*pSystemType = NV_SYSTEM_TYPE_DESKTOP;
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorGetPCIIdentifiers(NvPhysicalGpuHandle gpuHandle, NvU32 *pDeviceId, NvU32 *pSubSystemId, NvU32 *pRevisionId, NvU32 *pExtDeviceId)
+{
+	EMULATED_GPU_CALL(NVAPI_CALL_GET_PCI_IDENTIFIERS, gpuHandle, pDeviceId);
+	if (!pSubSystemId || !pRevisionId || !pExtDeviceId)
+		return NVAPI_INVALID_ARGUMENT;
+	*pDeviceId = gpu->config.deviceId;
+	*pSubSystemId = gpu->config.subSystemId;
+	*pRevisionId = gpu->config.revisionId;
+	*pExtDeviceId = gpu->config.extDeviceId;
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorGetBusId(NvPhysicalGpuHandle gpuHandle, NvU32 *pBusId)
+{
+	EMULATED_GPU_CALL(NVAPI_CALL_GET_BUS_ID, gpuHandle, pBusId);
+	*pBusId = gpu->config.busId;
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorIllumZonesGetInfo(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS *pParams)
+{
+	EMULATED_GPU_CALL(NVAPI_CALL_ILLUM_ZONES_GET_INFO, gpuHandle, pParams);
+	if (pParams->version != NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS_VER)
+		return NVAPI_INCOMPATIBLE_STRUCT_VERSION;
+	memset(pParams, 0, sizeof(*pParams));
+	pParams->version = NV_GPU_CLIENT_ILLUM_ZONE_INFO_PARAMS_VER;
+	pParams->numIllumZones = gpu->config.zoneCount;
+	for (unsigned int z = 0; z < gpu->config.zoneCount; ++z)
+	{
+		pParams->zones[z].type = static_cast<NV_GPU_CLIENT_ILLUM_ZONE_TYPE>(gpu->config.zoneTypes[z]);
+		pParams->zones[z].zoneLocation = static_cast<NV_GPU_CLIENT_ILLUM_ZONE_LOCATION>(gpu->config.zoneLocations[z]);
+	}
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorIllumZonesGetControl(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams)
+{
+	EMULATED_GPU_CALL(NVAPI_CALL_ILLUM_ZONES_GET_CONTROL, gpuHandle, pParams);
+	if (pParams->version != NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS_VER)
+		return NVAPI_INCOMPATIBLE_STRUCT_VERSION;
+	std::lock_guard<std::mutex> lock(gpu->lock);
+	*pParams = pParams->bDefault ? gpu->defaults : gpu->current;
+	return NVAPI_OK;
+}
+
+// Only full zone sets whose types match the topology are accepted, the same rule the driver enforces
+static NvAPI_Status emulatorIllumZonesSetControl(NvPhysicalGpuHandle gpuHandle, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams)
+{
+	EMULATED_GPU_CALL(NVAPI_CALL_ILLUM_ZONES_SET_CONTROL, gpuHandle, pParams);
+	if (pParams->version != NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS_VER)
+		return NVAPI_INCOMPATIBLE_STRUCT_VERSION;
+	if (pParams->numIllumZonesControl != gpu->config.zoneCount)
+		return NVAPI_INVALID_ARGUMENT;
+	for (unsigned int z = 0; z < pParams->numIllumZonesControl; ++z)
+	{
+		const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_V1 &zone = pParams->zones[z];
+		if (static_cast<unsigned int>(zone.type) != gpu->config.zoneTypes[z])
+			return NVAPI_INVALID_ARGUMENT;
+		if (zone.ctrlMode != NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL && zone.ctrlMode != NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR)
+			return NVAPI_INVALID_ARGUMENT;
+	}
+	std::lock_guard<std::mutex> lock(gpu->lock);
+	(pParams->bDefault ? gpu->defaults : gpu->current) = *pParams;
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorGetThermalSettings(NvPhysicalGpuHandle gpuHandle, NvU32 sensorIndex, NV_GPU_THERMAL_SETTINGS *pThermalSettings)
+{
+	EMULATED_GPU_CALL(NVAPI_CALL_GET_THERMAL_SETTINGS, gpuHandle, pThermalSettings);
+	if (pThermalSettings->version != NV_GPU_THERMAL_SETTINGS_VER)
+		return NVAPI_INCOMPATIBLE_STRUCT_VERSION;
+	if (sensorIndex != 0 && sensorIndex != NVAPI_THERMAL_TARGET_ALL)
+		return NVAPI_INVALID_ARGUMENT;
+	std::lock_guard<std::mutex> lock(gpu->lock);
+	memset(pThermalSettings, 0, sizeof(*pThermalSettings));
+	pThermalSettings->version = NV_GPU_THERMAL_SETTINGS_VER;
+	// a single GPU sensor, like consumer boards report
+	if (gpu->telemetry.validMask & (1u << TELEMETRY_METRIC_GPU_TEMPERATURE))
+	{
+		pThermalSettings->count = 1;
+		pThermalSettings->sensor[0].target = NVAPI_THERMAL_TARGET_GPU;
+		pThermalSettings->sensor[0].defaultMaxTemp = 127;
+		pThermalSettings->sensor[0].currentTemp = static_cast<NvS32>(gpu->telemetry.values[TELEMETRY_METRIC_GPU_TEMPERATURE]);
+	}
+	return NVAPI_OK;
+}
+
+static NvAPI_Status emulatorGetDynamicPstatesInfoEx(NvPhysicalGpuHandle gpuHandle, NV_GPU_DYNAMIC_PSTATES_INFO_EX *pDynamicPstatesInfoEx)
+{
+	EMULATED_GPU_CALL(NVAPI_CALL_GET_DYNAMIC_PSTATES_INFO_EX, gpuHandle, pDynamicPstatesInfoEx);
+	if (pDynamicPstatesInfoEx->version != NV_GPU_DYNAMIC_PSTATES_INFO_EX_VER)
+		return NVAPI_INCOMPATIBLE_STRUCT_VERSION;
+	std::lock_guard<std::mutex> lock(gpu->lock);
+	memset(pDynamicPstatesInfoEx, 0, sizeof(*pDynamicPstatesInfoEx));
+	pDynamicPstatesInfoEx->version = NV_GPU_DYNAMIC_PSTATES_INFO_EX_VER;
+	pDynamicPstatesInfoEx->flags = 1;
+	// utilization domains 0 to 2 are graphics, frame buffer and video, the metrics right after the temperature
+	for (unsigned int domain = 0; domain < 3; ++domain)
+	{
+		unsigned int metric = TELEMETRY_METRIC_GPU_UTILIZATION + domain;
+		if (!(gpu->telemetry.validMask & (1u << metric)))
+			continue;
+		pDynamicPstatesInfoEx->utilization[domain].bIsPresent = 1;
+		pDynamicPstatesInfoEx->utilization[domain].percentage = static_cast<NvU32>(gpu->telemetry.values[metric]);
+	}
+	return NVAPI_OK;
+}
+
+const NvApiBackend emulatorBackend = {
+	emulatorInitialize,
+	emulatorUnload,
+	emulatorGetErrorMessage,
+	emulatorGetInterfaceVersionString,
+	emulatorGetDriverAndBranchVersion,
+	emulatorEnumPhysicalGPUs,
+	emulatorGetFullName,
+	emulatorGetGPUInfo,
+	emulatorGetSystemType,
+	emulatorGetPCIIdentifiers,
+	emulatorGetBusId,
+	emulatorIllumZonesGetInfo,
+	emulatorIllumZonesGetControl,
+	emulatorIllumZonesSetControl,
+	emulatorGetThermalSettings,
+	emulatorGetDynamicPstatesInfoEx,
+};
+
+// Replaces the emulated topology, every zone starts out in manual mode at full brightness
+NVAPI_DLL bool ConfigureNvApiEmulator(const EmulatorGpuConfig *pGpus, unsigned int gpuCount)
+{
+	if ((gpuCount && !pGpus) || gpuCount > NVAPI_MAX_PHYSICAL_GPUS)
+		return false;
+	for (unsigned int i = 0; i < gpuCount; ++i)
+	{
+		if (pGpus[i].zoneCount > NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX)
+			return false;
+		for (unsigned int z = 0; z < pGpus[i].zoneCount; ++z)
+			if (pGpus[i].zoneTypes[z] == NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID || pGpus[i].zoneTypes[z] > NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR)
+				return false;
+	}
+	{
+		std::unique_lock<std::shared_mutex> topology(emulatorTopologyLock);
+		for (unsigned int i = 0; i < gpuCount; ++i)
+			resetEmulatedGpu(emulatedGpus[i], pGpus[i]);
+		emulatedGpuCount = gpuCount;
+		emulatorConfigured = true;
+	}
+	// the slots are reused, so handles the wrapper cached may now point at a different GPU
+	if (!nvapiIsDriverBackend())
+	{
+		InvalidateGPUHandleCache();
+		InvalidateIlluminationShadow(NVAPI_MAX_PHYSICAL_GPUS);
+	}
+	return true;
+}
+
+NVAPI_DLL bool SetNvApiEmulatorLatency(unsigned int call, unsigned int latencyUs)
+{
+	if (call >= NVAPI_CALL_COUNT)
+		return false;
+	emulatorCalls[call].latencyUs = latencyUs;
+	return true;
+}
+
+// Makes every Nth call of the given entry point return status, everyNthCall 0 turns the injection off
+NVAPI_DLL bool SetNvApiEmulatorFailure(unsigned int call, NvAPI_Status status, unsigned int everyNthCall)
+{
+	if (call >= NVAPI_CALL_COUNT || (everyNthCall && status == NVAPI_OK))
+		return false;
+	emulatorCalls[call].failStatus = static_cast<int>(status);
+	emulatorCalls[call].failEveryNth = everyNthCall;
+	return true;
+}
+
+NVAPI_DLL bool GetNvApiEmulatorCallCount(unsigned int call, unsigned long long *pCount)
+{
+	if (call >= NVAPI_CALL_COUNT || !pCount)
+		return false;
+	*pCount = emulatorCalls[call].count.load();
+	return true;
+}
+
+// Sets what the thermal and utilization calls report for an emulated GPU, metrics outside validMask are not reported
+NVAPI_DLL bool SetNvApiEmulatorTelemetry(unsigned int gpuIndex, const TelemetrySample *pSample)
+{
+	if (!pSample || pSample->validMask >= (1u << TELEMETRY_METRIC_COUNT))
+		return false;
+	for (unsigned int metric = 0; metric < TELEMETRY_METRIC_COUNT; ++metric)
+		if (!(pSample->values[metric] >= (metric == TELEMETRY_METRIC_GPU_TEMPERATURE ? -100.0f : 0.0f) &&
+			  pSample->values[metric] <= (metric == TELEMETRY_METRIC_GPU_TEMPERATURE ? 200.0f : 100.0f)))
+			return false;
+	std::unique_lock<std::shared_mutex> topology(emulatorTopologyLock);
+	ensureDefaultTopology();
+	if (gpuIndex >= emulatedGpuCount)
+		return false;
+	EmulatedGpu &gpu = emulatedGpus[gpuIndex];
+	std::lock_guard<std::mutex> lock(gpu.lock);
+	gpu.telemetry = *pSample;
+	return true;
+}
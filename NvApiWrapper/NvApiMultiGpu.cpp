@@ -0,0 +1,149 @@
+#include "pch.h"
+#include "NvApiPerf.h"
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Multi-GPU profile application. GPUs are located by PCI identity instead of enumeration index, since the index
+// order is not stable across driver restarts, and every matched GPU gets its own worker so the per-GPU driver
+// latency overlaps instead of adding up.
+
+static bool readPciIdentity(unsigned int index, GpuPciIdentity &identity)
+{
+	unsigned long busId = 0, deviceId = 0, subSystemId = 0;
+	if (!GetGPUBusId(index, &busId) || !GetGPUPCIIdentifiers(index, &deviceId, &subSystemId, nullptr, nullptr))
+		return false;
+	identity.busId = static_cast<unsigned int>(busId);
+	identity.deviceId = static_cast<unsigned int>(deviceId);
+	identity.subSystemId = static_cast<unsigned int>(subSystemId);
+	return true;
+}
+
+// Same rule as GpuIdentifier.Matches in the app, revision and external device id are not compared
+static bool pciIdentityMatches(const GpuPciIdentity &a, const GpuPciIdentity &b)
+{
+	return a.busId == b.busId && a.deviceId == b.deviceId && a.subSystemId == b.subSystemId;
+}
+
+NVAPI_DLL bool FindGPUByPciIdentity(const GpuPciIdentity *pIdentity, unsigned int *pIndex)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_FIND_GPU_BY_PCI_IDENTITY);
+	if (!pIdentity || !pIndex)
+		return false;
+	unsigned int gpuCount = GetNumberOfGPUs();
+	for (unsigned int i = 0; i < gpuCount; ++i)
+	{
+		GpuPciIdentity identity;
+		if (readPciIdentity(i, identity) && pciIdentityMatches(identity, *pIdentity))
+		{
+			*pIndex = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Two batches for one GPU would race on its zones and two overlapping slices on their results
+static bool batchesConflict(const GpuZoneBatch &a, const GpuZoneBatch &b)
+{
+	if (pciIdentityMatches(a.identity, b.identity))
+		return true;
+	return a.updateCount && b.updateCount && a.firstUpdate < b.firstUpdate + b.updateCount && b.firstUpdate < a.firstUpdate + a.updateCount;
+}
+
+static void applyGpuZoneBatch(unsigned int gpuIndex, const ZoneUpdate *pUpdates, unsigned int count, bool Default, NvAPI_Status *pGpuResult, NvAPI_Status *pZoneResults)
+{
+	if (count == 0)
+	{
+		*pGpuResult = NVAPI_OK;
+		return;
+	}
+	if (SetIlluminationZonesBatch(gpuIndex, pUpdates, count, Default, pZoneResults))
+	{
+		*pGpuResult = NVAPI_OK;
+		return;
+	}
+	// report the first zone failure as the GPU result
+	*pGpuResult = NVAPI_ERROR;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		if (pZoneResults[i] != NVAPI_OK)
+		{
+			*pGpuResult = pZoneResults[i];
+			break;
+		}
+	}
+}
+
+NVAPI_DLL bool ApplyIlluminationZonesMultiGpu(const GpuZoneBatch *pBatches, unsigned int batchCount, const ZoneUpdate *pUpdates, unsigned int updateCount, bool Default, NvAPI_Status *pGpuResults, NvAPI_Status *pZoneResults, unsigned long long *pWallTimeUs)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_APPLY_ILLUMINATION_ZONES_MULTI_GPU);
+	if (!pBatches || !pGpuResults || !pZoneResults || batchCount == 0 || batchCount > NVAPI_MAX_PHYSICAL_GPUS)
+		return false;
+	if (updateCount && !pUpdates)
+		return false;
+	for (unsigned int b = 0; b < batchCount; ++b)
+		if (pBatches[b].firstUpdate > updateCount || pBatches[b].updateCount > updateCount - pBatches[b].firstUpdate)
+			return false;
+	for (unsigned int b = 0; b < batchCount; ++b)
+	{
+		for (unsigned int other = b + 1; other < batchCount; ++other)
+		{
+			if (!batchesConflict(pBatches[b], pBatches[other]))
+				continue;
+			// nothing is applied, every result says why
+			for (unsigned int i = 0; i < batchCount; ++i)
+				pGpuResults[i] = NVAPI_INVALID_ARGUMENT;
+			for (unsigned int i = 0; i < updateCount; ++i)
+				pZoneResults[i] = NVAPI_INVALID_ARGUMENT;
+			return false;
+		}
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// read every GPU identity once up front, the batches are then matched against this table
+	GpuPciIdentity identities[NVAPI_MAX_PHYSICAL_GPUS];
+	bool identityValid[NVAPI_MAX_PHYSICAL_GPUS] = {false};
+	unsigned int gpuCount = GetNumberOfGPUs();
+	for (unsigned int i = 0; i < gpuCount; ++i)
+		identityValid[i] = readPciIdentity(i, identities[i]);
+
+	std::thread workers[NVAPI_MAX_PHYSICAL_GPUS];
+	for (unsigned int b = 0; b < batchCount; ++b)
+	{
+		const GpuZoneBatch &batch = pBatches[b];
+		NvAPI_Status *pBatchResults = pZoneResults + batch.firstUpdate;
+
+		unsigned int gpuIndex = gpuCount;
+		for (unsigned int i = 0; i < gpuCount; ++i)
+		{
+			if (identityValid[i] && pciIdentityMatches(identities[i], batch.identity))
+			{
+				gpuIndex = i;
+				break;
+			}
+		}
+		if (gpuIndex == gpuCount)
+		{
+			pGpuResults[b] = NVAPI_NVIDIA_DEVICE_NOT_FOUND;
+			for (unsigned int i = 0; i < batch.updateCount; ++i)
+				pBatchResults[i] = NVAPI_NVIDIA_DEVICE_NOT_FOUND;
+			continue;
+		}
+
+		workers[b] = std::thread(applyGpuZoneBatch, gpuIndex, pUpdates + batch.firstUpdate, batch.updateCount, Default, &pGpuResults[b], pBatchResults);
+	}
+
+	bool allApplied = true;
+	for (unsigned int b = 0; b < batchCount; ++b)
+	{
+		if (workers[b].joinable())
+			workers[b].join();
+		if (pGpuResults[b] != NVAPI_OK)
+			allApplied = false;
+	}
+
+	if (pWallTimeUs)
+		*pWallTimeUs = static_cast<unsigned long long>(
+			std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+	return allApplied;
+}
@@ -0,0 +1,252 @@
+#include "pch.h"
+#include "NvApiNotify.h"
+#include <algorithm>
+#include <vector>
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Zone change subscriptions. One sampler thread re-reads the zone control state of every GPU with a subscriber,
+// compares it with the state last delivered and hands only the differing zones to the callbacks. A change is held
+// back for the coalescing window so a burst of writes, e.g. a color picker drag, arrives as one notification with
+// the final state, and a change that is undone within the window is never reported. The thread only exists while
+// there are subscribers.
+
+static const unsigned int SAMPLER_MAX_INTERVAL_MS = 60 * 60 * 1000;
+
+struct ZoneChangeSubscriber
+{
+	unsigned int id;
+	unsigned int gpuIndex;
+	ZoneChangeFn callback;
+	void *context;
+};
+// Last delivered state of one GPU, the baseline new samples are compared with
+struct SampledGpuState
+{
+	bool hasBaseline;
+	bool pending; // a change was seen and is waiting for the coalescing window to pass
+	std::chrono::steady_clock::time_point pendingSince;
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS delivered;
+};
+
+static std::mutex notifyLock;
+// held while callbacks run so UnregisterZoneChangeCallback can wait for a delivery in flight
+static std::mutex notifyCallbackLock;
+static std::condition_variable samplerWake;
+static std::condition_variable samplerExited;
+static bool samplerThreadAlive = false;
+static std::thread::id samplerThreadId;
+static std::vector<ZoneChangeSubscriber> subscribers;
+static unsigned int nextSubscriptionId = 1;
+static unsigned int samplerPollIntervalMs = 250;
+static unsigned int samplerCoalesceWindowMs = 50;
+static SampledGpuState sampledGpus[NVAPI_MAX_PHYSICAL_GPUS];
+static unsigned long long samplerSamples = 0;
+static unsigned long long samplerNotifications = 0;
+static unsigned long long samplerCoalesced = 0;
+
+// Bit per zone whose control state differs, a changed zone count marks every zone of the larger set
+static unsigned int diffZones(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS &before, const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS &after)
+{
+	unsigned int zoneCount = (std::max)(before.numIllumZonesControl, after.numIllumZonesControl);
+	if (zoneCount > NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX)
+		zoneCount = NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX;
+	unsigned int changedMask = 0;
+	for (unsigned int i = 0; i < zoneCount; ++i)
+		if (before.numIllumZonesControl != after.numIllumZonesControl || memcmp(&before.zones[i], &after.zones[i], sizeof(after.zones[i])) != 0)
+			changedMask |= 1u << i;
+	return changedMask;
+}
+
+static bool hasSubscriber(unsigned int gpuIndex)
+{
+	for (const ZoneChangeSubscriber &subscriber : subscribers)
+		if (subscriber.gpuIndex == gpuIndex)
+			return true;
+	return false;
+}
+
+// Samples one GPU and decides whether its changes are due, called with notifyLock held and returns with it held
+static void sampleGpu(std::unique_lock<std::mutex> &lock, unsigned int gpuIndex, std::chrono::steady_clock::time_point &nextPoll)
+{
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS params;
+	IlluminationZoneChange changes[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	std::vector<ZoneChangeSubscriber> targets;
+
+	lock.unlock();
+	NvAPI_Status status = sampleIlluminationControl(gpuIndex, params);
+	lock.lock();
+	samplerSamples++;
+	SampledGpuState &state = sampledGpus[gpuIndex];
+	// a failed read or a GPU whose last subscriber left meanwhile keeps the baseline as it is
+	if (status != NVAPI_OK || !hasSubscriber(gpuIndex))
+		return;
+	if (!state.hasBaseline)
+	{
+		state.delivered = params;
+		state.hasBaseline = true;
+		return;
+	}
+
+	unsigned int changedMask = diffZones(state.delivered, params);
+	if (!changedMask)
+	{
+		state.pending = false;
+		return;
+	}
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (!state.pending)
+	{
+		state.pending = true;
+		state.pendingSince = now;
+	}
+	std::chrono::steady_clock::time_point due = state.pendingSince + std::chrono::milliseconds(samplerCoalesceWindowMs);
+	if (now < due)
+	{
+		samplerCoalesced++;
+		if (due < nextPoll)
+			nextPoll = due;
+		return;
+	}
+
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < params.numIllumZonesControl && i < NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX; ++i)
+	{
+		if (!(changedMask & (1u << i)))
+			continue;
+		changes[count].zoneIndex = i;
+		fillZoneControlV2(params.zones[i], changes[count].control);
+		++count;
+	}
+	state.delivered = params;
+	state.pending = false;
+	for (const ZoneChangeSubscriber &subscriber : subscribers)
+		if (subscriber.gpuIndex == gpuIndex)
+			targets.push_back(subscriber);
+	samplerNotifications += targets.size();
+
+	// taking the callback lock before dropping notifyLock means an unregister that returns has seen this delivery end
+	std::lock_guard<std::mutex> callbackLock(notifyCallbackLock);
+	lock.unlock();
+	for (const ZoneChangeSubscriber &subscriber : targets)
+		subscriber.callback(gpuIndex, changes, count, subscriber.context);
+	lock.lock();
+}
+
+static void samplerThread()
+{
+	std::unique_lock<std::mutex> lock(notifyLock);
+	samplerThreadId = std::this_thread::get_id();
+	std::chrono::steady_clock::time_point nextPoll = std::chrono::steady_clock::now() + std::chrono::milliseconds(samplerPollIntervalMs);
+	while (!subscribers.empty())
+	{
+		if (samplerWake.wait_until(lock, nextPoll, []
+								   { return subscribers.empty(); }))
+			break;
+		nextPoll = std::chrono::steady_clock::now() + std::chrono::milliseconds(samplerPollIntervalMs);
+		for (unsigned int gpuIndex = 0; gpuIndex < NVAPI_MAX_PHYSICAL_GPUS; ++gpuIndex)
+			if (hasSubscriber(gpuIndex))
+				sampleGpu(lock, gpuIndex, nextPoll);
+	}
+	samplerThreadId = std::thread::id();
+	samplerThreadAlive = false;
+	samplerExited.notify_all();
+}
+
+// Subscribes to changes of the GPU's active zone state, returns the subscription id or 0. The baseline is read before
+// returning, so a caller that registers first and then queries the zones misses no change in between.
+NVAPI_DLL unsigned int RegisterZoneChangeCallback(unsigned int gpuIndex, ZoneChangeFn callback, void *context)
+{
+	if (!callback || gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS)
+		return 0;
+	NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS baseline;
+	std::unique_lock<std::mutex> lock(notifyLock);
+	if (!sampledGpus[gpuIndex].hasBaseline)
+	{
+		// the driver is asked without the lock, the sampler may fill the baseline meanwhile and that one is as good
+		lock.unlock();
+		NvAPI_Status status = sampleIlluminationControl(gpuIndex, baseline);
+		lock.lock();
+		if (status != NVAPI_OK)
+			return 0;
+		if (!sampledGpus[gpuIndex].hasBaseline)
+		{
+			sampledGpus[gpuIndex].delivered = baseline;
+			sampledGpus[gpuIndex].pending = false;
+			sampledGpus[gpuIndex].hasBaseline = true;
+		}
+	}
+
+	unsigned int id = nextSubscriptionId++;
+	if (id == 0)
+		id = nextSubscriptionId++;
+	subscribers.push_back({id, gpuIndex, callback, context});
+	if (!samplerThreadAlive)
+	{
+		samplerThreadAlive = true;
+		// detached like the other worker threads, the sampler exits by itself once the last subscriber is gone
+		std::thread(samplerThread).detach();
+	}
+	return id;
+}
+
+// No callback of the subscription runs after this returns, unless it is called from within a callback
+NVAPI_DLL bool UnregisterZoneChangeCallback(unsigned int subscription)
+{
+	{
+		std::lock_guard<std::mutex> lock(notifyLock);
+		auto it = std::find_if(subscribers.begin(), subscribers.end(), [subscription](const ZoneChangeSubscriber &subscriber)
+							   { return subscriber.id == subscription; });
+		if (it == subscribers.end())
+			return false;
+		unsigned int gpuIndex = it->gpuIndex;
+		subscribers.erase(it);
+		if (!hasSubscriber(gpuIndex))
+		{
+			sampledGpus[gpuIndex].hasBaseline = false;
+			sampledGpus[gpuIndex].pending = false;
+		}
+		if (subscribers.empty())
+			samplerWake.notify_all();
+		if (samplerThreadId == std::this_thread::get_id())
+			return true;
+	}
+	std::lock_guard<std::mutex> callbackLock(notifyCallbackLock);
+	return true;
+}
+
+// Sets how often the zones are read and how long a change is held back to coalesce it with the ones that follow
+NVAPI_DLL bool SetZoneChangeSamplerTiming(unsigned int pollIntervalMs, unsigned int coalesceWindowMs)
+{
+	if (pollIntervalMs == 0 || pollIntervalMs > SAMPLER_MAX_INTERVAL_MS || coalesceWindowMs > SAMPLER_MAX_INTERVAL_MS)
+		return false;
+	std::lock_guard<std::mutex> lock(notifyLock);
+	samplerPollIntervalMs = pollIntervalMs;
+	samplerCoalesceWindowMs = coalesceWindowMs;
+	return true;
+}
+
+NVAPI_DLL void GetZoneChangeSamplerStats(unsigned long long *pSamples, unsigned long long *pNotifications, unsigned long long *pCoalesced)
+{
+	std::lock_guard<std::mutex> lock(notifyLock);
+	if (pSamples)
+		*pSamples = samplerSamples;
+	if (pNotifications)
+		*pNotifications = samplerNotifications;
+	if (pCoalesced)
+		*pCoalesced = samplerCoalesced;
+}
+
+void stopZoneChangeSampler()
+{
+	std::unique_lock<std::mutex> lock(notifyLock);
+	subscribers.clear();
+	for (SampledGpuState &state : sampledGpus)
+	{
+		state.hasBaseline = false;
+		state.pending = false;
+	}
+	samplerWake.notify_all();
+	if (samplerThreadId != std::this_thread::get_id())
+		samplerExited.wait(lock, []
+						   { return !samplerThreadAlive; });
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include "NvApiDll.h"
+
+// Reads the active zone control state from the driver, never from the shadow state, and refreshes the shadow with it
+NvAPI_Status sampleIlluminationControl(unsigned int gpuIndex, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS &params);
+// Converts one driver zone to the v2 layout handed to GetIlluminationZonesControlV2 callers
+void fillZoneControlV2(const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_V1 &src, IlluminationZoneControlV2 &dst);
+// Drops every subscription and waits for the sampler thread, called by DeinitializeNvApi
+void stopZoneChangeSampler();
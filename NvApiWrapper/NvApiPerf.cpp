@@ -0,0 +1,217 @@
+#include "pch.h"
+#include "NvApiPerf.h"
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Per-call counters for every NvAPI entry point and every instrumented export. Recording is a handful of relaxed
+// atomic adds, snapshots read the counters without stopping writers so fields of one snapshot may be a few calls apart.
+
+static const char *const perfCallNames[NVAPI_CALL_COUNT] = {
+	"NvAPI_Initialize",
+	"NvAPI_Unload",
+	"NvAPI_GetErrorMessage",
+	"NvAPI_GetInterfaceVersionString",
+	"NvAPI_SYS_GetDriverAndBranchVersion",
+	"NvAPI_EnumPhysicalGPUs",
+	"NvAPI_GPU_GetFullName",
+	"NvAPI_GPU_GetGPUInfo",
+	"NvAPI_GPU_GetSystemType",
+	"NvAPI_GPU_GetPCIIdentifiers",
+	"NvAPI_GPU_GetBusId",
+	"NvAPI_GPU_ClientIllumZonesGetInfo",
+	"NvAPI_GPU_ClientIllumZonesGetControl",
+	"NvAPI_GPU_ClientIllumZonesSetControl",
+	"NvAPI_GPU_GetThermalSettings",
+	"NvAPI_GPU_GetDynamicPstatesInfoEx",
+};
+
+static const char *const perfExportNames[PERF_EXPORT_COUNT] = {
+	"InitializeNvApi",
+	"DeinitializeNvApi",
+	"GetInterfaceVersionString",
+	"GetDriverVersion",
+	"GetNumberOfGPUs",
+	"GetGPUHandle",
+	"GetGPUName",
+	"GetGPUInfo",
+	"GetSystemType",
+	"GetGPUPCIIdentifiers",
+	"GetGPUBusId",
+	"GetIlluminationZonesInfoData",
+	"FormatIlluminationZonesInfo",
+	"GetIlluminationZonesInfo",
+	"GetIlluminationZonesControlData",
+	"FormatIlluminationZonesControl",
+	"GetIlluminationZonesControl",
+	"SetIlluminationZonesBatch",
+	"SetIlluminationZoneManualRGB",
+	"SetIlluminationZoneManualRGBW",
+	"SetIlluminationZoneManualSingleColor",
+	"SetIlluminationZoneManualColorFixed",
+	"SetIlluminationZonePiecewiseLinear",
+	"SetIlluminationZoneControlMode",
+	"FindGPUByPciIdentity",
+	"ApplyIlluminationZonesMultiGpu",
+	"EnqueueIlluminationZoneUpdate",
+	"ApplyProfileFile",
+	"WaitForIlluminationReady",
+	"GetIlluminationZonesInfoV2",
+	"GetIlluminationZonesControlV2",
+	"SubmitAmbientFrame",
+	"GetGpuTelemetry",
+};
+
+// Statuses with an error slot of their own, everything else lands in the PERF_STATUS_OTHER slot
+static const int perfStatusCodes[PERF_STATUS_SLOTS] = {
+	NVAPI_ERROR,
+	NVAPI_LIBRARY_NOT_FOUND,
+	NVAPI_NO_IMPLEMENTATION,
+	NVAPI_API_NOT_INITIALIZED,
+	NVAPI_INVALID_ARGUMENT,
+	NVAPI_NVIDIA_DEVICE_NOT_FOUND,
+	NVAPI_END_ENUMERATION,
+	NVAPI_INVALID_HANDLE,
+	NVAPI_INCOMPATIBLE_STRUCT_VERSION,
+	NVAPI_HANDLE_INVALIDATED,
+	NVAPI_INVALID_POINTER,
+	NVAPI_EXPECTED_PHYSICAL_GPU_HANDLE,
+	NVAPI_NOT_SUPPORTED,
+	NVAPI_ACCESS_DENIED,
+	NVAPI_OK, // unused
+	PERF_STATUS_OTHER,
+};
+
+static const unsigned int PERF_COUNTER_COUNT = NVAPI_CALL_COUNT + PERF_EXPORT_COUNT;
+
+#if NVAPI_PERF_COUNTERS
+
+// One cache line apart so threads recording different calls do not contend. Call counts are not stored, a snapshot
+// sums the histogram buckets instead, which saves one atomic add per call.
+struct alignas(64) PerfCounter
+{
+	std::atomic<unsigned long long> errors;
+	std::atomic<unsigned long long> totalNs;
+	std::atomic<unsigned long long> maxNs;
+	std::atomic<unsigned long long> histogram[PERF_HISTOGRAM_BUCKETS];
+	std::atomic<unsigned long long> statusCounts[PERF_STATUS_SLOTS];
+};
+static PerfCounter perfCounters[PERF_COUNTER_COUNT];
+
+thread_local PerfExportScope *PerfExportScope::current = nullptr;
+
+static unsigned int perfHistogramBucket(unsigned long long ns)
+{
+	unsigned int bucket = 0;
+	for (unsigned long long scaled = ns >> 7; scaled && bucket < PERF_HISTOGRAM_BUCKETS - 1; scaled >>= 1)
+		++bucket;
+	return bucket;
+}
+
+static unsigned int perfStatusSlot(NvAPI_Status status)
+{
+	for (unsigned int slot = 0; slot < PERF_STATUS_SLOTS - 1; ++slot)
+		if (perfStatusCodes[slot] == status && status != NVAPI_OK)
+			return slot;
+	return PERF_STATUS_SLOTS - 1;
+}
+
+static void perfRecord(PerfCounter &counter, NvAPI_Status status, std::chrono::steady_clock::time_point start)
+{
+	unsigned long long ns = static_cast<unsigned long long>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	counter.totalNs.fetch_add(ns, std::memory_order_relaxed);
+	counter.histogram[perfHistogramBucket(ns)].fetch_add(1, std::memory_order_relaxed);
+	unsigned long long maxNs = counter.maxNs.load(std::memory_order_relaxed);
+	while (ns > maxNs && !counter.maxNs.compare_exchange_weak(maxNs, ns, std::memory_order_relaxed))
+	{
+	}
+	if (status != NVAPI_OK)
+	{
+		counter.errors.fetch_add(1, std::memory_order_relaxed);
+		counter.statusCounts[perfStatusSlot(status)].fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+PerfExportScope::~PerfExportScope()
+{
+	perfRecord(perfCounters[NVAPI_CALL_COUNT + id], status, start);
+	current = parent;
+	if (parent && status != NVAPI_OK && parent->status == NVAPI_OK)
+		parent->status = status;
+}
+
+void perfRecordStatus(NvAPI_Status status)
+{
+	PerfExportScope *scope = PerfExportScope::current;
+	if (scope && status != NVAPI_OK && scope->status == NVAPI_OK)
+		scope->status = status;
+}
+
+void perfRecordCall(NvApiCall call, NvAPI_Status status, std::chrono::steady_clock::time_point start)
+{
+	perfRecord(perfCounters[call], status, start);
+}
+
+#endif
+
+NVAPI_DLL bool GetPerfCountersEnabled()
+{
+	return NVAPI_PERF_COUNTERS != 0;
+}
+
+NVAPI_DLL unsigned int GetPerfCounterCount()
+{
+	return NVAPI_PERF_COUNTERS ? PERF_COUNTER_COUNT : 0;
+}
+
+// Copies up to capacity counters, NvAPI calls first and exports after, and returns how many were written
+NVAPI_DLL unsigned int GetPerfCounters(PerfCounterSnapshot *pSnapshots, unsigned int capacity)
+{
+#if NVAPI_PERF_COUNTERS
+	if (!pSnapshots)
+		return 0;
+	unsigned int count = capacity < PERF_COUNTER_COUNT ? capacity : PERF_COUNTER_COUNT;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const PerfCounter &counter = perfCounters[i];
+		PerfCounterSnapshot &snapshot = pSnapshots[i];
+		memset(&snapshot, 0, sizeof(snapshot));
+		bool isCall = i < NVAPI_CALL_COUNT;
+		strncpy_s(snapshot.name, sizeof(snapshot.name), isCall ? perfCallNames[i] : perfExportNames[i - NVAPI_CALL_COUNT], _TRUNCATE);
+		snapshot.kind = isCall ? PERF_COUNTER_NVAPI_CALL : PERF_COUNTER_EXPORT;
+		snapshot.errors = counter.errors.load(std::memory_order_relaxed);
+		snapshot.totalNs = counter.totalNs.load(std::memory_order_relaxed);
+		snapshot.maxNs = counter.maxNs.load(std::memory_order_relaxed);
+		for (unsigned int b = 0; b < PERF_HISTOGRAM_BUCKETS; ++b)
+		{
+			snapshot.histogram[b] = counter.histogram[b].load(std::memory_order_relaxed);
+			snapshot.calls += snapshot.histogram[b];
+		}
+		for (unsigned int s = 0; s < PERF_STATUS_SLOTS; ++s)
+		{
+			snapshot.statusCodes[s] = perfStatusCodes[s];
+			snapshot.statusCounts[s] = counter.statusCounts[s].load(std::memory_order_relaxed);
+		}
+	}
+	return count;
+#else
+	(void)pSnapshots;
+	(void)capacity;
+	return 0;
+#endif
+}
+
+NVAPI_DLL void ResetPerfCounters()
+{
+#if NVAPI_PERF_COUNTERS
+	for (PerfCounter &counter : perfCounters)
+	{
+		counter.errors.store(0, std::memory_order_relaxed);
+		counter.totalNs.store(0, std::memory_order_relaxed);
+		counter.maxNs.store(0, std::memory_order_relaxed);
+		for (auto &bucket : counter.histogram)
+			bucket.store(0, std::memory_order_relaxed);
+		for (auto &statusCount : counter.statusCounts)
+			statusCount.store(0, std::memory_order_relaxed);
+	}
+#endif
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "NvApiDll.h"
+
+// Build with NVAPI_PERF_COUNTERS=0 to compile the counters out, the snapshot exports then report nothing
+#ifndef NVAPI_PERF_COUNTERS
+#define NVAPI_PERF_COUNTERS 1
+#endif
+
+// Exports with their own counter, the counters for NvAPI calls are indexed by NvApiCall and come first
+enum PerfExport
+{
+	PERF_EXPORT_INITIALIZE_NVAPI = 0,
+	PERF_EXPORT_DEINITIALIZE_NVAPI,
+	PERF_EXPORT_GET_INTERFACE_VERSION_STRING,
+	PERF_EXPORT_GET_DRIVER_VERSION,
+	PERF_EXPORT_GET_NUMBER_OF_GPUS,
+	PERF_EXPORT_GET_GPU_HANDLE,
+	PERF_EXPORT_GET_GPU_NAME,
+	PERF_EXPORT_GET_GPU_INFO,
+	PERF_EXPORT_GET_SYSTEM_TYPE,
+	PERF_EXPORT_GET_GPU_PCI_IDENTIFIERS,
+	PERF_EXPORT_GET_GPU_BUS_ID,
+	PERF_EXPORT_GET_ILLUMINATION_ZONES_INFO_DATA,
+	PERF_EXPORT_FORMAT_ILLUMINATION_ZONES_INFO,
+	PERF_EXPORT_GET_ILLUMINATION_ZONES_INFO,
+	PERF_EXPORT_GET_ILLUMINATION_ZONES_CONTROL_DATA,
+	PERF_EXPORT_FORMAT_ILLUMINATION_ZONES_CONTROL,
+	PERF_EXPORT_GET_ILLUMINATION_ZONES_CONTROL,
+	PERF_EXPORT_SET_ILLUMINATION_ZONES_BATCH,
+	PERF_EXPORT_SET_ILLUMINATION_ZONE_MANUAL_RGB,
+	PERF_EXPORT_SET_ILLUMINATION_ZONE_MANUAL_RGBW,
+	PERF_EXPORT_SET_ILLUMINATION_ZONE_MANUAL_SINGLE_COLOR,
+	PERF_EXPORT_SET_ILLUMINATION_ZONE_MANUAL_COLOR_FIXED,
+	PERF_EXPORT_SET_ILLUMINATION_ZONE_PIECEWISE_LINEAR,
+	PERF_EXPORT_SET_ILLUMINATION_ZONE_CONTROL_MODE,
+	PERF_EXPORT_FIND_GPU_BY_PCI_IDENTITY,
+	PERF_EXPORT_APPLY_ILLUMINATION_ZONES_MULTI_GPU,
+	PERF_EXPORT_ENQUEUE_ILLUMINATION_ZONE_UPDATE,
+	PERF_EXPORT_APPLY_PROFILE_FILE,
+	PERF_EXPORT_WAIT_FOR_ILLUMINATION_READY,
+	PERF_EXPORT_GET_ILLUMINATION_ZONES_INFO_V2,
+	PERF_EXPORT_GET_ILLUMINATION_ZONES_CONTROL_V2,
+	PERF_EXPORT_SUBMIT_AMBIENT_FRAME,
+	PERF_EXPORT_GET_GPU_TELEMETRY,
+	PERF_EXPORT_COUNT
+};
+
+#if NVAPI_PERF_COUNTERS
+
+// Times one export call. Scopes nest per thread, a failure recorded in an inner export also fails the outer one.
+class PerfExportScope
+{
+public:
+	explicit PerfExportScope(PerfExport id)
+		: id(id), status(NVAPI_OK), parent(current), start(std::chrono::steady_clock::now())
+	{
+		current = this;
+	}
+	~PerfExportScope();
+	PerfExportScope(const PerfExportScope &) = delete;
+	PerfExportScope &operator=(const PerfExportScope &) = delete;
+
+	static thread_local PerfExportScope *current;
+
+private:
+	friend void perfRecordStatus(NvAPI_Status status);
+	PerfExport id;
+	NvAPI_Status status;
+	PerfExportScope *parent;
+	std::chrono::steady_clock::time_point start;
+};
+
+#define PERF_EXPORT_SCOPE(id) PerfExportScope perfExportScope(id)
+
+// Charges a failed status to the export running on this thread
+void perfRecordStatus(NvAPI_Status status);
+// Adds one NvAPI call to its counter, start is taken right before the call
+void perfRecordCall(NvApiCall call, NvAPI_Status status, std::chrono::steady_clock::time_point start);
+
+#else
+
+#define PERF_EXPORT_SCOPE(id) ((void)0)
+inline void perfRecordStatus(NvAPI_Status) {}
+
+#endif
@@ -0,0 +1,208 @@
+#include "pch.h"
+#include "NvApiPerf.h"
+#include "NvApiProfile.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Binary profiles are mapped read-only and the zone records are handed to the commit in place, so applying a profile
+// costs one file mapping, the identity check and a single SetControl.
+
+static const char profileMagic[4] = {'N', 'V', 'F', 'L'};
+// largest file worth mapping, with some room for a header grown by a later version
+static const size_t PROFILE_FILE_MAX_SIZE = sizeof(ProfileFileHeader) + 64 + NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX * sizeof(ZoneUpdate);
+
+struct ProfileMapping
+{
+	const unsigned char *data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+};
+
+static void unmapProfile(ProfileMapping &mapped)
+{
+#ifdef _WIN32
+	if (mapped.data)
+		UnmapViewOfFile(mapped.data);
+	if (mapped.mapping)
+		CloseHandle(mapped.mapping);
+	if (mapped.file != INVALID_HANDLE_VALUE)
+		CloseHandle(mapped.file);
+#else
+	if (mapped.data)
+		munmap(const_cast<unsigned char *>(mapped.data), mapped.size);
+#endif
+	mapped.data = nullptr;
+}
+
+#ifndef _WIN32
+// open() takes bytes, so the wide path is passed on as UTF-8. False for code points outside Unicode.
+static bool widePathToUtf8(const wchar_t *path, std::string &utf8)
+{
+	utf8.clear();
+	for (; *path; ++path)
+	{
+		uint32_t c = static_cast<uint32_t>(*path);
+		if (c < 0x80)
+			utf8 += static_cast<char>(c);
+		else if (c < 0x800)
+		{
+			utf8 += static_cast<char>(0xC0 | (c >> 6));
+			utf8 += static_cast<char>(0x80 | (c & 0x3F));
+		}
+		else if (c < 0x10000)
+		{
+			if (c >= 0xD800 && c < 0xE000)
+				return false;
+			utf8 += static_cast<char>(0xE0 | (c >> 12));
+			utf8 += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+			utf8 += static_cast<char>(0x80 | (c & 0x3F));
+		}
+		else if (c < 0x110000)
+		{
+			utf8 += static_cast<char>(0xF0 | (c >> 18));
+			utf8 += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+			utf8 += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+			utf8 += static_cast<char>(0x80 | (c & 0x3F));
+		}
+		else
+			return false;
+	}
+	return true;
+}
+#endif
+
+// Maps the whole file, files that cannot hold a profile are rejected before mapping. The path is wide so profiles in
+// folders outside the ANSI code page open too.
+static NvAPI_Status mapProfile(const wchar_t *path, ProfileMapping &mapped)
+{
+	mapped.data = nullptr;
+	mapped.size = 0;
+#ifdef _WIN32
+	mapped.mapping = nullptr;
+	mapped.file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (mapped.file == INVALID_HANDLE_VALUE)
+		return NVAPI_ERROR;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(mapped.file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(ProfileFileHeader)) ||
+		fileSize.QuadPart > static_cast<LONGLONG>(PROFILE_FILE_MAX_SIZE))
+	{
+		unmapProfile(mapped);
+		return NVAPI_INVALID_ARGUMENT;
+	}
+	mapped.size = static_cast<size_t>(fileSize.QuadPart);
+	mapped.mapping = CreateFileMappingA(mapped.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapped.mapping)
+		mapped.data = static_cast<const unsigned char *>(MapViewOfFile(mapped.mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+	std::string utf8Path;
+	if (!widePathToUtf8(path, utf8Path))
+		return NVAPI_INVALID_ARGUMENT;
+	int fd = open(utf8Path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return NVAPI_ERROR;
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(ProfileFileHeader)) ||
+		fileStat.st_size > static_cast<off_t>(PROFILE_FILE_MAX_SIZE))
+	{
+		close(fd);
+		return NVAPI_INVALID_ARGUMENT;
+	}
+	mapped.size = static_cast<size_t>(fileStat.st_size);
+	void *view = mmap(nullptr, mapped.size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view != MAP_FAILED)
+		mapped.data = static_cast<const unsigned char *>(view);
+#endif
+	if (!mapped.data)
+	{
+		unmapProfile(mapped);
+		return NVAPI_ERROR;
+	}
+	return NVAPI_OK;
+}
+
+static uint32_t profileChecksum(const unsigned char *data, size_t size)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; ++i)
+		hash = (hash ^ data[i]) * 16777619u;
+	return hash;
+}
+
+// Checks the layout and checksum, the mapping is page aligned so the header and records can be read in place
+static NvAPI_Status validateProfile(const ProfileMapping &mapped, const ProfileFileHeader *&pHeader, const ZoneUpdate *&pUpdates)
+{
+	const ProfileFileHeader *header = reinterpret_cast<const ProfileFileHeader *>(mapped.data);
+	if (memcmp(header->magic, profileMagic, sizeof(profileMagic)) != 0)
+		return NVAPI_INVALID_ARGUMENT;
+	if (header->version != PROFILE_FILE_VERSION)
+		return NVAPI_INCOMPATIBLE_STRUCT_VERSION;
+	if (header->headerSize < sizeof(ProfileFileHeader) || header->headerSize % alignof(ZoneUpdate) != 0 ||
+		header->zoneCount == 0 || header->zoneCount > NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX ||
+		mapped.size != header->headerSize + header->zoneCount * sizeof(ZoneUpdate))
+		return NVAPI_INVALID_ARGUMENT;
+
+	size_t checksumEnd = offsetof(ProfileFileHeader, checksum) + sizeof(header->checksum);
+	if (profileChecksum(mapped.data + checksumEnd, mapped.size - checksumEnd) != header->checksum)
+		return NVAPI_INVALID_ARGUMENT;
+
+	pHeader = header;
+	pUpdates = reinterpret_cast<const ZoneUpdate *>(mapped.data + header->headerSize);
+	return NVAPI_OK;
+}
+
+// Resolves the GPU the profile applies to, either the one saved in the profile or an index checked against it
+static NvAPI_Status resolveProfileGpu(const ProfileFileHeader &header, unsigned int gpuIndex, unsigned int &resolvedIndex)
+{
+	bool anyGpu = (header.flags & PROFILE_FLAG_ANY_GPU) != 0;
+	if (gpuIndex == PROFILE_MATCH_GPU_IDENTITY)
+	{
+		if (anyGpu)
+			return NVAPI_INVALID_ARGUMENT;
+		return FindGPUByPciIdentity(&header.identity, &resolvedIndex) ? NVAPI_OK : NVAPI_NVIDIA_DEVICE_NOT_FOUND;
+	}
+
+	resolvedIndex = gpuIndex;
+	if (anyGpu)
+		return NVAPI_OK;
+	unsigned long busId = 0, deviceId = 0, subSystemId = 0;
+	if (!GetGPUBusId(gpuIndex, &busId) || !GetGPUPCIIdentifiers(gpuIndex, &deviceId, &subSystemId, nullptr, nullptr))
+		return NVAPI_NVIDIA_DEVICE_NOT_FOUND;
+	if (busId != header.identity.busId || deviceId != header.identity.deviceId || subSystemId != header.identity.subSystemId)
+		return NVAPI_NVIDIA_DEVICE_NOT_FOUND;
+	return NVAPI_OK;
+}
+
+NVAPI_DLL bool ApplyProfileFile(const wchar_t *path, unsigned int gpuIndex, NvAPI_Status *pStatus)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_APPLY_PROFILE_FILE);
+	NvAPI_Status status = NVAPI_INVALID_POINTER;
+	if (path)
+	{
+		ProfileMapping mapped;
+		status = mapProfile(path, mapped);
+		if (status == NVAPI_OK)
+		{
+			const ProfileFileHeader *header = nullptr;
+			const ZoneUpdate *pUpdates = nullptr;
+			unsigned int resolvedIndex = 0;
+			status = validateProfile(mapped, header, pUpdates);
+			if (status == NVAPI_OK)
+				status = resolveProfileGpu(*header, gpuIndex, resolvedIndex);
+			if (status == NVAPI_OK)
+				status = commitProfileZones(resolvedIndex, pUpdates, header->zoneCount, header->gpuZoneCount, (header->flags & PROFILE_FLAG_DEFAULT) != 0);
+			unmapProfile(mapped);
+		}
+	}
+	perfRecordStatus(status);
+	if (pStatus)
+		*pStatus = status;
+	return status == NVAPI_OK;
+}
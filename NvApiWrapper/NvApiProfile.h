@@ -0,0 +1,26 @@
+#pragma once
+#include "NvApiDll.h"
+
+// Binary profile format (.nvfl), little-endian and fixed layout so it can be applied straight from a file mapping:
+// a ProfileFileHeader followed by zoneCount ZoneUpdate records. The app writes these files, see ProfileFile.cs.
+#define PROFILE_FILE_VERSION 1
+// Writes the default state of the zones instead of the active one
+#define PROFILE_FLAG_DEFAULT 0x1u
+// Skips the PCI identity check, used for profiles converted from files that never recorded the GPU
+#define PROFILE_FLAG_ANY_GPU 0x2u
+
+struct ProfileFileHeader
+{
+	char magic[4]; // "NVFL"
+	uint16_t version;
+	uint16_t headerSize; // records start right after the header
+	uint32_t checksum;	 // FNV-1a of every byte after this field, records included
+	uint32_t flags;		 // PROFILE_FLAG_*
+	GpuPciIdentity identity;
+	uint32_t gpuZoneCount; // zones the GPU reported when the profile was saved
+	uint32_t zoneCount;	   // ZoneUpdate records following the header
+};
+
+// Commits a complete profile in one SetControl. Every update is checked against the GPU's zones first and nothing is
+// written unless all of them are valid and the GPU still has gpuZoneCount zones.
+NvAPI_Status commitProfileZones(unsigned int gpuIndex, const ZoneUpdate *pUpdates, unsigned int count, unsigned int gpuZoneCount, bool Default);
@@ -0,0 +1,206 @@
+#include "pch.h"
+#include "NvApiPerf.h"
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Asynchronous command queue with one worker thread per GPU.
+// Every (gpu, target, zone) has a single pending slot that packs a whole ZoneUpdate into 64 bits, so enqueueing is one
+// atomic exchange and a newer update for the same zone simply replaces the older one (last writer wins). The active and
+// default state are separate targets and never coalesce into each other.
+// The worker drains all pending slots of its GPU into one batched write, at most once per minimum interval.
+
+static const uint64_t QUEUE_SLOT_PENDING = 1ull << 63;
+
+struct GpuCommandQueue
+{
+	std::atomic<uint64_t> slots[2][NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX]; // [0] active state, [1] default state
+	std::atomic<bool> signaled;
+	std::atomic<bool> busy;
+	std::atomic<unsigned long long> coalesced;
+	std::atomic<unsigned long long> dispatched;
+	std::atomic<unsigned long long> failed;
+	std::mutex lock; // only held to park or wake the worker, never across a driver call
+	std::condition_variable wake;
+	std::condition_variable idle;
+	std::atomic<bool> running;
+};
+static GpuCommandQueue gpuCommandQueues[NVAPI_MAX_PHYSICAL_GPUS];
+static std::atomic<unsigned int> queueMinIntervalMs{20};
+static std::atomic<bool> queueStopping{false};
+static std::mutex queueWorkersLock;
+static std::condition_variable queueWorkersExited;
+static unsigned int queueWorkersRunning = 0;
+
+static uint64_t packZoneUpdate(const ZoneUpdate &update)
+{
+	return QUEUE_SLOT_PENDING |
+		   (static_cast<uint64_t>(update.zoneType & 0xFF) << 40) |
+		   (static_cast<uint64_t>(update.brightness) << 32) |
+		   (static_cast<uint64_t>(update.w) << 24) |
+		   (static_cast<uint64_t>(update.r) << 16) |
+		   (static_cast<uint64_t>(update.g) << 8) |
+		   static_cast<uint64_t>(update.b);
+}
+
+static ZoneUpdate unpackZoneUpdate(unsigned int zoneIndex, uint64_t slot)
+{
+	ZoneUpdate update = {0};
+	update.zoneIndex = zoneIndex;
+	update.zoneType = static_cast<unsigned int>((slot >> 40) & 0xFF);
+	update.brightness = static_cast<uint8_t>(slot >> 32);
+	update.w = static_cast<uint8_t>(slot >> 24);
+	update.r = static_cast<uint8_t>(slot >> 16);
+	update.g = static_cast<uint8_t>(slot >> 8);
+	update.b = static_cast<uint8_t>(slot);
+	return update;
+}
+
+static unsigned int pendingQueueDepth(GpuCommandQueue &queue)
+{
+	unsigned int depth = 0;
+	for (auto &targetSlots : queue.slots)
+		for (auto &slot : targetSlots)
+			if (slot.load() & QUEUE_SLOT_PENDING)
+				++depth;
+	return depth;
+}
+
+// Takes every pending slot and commits them with one batched write per target (active/default)
+static void drainCommandQueue(unsigned int gpuIndex, GpuCommandQueue &queue)
+{
+	for (int target = 0; target < 2; ++target)
+	{
+		ZoneUpdate updates[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+		unsigned int count = 0;
+		for (unsigned int zone = 0; zone < NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX; ++zone)
+		{
+			uint64_t slot = queue.slots[target][zone].exchange(0);
+			if (slot & QUEUE_SLOT_PENDING)
+				updates[count++] = unpackZoneUpdate(zone, slot);
+		}
+		if (count == 0)
+			continue;
+		if (SetIlluminationZonesBatch(gpuIndex, updates, count, target == 1, nullptr))
+			queue.dispatched += count;
+		else
+			queue.failed += count;
+	}
+}
+
+static void commandQueueWorker(unsigned int gpuIndex)
+{
+	GpuCommandQueue &queue = gpuCommandQueues[gpuIndex];
+	std::chrono::steady_clock::time_point lastWrite;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(queue.lock);
+			queue.wake.wait(lock, [&]
+							{ return queue.signaled.load() || queueStopping.load(); });
+			if (!queue.signaled.load())
+				break;
+		}
+
+		// pace the writes, updates that arrive while we wait are coalesced into this drain
+		std::chrono::steady_clock::time_point nextWrite = lastWrite + std::chrono::milliseconds(queueMinIntervalMs.load());
+		if (!queueStopping.load() && std::chrono::steady_clock::now() < nextWrite)
+			std::this_thread::sleep_until(nextWrite);
+
+		queue.busy = true;
+		queue.signaled = false;
+		drainCommandQueue(gpuIndex, queue);
+		lastWrite = std::chrono::steady_clock::now();
+		{
+			std::lock_guard<std::mutex> lock(queue.lock);
+			queue.busy = false;
+		}
+		queue.idle.notify_all();
+	}
+
+	std::lock_guard<std::mutex> lock(queueWorkersLock);
+	queue.running = false;
+	--queueWorkersRunning;
+	queueWorkersExited.notify_all();
+}
+
+static bool ensureCommandQueueWorker(unsigned int gpuIndex)
+{
+	std::lock_guard<std::mutex> lock(queueWorkersLock);
+	GpuCommandQueue &queue = gpuCommandQueues[gpuIndex];
+	if (queue.running)
+		return true;
+	if (queueStopping.load())
+		return false;
+	// detached so process exit never trips over a joinable std::thread, StopIlluminationQueue waits for it instead
+	std::thread(commandQueueWorker, gpuIndex).detach();
+	queue.running = true;
+	++queueWorkersRunning;
+	return true;
+}
+
+NVAPI_DLL bool EnqueueIlluminationZoneUpdate(unsigned int gpuIndex, const ZoneUpdate *pUpdate, bool Default)
+{
+	PERF_EXPORT_SCOPE(PERF_EXPORT_ENQUEUE_ILLUMINATION_ZONE_UPDATE);
+	if (!pUpdate || gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS || pUpdate->zoneIndex >= NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX)
+		return false;
+	GpuCommandQueue &queue = gpuCommandQueues[gpuIndex];
+	if (!queue.running && !ensureCommandQueueWorker(gpuIndex))
+		return false;
+
+	uint64_t previous = queue.slots[Default ? 1 : 0][pUpdate->zoneIndex].exchange(packZoneUpdate(*pUpdate));
+	if (previous & QUEUE_SLOT_PENDING)
+		queue.coalesced++;
+
+	// only the first enqueue after a drain has to wake the worker
+	if (!queue.signaled.exchange(true))
+	{
+		std::lock_guard<std::mutex> lock(queue.lock);
+		queue.wake.notify_one();
+	}
+	return true;
+}
+
+NVAPI_DLL void SetIlluminationQueueInterval(unsigned int minIntervalMs)
+{
+	queueMinIntervalMs = minIntervalMs;
+}
+
+NVAPI_DLL bool FlushIlluminationQueue(unsigned int gpuIndex, unsigned int timeoutMs)
+{
+	if (gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS)
+		return false;
+	GpuCommandQueue &queue = gpuCommandQueues[gpuIndex];
+	std::unique_lock<std::mutex> lock(queue.lock);
+	return queue.idle.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]
+							   { return !queue.busy.load() && pendingQueueDepth(queue) == 0; });
+}
+
+NVAPI_DLL bool GetIlluminationQueueStats(unsigned int gpuIndex, unsigned int *pDepth, unsigned long long *pCoalesced, unsigned long long *pDispatched, unsigned long long *pFailed)
+{
+	if (gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS)
+		return false;
+	GpuCommandQueue &queue = gpuCommandQueues[gpuIndex];
+	if (pDepth)
+		*pDepth = pendingQueueDepth(queue);
+	if (pCoalesced)
+		*pCoalesced = queue.coalesced.load();
+	if (pDispatched)
+		*pDispatched = queue.dispatched.load();
+	if (pFailed)
+		*pFailed = queue.failed.load();
+	return true;
+}
+
+NVAPI_DLL void StopIlluminationQueue()
+{
+	std::unique_lock<std::mutex> lock(queueWorkersLock);
+	queueStopping = true;
+	for (auto &queue : gpuCommandQueues)
+	{
+		std::lock_guard<std::mutex> queueLock(queue.lock);
+		queue.wake.notify_all();
+	}
+	// workers drain what is still pending before they exit
+	queueWorkersExited.wait(lock, []
+							{ return queueWorkersRunning == 0; });
+	queueStopping = false;
+}
@@ -0,0 +1,153 @@
+#include "pch.h"
+#include "NvApiReconciler.h"
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Drift reconciler. One thread re-reads the zone control state of every GPU with a desired state and rewrites the
+// zones that changed behind our back, e.g. after resume, a driver update or another vendor tool. The poll interval
+// doubles while nothing drifts and drops back to the minimum after a drift, a failed poll or a power event. Between
+// polls the thread blocks on a condition variable, so a stable system costs one GetControl per GPU per max interval.
+
+static const unsigned int RECONCILER_MAX_INTERVAL_LIMIT_MS = 24 * 60 * 60 * 1000;
+
+static std::mutex reconcilerLock;
+static std::condition_variable reconcilerWake;
+static std::condition_variable reconcilerExited;
+static bool reconcilerRunning = false;
+static bool reconcilerStopping = false;
+static bool reconcilerThreadAlive = false;
+static bool reconcilerPowerEvent = false;
+static unsigned int reconcilerMinIntervalMs = 1000;
+static unsigned int reconcilerMaxIntervalMs = 60000;
+static IlluminationDriftFn reconcilerDriftCallback = nullptr;
+static void *reconcilerDriftContext = nullptr;
+static IlluminationReconcilerStats reconcilerStats = {0};
+
+static unsigned int zoneCountOf(unsigned int zoneMask)
+{
+	unsigned int count = 0;
+	for (; zoneMask; zoneMask &= zoneMask - 1)
+		++count;
+	return count;
+}
+
+static void reconcilerThread()
+{
+	std::unique_lock<std::mutex> lock(reconcilerLock);
+	unsigned int intervalMs = reconcilerMinIntervalMs;
+	std::chrono::steady_clock::time_point nextPoll = std::chrono::steady_clock::now();
+	while (!reconcilerStopping)
+	{
+		reconcilerStats.currentIntervalMs = intervalMs;
+		reconcilerWake.wait_until(lock, nextPoll, []
+								  { return reconcilerStopping || reconcilerPowerEvent; });
+		if (reconcilerStopping)
+			break;
+		bool powerEvent = reconcilerPowerEvent;
+		reconcilerPowerEvent = false;
+		IlluminationDriftFn callback = reconcilerDriftCallback;
+		void *context = reconcilerDriftContext;
+		lock.unlock();
+
+		// the driver calls run without the reconciler lock so stats and callbacks can be swapped meanwhile
+		IlluminationReconcilerStats delta = {0};
+		bool unsettled = powerEvent;
+		for (unsigned int gpuIndex = 0; gpuIndex < NVAPI_MAX_PHYSICAL_GPUS; ++gpuIndex)
+		{
+			if (!hasIlluminationDesiredState(gpuIndex))
+				continue;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			unsigned int driftMask = 0;
+			NvAPI_Status status = reconcileIlluminationState(gpuIndex, &driftMask);
+			unsigned long long pollUs = static_cast<unsigned long long>(
+				std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+			delta.polls++;
+			delta.pollTimeUs += pollUs;
+			if (pollUs > delta.maxPollUs)
+				delta.maxPollUs = pollUs;
+			if (status != NVAPI_OK)
+			{
+				delta.repairFailures++;
+				unsettled = true;
+			}
+			if (driftMask)
+			{
+				delta.drifts++;
+				if (status == NVAPI_OK)
+					delta.zonesRepaired += zoneCountOf(driftMask);
+				unsettled = true;
+				if (callback)
+					callback(gpuIndex, driftMask, status, context);
+			}
+		}
+
+		lock.lock();
+		reconcilerStats.polls += delta.polls;
+		reconcilerStats.pollTimeUs += delta.pollTimeUs;
+		if (delta.maxPollUs > reconcilerStats.maxPollUs)
+			reconcilerStats.maxPollUs = delta.maxPollUs;
+		reconcilerStats.drifts += delta.drifts;
+		reconcilerStats.zonesRepaired += delta.zonesRepaired;
+		reconcilerStats.repairFailures += delta.repairFailures;
+		// whatever caused a drift or a resume often keeps writing for a while, so look again soon
+		intervalMs = unsettled ? reconcilerMinIntervalMs : (std::min)(intervalMs * 2, reconcilerMaxIntervalMs);
+		nextPoll = std::chrono::steady_clock::now() + std::chrono::milliseconds(intervalMs);
+	}
+	reconcilerThreadAlive = false;
+	reconcilerExited.notify_all();
+}
+
+NVAPI_DLL bool StartIlluminationReconciler(unsigned int minIntervalMs, unsigned int maxIntervalMs)
+{
+	if (minIntervalMs == 0 || maxIntervalMs < minIntervalMs || maxIntervalMs > RECONCILER_MAX_INTERVAL_LIMIT_MS)
+		return false;
+	std::lock_guard<std::mutex> lock(reconcilerLock);
+	if (reconcilerRunning)
+		return false;
+	reconcilerMinIntervalMs = minIntervalMs;
+	reconcilerMaxIntervalMs = maxIntervalMs;
+	reconcilerStats = {0};
+	reconcilerStopping = false;
+	reconcilerPowerEvent = false;
+	reconcilerRunning = true;
+	reconcilerThreadAlive = true;
+	// detached so process exit never trips over a joinable std::thread, StopIlluminationReconciler waits for it instead
+	std::thread(reconcilerThread).detach();
+	return true;
+}
+
+NVAPI_DLL void StopIlluminationReconciler()
+{
+	std::unique_lock<std::mutex> lock(reconcilerLock);
+	if (!reconcilerRunning)
+		return;
+	reconcilerStopping = true;
+	reconcilerWake.notify_all();
+	reconcilerExited.wait(lock, []
+						  { return !reconcilerThreadAlive; });
+	reconcilerRunning = false;
+}
+
+// Resume and display power changes are when drivers reset lighting, poll right away and at the minimum interval
+NVAPI_DLL void NotifyIlluminationPowerEvent()
+{
+	std::lock_guard<std::mutex> lock(reconcilerLock);
+	reconcilerStats.powerEvents++;
+	reconcilerPowerEvent = true;
+	reconcilerWake.notify_all();
+}
+
+NVAPI_DLL bool SetIlluminationDriftCallback(IlluminationDriftFn callback, void *context)
+{
+	std::lock_guard<std::mutex> lock(reconcilerLock);
+	reconcilerDriftCallback = callback;
+	reconcilerDriftContext = context;
+	return true;
+}
+
+NVAPI_DLL void GetIlluminationReconcilerStats(IlluminationReconcilerStats *pStats)
+{
+	if (!pStats)
+		return;
+	std::lock_guard<std::mutex> lock(reconcilerLock);
+	*pStats = reconcilerStats;
+}
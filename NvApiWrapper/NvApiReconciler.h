@@ -0,0 +1,8 @@
+#pragma once
+#include "NvApiDll.h"
+
+// True if SetIlluminationDesiredState gave the GPU zones to keep
+bool hasIlluminationDesiredState(unsigned int gpuIndex);
+// Reads the zone control state from the driver and rewrites the tracked zones that drifted from the desired state in
+// one SetControl. pDriftMask receives a bit per rewritten zone.
+NvAPI_Status reconcileIlluminationState(unsigned int gpuIndex, unsigned int *pDriftMask);
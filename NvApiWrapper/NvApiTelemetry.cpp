@@ -0,0 +1,295 @@
+#include "pch.h"
+#include "NvApiTelemetry.h"
+#include <cmath>
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Telemetry sampler. Each tick reads the mapped metrics of every GPU once, from one copy of the cached handle set and
+// with at most one thermal and one utilization call per GPU, then maps every metric through its curve into a zone
+// color. A metric only moves its color once it has moved hysteresis away from the value the color was made from, and
+// a GPU is only written through SetIlluminationZonesBatch when one of its colors changed, so a steady GPU costs two
+// telemetry calls per tick and no writes. The next tick is scheduled from how fast the metrics move: half the time the
+// fastest one needs to cross its hysteresis, clamped to the configured interval range.
+
+static const unsigned int TELEMETRY_MAX_INTERVAL_LIMIT_MS = 60 * 60 * 1000;
+static const unsigned int TELEMETRY_MAX_MAPPINGS = NVAPI_MAX_PHYSICAL_GPUS * NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX;
+static const float TELEMETRY_RATE_BLEND = 0.5f; // weight of the newest rate in the smoothed one
+
+struct TelemetryMappingState
+{
+	bool primed;
+	float held;	   // value the color is made from
+	float lastRaw; // value read by the previous tick
+	float rate;	   // smoothed units per second
+};
+
+static std::mutex telemetryLock;
+static std::condition_variable telemetryWake;
+static std::condition_variable telemetryExited;
+static bool telemetryRunning = false;
+static bool telemetryStopping = false;
+static bool telemetryThreadAlive = false;
+static bool telemetryMappingsChanged = false;
+static unsigned int telemetryMinIntervalMs = 250;
+static unsigned int telemetryMaxIntervalMs = 5000;
+static TelemetryZoneMapping telemetryMappings[TELEMETRY_MAX_MAPPINGS];
+static TelemetryMappingState telemetryStates[TELEMETRY_MAX_MAPPINGS];
+static unsigned int telemetryMappingCount = 0;
+static unsigned long long telemetryLastUs = 0;
+static bool telemetryHasLast = false;
+static ZoneUpdate telemetryWritten[NVAPI_MAX_PHYSICAL_GPUS][NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+static unsigned int telemetryWrittenCount[NVAPI_MAX_PHYSICAL_GPUS] = {0};
+static bool telemetryHasWritten[NVAPI_MAX_PHYSICAL_GPUS] = {false};
+static TelemetryStats telemetryStats = {0};
+
+static bool validTelemetryMappings(const TelemetryZoneMapping *pMappings, unsigned int count)
+{
+	if (count > TELEMETRY_MAX_MAPPINGS || (!pMappings && count))
+		return false;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const TelemetryZoneMapping &mapping = pMappings[i];
+		if (mapping.gpuIndex >= NVAPI_MAX_PHYSICAL_GPUS || mapping.zoneIndex >= NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX ||
+			mapping.metric >= TELEMETRY_METRIC_COUNT || !(mapping.hysteresis >= 0.0f) || !std::isfinite(mapping.hysteresis) ||
+			mapping.pointCount == 0 || mapping.pointCount > TELEMETRY_CURVE_POINTS)
+			return false;
+		for (unsigned int p = 0; p < mapping.pointCount; ++p)
+			if (!std::isfinite(mapping.points[p].value) || (p && mapping.points[p].value < mapping.points[p - 1].value))
+				return false;
+		// one color per zone, two mappings fighting over a zone would write it every tick
+		for (unsigned int j = 0; j < i; ++j)
+			if (pMappings[j].gpuIndex == mapping.gpuIndex && pMappings[j].zoneIndex == mapping.zoneIndex)
+				return false;
+	}
+	return true;
+}
+
+static bool validTelemetryIntervals(unsigned int minIntervalMs, unsigned int maxIntervalMs)
+{
+	return minIntervalMs != 0 && maxIntervalMs >= minIntervalMs && maxIntervalMs <= TELEMETRY_MAX_INTERVAL_LIMIT_MS;
+}
+
+static uint8_t lerpChannel(uint8_t a, uint8_t b, float t)
+{
+	return static_cast<uint8_t>(a + (static_cast<float>(b) - a) * t + 0.5f);
+}
+
+// Color of the curve at value, clamped to the first and last point
+static CustomRGBW evaluateCurve(const TelemetryZoneMapping &mapping, float value)
+{
+	const TelemetryCurvePoint *points = mapping.points;
+	unsigned int last = mapping.pointCount - 1;
+	if (value <= points[0].value)
+		return points[0].color;
+	if (value >= points[last].value)
+		return points[last].color;
+	unsigned int i = 0;
+	while (value >= points[i + 1].value)
+		++i;
+	const TelemetryCurvePoint &a = points[i];
+	const TelemetryCurvePoint &b = points[i + 1];
+	float t = (value - a.value) / (b.value - a.value);
+	CustomRGBW color;
+	color.r = lerpChannel(a.color.r, b.color.r, t);
+	color.g = lerpChannel(a.color.g, b.color.g, t);
+	color.b = lerpChannel(a.color.b, b.color.b, t);
+	color.w = lerpChannel(a.color.w, b.color.w, t);
+	color.brightness = lerpChannel(a.color.brightness, b.color.brightness, t);
+	return color;
+}
+
+static void resetTelemetryState()
+{
+	memset(telemetryStates, 0, sizeof(telemetryStates));
+	memset(telemetryHasWritten, 0, sizeof(telemetryHasWritten));
+	telemetryHasLast = false;
+}
+
+// One sampling pass, caller must hold telemetryLock. Returns the interval until the next pass.
+static unsigned int telemetryTick(unsigned int minIntervalMs, unsigned int maxIntervalMs, unsigned long long nowUs)
+{
+	unsigned int metricMasks[NVAPI_MAX_PHYSICAL_GPUS] = {0};
+	for (unsigned int i = 0; i < telemetryMappingCount; ++i)
+		metricMasks[telemetryMappings[i].gpuIndex] |= 1u << telemetryMappings[i].metric;
+	TelemetrySample samples[NVAPI_MAX_PHYSICAL_GPUS];
+	NvAPI_Status statuses[NVAPI_MAX_PHYSICAL_GPUS];
+	unsigned long long driverCalls = 0;
+	sampleGpuTelemetry(metricMasks, samples, statuses, driverCalls);
+	telemetryStats.samples++;
+	telemetryStats.driverCalls += driverCalls;
+
+	float elapsedS = telemetryHasLast && nowUs > telemetryLastUs ? static_cast<float>(nowUs - telemetryLastUs) * 1e-6f : 0.0f;
+	telemetryLastUs = nowUs;
+	telemetryHasLast = true;
+	bool unsettled = false;
+	for (unsigned int gpuIndex = 0; gpuIndex < NVAPI_MAX_PHYSICAL_GPUS; ++gpuIndex)
+	{
+		if (metricMasks[gpuIndex] && statuses[gpuIndex] != NVAPI_OK)
+		{
+			telemetryStats.sampleFailures++;
+			unsettled = true;
+		}
+	}
+
+	ZoneUpdate updates[NVAPI_MAX_PHYSICAL_GPUS][NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	unsigned int updateCounts[NVAPI_MAX_PHYSICAL_GPUS] = {0};
+	float nextS = static_cast<float>(maxIntervalMs) * 1e-3f;
+	for (unsigned int i = 0; i < telemetryMappingCount; ++i)
+	{
+		const TelemetryZoneMapping &mapping = telemetryMappings[i];
+		TelemetryMappingState &state = telemetryStates[i];
+		const TelemetrySample &sample = samples[mapping.gpuIndex];
+		// a GPU that failed or a metric it does not report keeps its last color
+		if (statuses[mapping.gpuIndex] != NVAPI_OK || !(sample.validMask & (1u << mapping.metric)))
+			continue;
+		float raw = sample.values[mapping.metric];
+		if (!state.primed)
+		{
+			state.primed = true;
+			state.held = raw;
+			state.rate = 0.0f;
+		}
+		else
+		{
+			if (elapsedS > 0.0f)
+				state.rate += (fabsf(raw - state.lastRaw) / elapsedS - state.rate) * TELEMETRY_RATE_BLEND;
+			if (fabsf(raw - state.held) >= mapping.hysteresis)
+				state.held = raw;
+		}
+		state.lastRaw = raw;
+		if (state.rate > 0.0f)
+			nextS = (std::min)(nextS, 0.5f * mapping.hysteresis / state.rate);
+
+		CustomRGBW color = evaluateCurve(mapping, state.held);
+		ZoneUpdate &update = updates[mapping.gpuIndex][updateCounts[mapping.gpuIndex]++];
+		update = {0};
+		update.zoneIndex = mapping.zoneIndex;
+		update.zoneType = mapping.zoneType;
+		update.r = color.r;
+		update.g = color.g;
+		update.b = color.b;
+		update.w = color.w;
+		update.brightness = color.brightness;
+	}
+
+	for (unsigned int gpuIndex = 0; gpuIndex < NVAPI_MAX_PHYSICAL_GPUS; ++gpuIndex)
+	{
+		unsigned int count = updateCounts[gpuIndex];
+		if (!count)
+			continue;
+		if (telemetryHasWritten[gpuIndex] && count == telemetryWrittenCount[gpuIndex] && memcmp(updates[gpuIndex], telemetryWritten[gpuIndex], count * sizeof(ZoneUpdate)) == 0)
+			continue;
+		telemetryStats.writes++;
+		if (SetIlluminationZonesBatch(gpuIndex, updates[gpuIndex], count, false, nullptr))
+		{
+			memcpy(telemetryWritten[gpuIndex], updates[gpuIndex], count * sizeof(ZoneUpdate));
+			telemetryWrittenCount[gpuIndex] = count;
+			telemetryHasWritten[gpuIndex] = true;
+		}
+		else
+		{
+			telemetryStats.writeFailures++;
+			telemetryHasWritten[gpuIndex] = false;
+			unsettled = true;
+		}
+	}
+
+	unsigned int intervalMs = minIntervalMs;
+	if (!unsettled && nextS * 1000.0f > static_cast<float>(minIntervalMs))
+		intervalMs = nextS * 1000.0f >= static_cast<float>(maxIntervalMs) ? maxIntervalMs : static_cast<unsigned int>(nextS * 1000.0f);
+	telemetryStats.currentIntervalMs = intervalMs;
+	return intervalMs;
+}
+
+static unsigned long long telemetryNowUs()
+{
+	return static_cast<unsigned long long>(
+		std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void telemetryThread()
+{
+	std::unique_lock<std::mutex> lock(telemetryLock);
+	std::chrono::steady_clock::time_point nextTick = std::chrono::steady_clock::now();
+	while (!telemetryStopping)
+	{
+		telemetryWake.wait_until(lock, nextTick, []
+								 { return telemetryStopping || telemetryMappingsChanged; });
+		if (telemetryStopping)
+			break;
+		telemetryMappingsChanged = false;
+		unsigned int intervalMs = telemetryTick(telemetryMinIntervalMs, telemetryMaxIntervalMs, telemetryNowUs());
+		nextTick = std::chrono::steady_clock::now() + std::chrono::milliseconds(intervalMs);
+	}
+	telemetryThreadAlive = false;
+	telemetryExited.notify_all();
+}
+
+// Replaces every mapping, count 0 clears them. Colors are written again from the first tick after the change.
+NVAPI_DLL bool SetTelemetryMappings(const TelemetryZoneMapping *pMappings, unsigned int count)
+{
+	if (!validTelemetryMappings(pMappings, count))
+		return false;
+	std::lock_guard<std::mutex> lock(telemetryLock);
+	if (count)
+		memcpy(telemetryMappings, pMappings, count * sizeof(TelemetryZoneMapping));
+	telemetryMappingCount = count;
+	resetTelemetryState();
+	telemetryMappingsChanged = true;
+	telemetryWake.notify_all();
+	return true;
+}
+
+NVAPI_DLL bool StartTelemetrySampler(unsigned int minIntervalMs, unsigned int maxIntervalMs)
+{
+	if (!validTelemetryIntervals(minIntervalMs, maxIntervalMs))
+		return false;
+	std::lock_guard<std::mutex> lock(telemetryLock);
+	if (telemetryRunning)
+		return false;
+	telemetryMinIntervalMs = minIntervalMs;
+	telemetryMaxIntervalMs = maxIntervalMs;
+	telemetryStats = {0};
+	resetTelemetryState();
+	telemetryStopping = false;
+	telemetryMappingsChanged = false;
+	telemetryRunning = true;
+	telemetryThreadAlive = true;
+	// detached so process exit never trips over a joinable std::thread, StopTelemetrySampler waits for it instead
+	std::thread(telemetryThread).detach();
+	return true;
+}
+
+NVAPI_DLL void StopTelemetrySampler()
+{
+	std::unique_lock<std::mutex> lock(telemetryLock);
+	if (!telemetryRunning)
+		return;
+	telemetryStopping = true;
+	telemetryWake.notify_all();
+	telemetryExited.wait(lock, []
+						 { return !telemetryThreadAlive; });
+	telemetryRunning = false;
+}
+
+// Runs one sampling pass on the calling thread at the given time, so the adaptive interval can be driven by a test
+// clock against emulated telemetry. Fails while the sampler thread runs.
+NVAPI_DLL bool StepTelemetrySampler(unsigned int minIntervalMs, unsigned int maxIntervalMs, unsigned long long nowUs, unsigned int *pNextIntervalMs)
+{
+	if (!validTelemetryIntervals(minIntervalMs, maxIntervalMs))
+		return false;
+	std::lock_guard<std::mutex> lock(telemetryLock);
+	if (telemetryRunning)
+		return false;
+	unsigned int intervalMs = telemetryTick(minIntervalMs, maxIntervalMs, nowUs);
+	if (pNextIntervalMs)
+		*pNextIntervalMs = intervalMs;
+	return true;
+}
+
+NVAPI_DLL void GetTelemetryStats(TelemetryStats *pStats)
+{
+	if (!pStats)
+		return;
+	std::lock_guard<std::mutex> lock(telemetryLock);
+	*pStats = telemetryStats;
+}
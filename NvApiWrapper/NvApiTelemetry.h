@@ -0,0 +1,7 @@
+#pragma once
+#include "NvApiDll.h"
+
+// Reads the metrics in metricMasks[gpu] of every GPU with a nonzero mask from one copy of the cached handle set, with
+// at most one thermal and one utilization call per GPU. driverCalls is increased by the number of calls made.
+void sampleGpuTelemetry(const unsigned int (&metricMasks)[NVAPI_MAX_PHYSICAL_GPUS], TelemetrySample (&samples)[NVAPI_MAX_PHYSICAL_GPUS],
+						NvAPI_Status (&statuses)[NVAPI_MAX_PHYSICAL_GPUS], unsigned long long &driverCalls);
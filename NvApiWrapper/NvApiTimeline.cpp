@@ -0,0 +1,656 @@
+#include "pch.h"
+#include "NvApiTimeline.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Keyframe timelines. The JSON source is compiled once into flat tables: one track per zone, the keyframe times of all
+// tracks back to back so a track is searched within one contiguous run, and one segment per keyframe holding its
+// values and the slope to the next keyframe. Evaluating a zone is a binary search over its keyframe times and a fused
+// multiply add per channel, eased segments add one lookup into a table the compiler fills in. Nothing is allocated
+// after compilation, so timelines can be evaluated from the animation tick.
+
+static const unsigned int TIMELINE_MAX_DURATION_MS = 60 * 60 * 1000; // keeps every time in microseconds within 32 bits
+static const unsigned int TIMELINE_MAX_KEYFRAMES = 4096;			 // per track
+static const unsigned int TIMELINE_CHANNELS = 5; // r, g, b, w, brightness
+
+enum TimelineEasing
+{
+	EASE_LINEAR = 0,
+	EASE_STEP,
+	EASE_IN_QUAD,
+	EASE_OUT_QUAD,
+	EASE_IN_OUT_QUAD,
+	EASE_IN_CUBIC,
+	EASE_OUT_CUBIC,
+	EASE_IN_OUT_CUBIC,
+	EASE_IN_SINE,
+	EASE_OUT_SINE,
+	EASE_IN_OUT_SINE,
+	EASE_SMOOTH,
+	EASE_COUNT
+};
+static const char *const easingNames[EASE_COUNT] = {
+	"linear", "step", "inQuad", "outQuad", "inOutQuad", "inCubic", "outCubic", "inOutCubic", "inSine", "outSine", "inOutSine", "smooth"};
+
+// Easing curves sampled at compile time, lookups interpolate between neighbouring samples
+static const unsigned int EASE_TABLE_STEPS = 256;
+typedef std::array<float, EASE_TABLE_STEPS + 1> EaseTable;
+
+// Taylor series, exact to float precision for |x| <= pi / 2 which is all the sine curves need
+static constexpr double constexprSin(double x)
+{
+	double term = x, sum = x;
+	for (int n = 1; n < 10; ++n)
+	{
+		term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+		sum += term;
+	}
+	return sum;
+}
+
+static constexpr double easeCurve(unsigned int easing, double u)
+{
+	const double halfPi = 1.5707963267948966;
+	switch (easing)
+	{
+	case EASE_STEP: return u < 1.0 ? 0.0 : 1.0;
+	case EASE_IN_QUAD: return u * u;
+	case EASE_OUT_QUAD: return 1.0 - (1.0 - u) * (1.0 - u);
+	case EASE_IN_OUT_QUAD: return u < 0.5 ? 2.0 * u * u : 1.0 - 2.0 * (1.0 - u) * (1.0 - u);
+	case EASE_IN_CUBIC: return u * u * u;
+	case EASE_OUT_CUBIC: return 1.0 - (1.0 - u) * (1.0 - u) * (1.0 - u);
+	case EASE_IN_OUT_CUBIC: return u < 0.5 ? 4.0 * u * u * u : 1.0 - 4.0 * (1.0 - u) * (1.0 - u) * (1.0 - u);
+	case EASE_IN_SINE: return 1.0 - constexprSin(halfPi - u * halfPi);
+	case EASE_OUT_SINE: return constexprSin(u * halfPi);
+	case EASE_IN_OUT_SINE: return 0.5 - 0.5 * constexprSin(halfPi - 2.0 * u * halfPi);
+	case EASE_SMOOTH: return u * u * (3.0 - 2.0 * u);
+	default: return u;
+	}
+}
+
+static constexpr std::array<EaseTable, EASE_COUNT> makeEaseTables()
+{
+	std::array<EaseTable, EASE_COUNT> tables{};
+	for (unsigned int easing = 0; easing < EASE_COUNT; ++easing)
+		for (unsigned int i = 0; i <= EASE_TABLE_STEPS; ++i)
+			tables[easing][i] = static_cast<float>(easeCurve(easing, static_cast<double>(i) / EASE_TABLE_STEPS));
+	return tables;
+}
+static constexpr std::array<EaseTable, EASE_COUNT> easeTables = makeEaseTables();
+static_assert(easeTables[EASE_SMOOTH][EASE_TABLE_STEPS / 2] == 0.5f, "ease tables are built at compile time");
+
+static float ease(unsigned int easing, float u)
+{
+	const EaseTable &table = easeTables[easing];
+	float position = u * EASE_TABLE_STEPS;
+	unsigned int i = static_cast<unsigned int>(position);
+	if (i >= EASE_TABLE_STEPS)
+		return table[EASE_TABLE_STEPS];
+	return table[i] + (table[i + 1] - table[i]) * (position - static_cast<float>(i));
+}
+
+struct TimelineTrack
+{
+	uint32_t zoneIndex;
+	uint32_t zoneType; // NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID when the source did not name one
+	uint32_t firstKey; // into keyTimesUs and segments
+	uint32_t keyCount;
+};
+
+// Values at a keyframe and how they move until the next one: value + slope * x, where x is the time into the segment
+// for linear segments and the eased time otherwise. The last keyframe of a track has no slope.
+struct TimelineSegment
+{
+	float value[TIMELINE_CHANNELS];
+	float slope[TIMELINE_CHANNELS]; // per microsecond
+	float durationUs;
+	uint32_t easing; // TimelineEasing
+};
+
+struct IlluminationTimeline
+{
+	std::atomic<unsigned int> references;
+	uint32_t durationUs;
+	uint32_t zoneMask;
+	bool loop;
+	std::vector<TimelineTrack> tracks;
+	std::vector<uint32_t> keyTimesUs;
+	std::vector<TimelineSegment> segments;
+};
+
+void retainTimeline(IlluminationTimeline *pTimeline)
+{
+	if (pTimeline)
+		pTimeline->references.fetch_add(1);
+}
+
+void releaseTimeline(IlluminationTimeline *pTimeline)
+{
+	if (pTimeline && pTimeline->references.fetch_sub(1) == 1)
+		delete pTimeline;
+}
+
+static uint8_t channelValue(float value, float limit)
+{
+	return static_cast<uint8_t>((std::min)((std::max)(value, 0.0f), limit) + 0.5f);
+}
+
+unsigned int evaluateTimeline(const IlluminationTimeline &timeline, unsigned long long timeUs, ZoneUpdate *pUpdates)
+{
+	uint32_t t;
+	if (timeline.loop)
+		t = static_cast<uint32_t>(timeUs % timeline.durationUs);
+	else
+		t = static_cast<uint32_t>((std::min)(timeUs, static_cast<unsigned long long>(timeline.durationUs)));
+
+	unsigned int count = 0;
+	for (const TimelineTrack &track : timeline.tracks)
+	{
+		const uint32_t *times = timeline.keyTimesUs.data() + track.firstKey;
+		unsigned int key = static_cast<unsigned int>(std::upper_bound(times, times + track.keyCount, t) - times);
+		key = key ? key - 1 : 0;
+		const TimelineSegment &segment = timeline.segments[track.firstKey + key];
+		float x = t > times[key] ? static_cast<float>(t - times[key]) : 0.0f;
+		if (segment.easing == EASE_STEP)
+			x = 0.0f;
+		else if (segment.easing != EASE_LINEAR)
+			x = segment.durationUs * ease(segment.easing, x / segment.durationUs);
+
+		ZoneUpdate &update = pUpdates[count++];
+		update = {0};
+		update.zoneIndex = track.zoneIndex;
+		update.zoneType = track.zoneType;
+		update.r = channelValue(segment.value[0] + segment.slope[0] * x, 255.0f);
+		update.g = channelValue(segment.value[1] + segment.slope[1] * x, 255.0f);
+		update.b = channelValue(segment.value[2] + segment.slope[2] * x, 255.0f);
+		update.w = channelValue(segment.value[3] + segment.slope[3] * x, 255.0f);
+		update.brightness = channelValue(segment.value[4] + segment.slope[4] * x, 100.0f);
+	}
+	return count;
+}
+
+// Minimal JSON reader for the timeline source, it walks the text once and stops at the first error. Values are only
+// read where the timeline schema expects them and unknown keys fail, so nesting never goes deeper than the schema.
+struct JsonReader
+{
+	const char *begin;
+	const char *p;
+	const char *end;
+	const char *error;
+	size_t errorOffset;
+};
+
+static bool jsonFail(JsonReader &reader, const char *message)
+{
+	if (!reader.error)
+	{
+		reader.error = message;
+		reader.errorOffset = static_cast<size_t>(reader.p - reader.begin);
+	}
+	return false;
+}
+
+static void jsonSkipSpace(JsonReader &reader)
+{
+	while (reader.p < reader.end && (*reader.p == ' ' || *reader.p == '\t' || *reader.p == '\n' || *reader.p == '\r'))
+		++reader.p;
+}
+
+static bool jsonConsume(JsonReader &reader, char c)
+{
+	jsonSkipSpace(reader);
+	if (reader.p < reader.end && *reader.p == c)
+	{
+		++reader.p;
+		return true;
+	}
+	return false;
+}
+
+// Reads a string into buffer, or skips it when buffer is null. Escapes are kept verbatim, nothing here needs them.
+static bool jsonString(JsonReader &reader, char *buffer, size_t bufferSize)
+{
+	if (!jsonConsume(reader, '"'))
+		return jsonFail(reader, "expected a string");
+	size_t length = 0;
+	while (reader.p < reader.end && *reader.p != '"')
+	{
+		if (*reader.p == '\\' && reader.p + 1 < reader.end)
+			++reader.p;
+		if (buffer)
+		{
+			if (length + 1 >= bufferSize)
+				return jsonFail(reader, "string too long");
+			buffer[length++] = *reader.p;
+		}
+		++reader.p;
+	}
+	if (reader.p >= reader.end)
+		return jsonFail(reader, "unterminated string");
+	++reader.p;
+	if (buffer)
+		buffer[length] = '\0';
+	return true;
+}
+
+static bool jsonNumber(JsonReader &reader, double &value)
+{
+	jsonSkipSpace(reader);
+	char text[64];
+	size_t length = 0;
+	while (reader.p + length < reader.end && length < sizeof(text) - 1 && strchr("+-0123456789.eE", reader.p[length]))
+	{
+		text[length] = reader.p[length];
+		++length;
+	}
+	text[length] = '\0';
+	char *parsed = nullptr;
+	value = strtod(text, &parsed);
+	if (length == 0 || parsed != text + length || !std::isfinite(value))
+		return jsonFail(reader, "expected a number");
+	reader.p += length;
+	return true;
+}
+
+static bool jsonLiteral(JsonReader &reader, const char *literal)
+{
+	jsonSkipSpace(reader);
+	size_t length = strlen(literal);
+	if (static_cast<size_t>(reader.end - reader.p) < length || memcmp(reader.p, literal, length) != 0)
+		return false;
+	reader.p += length;
+	return true;
+}
+
+static bool jsonBool(JsonReader &reader, bool &value)
+{
+	if (jsonLiteral(reader, "true"))
+		value = true;
+	else if (jsonLiteral(reader, "false"))
+		value = false;
+	else
+		return jsonFail(reader, "expected true or false");
+	return true;
+}
+
+// Calls onMember(key) for every member, which must read the value
+template <typename Fn>
+static bool jsonObject(JsonReader &reader, Fn onMember)
+{
+	if (!jsonConsume(reader, '{'))
+		return jsonFail(reader, "expected an object");
+	if (jsonConsume(reader, '}'))
+		return true;
+	do
+	{
+		char key[32];
+		if (!jsonString(reader, key, sizeof(key)))
+			return false;
+		if (!jsonConsume(reader, ':'))
+			return jsonFail(reader, "expected ':'");
+		if (!onMember(key))
+			return jsonFail(reader, "unknown key");
+	} while (jsonConsume(reader, ','));
+	if (!jsonConsume(reader, '}'))
+		return jsonFail(reader, "expected ',' or '}'");
+	return true;
+}
+
+// Calls onElement(index) for every element, which must read the value
+template <typename Fn>
+static bool jsonArray(JsonReader &reader, Fn onElement)
+{
+	if (!jsonConsume(reader, '['))
+		return jsonFail(reader, "expected an array");
+	if (jsonConsume(reader, ']'))
+		return true;
+	unsigned int index = 0;
+	do
+	{
+		if (!onElement(index++))
+			return false;
+	} while (jsonConsume(reader, ','));
+	if (!jsonConsume(reader, ']'))
+		return jsonFail(reader, "expected ',' or ']'");
+	return true;
+}
+
+static bool jsonInteger(JsonReader &reader, double low, double high, unsigned int &value)
+{
+	double number;
+	if (!jsonNumber(reader, number))
+		return false;
+	if (number != floor(number) || number < low || number > high)
+		return jsonFail(reader, "integer out of range");
+	value = static_cast<unsigned int>(number);
+	return true;
+}
+
+struct SourceKeyframe
+{
+	double timeMs;
+	float value[TIMELINE_CHANNELS];
+	uint32_t easing;
+};
+struct SourceTrack
+{
+	unsigned int zoneIndex;
+	unsigned int zoneType;
+	std::vector<SourceKeyframe> keyframes;
+};
+
+static bool parseZoneType(JsonReader &reader, unsigned int &zoneType)
+{
+	char name[16];
+	if (!jsonString(reader, name, sizeof(name)))
+		return false;
+	if (strcmp(name, "rgb") == 0)
+		zoneType = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB;
+	else if (strcmp(name, "rgbw") == 0)
+		zoneType = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW;
+	else if (strcmp(name, "singleColor") == 0)
+		zoneType = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR;
+	else if (strcmp(name, "colorFixed") == 0)
+		zoneType = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED;
+	else
+		return jsonFail(reader, "unknown zone type");
+	return true;
+}
+
+static bool parseKeyframe(JsonReader &reader, SourceKeyframe &keyframe)
+{
+	bool hasTime = false;
+	keyframe = {0.0, {0.0f, 0.0f, 0.0f, 0.0f, 100.0f}, EASE_LINEAR};
+	return jsonObject(reader, [&](const char *key)
+					  {
+		if (strcmp(key, "t") == 0)
+		{
+			hasTime = true;
+			if (!jsonNumber(reader, keyframe.timeMs))
+				return false;
+			if (keyframe.timeMs < 0.0 || keyframe.timeMs > TIMELINE_MAX_DURATION_MS)
+				return jsonFail(reader, "keyframe time out of range");
+			return true;
+		}
+		if (strcmp(key, "color") == 0)
+			return jsonArray(reader, [&](unsigned int channel)
+							 {
+				unsigned int value;
+				if (channel > 3)
+					return jsonFail(reader, "color takes r, g, b and an optional w");
+				if (!jsonInteger(reader, 0.0, 255.0, value))
+					return false;
+				keyframe.value[channel] = static_cast<float>(value);
+				return true; });
+		if (strcmp(key, "brightness") == 0)
+		{
+			unsigned int value;
+			if (!jsonInteger(reader, 0.0, 100.0, value))
+				return false;
+			keyframe.value[4] = static_cast<float>(value);
+			return true;
+		}
+		if (strcmp(key, "ease") == 0)
+		{
+			char name[16];
+			if (!jsonString(reader, name, sizeof(name)))
+				return false;
+			for (keyframe.easing = 0; keyframe.easing < EASE_COUNT; ++keyframe.easing)
+				if (strcmp(name, easingNames[keyframe.easing]) == 0)
+					return true;
+			return jsonFail(reader, "unknown easing");
+		}
+		return false; }) &&
+		   (hasTime || jsonFail(reader, "keyframe without \"t\""));
+}
+
+static bool parseTrack(JsonReader &reader, SourceTrack &track)
+{
+	bool hasZone = false;
+	track.zoneType = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID;
+	bool parsed = jsonObject(reader, [&](const char *key)
+							 {
+		if (strcmp(key, "zone") == 0)
+		{
+			hasZone = true;
+			return jsonInteger(reader, 0.0, NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX - 1, track.zoneIndex);
+		}
+		if (strcmp(key, "type") == 0)
+			return parseZoneType(reader, track.zoneType);
+		if (strcmp(key, "keyframes") == 0)
+			return jsonArray(reader, [&](unsigned int index)
+							 {
+				if (index >= TIMELINE_MAX_KEYFRAMES)
+					return jsonFail(reader, "too many keyframes");
+				SourceKeyframe keyframe;
+				if (!parseKeyframe(reader, keyframe))
+					return false;
+				if (!track.keyframes.empty() && keyframe.timeMs * 1000.0 < track.keyframes.back().timeMs * 1000.0 + 1.0)
+					return jsonFail(reader, "keyframe times must increase");
+				track.keyframes.push_back(keyframe);
+				return true; });
+		return false; });
+	if (!parsed)
+		return false;
+	if (!hasZone)
+		return jsonFail(reader, "track without \"zone\"");
+	if (track.keyframes.empty())
+		return jsonFail(reader, "track without keyframes");
+	return true;
+}
+
+static bool parseTimeline(JsonReader &reader, std::vector<SourceTrack> &tracks, double &durationMs, bool &loop)
+{
+	durationMs = -1.0;
+	loop = false;
+	bool parsed = jsonObject(reader, [&](const char *key)
+							 {
+		if (strcmp(key, "durationMs") == 0)
+		{
+			if (!jsonNumber(reader, durationMs))
+				return false;
+			if (durationMs < 0.0 || durationMs > TIMELINE_MAX_DURATION_MS)
+				return jsonFail(reader, "duration out of range");
+			return true;
+		}
+		if (strcmp(key, "loop") == 0)
+			return jsonBool(reader, loop);
+		if (strcmp(key, "tracks") == 0)
+			return jsonArray(reader, [&](unsigned int index)
+							 {
+				if (index >= NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX)
+					return jsonFail(reader, "more tracks than zones");
+				SourceTrack track;
+				if (!parseTrack(reader, track))
+					return false;
+				for (const SourceTrack &other : tracks)
+					if (other.zoneIndex == track.zoneIndex)
+						return jsonFail(reader, "zone has two tracks");
+				tracks.push_back(std::move(track));
+				return true; });
+		return false; });
+	if (!parsed)
+		return false;
+	jsonSkipSpace(reader);
+	if (reader.p != reader.end)
+		return jsonFail(reader, "text after the timeline");
+	if (tracks.empty())
+		return jsonFail(reader, "timeline without tracks");
+	return true;
+}
+
+// Compiles a JSON timeline, see NvApiTimeline.h for the format. Returns null on error and describes the error in
+// errorBuffer, free the result with FreeIlluminationTimeline.
+NVAPI_DLL IlluminationTimeline *CompileIlluminationTimeline(const char *json, size_t length, char *errorBuffer, size_t errorBufferSize)
+{
+	if (errorBuffer && errorBufferSize)
+		errorBuffer[0] = '\0';
+	if (!json)
+		return nullptr;
+	JsonReader reader = {json, json, json + length, nullptr, 0};
+	std::vector<SourceTrack> tracks;
+	double durationMs;
+	bool loop;
+	if (!parseTimeline(reader, tracks, durationMs, loop))
+	{
+		if (errorBuffer && errorBufferSize)
+			snprintf(errorBuffer, errorBufferSize, "offset %zu: %s", reader.errorOffset, reader.error);
+		return nullptr;
+	}
+
+	double lastMs = 0.0;
+	size_t keyCount = 0;
+	for (const SourceTrack &track : tracks)
+	{
+		lastMs = (std::max)(lastMs, track.keyframes.back().timeMs);
+		keyCount += track.keyframes.size();
+	}
+	if (durationMs < 0.0)
+		durationMs = lastMs;
+	const char *error = nullptr;
+	if (durationMs < lastMs)
+		error = "durationMs is before the last keyframe";
+	else if (loop && durationMs < 1.0)
+		error = "a looping timeline needs a duration";
+	if (error)
+	{
+		if (errorBuffer && errorBufferSize)
+			snprintf(errorBuffer, errorBufferSize, "%s", error);
+		return nullptr;
+	}
+
+	IlluminationTimeline *pTimeline = new (std::nothrow) IlluminationTimeline();
+	if (!pTimeline)
+		return nullptr;
+	pTimeline->references = 1;
+	pTimeline->durationUs = static_cast<uint32_t>(durationMs * 1000.0 + 0.5);
+	pTimeline->zoneMask = 0;
+	pTimeline->loop = loop;
+	pTimeline->tracks.reserve(tracks.size());
+	pTimeline->keyTimesUs.reserve(keyCount);
+	pTimeline->segments.reserve(keyCount);
+	for (const SourceTrack &source : tracks)
+	{
+		TimelineTrack track = {source.zoneIndex, source.zoneType, static_cast<uint32_t>(pTimeline->keyTimesUs.size()),
+							   static_cast<uint32_t>(source.keyframes.size())};
+		pTimeline->tracks.push_back(track);
+		pTimeline->zoneMask |= 1u << source.zoneIndex;
+		for (size_t i = 0; i < source.keyframes.size(); ++i)
+		{
+			const SourceKeyframe &keyframe = source.keyframes[i];
+			uint32_t timeUs = static_cast<uint32_t>(keyframe.timeMs * 1000.0 + 0.5);
+			TimelineSegment segment = {};
+			memcpy(segment.value, keyframe.value, sizeof(segment.value));
+			segment.easing = EASE_LINEAR;
+			if (i + 1 < source.keyframes.size())
+			{
+				const SourceKeyframe &next = source.keyframes[i + 1];
+				uint32_t durationUs = static_cast<uint32_t>(next.timeMs * 1000.0 + 0.5) - timeUs;
+				segment.durationUs = static_cast<float>(durationUs);
+				segment.easing = keyframe.easing;
+				for (unsigned int c = 0; c < TIMELINE_CHANNELS; ++c)
+					segment.slope[c] = (next.value[c] - keyframe.value[c]) / segment.durationUs;
+			}
+			pTimeline->keyTimesUs.push_back(timeUs);
+			pTimeline->segments.push_back(segment);
+		}
+	}
+	return pTimeline;
+}
+
+// Drops the caller's reference, a timeline still played by the animation engine lives on until it is replaced there
+NVAPI_DLL void FreeIlluminationTimeline(IlluminationTimeline *pTimeline)
+{
+	releaseTimeline(pTimeline);
+}
+
+NVAPI_DLL bool GetIlluminationTimelineInfo(const IlluminationTimeline *pTimeline, IlluminationTimelineInfo *pInfo)
+{
+	if (!pTimeline || !pInfo)
+		return false;
+	pInfo->durationMs = pTimeline->durationUs / 1000;
+	pInfo->zoneMask = pTimeline->zoneMask;
+	pInfo->keyframeCount = static_cast<unsigned int>(pTimeline->keyTimesUs.size());
+	pInfo->loop = pTimeline->loop ? 1 : 0;
+	return true;
+}
+
+// Writes the colors of every track at timeUs, returns the number of updates or 0 if capacity is too small
+NVAPI_DLL unsigned int EvaluateIlluminationTimeline(const IlluminationTimeline *pTimeline, unsigned long long timeUs, ZoneUpdate *pUpdates, unsigned int capacity)
+{
+	if (!pTimeline || !pUpdates || capacity < pTimeline->tracks.size())
+		return 0;
+	return evaluateTimeline(*pTimeline, timeUs, pUpdates);
+}
+
+// Writes the timeline at timeUs into a full control frame, e.g. one read with NvAPI_GPU_ClientIllumZonesGetControl.
+// Every track's zone is switched to manual control, the other zones are left alone. Colors are written as authored,
+// zone color pipelines only apply to writes through the wrapper. Fails without touching the frame if a track does not
+// fit the frame's zones.
+NVAPI_DLL bool RenderIlluminationTimelineFrame(const IlluminationTimeline *pTimeline, unsigned long long timeUs, NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_PARAMS *pParams)
+{
+	if (!pTimeline || !pParams)
+		return false;
+	ZoneUpdate updates[NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX];
+	unsigned int count = evaluateTimeline(*pTimeline, timeUs, updates);
+	// check every track first so a frame is either rendered whole or left as it was
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const ZoneUpdate &update = updates[i];
+		if (update.zoneIndex >= pParams->numIllumZonesControl)
+			return false;
+		const NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_V1 &zone = pParams->zones[update.zoneIndex];
+		if (update.zoneType != NV_GPU_CLIENT_ILLUM_ZONE_TYPE_INVALID && update.zoneType != static_cast<unsigned int>(zone.type))
+			return false;
+		switch (zone.type)
+		{
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
+			break;
+		default:
+			return false;
+		}
+	}
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const ZoneUpdate &update = updates[i];
+		NV_GPU_CLIENT_ILLUM_ZONE_CONTROL_V1 &zone = pParams->zones[update.zoneIndex];
+		zone.ctrlMode = NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL;
+		switch (zone.type)
+		{
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB:
+		{
+			auto &rgb = zone.data.rgb.data.manualRGB.rgbParams;
+			rgb.colorR = update.r;
+			rgb.colorG = update.g;
+			rgb.colorB = update.b;
+			rgb.brightnessPct = update.brightness;
+			break;
+		}
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW:
+		{
+			auto &rgbw = zone.data.rgbw.data.manualRGBW.rgbwParams;
+			rgbw.colorR = update.r;
+			rgbw.colorG = update.g;
+			rgbw.colorB = update.b;
+			rgbw.colorW = update.w;
+			rgbw.brightnessPct = update.brightness;
+			break;
+		}
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR:
+			zone.data.singleColor.data.manualSingleColor.singleColorParams.brightnessPct = update.brightness;
+			break;
+		case NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED:
+			zone.data.colorFixed.data.manualColorFixed.colorFixedParams.brightnessPct = update.brightness;
+			break;
+		default:
+			break;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "NvApiDll.h"
+
+// Timeline source format, JSON compiled by CompileIlluminationTimeline:
+//
+//	{
+//		"durationMs": 4000,		// optional, defaults to the last keyframe, the loop period when looping
+//		"loop": true,			// optional, without it the frame at durationMs is held
+//		"tracks": [
+//			{
+//				"zone": 0,
+//				"type": "rgb",	// optional, rgb, rgbw, singleColor or colorFixed, checked when the frame is written
+//				"keyframes": [
+//					{"t": 0, "color": [255, 0, 0], "brightness": 100, "ease": "inOutCubic"},
+//					{"t": 2000, "color": [0, 0, 255, 0]}
+//				]
+//			}
+//		]
+//	}
+//
+// Keyframe times are milliseconds in ascending order, "color" takes r, g, b and an optional w, brightness defaults to
+// 100. "ease" shapes the segment that starts at the keyframe: linear (default), step, inQuad, outQuad, inOutQuad,
+// inCubic, outCubic, inOutCubic, inSine, outSine, inOutSine or smooth. Before its first keyframe a zone shows that
+// keyframe, after its last one the last.
+
+// Takes a reference, the timeline is freed when the last one is released
+void retainTimeline(IlluminationTimeline *pTimeline);
+void releaseTimeline(IlluminationTimeline *pTimeline);
+// Writes one update per track to pUpdates, which must hold NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX, and returns the count
+unsigned int evaluateTimeline(const IlluminationTimeline &timeline, unsigned long long timeUs, ZoneUpdate *pUpdates);
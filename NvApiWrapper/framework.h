@@ -1,5 +1,37 @@
 #pragma once
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
 // Windows Header Files
 #include <windows.h>
+#else
+// Minimal stand-ins for the MSVC CRT and Win32 calls the wrapper uses, so it also builds against the emulator
+// backend on machines without the NVIDIA driver
+#include <string.h>
+#include <unistd.h>
+
+#define _TRUNCATE ((size_t)-1)
+
+inline int strncpy_s(char *dst, size_t dstSize, const char *src, size_t count)
+{
+	if (!dst || dstSize == 0)
+		return 22;
+	size_t length = strnlen(src, count == _TRUNCATE ? dstSize - 1 : count);
+	if (length > dstSize - 1)
+		length = dstSize - 1;
+	memcpy(dst, src, length);
+	dst[length] = '\0';
+	return 0;
+}
+template <size_t Size>
+inline int strcat_s(char (&dst)[Size], const char *src)
+{
+	size_t length = strnlen(dst, Size);
+	strncpy_s(dst + length, Size - length, src, _TRUNCATE);
+	return 0;
+}
+inline void Sleep(unsigned int milliseconds)
+{
+	usleep(milliseconds * 1000);
+}
+#endif
@@ -0,0 +1,1486 @@
+﻿// Benchmark for the NvApiWrapper exports. The wrapper sources are compiled into this executable and run against the
+// emulator backend, so results do not depend on a GPU and allocations made inside the wrapper are counted as well.
+//
+// The stress stage runs one thread per --threads entry over a mix of zone writes and control reads spread across all
+// GPUs, its calls/s column is the thread scaling of the per-GPU locks. Every read has to show the thread's own writes.
+//
+// The GPU handle cache is checked to enumerate only after an invalidation, and a failing enumeration to fail
+// InitializeNvApi until the driver recovers.
+//
+// Piecewise endpoints and timing have to read back as written while a color pipeline is set on the zone. Switching a
+// zone back to piecewise control has to restore its last effect, and fail on a zone that never had one.
+//
+// The color pipeline and ambient sampler kernels are checked against the scalar reference first, a kernel that differs
+// in any byte fails the run. Each color kernel call processes COLOR_BENCH_COLORS colors, each ambient call one 4K frame.
+//
+// The audio stage plays a clip through SubmitAudioSamples and StepAudioReactive in 60 Hz blocks with every FFT kernel,
+// the kernels must agree on beats and writes. The clip is a synthetic 120 bpm kick unless --wav names a 16-bit PCM or
+// 32-bit float file, the synthetic run also fails when the beat count is off.
+//
+// The telemetry sampler and the animation engine are stepped on a test clock, the telemetry sampler against emulated
+// telemetry. The animation engine has to drop exactly the frames it missed and commit every GPU once per rendered frame.
+// TIMELINE_BENCH_COUNT generated keyframe timelines are compiled and checked at every keyframe, then all of them are
+// evaluated once per measured call.
+//
+// Producer threads push bursts of zone updates into an illumination channel that the bench thread drains, every drain
+// must read each burst, write each GPU once and leave every zone at the last update pushed to it.
+//
+// A session of zone writes and reads is recorded on the emulator with failures injected into every
+// TRACE_BENCH_FAIL_EVERY-th SetControl, then replayed from the trace. Each replayed call must give the recorded result.
+//
+// Usage: NvApiWrapperBench [--iterations N] [--warmup N] [--latency-us N] [--gpus N] [--threads 1,2,4] [--json path|-]
+//                          [--wav path]
+
+#include "NvApiDll.h"
+#include "NvApiColor.h"
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#pragma warning(disable : 5045) // suppress spectre warnings in this file
+
+// Every operator new in the process goes through here, the counter is read around each measured loop
+static std::atomic<unsigned long long> allocationCount{0};
+
+void *operator new(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void *p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+void operator delete[](void *p, size_t) noexcept
+{
+	free(p);
+}
+
+// Zone layout of every emulated GPU, one zone of each type so all four manual setters hit a matching zone
+enum BenchZone
+{
+	BENCH_ZONE_RGB = 0,
+	BENCH_ZONE_RGBW,
+	BENCH_ZONE_SINGLE_COLOR,
+	BENCH_ZONE_COLOR_FIXED,
+	BENCH_ZONE_COUNT
+};
+
+// One benchmarked call, iteration is passed so setters can write a new value every time and defeat the shadow
+typedef bool (*BenchFn)(unsigned int gpuIndex, unsigned int iteration);
+
+struct BenchCase
+{
+	const char *name;
+	BenchFn fn;
+	bool contended; // also run in the multi-threaded mode
+};
+
+static uint8_t benchLevel(unsigned int iteration)
+{
+	return static_cast<uint8_t>(1 + iteration % 100);
+}
+
+static thread_local CustomIlluminationZonesInfo benchZonesInfo;
+static thread_local CustomIlluminationZoneControls benchZoneControls;
+static thread_local char benchText[8192];
+
+static const BenchCase benchCases[] = {
+	{"GetNumberOfGPUs", [](unsigned int, unsigned int) { return GetNumberOfGPUs() != 0; }, false},
+	{"GetGPUHandle", [](unsigned int gpu, unsigned int) { return GetGPUHandle(gpu) != nullptr; }, false},
+	{"GetInterfaceVersionString", [](unsigned int, unsigned int) { return GetInterfaceVersionString() != nullptr; }, false},
+	{"GetGPUName", [](unsigned int gpu, unsigned int) { return strncmp(GetGPUName(gpu), "Error", 5) != 0; }, true},
+	{"GetGPUInfo", [](unsigned int gpu, unsigned int) { return strncmp(GetGPUInfo(gpu), "Error", 5) != 0; }, false},
+	{"GetSystemType", [](unsigned int gpu, unsigned int) { return strncmp(GetSystemType(gpu), "Error", 5) != 0; }, false},
+	{"GetGPUPCIIdentifiers", [](unsigned int gpu, unsigned int) {
+		 unsigned long deviceId, subSystemId, revisionId, extDeviceId;
+		 return GetGPUPCIIdentifiers(gpu, &deviceId, &subSystemId, &revisionId, &extDeviceId);
+	 },
+	 false},
+	{"GetGPUBusId", [](unsigned int gpu, unsigned int) {
+		 unsigned long busId;
+		 return GetGPUBusId(gpu, &busId);
+	 },
+	 false},
+	{"GetIlluminationZonesInfo", [](unsigned int gpu, unsigned int) { return GetIlluminationZonesInfo(gpu, &benchZonesInfo) != nullptr; }, false},
+	{"GetIlluminationZonesInfoData", [](unsigned int gpu, unsigned int) { return GetIlluminationZonesInfoData(gpu, &benchZonesInfo); }, false},
+	{"FormatIlluminationZonesInfo", [](unsigned int gpu, unsigned int) { return FormatIlluminationZonesInfo(gpu, benchText, sizeof(benchText), nullptr); }, false},
+	{"GetIlluminationZonesControl", [](unsigned int gpu, unsigned int) { return GetIlluminationZonesControl(gpu, false, &benchZoneControls) != nullptr; }, true},
+	{"GetIlluminationZonesControlData", [](unsigned int gpu, unsigned int) { return GetIlluminationZonesControlData(gpu, false, &benchZoneControls); }, true},
+	{"FormatIlluminationZonesControl", [](unsigned int gpu, unsigned int) { return FormatIlluminationZonesControl(gpu, false, benchText, sizeof(benchText), nullptr); }, false},
+	{"SetIlluminationZoneManualRGB", [](unsigned int gpu, unsigned int i) {
+		 uint8_t level = benchLevel(i);
+		 return SetIlluminationZoneManualRGB(gpu, BENCH_ZONE_RGB, level, 0, 255, level, false);
+	 },
+	 true},
+	{"SetIlluminationZoneManualRGBW", [](unsigned int gpu, unsigned int i) {
+		 uint8_t level = benchLevel(i);
+		 return SetIlluminationZoneManualRGBW(gpu, BENCH_ZONE_RGBW, level, 0, 255, 0, level, false);
+	 },
+	 true},
+	{"SetIlluminationZoneManualSingleColor", [](unsigned int gpu, unsigned int i) { return SetIlluminationZoneManualSingleColor(gpu, BENCH_ZONE_SINGLE_COLOR, benchLevel(i), false); }, true},
+	{"SetIlluminationZoneManualColorFixed", [](unsigned int gpu, unsigned int i) { return SetIlluminationZoneManualColorFixed(gpu, BENCH_ZONE_COLOR_FIXED, benchLevel(i), false); }, true},
+	{"SetIlluminationZonesBatch", [](unsigned int gpu, unsigned int i) {
+		 uint8_t level = benchLevel(i);
+		 ZoneUpdate updates[BENCH_ZONE_COUNT] = {
+			 {BENCH_ZONE_RGB, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB, level, 0, 255, 0, level, {0}},
+			 {BENCH_ZONE_RGBW, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW, level, 0, 255, 0, level, {0}},
+			 {BENCH_ZONE_SINGLE_COLOR, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR, 0, 0, 0, 0, level, {0}},
+			 {BENCH_ZONE_COLOR_FIXED, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED, 0, 0, 0, 0, level, {0}},
+		 };
+		 NvAPI_Status results[BENCH_ZONE_COUNT];
+		 return SetIlluminationZonesBatch(gpu, updates, BENCH_ZONE_COUNT, false, results);
+	 },
+	 true},
+	{"GetDriverVersion", [](unsigned int, unsigned int) { return GetDriverVersion() != 0; }, false},
+};
+
+struct BenchOptions
+{
+	unsigned int iterations = 2000;
+	unsigned int warmup = 100;
+	unsigned int latencyUs = 0;
+	unsigned int gpuCount = 2;
+	std::vector<unsigned int> threadCounts = {1, 2, 4, 8};
+	std::string jsonPath;
+	std::string wavPath;
+};
+
+struct BenchResult
+{
+	const char *name;
+	unsigned int threads;
+	unsigned long long calls;
+	unsigned long long failures;
+	double p50Us, p99Us, maxUs;
+	double callsPerSecond;
+	double allocationsPerCall;
+};
+
+// Per thread sample buffer, sized before the clock starts so recording a sample never allocates
+struct BenchThread
+{
+	std::vector<unsigned long long> samplesNs;
+	unsigned long long failures = 0;
+};
+
+static void runBenchThread(const BenchCase &benchCase, unsigned int gpuIndex, unsigned int iterations, BenchThread &thread)
+{
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool ok = benchCase.fn(gpuIndex, i);
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		thread.samplesNs[i] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		if (!ok)
+			thread.failures++;
+	}
+}
+
+static double percentileUs(std::vector<unsigned long long> &samplesNs, double percentile)
+{
+	if (samplesNs.empty())
+		return 0.0;
+	size_t rank = static_cast<size_t>(percentile * static_cast<double>(samplesNs.size() - 1) + 0.5);
+	std::nth_element(samplesNs.begin(), samplesNs.begin() + static_cast<ptrdiff_t>(rank), samplesNs.end());
+	return static_cast<double>(samplesNs[rank]) / 1000.0;
+}
+
+// All threads hammer GPU 0, which is the contended case the per-GPU lock has to handle
+static BenchResult runBenchCase(const BenchCase &benchCase, unsigned int threadCount, const BenchOptions &options)
+{
+	std::vector<BenchThread> threads(threadCount);
+	for (BenchThread &thread : threads)
+		thread.samplesNs.resize(options.iterations);
+	for (unsigned int i = 0; i < options.warmup; ++i)
+		benchCase.fn(0, i);
+
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount);
+	unsigned long long allocationsBefore = allocationCount.load();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (threadCount == 1)
+		runBenchThread(benchCase, 0, options.iterations, threads[0]);
+	else
+	{
+		for (unsigned int t = 0; t < threadCount; ++t)
+			workers.emplace_back(runBenchThread, std::cref(benchCase), 0u, options.iterations, std::ref(threads[t]));
+		for (std::thread &worker : workers)
+			worker.join();
+	}
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	unsigned long long allocations = allocationCount.load() - allocationsBefore;
+
+	BenchResult result = {};
+	result.name = benchCase.name;
+	result.threads = threadCount;
+	result.calls = static_cast<unsigned long long>(options.iterations) * threadCount;
+	std::vector<unsigned long long> samplesNs;
+	samplesNs.reserve(result.calls);
+	for (BenchThread &thread : threads)
+	{
+		samplesNs.insert(samplesNs.end(), thread.samplesNs.begin(), thread.samplesNs.end());
+		result.failures += thread.failures;
+	}
+	if (threadCount > 1)
+		allocations -= threadCount; // thread start-up allocates once per worker, not per call
+	result.maxUs = static_cast<double>(*std::max_element(samplesNs.begin(), samplesNs.end())) / 1000.0;
+	result.p99Us = percentileUs(samplesNs, 0.99);
+	result.p50Us = percentileUs(samplesNs, 0.50);
+	result.callsPerSecond = elapsedSeconds > 0.0 ? static_cast<double>(result.calls) / elapsedSeconds : 0.0;
+	result.allocationsPerCall = static_cast<double>(allocations) / static_cast<double>(result.calls);
+	return result;
+}
+
+static const NV_GPU_CLIENT_ILLUM_ZONE_TYPE benchZoneTypes[BENCH_ZONE_COUNT] = {
+	NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED};
+
+// Each thread owns one zone and alternates writes of it with control reads of its GPU. Threads beyond the number of
+// zones share them, so only the exclusive ones can check that a read shows their last write.
+static void runStressThread(unsigned int gpuIndex, unsigned int zoneIndex, bool exclusive, unsigned int iterations, BenchThread &thread)
+{
+	IlluminationZoneControlsV2 controls;
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		uint8_t level = benchLevel(i);
+		ZoneUpdate update = {zoneIndex, static_cast<unsigned int>(benchZoneTypes[zoneIndex]), level, 0, 255, 0, level, {0}};
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool ok = SetIlluminationZonesBatch(gpuIndex, &update, 1, false, nullptr) && GetIlluminationZonesControlV2(gpuIndex, false, &controls);
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		thread.samplesNs[i] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		if (!ok || (exclusive && controls.zones[zoneIndex].manualColor.brightness != level))
+			thread.failures++;
+	}
+}
+
+static BenchResult sampledResult(const char *name, std::vector<unsigned long long> &samplesNs, double elapsedSeconds, unsigned long long allocations, unsigned long long failures)
+{
+	BenchResult result = {};
+	result.name = name;
+	result.threads = 1;
+	result.calls = samplesNs.size();
+	result.failures = failures;
+	result.maxUs = static_cast<double>(*std::max_element(samplesNs.begin(), samplesNs.end())) / 1000.0;
+	result.p99Us = percentileUs(samplesNs, 0.99);
+	result.p50Us = percentileUs(samplesNs, 0.50);
+	result.callsPerSecond = elapsedSeconds > 0.0 ? static_cast<double>(result.calls) / elapsedSeconds : 0.0;
+	result.allocationsPerCall = static_cast<double>(allocations) / static_cast<double>(result.calls);
+	return result;
+}
+
+// Runs the write and read mix once per --threads count, thread t works on GPU t % gpus so every GPU lock is contended
+static void runStressCases(const BenchOptions &options, std::vector<BenchResult> &results)
+{
+	unsigned int zoneSlots = options.gpuCount * BENCH_ZONE_COUNT;
+	for (unsigned int threadCount : options.threadCounts)
+	{
+		std::vector<BenchThread> threads(threadCount);
+		for (BenchThread &thread : threads)
+			thread.samplesNs.resize(options.iterations);
+		std::vector<std::thread> workers;
+		workers.reserve(threadCount);
+		unsigned long long allocationsBefore = allocationCount.load();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned int t = 0; t < threadCount; ++t)
+			workers.emplace_back(runStressThread, t % options.gpuCount, (t / options.gpuCount) % BENCH_ZONE_COUNT, threadCount <= zoneSlots,
+								 options.iterations, std::ref(threads[t]));
+		for (std::thread &worker : workers)
+			worker.join();
+		double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		unsigned long long allocations = allocationCount.load() - allocationsBefore - threadCount; // thread start-up
+
+		std::vector<unsigned long long> samplesNs;
+		samplesNs.reserve(static_cast<size_t>(options.iterations) * threadCount);
+		unsigned long long failures = 0;
+		for (BenchThread &thread : threads)
+		{
+			samplesNs.insert(samplesNs.end(), thread.samplesNs.begin(), thread.samplesNs.end());
+			failures += thread.failures;
+		}
+		if (failures)
+			fprintf(stderr, "Stress write+read: %llu of %zu calls failed or read back another value with %u threads\n", failures, samplesNs.size(), threadCount);
+		BenchResult result = sampledResult("Stress write+read", samplesNs, elapsedSeconds, allocations, failures);
+		result.threads = threadCount;
+		results.push_back(result);
+	}
+}
+
+// Invalidates the handle cache before every lookup, so each timed call enumerates once. Lookups on a valid cache must
+// not enumerate at all, and a failing enumeration has to fail InitializeNvApi and leave the cache to rebuild later.
+static void runHandleCacheCases(const BenchOptions &options, std::vector<BenchResult> &results)
+{
+	unsigned long long avoidedBefore, performedBefore, avoidedAfter, performedAfter, enumerationsBefore, enumerationsAfter;
+	std::vector<unsigned long long> samplesNs(options.iterations);
+	unsigned long long failures = 0;
+	GetGPUHandleCacheStats(&avoidedBefore, &performedBefore);
+	unsigned long long allocationsBefore = allocationCount.load();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < options.iterations; ++i)
+	{
+		std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+		InvalidateGPUHandleCache();
+		if (!GetGPUHandle(i % options.gpuCount))
+			failures++;
+		samplesNs[i] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callStart).count());
+	}
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	unsigned long long allocations = allocationCount.load() - allocationsBefore;
+	GetGPUHandleCacheStats(&avoidedAfter, &performedAfter);
+	if (performedAfter - performedBefore != options.iterations || avoidedAfter != avoidedBefore)
+	{
+		fprintf(stderr, "InvalidateGPUHandleCache: %llu enumerations for %u lookups, %llu avoided\n", performedAfter - performedBefore,
+				options.iterations, avoidedAfter - avoidedBefore);
+		failures++;
+	}
+
+	// a warm cache answers every lookup without the driver
+	GetNvApiEmulatorCallCount(NVAPI_CALL_ENUM_PHYSICAL_GPUS, &enumerationsBefore);
+	GetGPUHandleCacheStats(&avoidedBefore, &performedBefore);
+	for (unsigned int i = 0; i < options.iterations; ++i)
+		if (!GetGPUHandle(i % options.gpuCount) || GetNumberOfGPUs() != options.gpuCount)
+			failures++;
+	GetNvApiEmulatorCallCount(NVAPI_CALL_ENUM_PHYSICAL_GPUS, &enumerationsAfter);
+	GetGPUHandleCacheStats(&avoidedAfter, &performedAfter);
+	if (enumerationsAfter != enumerationsBefore || performedAfter != performedBefore || avoidedAfter - avoidedBefore != 2ull * options.iterations)
+	{
+		fprintf(stderr, "GetGPUHandle: %llu enumerations on a valid cache, %llu avoided\n", enumerationsAfter - enumerationsBefore, avoidedAfter - avoidedBefore);
+		failures++;
+	}
+
+	// enumeration fails until the injection is lifted, then the next lookup rebuilds the cache
+	SetNvApiEmulatorFailure(NVAPI_CALL_ENUM_PHYSICAL_GPUS, NVAPI_NVIDIA_DEVICE_NOT_FOUND, 1);
+	bool initialized = InitializeNvApi();
+	NvPhysicalGpuHandle handle = GetGPUHandle(0);
+	SetNvApiEmulatorFailure(NVAPI_CALL_ENUM_PHYSICAL_GPUS, NVAPI_OK, 0);
+	if (initialized || handle || !GetGPUHandle(0) || !InitializeNvApi())
+	{
+		fprintf(stderr, "InitializeNvApi %s with enumeration failing\n", initialized ? "succeeded" : "recovered incorrectly");
+		failures++;
+	}
+	results.push_back(sampledResult("InvalidateGPUHandleCache+GetGPUHandle", samplesNs, elapsedSeconds, allocations, failures));
+}
+
+static bool piecewiseRgbMatches(const IlluminationZoneControlV2 &zone, const CustomRGB (&endpoints)[NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS],
+							   const CustomPiecewiseLinear &piecewise)
+{
+	if (zone.ctrlMode != NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR)
+		return false;
+	for (int j = 0; j < NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS; ++j)
+	{
+		const IlluminationColorV2 &color = zone.piecewiseColors[j];
+		if (color.r != endpoints[j].r || color.g != endpoints[j].g || color.b != endpoints[j].b || color.brightness != endpoints[j].brightness)
+			return false;
+	}
+	const IlluminationPiecewiseV2 &timing = zone.piecewise;
+	return timing.cycleType == NV_GPU_CLIENT_ILLUM_PIECEWISE_LINEAR_CYCLE_FULL_REPEAT && timing.riseTimeMs == piecewise.riseTimeMs &&
+		   timing.fallTimeMs == piecewise.fallTimeMs && timing.aTimeMs == piecewise.aTimeMs && timing.bTimeMs == piecewise.bTimeMs &&
+		   timing.idleTimeMs == piecewise.idleTimeMs && timing.phaseOffsetMs == piecewise.phaseOffsetMs && timing.grpCount == piecewise.grpCount;
+}
+
+// Writes a new piecewise effect to the RGB zone per call with a gamma pipeline on the zone, each one must read back
+// unchanged. Then the RGBW zone, never piecewise, must refuse the switch to piecewise, and the RGB zone must get its
+// effect back after a detour through manual control.
+static void runPiecewiseCases(const BenchOptions &options, std::vector<BenchResult> &results)
+{
+	ColorPipelineConfig pipeline = {};
+	pipeline.flags = COLOR_PIPELINE_GAMMA;
+	pipeline.gamma = 2.2f;
+	pipeline.brightnessGamma = 1.0f;
+	for (unsigned int gpu = 0; gpu < options.gpuCount; ++gpu)
+		SetZoneColorPipeline(gpu, BENCH_ZONE_RGB, &pipeline);
+
+	CustomPiecewiseLinear piecewise = {"Full Repeat", 400, 300, 200, 100, 50, 25, 1, 0};
+	CustomRGB endpoints[NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR_COLOR_ENDPOINTS];
+	IlluminationZoneControlsV2 controls;
+	std::vector<unsigned long long> samplesNs(options.iterations);
+	unsigned long long failures = 0;
+	unsigned long long mismatches = 0;
+	unsigned long long allocationsBefore = allocationCount.load();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < options.iterations; ++i)
+	{
+		unsigned int gpu = i % options.gpuCount;
+		uint8_t level = benchLevel(i);
+		endpoints[0] = {level, 10, 200, 100};
+		endpoints[1] = {30, level, 60, level};
+		piecewise.riseTimeMs = static_cast<uint16_t>(100 + i % 1000);
+		std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+		if (!SetIlluminationZonePiecewiseLinearRGB(gpu, BENCH_ZONE_RGB, endpoints, &piecewise, false))
+			failures++;
+		samplesNs[i] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callStart).count());
+		if (!GetIlluminationZonesControlV2(gpu, false, &controls) || !piecewiseRgbMatches(controls.zones[BENCH_ZONE_RGB], endpoints, piecewise))
+			mismatches++;
+	}
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	unsigned long long allocations = allocationCount.load() - allocationsBefore;
+	if (mismatches)
+	{
+		fprintf(stderr, "SetIlluminationZonePiecewiseLinearRGB: %llu of %u effects read back changed\n", mismatches, options.iterations);
+		failures++;
+	}
+
+	if (SetIlluminationZoneControlMode(0, BENCH_ZONE_RGBW, NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR, false))
+	{
+		fprintf(stderr, "SetIlluminationZoneControlMode: switched a zone without a piecewise effect to piecewise\n");
+		failures++;
+	}
+	endpoints[0] = {255, 128, 0, 80};
+	endpoints[1] = {0, 64, 255, 20};
+	bool restored = SetIlluminationZonePiecewiseLinearRGB(0, BENCH_ZONE_RGB, endpoints, &piecewise, false) &&
+					SetIlluminationZoneControlMode(0, BENCH_ZONE_RGB, NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL, false) &&
+					SetIlluminationZoneManualRGB(0, BENCH_ZONE_RGB, 1, 2, 3, 50, false) &&
+					SetIlluminationZoneControlMode(0, BENCH_ZONE_RGB, NV_GPU_CLIENT_ILLUM_CTRL_MODE_PIECEWISE_LINEAR, false) &&
+					GetIlluminationZonesControlV2(0, false, &controls) && piecewiseRgbMatches(controls.zones[BENCH_ZONE_RGB], endpoints, piecewise);
+	if (!restored)
+	{
+		fprintf(stderr, "SetIlluminationZoneControlMode: piecewise effect not restored after manual control\n");
+		failures++;
+	}
+	for (unsigned int gpu = 0; gpu < options.gpuCount; ++gpu)
+	{
+		SetZoneColorPipeline(gpu, BENCH_ZONE_RGB, nullptr);
+		SetIlluminationZoneControlMode(gpu, BENCH_ZONE_RGB, NV_GPU_CLIENT_ILLUM_CTRL_MODE_MANUAL, false);
+	}
+	results.push_back(sampledResult("SetIlluminationZonePiecewiseLinearRGB", samplesNs, elapsedSeconds, allocations, failures));
+}
+
+static const unsigned int COLOR_BENCH_COLORS = 4096 + 5; // not a multiple of a vector so the tails are checked too
+static const char *const colorKernelNames[] = {"ColorKernel scalar", "ColorKernel sse4.1", "ColorKernel avx2"};
+
+// Colors in planar form with the storage ColorPlanes points into
+struct ColorBenchPlanes
+{
+	std::vector<uint8_t> bytes[7]; // r, g, b, w, brightness, zone, extractWhite
+
+	ColorPlanes planes()
+	{
+		return {bytes[0].data(), bytes[1].data(), bytes[2].data(), bytes[3].data(), bytes[4].data(), bytes[5].data(), bytes[6].data(), COLOR_BENCH_COLORS};
+	}
+};
+
+// Random pipeline for every zone, all stage combinations show up across the 32 zones
+static void buildColorBenchBank(ColorPipelineBank &bank, std::minstd_rand &random)
+{
+	std::uniform_real_distribution<float> coefficient(-2.0f, 2.0f), unit(0.0f, 1.0f), exponent(0.3f, 3.0f);
+	for (unsigned int zone = 0; zone < NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX; ++zone)
+	{
+		ColorPipelineConfig config;
+		memset(&config, 0, sizeof(config));
+		config.flags = zone & (COLOR_PIPELINE_WHITE_BALANCE | COLOR_PIPELINE_EXTRACT_WHITE | COLOR_PIPELINE_GAMMA | COLOR_PIPELINE_CALIBRATION);
+		for (float &value : config.whiteBalance)
+			value = coefficient(random);
+		config.whiteExtraction = unit(random);
+		config.gamma = exponent(random);
+		config.brightnessGamma = exponent(random);
+		for (auto &channel : config.calibration)
+			for (uint8_t &value : channel)
+				value = static_cast<uint8_t>(random());
+		compileColorPipeline(config, zone, bank);
+	}
+}
+
+static void fillColorBenchPlanes(ColorBenchPlanes &colors, std::minstd_rand &random)
+{
+	for (int plane = 0; plane < 7; ++plane)
+	{
+		colors.bytes[plane].resize(COLOR_BENCH_COLORS);
+		for (uint8_t &value : colors.bytes[plane])
+			value = static_cast<uint8_t>(random());
+	}
+	for (uint8_t &zone : colors.bytes[5])
+		zone %= NV_GPU_CLIENT_ILLUM_ZONE_NUM_ZONES_MAX;
+	for (uint8_t &extractWhite : colors.bytes[6])
+		extractWhite &= 1;
+}
+
+// Runs every kernel the CPU supports on the same colors, compares the output with the scalar kernel and times it
+static void runColorKernelCases(const BenchOptions &options, std::vector<BenchResult> &results)
+{
+	std::unique_ptr<ColorPipelineBank> bank(new ColorPipelineBank());
+	std::minstd_rand random(1234);
+	buildColorBenchBank(*bank, random);
+	ColorBenchPlanes input, reference;
+	fillColorBenchPlanes(input, random);
+	reference = input;
+	runColorKernel(*bank, reference.planes(), COLOR_PIPELINE_ISA_SCALAR);
+
+	for (unsigned int isa = COLOR_PIPELINE_ISA_SCALAR; isa <= detectColorIsa(); ++isa)
+	{
+		ColorBenchPlanes colors = input;
+		runColorKernel(*bank, colors.planes(), isa);
+		unsigned long long mismatches = 0;
+		for (int plane = 0; plane < 5; ++plane)
+			for (unsigned int i = 0; i < COLOR_BENCH_COLORS; ++i)
+				if (colors.bytes[plane][i] != reference.bytes[plane][i])
+				{
+					if (mismatches++ == 0)
+						fprintf(stderr, "%s differs from the scalar kernel at color %u\n", colorKernelNames[isa], i);
+				}
+
+		// the kernel works in place, timing it on its own output keeps the values in range
+		std::vector<unsigned long long> samplesNs(options.iterations);
+		ColorPlanes planes = colors.planes();
+		for (unsigned int i = 0; i < options.warmup; ++i)
+			runColorKernel(*bank, planes, isa);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < options.iterations; ++i)
+		{
+			std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+			runColorKernel(*bank, planes, isa);
+			samplesNs[i] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callStart).count());
+		}
+		double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		BenchResult result = {};
+		result.name = colorKernelNames[isa];
+		result.threads = 1;
+		result.calls = options.iterations;
+		result.failures = mismatches;
+		result.maxUs = static_cast<double>(*std::max_element(samplesNs.begin(), samplesNs.end())) / 1000.0;
+		result.p99Us = percentileUs(samplesNs, 0.99);
+		result.p50Us = percentileUs(samplesNs, 0.50);
+		result.callsPerSecond = elapsedSeconds > 0.0 ? static_cast<double>(result.calls) / elapsedSeconds : 0.0;
+		results.push_back(result);
+	}
+}
+
+static const unsigned int AMBIENT_BENCH_WIDTH = 3840;
+static const unsigned int AMBIENT_BENCH_HEIGHT = 2160;
+// The sampler has no SSE4.1 path, that setting runs the scalar kernel
+static const unsigned int ambientIsas[] = {COLOR_PIPELINE_ISA_SCALAR, COLOR_PIPELINE_ISA_AVX2};
+static const char *const ambientCaseNames[] = {"SubmitAmbientFrame 4K scalar", "SubmitAmbientFrame 4K avx2"};
+
+// One region per bench zone, both modes and every zone type
+static const AmbientZoneRegion ambientBenchRegions[BENCH_ZONE_COUNT] = {
+	{BENCH_ZONE_RGB, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB, AMBIENT_MODE_AVERAGE, 0.0f, 0.0f, 0.5f, 1.0f},
+	{BENCH_ZONE_RGBW, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW, AMBIENT_MODE_DOMINANT, 0.5f, 0.0f, 1.0f, 1.0f},
+	{BENCH_ZONE_SINGLE_COLOR, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR, AMBIENT_MODE_AVERAGE, 0.0f, 0.0f, 1.0f, 1.0f},
+	{BENCH_ZONE_COLOR_FIXED, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED, AMBIENT_MODE_DOMINANT, 0.0f, 0.0f, 1.0f, 0.1f},
+};
+
+// Checks every sampler kernel against the scalar one on random frames, then times a full SubmitAmbientFrame on a
+// synthetic 4K frame with each of them. The kernel is switched through SetColorPipelineIsa, which both stages share.
+static void runAmbientCases(const BenchOptions &options, std::vector<BenchResult> &results)
+{
+	std::minstd_rand random(4321);
+	std::vector<uint8_t> frame(static_cast<size_t>(AMBIENT_BENCH_WIDTH) * AMBIENT_BENCH_HEIGHT * 4);
+	unsigned int bestIsa = detectColorIsa();
+	unsigned long long mismatches[2] = {0};
+	for (unsigned int round = 0; round < 8; ++round)
+	{
+		// odd sizes and padded strides so the kernels' tails and cell edges are covered
+		unsigned int width = 1 + random() % AMBIENT_BENCH_WIDTH, height = 1 + random() % AMBIENT_BENCH_HEIGHT;
+		int stride = static_cast<int>(width * 4 + (random() % 4) * 4);
+		for (size_t i = 0; i < static_cast<size_t>(stride) * height; ++i)
+			frame[i] = static_cast<uint8_t>(random());
+		ZoneUpdate reference[BENCH_ZONE_COUNT], updates[BENCH_ZONE_COUNT];
+		SetColorPipelineIsa(COLOR_PIPELINE_ISA_SCALAR);
+		ComputeAmbientColors(frame.data(), width, height, stride, ambientBenchRegions, BENCH_ZONE_COUNT, 100, reference);
+		for (unsigned int kernel = 1; kernel < 2 && ambientIsas[kernel] <= bestIsa; ++kernel)
+		{
+			SetColorPipelineIsa(ambientIsas[kernel]);
+			if (!ComputeAmbientColors(frame.data(), width, height, stride, ambientBenchRegions, BENCH_ZONE_COUNT, 100, updates) ||
+				memcmp(reference, updates, sizeof(reference)) != 0)
+			{
+				if (mismatches[kernel]++ == 0)
+					fprintf(stderr, "%s differs from the scalar kernel on a %ux%u frame\n", ambientCaseNames[kernel], width, height);
+			}
+		}
+	}
+
+	// horizontal gradient with a bright block, the same frame every call so only the sampling cost varies
+	for (unsigned int y = 0; y < AMBIENT_BENCH_HEIGHT; ++y)
+	{
+		for (unsigned int x = 0; x < AMBIENT_BENCH_WIDTH; ++x)
+		{
+			uint8_t *pixel = &frame[(static_cast<size_t>(y) * AMBIENT_BENCH_WIDTH + x) * 4];
+			bool block = x > AMBIENT_BENCH_WIDTH / 2 && y < AMBIENT_BENCH_HEIGHT / 3;
+			pixel[0] = static_cast<uint8_t>(x * 255 / AMBIENT_BENCH_WIDTH);
+			pixel[1] = block ? 230 : 40;
+			pixel[2] = static_cast<uint8_t>(255 - pixel[0]);
+			pixel[3] = 255;
+		}
+	}
+	SetAmbientRegions(0, ambientBenchRegions, BENCH_ZONE_COUNT, 100, 100);
+	for (unsigned int kernel = 0; kernel < 2 && ambientIsas[kernel] <= bestIsa; ++kernel)
+	{
+		SetColorPipelineIsa(ambientIsas[kernel]);
+		std::vector<unsigned long long> samplesNs(options.iterations);
+		unsigned long long failures = mismatches[kernel];
+		unsigned long long frameUs = 0;
+		for (unsigned int i = 0; i < options.warmup; ++i, frameUs += 16667)
+			SubmitAmbientFrame(0, frame.data(), AMBIENT_BENCH_WIDTH, AMBIENT_BENCH_HEIGHT, static_cast<int>(AMBIENT_BENCH_WIDTH * 4), frameUs);
+		unsigned long long allocationsBefore = allocationCount.load();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < options.iterations; ++i, frameUs += 16667)
+		{
+			std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+			if (!SubmitAmbientFrame(0, frame.data(), AMBIENT_BENCH_WIDTH, AMBIENT_BENCH_HEIGHT, static_cast<int>(AMBIENT_BENCH_WIDTH * 4), frameUs))
+				failures++;
+			samplesNs[i] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callStart).count());
+		}
+		double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		unsigned long long allocations = allocationCount.load() - allocationsBefore;
+
+		BenchResult result = {};
+		result.name = ambientCaseNames[kernel];
+		result.threads = 1;
+		result.calls = options.iterations;
+		result.failures = failures;
+		result.maxUs = static_cast<double>(*std::max_element(samplesNs.begin(), samplesNs.end())) / 1000.0;
+		result.p99Us = percentileUs(samplesNs, 0.99);
+		result.p50Us = percentileUs(samplesNs, 0.50);
+		result.callsPerSecond = elapsedSeconds > 0.0 ? static_cast<double>(result.calls) / elapsedSeconds : 0.0;
+		result.allocationsPerCall = static_cast<double>(allocations) / static_cast<double>(result.calls);
+		results.push_back(result);
+	}
+	SetAmbientRegions(0, nullptr, 0, 0, 0);
+	SetColorPipelineIsa(bestIsa);
+}
+
+static const unsigned int AUDIO_BENCH_RATE = 48000;
+static const unsigned int AUDIO_BENCH_SECONDS = 10;
+static const unsigned int AUDIO_BENCH_BEATS = 20; // one kick every half second
+static const char *const audioCaseNames[] = {"StepAudioReactive scalar", "StepAudioReactive sse", "StepAudioReactive avx2"};
+
+struct AudioClip
+{
+	std::vector<uint8_t> samples; // interleaved, AUDIO_FORMAT_*
+	unsigned int sampleRate, channels, format, frames;
+};
+
+static uint32_t readLe(const uint8_t *p, unsigned int bytes)
+{
+	uint32_t value = 0;
+	for (unsigned int i = 0; i < bytes; ++i)
+		value |= static_cast<uint32_t>(p[i]) << (8 * i);
+	return value;
+}
+
+// Reads the fmt and data chunks of a RIFF WAVE file, 16-bit PCM and 32-bit float only
+static bool loadWavClip(const char *path, AudioClip &clip)
+{
+	FILE *file = nullptr;
+#ifdef _WIN32
+	if (fopen_s(&file, path, "rb") != 0)
+		file = nullptr;
+#else
+	file = fopen(path, "rb");
+#endif
+	if (!file)
+		return false;
+	std::vector<uint8_t> bytes;
+	uint8_t buffer[65536];
+	for (size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) > 0;)
+		bytes.insert(bytes.end(), buffer, buffer + read);
+	fclose(file);
+	if (bytes.size() < 12 || memcmp(bytes.data(), "RIFF", 4) != 0 || memcmp(bytes.data() + 8, "WAVE", 4) != 0)
+		return false;
+
+	unsigned int formatTag = 0, bits = 0;
+	clip.channels = 0;
+	for (size_t offset = 12; offset + 8 <= bytes.size();)
+	{
+		const uint8_t *chunk = bytes.data() + offset;
+		size_t size = (std::min)(static_cast<size_t>(readLe(chunk + 4, 4)), bytes.size() - offset - 8);
+		if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16)
+		{
+			formatTag = readLe(chunk + 8, 2);
+			clip.channels = readLe(chunk + 10, 2);
+			clip.sampleRate = readLe(chunk + 12, 4);
+			bits = readLe(chunk + 22, 2);
+			if (formatTag == 0xFFFE && size >= 40) // WAVE_FORMAT_EXTENSIBLE, the tag is the start of the subformat GUID
+				formatTag = readLe(chunk + 32, 2);
+		}
+		else if (memcmp(chunk, "data", 4) == 0 && clip.channels)
+		{
+			if (formatTag == 1 && bits == 16)
+				clip.format = AUDIO_FORMAT_INT16;
+			else if (formatTag == 3 && bits == 32)
+				clip.format = AUDIO_FORMAT_FLOAT32;
+			else
+				return false;
+			clip.frames = static_cast<unsigned int>(size / (clip.channels * bits / 8));
+			clip.samples.assign(chunk + 8, chunk + 8 + static_cast<size_t>(clip.frames) * clip.channels * bits / 8);
+			return clip.frames > 0;
+		}
+		offset += 8 + size + (size & 1);
+	}
+	return false;
+}
+
+// Stereo float clip with a kick drum, a 50 Hz dropping sine burst, every half second over a quiet tone and noise
+static void synthesizeAudioClip(AudioClip &clip)
+{
+	clip.sampleRate = AUDIO_BENCH_RATE;
+	clip.channels = 2;
+	clip.format = AUDIO_FORMAT_FLOAT32;
+	clip.frames = AUDIO_BENCH_RATE * AUDIO_BENCH_SECONDS;
+	clip.samples.resize(static_cast<size_t>(clip.frames) * 2 * sizeof(float));
+	float *samples = reinterpret_cast<float *>(clip.samples.data());
+	std::minstd_rand random(99);
+	const double pi = 3.14159265358979323846;
+	double kickPhase = 0.0;
+	for (unsigned int n = 0; n < clip.frames; ++n)
+	{
+		double t = static_cast<double>(n) / AUDIO_BENCH_RATE;
+		double sinceKick = fmod(t + 0.25, 0.5); // first kick at 0.25 s, once the beat threshold has some history
+		double kickHz = 50.0 + 100.0 * exp(-sinceKick / 0.03);
+		kickPhase += 2.0 * pi * kickHz / AUDIO_BENCH_RATE;
+		double kick = sinceKick < 0.3 ? 0.8 * exp(-sinceKick / 0.08) * sin(kickPhase) : 0.0;
+		double tone = 0.05 * sin(2.0 * pi * 440.0 * t);
+		double noise = 0.01 * (static_cast<double>(random()) / random.max() - 0.5);
+		samples[2 * n] = static_cast<float>(kick + tone + noise);
+		samples[2 * n + 1] = static_cast<float>(kick + tone - noise);
+	}
+}
+
+// Plays the clip through the audio stage with every FFT kernel, one 60 Hz block and one lighting step per call
+static void runAudioCases(const BenchOptions &options, std::vector<BenchResult> &results)
+{
+	AudioClip clip;
+	bool synthetic = options.wavPath.empty();
+	if (synthetic)
+		synthesizeAudioClip(clip);
+	else if (!loadWavClip(options.wavPath.c_str(), clip))
+	{
+		fprintf(stderr, "Cannot read %s as 16-bit PCM or 32-bit float WAV\n", options.wavPath.c_str());
+		BenchResult result = {};
+		result.name = audioCaseNames[0];
+		result.threads = 1;
+		result.failures = 1;
+		results.push_back(result);
+		return;
+	}
+
+	AudioReactiveConfig config = {0, clip.sampleRate, 1024, 60, 48.0f, 1.6f};
+	float top = (std::min)(8000.0f, clip.sampleRate * 0.5f);
+	AudioBandMapping mappings[BENCH_ZONE_COUNT] = {
+		{BENCH_ZONE_RGB, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB, AUDIO_BAND_BEAT, 30.0f, 150.0f, 5.0f, 250.0f, {40, 0, 0, 0, 10}, {255, 0, 0, 0, 100}, {0, 0}},
+		{BENCH_ZONE_RGBW, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW, 0, 150.0f, 2000.0f, 20.0f, 300.0f, {0, 0, 255, 0, 100}, {255, 255, 255, 255, 100}, {0, 0}},
+		{BENCH_ZONE_SINGLE_COLOR, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR, 0, 2000.0f, top, 10.0f, 200.0f, {0, 0, 0, 0, 0}, {0, 0, 0, 0, 100}, {0, 0}},
+		{BENCH_ZONE_COLOR_FIXED, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED, 0, 30.0f, top, 50.0f, 500.0f, {0, 0, 0, 0, 20}, {0, 0, 0, 0, 100}, {0, 0}},
+	};
+	unsigned int blockFrames = clip.sampleRate / config.updateRateHz;
+	unsigned int frameBytes = clip.channels * (clip.format == AUDIO_FORMAT_INT16 ? 2 : 4);
+	unsigned int blocks = (clip.frames + blockFrames - 1) / blockFrames;
+
+	unsigned int bestIsa = detectColorIsa();
+	AudioReactiveStats reference = {};
+	for (unsigned int isa = COLOR_PIPELINE_ISA_SCALAR; isa <= bestIsa; ++isa)
+	{
+		SetColorPipelineIsa(isa);
+		SetAudioReactiveConfig(&config, mappings, BENCH_ZONE_COUNT);
+		std::vector<unsigned long long> samplesNs(blocks);
+		unsigned long long failures = 0;
+		unsigned long long allocationsBefore = allocationCount.load();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned int block = 0; block < blocks; ++block)
+		{
+			unsigned int first = block * blockFrames;
+			unsigned int count = (std::min)(blockFrames, clip.frames - first);
+			std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+			if (!SubmitAudioSamples(clip.samples.data() + static_cast<size_t>(first) * frameBytes, count, clip.channels, clip.format) ||
+				!StepAudioReactive())
+				failures++;
+			samplesNs[block] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callStart).count());
+		}
+		double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		unsigned long long allocations = allocationCount.load() - allocationsBefore;
+
+		AudioReactiveStats stats;
+		GetAudioReactiveStats(&stats);
+		if (isa == COLOR_PIPELINE_ISA_SCALAR)
+			reference = stats;
+		else if (stats.beats != reference.beats || stats.writes != reference.writes)
+		{
+			fprintf(stderr, "%s found %llu beats and %llu writes, the scalar kernel %llu and %llu\n", audioCaseNames[isa],
+					stats.beats, stats.writes, reference.beats, reference.writes);
+			failures++;
+		}
+		if (synthetic && (stats.beats + 1 < AUDIO_BENCH_BEATS || stats.beats > AUDIO_BENCH_BEATS + 1))
+		{
+			fprintf(stderr, "%s found %llu beats in the synthetic clip, expected %u\n", audioCaseNames[isa], stats.beats, AUDIO_BENCH_BEATS);
+			failures++;
+		}
+		if (!synthetic && isa == bestIsa)
+			fprintf(stderr, "%s: %.1f s, %llu beats, %llu analyses, %llu writes, %llu write failures\n", options.wavPath.c_str(),
+					static_cast<double>(clip.frames) / clip.sampleRate, stats.beats, stats.analyses, stats.writes, stats.writeFailures);
+
+		BenchResult result = {};
+		result.name = audioCaseNames[isa];
+		result.threads = 1;
+		result.calls = blocks;
+		result.failures = failures;
+		result.maxUs = static_cast<double>(*std::max_element(samplesNs.begin(), samplesNs.end())) / 1000.0;
+		result.p99Us = percentileUs(samplesNs, 0.99);
+		result.p50Us = percentileUs(samplesNs, 0.50);
+		result.callsPerSecond = elapsedSeconds > 0.0 ? static_cast<double>(result.calls) / elapsedSeconds : 0.0;
+		result.allocationsPerCall = static_cast<double>(allocations) / static_cast<double>(result.calls);
+		results.push_back(result);
+	}
+	SetColorPipelineIsa(bestIsa);
+}
+
+static const unsigned int TELEMETRY_BENCH_MIN_MS = 50;
+static const unsigned int TELEMETRY_BENCH_MAX_MS = 2000;
+static const float TELEMETRY_BENCH_RAMP_PER_S = 5.0f; // degrees per second while the emulated GPU heats up
+
+// Steps the telemetry sampler on a test clock against emulated telemetry: the GPUs heat up for the first half of the
+// ticks and hold for the second. Every tick must stay within two telemetry calls and one write per GPU, the held half
+// must settle at the longest interval without writes.
+static void runTelemetryCases(const BenchOptions &options, std::vector<BenchResult> &results)
+{
+	std::vector<TelemetrySample> defaults(options.gpuCount);
+	std::vector<TelemetryZoneMapping> mappings;
+	for (unsigned int gpu = 0; gpu < options.gpuCount; ++gpu)
+	{
+		GetGpuTelemetry(gpu, &defaults[gpu]);
+		TelemetryZoneMapping temperature = {gpu, BENCH_ZONE_RGB, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB, TELEMETRY_METRIC_GPU_TEMPERATURE, 1.0f, 3, {}};
+		temperature.points[0] = {40.0f, {0, 0, 255, 0, 100}, {0}};
+		temperature.points[1] = {65.0f, {0, 255, 0, 0, 100}, {0}};
+		temperature.points[2] = {90.0f, {255, 0, 0, 0, 100}, {0}};
+		TelemetryZoneMapping load = {gpu, BENCH_ZONE_SINGLE_COLOR, NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR, TELEMETRY_METRIC_GPU_UTILIZATION, 5.0f, 2, {}};
+		load.points[0] = {0.0f, {0, 0, 0, 0, 10}, {0}};
+		load.points[1] = {100.0f, {0, 0, 0, 0, 100}, {0}};
+		mappings.push_back(temperature);
+		mappings.push_back(load);
+	}
+	SetTelemetryMappings(mappings.data(), static_cast<unsigned int>(mappings.size()));
+
+	std::vector<unsigned long long> samplesNs(options.iterations);
+	unsigned long long failures = 0;
+	unsigned long long nowUs = 0;
+	unsigned int intervalMs = TELEMETRY_BENCH_MIN_MS;
+	unsigned int heldWrites = 0;
+	unsigned int heatingTicks = options.iterations / 2;
+	TelemetryStats before;
+	GetTelemetryStats(&before);
+	unsigned long long allocationsBefore = allocationCount.load();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < options.iterations; ++i)
+	{
+		if (i <= heatingTicks)
+		{
+			for (unsigned int gpu = 0; gpu < options.gpuCount; ++gpu)
+			{
+				TelemetrySample sample = defaults[gpu];
+				sample.values[TELEMETRY_METRIC_GPU_TEMPERATURE] = (std::min)(95.0f, 40.0f + TELEMETRY_BENCH_RAMP_PER_S * static_cast<float>(nowUs) * 1e-6f);
+				sample.values[TELEMETRY_METRIC_GPU_UTILIZATION] = 80.0f;
+				SetNvApiEmulatorTelemetry(gpu, &sample);
+			}
+		}
+		TelemetryStats tickBefore;
+		GetTelemetryStats(&tickBefore);
+		std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+		if (!StepTelemetrySampler(TELEMETRY_BENCH_MIN_MS, TELEMETRY_BENCH_MAX_MS, nowUs, &intervalMs))
+			failures++;
+		samplesNs[i] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callStart).count());
+		TelemetryStats tickAfter;
+		GetTelemetryStats(&tickAfter);
+		if (tickAfter.driverCalls - tickBefore.driverCalls > 2ull * options.gpuCount || tickAfter.writes - tickBefore.writes > options.gpuCount)
+			failures++;
+		// one tick after the hold to let the last heated reading reach the colors
+		if (i > heatingTicks + 1)
+			heldWrites += static_cast<unsigned int>(tickAfter.writes - tickBefore.writes);
+		nowUs += intervalMs * 1000ull;
+	}
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	unsigned long long allocations = allocationCount.load() - allocationsBefore;
+
+	TelemetryStats stats;
+	GetTelemetryStats(&stats);
+	if (heldWrites || intervalMs != TELEMETRY_BENCH_MAX_MS || stats.sampleFailures != before.sampleFailures || stats.writeFailures != before.writeFailures)
+	{
+		fprintf(stderr, "StepTelemetrySampler: %u writes while held, final interval %u ms, %llu sample failures, %llu write failures\n",
+				heldWrites, intervalMs, stats.sampleFailures - before.sampleFailures, stats.writeFailures - before.writeFailures);
+		failures++;
+	}
+	SetTelemetryMappings(nullptr, 0);
+	for (unsigned int gpu = 0; gpu < options.gpuCount; ++gpu)
+		SetNvApiEmulatorTelemetry(gpu, &defaults[gpu]);
+
+	BenchResult result = {};
+	result.name = "StepTelemetrySampler";
+	result.threads = 1;
+	result.calls = options.iterations;
+	result.failures = failures;
+	result.maxUs = static_cast<double>(*std::max_element(samplesNs.begin(), samplesNs.end())) / 1000.0;
+	result.p99Us = percentileUs(samplesNs, 0.99);
+	result.p50Us = percentileUs(samplesNs, 0.50);
+	result.callsPerSecond = elapsedSeconds > 0.0 ? static_cast<double>(result.calls) / elapsedSeconds : 0.0;
+	result.allocationsPerCall = static_cast<double>(allocations) / static_cast<double>(result.calls);
+	results.push_back(result);
+}
+
+static const unsigned int ANIMATION_BENCH_RATE_HZ = 60;
+static const unsigned int ANIMATION_BENCH_LATE_EVERY = 16; // every Nth frame arrives three intervals after the last
+static const unsigned int ANIMATION_BENCH_PERIOD_MS = 1000;
+
+// Test clock and commit hook of the animation case
+struct AnimationBenchHooks
+{
+	unsigned long long nowUs;
+	unsigned long long startUs;
+	unsigned long long commits;
+	unsigned long long mismatches;
+};
+
+static unsigned long long animationBenchClock(void *context)
+{
+	return static_cast<AnimationBenchHooks *>(context)->nowUs;
+}
+
+// Checks the strobe color against the test clock and forwards to the emulator. GetAnimationStats takes the engine
+// lock, so it would deadlock here if the engine still held it across the commit.
+static bool animationBenchCommit(unsigned int gpuIndex, const ZoneUpdate *pUpdates, unsigned int count, void *context)
+{
+	AnimationBenchHooks &hooks = *static_cast<AnimationBenchHooks *>(context);
+	AnimationStats stats;
+	GetAnimationStats(&stats);
+	hooks.commits++;
+	bool on = (hooks.nowUs - hooks.startUs) % (ANIMATION_BENCH_PERIOD_MS * 1000ull) < ANIMATION_BENCH_PERIOD_MS * 500ull;
+	if (stats.commits != hooks.commits || count != BENCH_ZONE_COUNT || pUpdates[0].brightness != (on ? 90 : 10))
+		hooks.mismatches++;
+	return SetIlluminationZonesBatch(gpuIndex, pUpdates, count, false, nullptr);
+}
+
+// Steps the animation engine on a test clock with a strobe on every GPU. Frames arrive on their deadline except every
+// ANIMATION_BENCH_LATE_EVERY one, which is two intervals late and must drop exactly two frames, and a poll half an
+// interval early after every frame must render nothing. Each rendered frame commits every GPU once.
+static void runAnimationCases(const BenchOptions &options, std::vector<BenchResult> &results)
+{
+	AnimationBenchHooks hooks = {};
+	SetAnimationHooks(animationBenchClock, animationBenchCommit, &hooks);
+	AnimationParams params = {};
+	params.effect = ANIMATION_EFFECT_STROBE;
+	params.periodMs = ANIMATION_BENCH_PERIOD_MS;
+	params.zoneMask = (1u << BENCH_ZONE_COUNT) - 1;
+	params.colorA = {255, 0, 0, 0, 90};
+	params.colorB = {0, 0, 255, 0, 10};
+	params.dutyPct = 50;
+	for (unsigned int gpu = 0; gpu < options.gpuCount; ++gpu)
+		SetAnimationEffect(gpu, &params);
+
+	unsigned long long intervalUs = 1000000ull / ANIMATION_BENCH_RATE_HZ;
+	std::vector<unsigned long long> samplesNs(options.iterations);
+	unsigned long long failures = 0;
+	unsigned long long lateFrames = 0;
+	hooks.nowUs = hooks.startUs = 1000000;
+	unsigned long long allocationsBefore = allocationCount.load();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < options.iterations; ++i)
+	{
+		std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+		if (!StepAnimationEngine(ANIMATION_BENCH_RATE_HZ, hooks.nowUs, i == 0))
+			failures++;
+		samplesNs[i] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callStart).count());
+		unsigned long long frameUs = hooks.nowUs;
+		hooks.nowUs = frameUs + intervalUs / 2;
+		StepAnimationEngine(ANIMATION_BENCH_RATE_HZ, hooks.nowUs, false);
+		bool late = (i + 1) % ANIMATION_BENCH_LATE_EVERY == 0;
+		lateFrames += late;
+		hooks.nowUs = frameUs + (late ? intervalUs * 3 : intervalUs);
+	}
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	unsigned long long allocations = allocationCount.load() - allocationsBefore;
+
+	AnimationStats stats;
+	GetAnimationStats(&stats);
+	// the last late step is never followed by a frame, so its drops are not counted yet
+	unsigned long long expectedDropped = 2 * (lateFrames - ((options.iterations % ANIMATION_BENCH_LATE_EVERY) == 0));
+	if (stats.framesRendered != options.iterations || stats.framesDropped != expectedDropped || stats.commits != stats.framesRendered * options.gpuCount ||
+		stats.commitFailures || hooks.commits != stats.commits || hooks.mismatches)
+	{
+		fprintf(stderr, "StepAnimationEngine: %llu frames rendered, %llu dropped (expected %llu), %llu commits, %llu failed, %llu mismatched\n",
+				stats.framesRendered, stats.framesDropped, expectedDropped, stats.commits, stats.commitFailures, hooks.mismatches);
+		failures++;
+	}
+	params.effect = ANIMATION_EFFECT_NONE;
+	for (unsigned int gpu = 0; gpu < options.gpuCount; ++gpu)
+		SetAnimationEffect(gpu, &params);
+	SetAnimationHooks(nullptr, nullptr, nullptr);
+	results.push_back(sampledResult("StepAnimationEngine", samplesNs, elapsedSeconds, allocations, failures));
+}
+
+static const unsigned int TIMELINE_BENCH_COUNT = 4096;
+static const unsigned int TIMELINE_BENCH_KEYFRAMES = 8;
+static const unsigned int TIMELINE_BENCH_PERIOD_MS = 4000;
+static const char *const timelineBenchEasings[] = {"linear", "step", "inOutCubic", "outQuad", "inOutSine", "smooth"};
+static const char *const timelineBenchTypes[BENCH_ZONE_COUNT] = {"rgb", "rgbw", "singleColor", "colorFixed"};
+
+struct TimelineBenchKey
+{
+	unsigned int timeMs;
+	uint8_t r, g, b, w, brightness;
+};
+
+// Looping timeline with a track per bench zone and keyframes at random times and colors
+static std::string buildTimelineJson(std::minstd_rand &random, TimelineBenchKey (&keys)[BENCH_ZONE_COUNT][TIMELINE_BENCH_KEYFRAMES])
+{
+	std::string json = "{\"durationMs\": " + std::to_string(TIMELINE_BENCH_PERIOD_MS) + ", \"loop\": true, \"tracks\": [";
+	for (unsigned int zone = 0; zone < BENCH_ZONE_COUNT; ++zone)
+	{
+		json += std::string(zone ? ", " : "") + "{\"zone\": " + std::to_string(zone) + ", \"type\": \"" + timelineBenchTypes[zone] + "\", \"keyframes\": [";
+		unsigned int timeMs = random() % 100;
+		for (unsigned int k = 0; k < TIMELINE_BENCH_KEYFRAMES; ++k)
+		{
+			TimelineBenchKey &key = keys[zone][k];
+			key = {timeMs, static_cast<uint8_t>(random()), static_cast<uint8_t>(random()), static_cast<uint8_t>(random()), 0, static_cast<uint8_t>(random() % 101)};
+			// only RGBW zones carry a w value, the rest keep the default
+			if (zone == BENCH_ZONE_RGBW)
+				key.w = static_cast<uint8_t>(random());
+			char text[160];
+			snprintf(text, sizeof(text), "%s{\"t\": %u, \"color\": [%u, %u, %u%s], \"brightness\": %u, \"ease\": \"%s\"}", k ? ", " : "",
+					 key.timeMs, key.r, key.g, key.b, zone == BENCH_ZONE_RGBW ? (", " + std::to_string(key.w)).c_str() : "", key.brightness,
+					 timelineBenchEasings[random() % (sizeof(timelineBenchEasings) / sizeof(timelineBenchEasings[0]))]);
+			json += text;
+			timeMs += 50 + random() % (TIMELINE_BENCH_PERIOD_MS / TIMELINE_BENCH_KEYFRAMES - 100);
+		}
+		json += "]}";
+	}
+	return json + "]}";
+}
+
+// Compiles TIMELINE_BENCH_COUNT timelines, checks every one of them at each keyframe and then times evaluating all of
+// them per call, which must not allocate
+static void runTimelineCases(const BenchOptions &options, std::vector<BenchResult> &results)
+{
+	std::minstd_rand random(4321);
+	std::vector<std::string> sources(TIMELINE_BENCH_COUNT);
+	std::unique_ptr<TimelineBenchKey[][BENCH_ZONE_COUNT][TIMELINE_BENCH_KEYFRAMES]> keys(new TimelineBenchKey[TIMELINE_BENCH_COUNT][BENCH_ZONE_COUNT][TIMELINE_BENCH_KEYFRAMES]);
+	for (unsigned int i = 0; i < TIMELINE_BENCH_COUNT; ++i)
+		sources[i] = buildTimelineJson(random, keys[i]);
+
+	std::vector<IlluminationTimeline *> timelines(TIMELINE_BENCH_COUNT);
+	std::vector<unsigned long long> compileNs(TIMELINE_BENCH_COUNT);
+	unsigned long long failures = 0;
+	unsigned long long allocationsBefore = allocationCount.load();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < TIMELINE_BENCH_COUNT; ++i)
+	{
+		char error[128];
+		std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+		timelines[i] = CompileIlluminationTimeline(sources[i].c_str(), sources[i].size(), error, sizeof(error));
+		compileNs[i] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callStart).count());
+		if (!timelines[i] && failures++ == 0)
+			fprintf(stderr, "CompileIlluminationTimeline failed on timeline %u: %s\n", i, error);
+	}
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	results.push_back(sampledResult("CompileIlluminationTimeline", compileNs, elapsedSeconds, allocationCount.load() - allocationsBefore, failures));
+	if (failures)
+	{
+		for (IlluminationTimeline *timeline : timelines)
+			FreeIlluminationTimeline(timeline);
+		return;
+	}
+
+	// every keyframe must come out exactly as authored
+	unsigned long long mismatches = 0;
+	for (unsigned int i = 0; i < TIMELINE_BENCH_COUNT; ++i)
+		for (unsigned int zone = 0; zone < BENCH_ZONE_COUNT; ++zone)
+			for (unsigned int k = 0; k < TIMELINE_BENCH_KEYFRAMES; ++k)
+			{
+				const TimelineBenchKey &key = keys[i][zone][k];
+				ZoneUpdate updates[BENCH_ZONE_COUNT];
+				unsigned int count = EvaluateIlluminationTimeline(timelines[i], key.timeMs * 1000ull, updates, BENCH_ZONE_COUNT);
+				const ZoneUpdate &update = updates[zone];
+				if (count != BENCH_ZONE_COUNT || update.zoneIndex != zone || update.r != key.r || update.g != key.g || update.b != key.b ||
+					update.w != key.w || update.brightness != key.brightness)
+				{
+					if (mismatches++ == 0)
+						fprintf(stderr, "Timeline %u zone %u differs from keyframe %u at %u ms\n", i, zone, k, key.timeMs);
+				}
+			}
+
+	std::vector<unsigned long long> samplesNs(options.iterations);
+	ZoneUpdate updates[BENCH_ZONE_COUNT];
+	unsigned long long checksum = 0;
+	allocationsBefore = allocationCount.load();
+	start = std::chrono::steady_clock::now();
+	for (unsigned int iteration = 0; iteration < options.iterations; ++iteration)
+	{
+		unsigned long long timeUs = iteration * 16667ull;
+		std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < TIMELINE_BENCH_COUNT; ++i)
+		{
+			EvaluateIlluminationTimeline(timelines[i], timeUs + i * 977ull, updates, BENCH_ZONE_COUNT);
+			checksum += updates[0].r;
+		}
+		samplesNs[iteration] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callStart).count());
+	}
+	elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	unsigned long long allocations = allocationCount.load() - allocationsBefore;
+	if (allocations)
+		fprintf(stderr, "EvaluateIlluminationTimeline allocated %llu times\n", allocations);
+	if (checksum == 0)
+		mismatches++;
+	results.push_back(sampledResult("EvaluateIlluminationTimeline x4096", samplesNs, elapsedSeconds, allocations, mismatches + allocations));
+	for (IlluminationTimeline *timeline : timelines)
+		FreeIlluminationTimeline(timeline);
+}
+
+static const unsigned int CHANNEL_BENCH_CAPACITY = 4096;
+static const unsigned int CHANNEL_BENCH_PRODUCERS = 8;
+static const unsigned int CHANNEL_BENCH_BURST = 256; // pushes per producer between drains
+#ifdef _WIN32
+static const char *const channelBenchName = "Local\\NvApiWrapperBench";
+#else
+static const char *const channelBenchName = "/NvApiWrapperBench";
+#endif
+
+// Each producer owns one zone of one GPU and pushes a burst of updates to it per iteration, the push time is averaged
+// over the burst. The drain that follows is timed as a whole and checked against the stats and the zone state.
+static void runChannelCases(const BenchOptions &options, std::vector<BenchResult> &results)
+{
+	unsigned int producerCount = (std::min)(CHANNEL_BENCH_PRODUCERS, options.gpuCount * BENCH_ZONE_COUNT);
+	unsigned int gpusTouched = (std::min)(producerCount, options.gpuCount);
+	if (!OpenIlluminationChannel(channelBenchName, CHANNEL_BENCH_CAPACITY, 0))
+	{
+		fprintf(stderr, "OpenIlluminationChannel failed on %s\n", channelBenchName);
+		BenchResult result = {};
+		result.name = "DrainIlluminationChannel";
+		result.threads = 1;
+		result.failures = 1;
+		results.push_back(result);
+		return;
+	}
+	std::vector<IlluminationChannelProducer *> producers(producerCount);
+	for (IlluminationChannelProducer *&producer : producers)
+		producer = ConnectIlluminationChannel(channelBenchName);
+
+	std::vector<unsigned long long> pushNs(static_cast<size_t>(options.iterations) * producerCount);
+	std::vector<unsigned long long> drainNs(options.iterations);
+	std::vector<unsigned long long> pushFailures(producerCount);
+	unsigned long long failures = 0;
+	unsigned long long allocations = 0;
+	double drainSeconds = 0.0;
+	for (unsigned int iteration = 0; iteration < options.iterations; ++iteration)
+	{
+		std::vector<std::thread> threads;
+		for (unsigned int p = 0; p < producerCount; ++p)
+			threads.emplace_back([&, p]()
+								 {
+				ZoneUpdate update = {p / options.gpuCount, 0, 0, 0, 0, 0, 0, {0}};
+				std::chrono::steady_clock::time_point burstStart = std::chrono::steady_clock::now();
+				for (unsigned int k = 0; k < CHANNEL_BENCH_BURST; ++k)
+				{
+					update.r = static_cast<uint8_t>(k);
+					update.b = static_cast<uint8_t>(p);
+					update.brightness = static_cast<uint8_t>((iteration + k) % 101);
+					if (!PushIlluminationChannelUpdate(producers[p], p % options.gpuCount, &update))
+						pushFailures[p]++;
+				}
+				pushNs[static_cast<size_t>(iteration) * producerCount + p] = static_cast<unsigned long long>(
+					std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - burstStart).count()) / CHANNEL_BENCH_BURST; });
+		for (std::thread &thread : threads)
+			thread.join();
+
+		IlluminationChannelStats before, after;
+		GetIlluminationChannelStats(&before);
+		unsigned long long allocationsBefore = allocationCount.load();
+		std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+		unsigned int drained = DrainIlluminationChannel();
+		drainNs[iteration] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callStart).count());
+		drainSeconds += static_cast<double>(drainNs[iteration]) * 1e-9;
+		allocations += allocationCount.load() - allocationsBefore;
+		GetIlluminationChannelStats(&after);
+
+		bool ok = drained == producerCount * CHANNEL_BENCH_BURST && after.writes - before.writes == gpusTouched &&
+				  after.coalesced - before.coalesced == producerCount * (CHANNEL_BENCH_BURST - 1ull) && after.writeFailures == before.writeFailures;
+		for (unsigned int gpu = 0; ok && gpu < gpusTouched; ++gpu)
+		{
+			IlluminationZoneControlsV2 controls;
+			ok = GetIlluminationZonesControlV2(gpu, false, &controls);
+			for (unsigned int p = gpu; ok && p < producerCount; p += options.gpuCount)
+				ok = controls.zones[p / options.gpuCount].manualColor.brightness == (iteration + CHANNEL_BENCH_BURST - 1) % 101;
+		}
+		if (!ok && failures++ == 0)
+			fprintf(stderr, "DrainIlluminationChannel read %u records in iteration %u, %llu writes, %llu coalesced, %llu write failures\n", drained,
+					iteration, after.writes - before.writes, after.coalesced - before.coalesced, after.writeFailures - before.writeFailures);
+	}
+	unsigned long long pushFailureCount = 0;
+	for (unsigned long long count : pushFailures)
+		pushFailureCount += count;
+	// producers run side by side, so the push rate is the per thread rate times the thread count
+	double pushSeconds = 0.0;
+	for (unsigned long long ns : pushNs)
+		pushSeconds += static_cast<double>(ns) * CHANNEL_BENCH_BURST * 1e-9 / producerCount;
+	for (IlluminationChannelProducer *producer : producers)
+		DisconnectIlluminationChannel(producer);
+	CloseIlluminationChannel();
+
+	BenchResult push = sampledResult("PushIlluminationChannelUpdate", pushNs, pushSeconds, 0, pushFailureCount);
+	push.threads = producerCount;
+	push.calls *= CHANNEL_BENCH_BURST;
+	push.callsPerSecond *= CHANNEL_BENCH_BURST;
+	push.allocationsPerCall = 0.0;
+	results.push_back(push);
+	results.push_back(sampledResult("DrainIlluminationChannel", drainNs, drainSeconds, allocations, failures));
+}
+
+static const unsigned int TRACE_BENCH_FAIL_EVERY = 7;
+static const char *const traceBenchPath = "NvApiWrapperBench.nvtrace";
+
+// Results of one step of the traced session, compared between the recording and the replay
+struct TraceBenchStep
+{
+	bool written;
+	bool read;
+	IlluminationZoneControlsV2 controls;
+};
+
+static void runTraceBenchStep(unsigned int i, unsigned int gpuCount, TraceBenchStep &step)
+{
+	unsigned int gpu = i % gpuCount;
+	uint8_t level = benchLevel(i);
+	step.written = SetIlluminationZoneManualRGB(gpu, BENCH_ZONE_RGB, level, 0, 255, level, false);
+	memset(&step.controls, 0, sizeof(step.controls));
+	step.read = GetIlluminationZonesControlV2(gpu, false, &step.controls);
+}
+
+// Records the session with failures injected, so failed writes and the re-reads they cause are part of the trace, then
+// replays it and times the replayed steps. A step past the end of the trace has to fail, the replay answers from the
+// trace alone.
+static void runTraceCases(const BenchOptions &options, std::vector<BenchResult> &results)
+{
+	std::vector<TraceBenchStep> recorded(options.iterations);
+	std::vector<TraceBenchStep> replayed(options.iterations);
+	std::vector<unsigned long long> samplesNs(options.iterations);
+	unsigned long long failures = 0;
+	unsigned long long setCallsBefore, setCallsAfter;
+	GetNvApiEmulatorCallCount(NVAPI_CALL_ILLUM_ZONES_SET_CONTROL, &setCallsBefore);
+	SetNvApiEmulatorFailure(NVAPI_CALL_ILLUM_ZONES_SET_CONTROL, NVAPI_ERROR, TRACE_BENCH_FAIL_EVERY);
+	bool recording = StartNvApiTraceRecording(traceBenchPath);
+	for (unsigned int i = 0; i < options.iterations; ++i)
+		runTraceBenchStep(i, options.gpuCount, recorded[i]);
+	StopNvApiTraceRecording();
+	SetNvApiEmulatorFailure(NVAPI_CALL_ILLUM_ZONES_SET_CONTROL, NVAPI_OK, 0);
+	GetNvApiEmulatorCallCount(NVAPI_CALL_ILLUM_ZONES_SET_CONTROL, &setCallsAfter);
+
+	unsigned long long injected = setCallsAfter / TRACE_BENCH_FAIL_EVERY - setCallsBefore / TRACE_BENCH_FAIL_EVERY;
+	unsigned long long failedWrites = 0;
+	for (const TraceBenchStep &step : recorded)
+		failedWrites += !step.written;
+	if (!recording || injected == 0 || failedWrites != injected)
+	{
+		fprintf(stderr, "Trace recording: %s, %llu writes failed for %llu injected failures\n", recording ? "started" : "not started", failedWrites, injected);
+		failures++;
+	}
+
+	bool loaded = LoadNvApiTraceReplay(traceBenchPath);
+	unsigned long long allocationsBefore = allocationCount.load();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; loaded && i < options.iterations; ++i)
+	{
+		std::chrono::steady_clock::time_point callStart = std::chrono::steady_clock::now();
+		runTraceBenchStep(i, options.gpuCount, replayed[i]);
+		samplesNs[i] = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callStart).count());
+	}
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	unsigned long long allocations = allocationCount.load() - allocationsBefore;
+	unsigned long long mismatches = 0;
+	for (unsigned int i = 0; i < options.iterations; ++i)
+		if (replayed[i].written != recorded[i].written || replayed[i].read != recorded[i].read ||
+			memcmp(&replayed[i].controls, &recorded[i].controls, sizeof(recorded[i].controls)) != 0)
+			mismatches++;
+	TraceBenchStep extra;
+	runTraceBenchStep(options.iterations, options.gpuCount, extra);
+	if (!loaded || mismatches || extra.written)
+	{
+		fprintf(stderr, "Trace replay: %s, %llu of %u steps differ from the recording, %s past the end\n", loaded ? "loaded" : "not loaded", mismatches,
+				options.iterations, extra.written ? "a write succeeded" : "writes fail");
+		failures++;
+	}
+	SetNvApiBackend(NVAPI_BACKEND_EMULATOR);
+	remove(traceBenchPath);
+	results.push_back(sampledResult("Trace replay", samplesNs, elapsedSeconds, allocations, failures));
+}
+
+static bool parseThreadCounts(const char *list, std::vector<unsigned int> &threadCounts)
+{
+	threadCounts.clear();
+	while (*list)
+	{
+		char *end = nullptr;
+		unsigned long count = strtoul(list, &end, 10);
+		if (end == list || count == 0 || count > 256)
+			return false;
+		threadCounts.push_back(static_cast<unsigned int>(count));
+		list = *end == ',' ? end + 1 : end;
+	}
+	return !threadCounts.empty();
+}
+
+static bool parseOptions(int argc, char **argv, BenchOptions &options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value)
+			return false;
+		if (strcmp(arg, "--iterations") == 0)
+			options.iterations = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+		else if (strcmp(arg, "--warmup") == 0)
+			options.warmup = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+		else if (strcmp(arg, "--latency-us") == 0)
+			options.latencyUs = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+		else if (strcmp(arg, "--gpus") == 0)
+			options.gpuCount = static_cast<unsigned int>(strtoul(value, nullptr, 10));
+		else if (strcmp(arg, "--threads") == 0)
+		{
+			if (!parseThreadCounts(value, options.threadCounts))
+				return false;
+		}
+		else if (strcmp(arg, "--json") == 0)
+			options.jsonPath = value;
+		else if (strcmp(arg, "--wav") == 0)
+			options.wavPath = value;
+		else
+			return false;
+		++i;
+	}
+	return options.iterations > 0 && options.gpuCount > 0 && options.gpuCount <= NVAPI_MAX_PHYSICAL_GPUS;
+}
+
+static void configureEmulator(const BenchOptions &options)
+{
+	std::vector<EmulatorGpuConfig> gpus(options.gpuCount);
+	for (unsigned int i = 0; i < options.gpuCount; ++i)
+	{
+		EmulatorGpuConfig &gpu = gpus[i];
+		memset(&gpu, 0, sizeof(gpu));
+		snprintf(gpu.name, sizeof(gpu.name), "Bench GPU %u", i);
+		gpu.busId = 1 + i;
+		gpu.deviceId = 0x268410DE;
+		gpu.subSystemId = 0x167C10DE + (i << 16);
+		gpu.zoneCount = BENCH_ZONE_COUNT;
+		gpu.zoneTypes[BENCH_ZONE_RGB] = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGB;
+		gpu.zoneTypes[BENCH_ZONE_RGBW] = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_RGBW;
+		gpu.zoneTypes[BENCH_ZONE_SINGLE_COLOR] = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_SINGLE_COLOR;
+		gpu.zoneTypes[BENCH_ZONE_COLOR_FIXED] = NV_GPU_CLIENT_ILLUM_ZONE_TYPE_COLOR_FIXED;
+	}
+	ConfigureNvApiEmulator(gpus.data(), options.gpuCount);
+	// every driver call pays the same latency, initialization is left instant
+	for (unsigned int call = NVAPI_CALL_GET_ERROR_MESSAGE; call < NVAPI_CALL_COUNT; ++call)
+		SetNvApiEmulatorLatency(call, options.latencyUs);
+}
+
+static void writeJson(FILE *out, const BenchOptions &options, const std::vector<BenchResult> &results)
+{
+	unsigned long long enumerationsAvoided, enumerationsPerformed, shadowHits, shadowMisses, shadowSkippedWrites;
+	GetGPUHandleCacheStats(&enumerationsAvoided, &enumerationsPerformed);
+	GetIlluminationShadowStats(&shadowHits, &shadowMisses, &shadowSkippedWrites);
+
+	fprintf(out, "{\n");
+	fprintf(out, "  \"config\": {\"iterations\": %u, \"warmup\": %u, \"latencyUs\": %u, \"gpus\": %u},\n",
+			options.iterations, options.warmup, options.latencyUs, options.gpuCount);
+	fprintf(out, "  \"counters\": {\"enumerationsAvoided\": %llu, \"enumerationsPerformed\": %llu, \"shadowHits\": %llu, \"shadowMisses\": %llu, \"shadowSkippedWrites\": %llu},\n",
+			enumerationsAvoided, enumerationsPerformed, shadowHits, shadowMisses, shadowSkippedWrites);
+	fprintf(out, "  \"results\": [\n");
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchResult &r = results[i];
+		fprintf(out, "    {\"name\": \"%s\", \"threads\": %u, \"calls\": %llu, \"failures\": %llu, \"p50Us\": %.3f, \"p99Us\": %.3f, \"maxUs\": %.3f, \"callsPerSecond\": %.1f, \"allocationsPerCall\": %.3f}%s\n",
+				r.name, r.threads, r.calls, r.failures, r.p50Us, r.p99Us, r.maxUs, r.callsPerSecond, r.allocationsPerCall,
+				i + 1 < results.size() ? "," : "");
+	}
+	fprintf(out, "  ]\n}\n");
+}
+
+static void printTable(const std::vector<BenchResult> &results)
+{
+	printf("%-38s %7s %10s %10s %10s %12s %8s %8s\n", "call", "threads", "p50 us", "p99 us", "max us", "calls/s", "allocs", "failed");
+	for (const BenchResult &r : results)
+		printf("%-38s %7u %10.3f %10.3f %10.3f %12.0f %8.3f %8llu\n", r.name, r.threads, r.p50Us, r.p99Us, r.maxUs, r.callsPerSecond, r.allocationsPerCall, r.failures);
+}
+
+int main(int argc, char **argv)
+{
+	BenchOptions options;
+	if (!parseOptions(argc, argv, options))
+	{
+		fprintf(stderr, "usage: %s [--iterations N] [--warmup N] [--latency-us N] [--gpus N] [--threads 1,2,4] [--json path|-] [--wav path]\n", argv[0]);
+		return 2;
+	}
+
+	SetNvApiBackend(NVAPI_BACKEND_EMULATOR);
+	configureEmulator(options);
+	if (!InitializeNvApi())
+	{
+		fprintf(stderr, "Failed to initialize the emulator backend.\n");
+		return 1;
+	}
+
+	std::vector<BenchResult> results;
+	for (const BenchCase &benchCase : benchCases)
+		results.push_back(runBenchCase(benchCase, 1, options));
+	for (unsigned int threadCount : options.threadCounts)
+	{
+		if (threadCount == 1)
+			continue;
+		for (const BenchCase &benchCase : benchCases)
+			if (benchCase.contended)
+				results.push_back(runBenchCase(benchCase, threadCount, options));
+	}
+	runStressCases(options, results);
+	runHandleCacheCases(options, results);
+	runPiecewiseCases(options, results);
+	runColorKernelCases(options, results);
+	runAmbientCases(options, results);
+	runAudioCases(options, results);
+	runTelemetryCases(options, results);
+	runAnimationCases(options, results);
+	runTimelineCases(options, results);
+	runChannelCases(options, results);
+	runTraceCases(options, results);
+
+	bool jsonToStdout = options.jsonPath == "-";
+	if (!jsonToStdout)
+		printTable(results);
+	if (!options.jsonPath.empty())
+	{
+		FILE *out = stdout;
+		if (!jsonToStdout)
+		{
+#ifdef _WIN32
+			if (fopen_s(&out, options.jsonPath.c_str(), "w") != 0)
+				out = nullptr;
+#else
+			out = fopen(options.jsonPath.c_str(), "w");
+#endif
+		}
+		if (!out)
+		{
+			fprintf(stderr, "Cannot write %s\n", options.jsonPath.c_str());
+			DeinitializeNvApi();
+			return 1;
+		}
+		writeJson(out, options, results);
+		if (out != stdout)
+			fclose(out);
+	}
+
+	DeinitializeNvApi();
+	unsigned long long failures = 0;
+	for (const BenchResult &r : results)
+		failures += r.failures;
+	return failures ? 1 : 0;
+}
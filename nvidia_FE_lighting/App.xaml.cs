@@ -34,10 +34,18 @@ namespace nvidia_FE_lighting
                 Directory.CreateDirectory(Path.GetDirectoryName(logPath));
                 File.WriteAllText(logPath, $"[{DateTime.Now}] Startup mode initiated\n");
 
-                // Wait for driver initialization
                 string settingsPath = Path.Combine(Environment.GetFolderPath(Environment.SpecialFolder.ApplicationData),
                     "NvidiaFELighting", "startup_settings.json");
 
+                // Binary startup profiles are applied by the DLL straight from disk, the JSON settings are only read
+                // for the driver timeout unless the app has not written the profiles yet
+                string[] startupProfiles = ProfileFile.StartupProfiles(Path.GetDirectoryName(logPath));
+                if (startupProfiles.Length > 0)
+                {
+                    ApplyStartupProfiles(startupProfiles, ReadyTimeoutSeconds(ReadStartupSettings(settingsPath)), logPath);
+                    return;
+                }
+
                 if (!File.Exists(settingsPath))
                 {
                     File.AppendAllText(logPath, "No startup settings found. Exiting.\n");
@@ -54,19 +62,11 @@ namespace nvidia_FE_lighting
                     return;
                 }
 
-                File.AppendAllText(logPath, $"Waiting {settings.DelaySeconds} seconds for driver initialization...\n");
-                Thread.Sleep(settings.DelaySeconds * 1000);
-
-                // Initialize NVAPI
-                if (!InitializeNvApi())
-                {
-                    File.AppendAllText(logPath, "Failed to initialize NVAPI. Exiting.\n");
+                // Wait for driver initialization
+                if (!WaitForDriver(ReadyTimeoutSeconds(settings), logPath))
                     return;
-                }
-
-                File.AppendAllText(logPath, "NVAPI initialized successfully.\n");
 
-                // Get GPU count and verify saved GPU index exists
+                // Get GPU count
                 uint gpuCount = GetNumberOfGPUs();
                 if (gpuCount == 0)
                 {
@@ -75,127 +75,71 @@ namespace nvidia_FE_lighting
                     return;
                 }
 
-                uint gpuIndex = settings.GpuIndex;
-                File.AppendAllText(logPath, $"Found {gpuCount} GPU(s). Using saved GPU index {gpuIndex}.\n");
-
-                // Verify GPU index is valid
-                if (gpuIndex >= gpuCount)
-                {
-                    File.AppendAllText(logPath, $"Saved GPU index {gpuIndex} is out of range (only {gpuCount} GPU(s) detected). Exiting.\n");
-                    DeinitializeNvApi();
-                    return;
-                }
-
-                // Get current GPU identifier
-                uint busId, deviceId, subSystemId, revisionId, extDeviceId;
-                if (!GetGPUBusId(gpuIndex, out busId) ||
-                    !GetGPUPCIIdentifiers(gpuIndex, out deviceId, out subSystemId, out revisionId, out extDeviceId))
-                {
-                    File.AppendAllText(logPath, "Failed to get GPU identifiers. Exiting.\n");
-                    DeinitializeNvApi();
-                    return;
-                }
+                // Older settings files only describe a single GPU
+                var targets = settings.Gpus.Count > 0
+                    ? settings.Gpus
+                    : new List<GpuStartupProfile> { new GpuStartupProfile { GpuIdentifier = settings.GpuIdentifier, Zones = settings.Zones } };
+                File.AppendAllText(logPath, $"Found {gpuCount} GPU(s). Applying settings to {targets.Count} saved GPU(s)...\n");
 
-                var currentGpuId = new GpuIdentifier
-                {
-                    BusId = busId,
-                    DeviceId = deviceId,
-                    SubSystemId = subSystemId,
-                    RevisionId = revisionId,
-                    ExtDeviceId = extDeviceId
-                };
-
-                // Verify GPU matches
-                if (!currentGpuId.Matches(settings.GpuIdentifier))
+                // GPUs are matched by PCI identity, never by enumeration index, so settings cannot land on the wrong card
+                var batches = new GpuZoneBatch[targets.Count];
+                var updates = new List<ZoneUpdate>();
+                for (int t = 0; t < targets.Count; t++)
                 {
-                    File.AppendAllText(logPath, $"GPU mismatch detected!\n");
-                    File.AppendAllText(logPath, $"  Expected: BusId={settings.GpuIdentifier.BusId}, DeviceId={settings.GpuIdentifier.DeviceId}, SubSystemId={settings.GpuIdentifier.SubSystemId}\n");
-                    File.AppendAllText(logPath, $"  Current:  BusId={currentGpuId.BusId}, DeviceId={currentGpuId.DeviceId}, SubSystemId={currentGpuId.SubSystemId}\n");
-                    File.AppendAllText(logPath, "Aborting to prevent applying settings to wrong GPU.\n");
-                    DeinitializeNvApi();
-                    return;
-                }
+                    var id = targets[t].GpuIdentifier;
+                    var identity = new GpuPciIdentity { busId = id.BusId, deviceId = id.DeviceId, subSystemId = id.SubSystemId };
+                    batches[t] = new GpuZoneBatch { identity = identity, firstUpdate = (uint)updates.Count, updateCount = (uint)targets[t].Zones.Count };
 
-                File.AppendAllText(logPath, "GPU verification successful. Detecting zones...\n");
-
-                // Detect zones first (critical step that UI does before applying settings)
-                var zoneInfo = new CustomIlluminationZonesInfo { zones = new CustomIlluminationZonesInfoData[32] };
-                GetIlluminationZonesInfo(gpuIndex, ref zoneInfo);
-
-                var zoneControls = new CustomIlluminationZoneControls { zones = new CustomIlluminationZoneControl[32] };
-                GetIlluminationZonesControl(gpuIndex, false, ref zoneControls);
+                    // Detect zones first (critical step that UI does before applying settings)
+                    if (FindGPUByPciIdentity(ref identity, out uint gpuIndex))
+                    {
+                        GetIlluminationZonesInfoV2(gpuIndex, out var zoneInfo);
+                        File.AppendAllText(logPath, $"  GPU BusId={id.BusId} found at index {gpuIndex} with {zoneInfo.numZones} zone(s).\n");
+                    }
 
-                if (zoneInfo.numIllumZones == 0)
-                {
-                    File.AppendAllText(logPath, "No illumination zones detected. Exiting.\n");
-                    DeinitializeNvApi();
-                    return;
+                    foreach (var zone in targets[t].Zones)
+                    {
+                        updates.Add(new ZoneUpdate
+                        {
+                            zoneIndex = (uint)zone.ZoneIndex,
+                            // single color profiles also apply to color fixed zones, so only check the other types
+                            zoneType = zone.ZoneType == "Single Color" ? 0 : ZoneTypeFromName(zone.ZoneType),
+                            r = zone.R,
+                            g = zone.G,
+                            b = zone.B,
+                            w = zone.W,
+                            brightness = zone.Brightness
+                        });
+                    }
                 }
 
-                File.AppendAllText(logPath, $"Detected {zoneInfo.numIllumZones} zone(s). Applying settings...\n");
+                // One worker per GPU inside the DLL, all cards are brought up at the same time
+                var gpuResults = new int[batches.Length];
+                var zoneResults = new int[updates.Count];
+                ApplyIlluminationZonesMultiGpu(batches, (uint)batches.Length, updates.ToArray(), (uint)updates.Count, false,
+                    gpuResults, zoneResults, out ulong wallTimeUs);
 
-                // Apply settings
                 int successCount = 0;
-                foreach (var zone in settings.Zones)
+                for (int t = 0; t < targets.Count; t++)
                 {
-                    File.AppendAllText(logPath, $"  Applying zone {zone.ZoneIndex} ({zone.ZoneType}): brightness={zone.Brightness}\n");
-
-                    bool success = false;
-                    if (zone.ZoneType == "RGB")
+                    var id = targets[t].GpuIdentifier;
+                    if (gpuResults[t] == NvApiStatusDeviceNotFound)
                     {
-                        success = SetIlluminationZoneManualRGB(gpuIndex, (uint)zone.ZoneIndex,
-                            zone.R, zone.G, zone.B, zone.Brightness, false);
-                        File.AppendAllText(logPath, $"    RGB result: {success}\n");
+                        File.AppendAllText(logPath, $"  GPU BusId={id.BusId}, DeviceId={id.DeviceId}, SubSystemId={id.SubSystemId} not found, skipped.\n");
+                        continue;
                     }
-                    else if (zone.ZoneType == "RGBW")
+                    File.AppendAllText(logPath, $"  GPU BusId={id.BusId}, DeviceId={id.DeviceId}, SubSystemId={id.SubSystemId} result: {gpuResults[t]}\n");
+                    for (int i = 0; i < targets[t].Zones.Count; i++)
                     {
-                        success = SetIlluminationZoneManualRGBW(gpuIndex, (uint)zone.ZoneIndex,
-                            zone.R, zone.G, zone.B, zone.W, zone.Brightness, false);
-                        File.AppendAllText(logPath, $"    RGBW result: {success}\n");
-                    }
-                    else if (zone.ZoneType == "Single Color")
-                    {
-                        success = SetIlluminationZoneManualSingleColor(gpuIndex, (uint)zone.ZoneIndex,
-                            zone.Brightness, false);
-                        File.AppendAllText(logPath, $"    SingleColor result: {success}\n");
-
-                        // Try ColorFixed as fallback
-                        if (!success)
-                        {
-                            success = SetIlluminationZoneManualColorFixed(gpuIndex, (uint)zone.ZoneIndex,
-                                zone.Brightness, false);
-                            File.AppendAllText(logPath, $"    ColorFixed fallback result: {success}\n");
-                        }
-                    }
-                    else if (zone.ZoneType == "Color Fixed")
-                    {
-                        success = SetIlluminationZoneManualColorFixed(gpuIndex, (uint)zone.ZoneIndex,
-                            zone.Brightness, false);
-                        File.AppendAllText(logPath, $"    ColorFixed result: {success}\n");
-                    }
-                    else
-                    {
-                        File.AppendAllText(logPath, $"    Unknown zone type, trying both\n");
-                        success = SetIlluminationZoneManualSingleColor(gpuIndex, (uint)zone.ZoneIndex,
-                            zone.Brightness, false);
-                        File.AppendAllText(logPath, $"    SingleColor result: {success}\n");
-                        if (!success)
-                        {
-                            success = SetIlluminationZoneManualColorFixed(gpuIndex, (uint)zone.ZoneIndex,
-                                zone.Brightness, false);
-                            File.AppendAllText(logPath, $"    ColorFixed result: {success}\n");
-                        }
-                    }
-
-                    if (success)
-                    {
-                        successCount++;
-                        // Small delay between zone commands
-                        Thread.Sleep(200);
+                        var zone = targets[t].Zones[i];
+                        int result = zoneResults[batches[t].firstUpdate + i];
+                        File.AppendAllText(logPath, $"    Zone {zone.ZoneIndex} ({zone.ZoneType}) brightness={zone.Brightness}: {result}\n");
+                        if (result == 0)
+                            successCount++;
                     }
                 }
 
-                File.AppendAllText(logPath, $"Applied settings to {successCount}/{settings.Zones.Count} zones successfully.\n");
+                File.AppendAllText(logPath, $"Applied settings to {successCount}/{updates.Count} zones successfully in {wallTimeUs / 1000.0:F1} ms.\n");
 
                 // Wait before exit
                 File.AppendAllText(logPath, "Waiting 1 second for hardware to process...\n");
@@ -217,6 +161,79 @@ namespace nvidia_FE_lighting
                 }
             }
         }
+
+        // Null when the settings file is missing or unreadable, the binary profiles do not need it
+        private static StartupSettings ReadStartupSettings(string settingsPath)
+        {
+            if (!File.Exists(settingsPath))
+                return null;
+            try
+            {
+                return JsonSerializer.Deserialize<StartupSettings>(File.ReadAllText(settingsPath));
+            }
+            catch (Exception)
+            {
+                return null;
+            }
+        }
+
+        // Files saved before the readiness wait only have DelaySeconds, which was a fixed sleep and is too short as a
+        // timeout, so they get the default
+        private static int ReadyTimeoutSeconds(StartupSettings settings)
+        {
+            return settings != null && settings.ReadyTimeoutSeconds > 0 ? settings.ReadyTimeoutSeconds : StartupSettings.DefaultReadyTimeoutSeconds;
+        }
+
+        // Returns as soon as the driver answers zone queries instead of sleeping a fixed time, NVAPI is initialized on success
+        private static bool WaitForDriver(int timeoutSeconds, string logPath)
+        {
+            File.AppendAllText(logPath, $"Waiting up to {timeoutSeconds} seconds for the driver...\n");
+            bool ready = WaitForIlluminationReady((uint)timeoutSeconds * 1000, out IlluminationReadyReport report);
+            File.AppendAllText(logPath, $"Driver phases: initialize {report.initializeUs / 1000.0:F1} ms ({report.initializeAttempts} attempt(s)), " +
+                $"enumerate {report.enumerateUs / 1000.0:F1} ms ({report.enumerateAttempts}), zones {report.zonesUs / 1000.0:F1} ms ({report.zonesAttempts}), " +
+                $"total {report.totalUs / 1000.0:F1} ms.\n");
+            if (!ready)
+            {
+                File.AppendAllText(logPath, $"Driver not ready, last status {report.lastStatus}, {report.gpuCount} GPU(s) enumerated. Exiting.\n");
+                return false;
+            }
+            File.AppendAllText(logPath, $"NVAPI initialized successfully, {report.readyGpuCount}/{report.gpuCount} GPU(s) with lighting.\n");
+            return true;
+        }
+
+        private static void ApplyStartupProfiles(string[] startupProfiles, int readyTimeoutSeconds, string logPath)
+        {
+            if (!WaitForDriver(readyTimeoutSeconds, logPath))
+                return;
+            File.AppendAllText(logPath, $"Applying {startupProfiles.Length} startup profile(s)...\n");
+
+            // each profile locates its GPU by PCI identity, GPUs are locked separately inside the DLL so they apply in parallel
+            var results = new int[startupProfiles.Length];
+            var stopwatch = System.Diagnostics.Stopwatch.StartNew();
+            Parallel.For(0, startupProfiles.Length, i => ApplyProfileFile(startupProfiles[i], ProfileMatchGpuIdentity, out results[i]));
+            stopwatch.Stop();
+
+            int successCount = 0;
+            for (int i = 0; i < startupProfiles.Length; i++)
+            {
+                string name = Path.GetFileName(startupProfiles[i]);
+                if (results[i] == NvApiStatusDeviceNotFound)
+                {
+                    File.AppendAllText(logPath, $"  {name}: GPU not found, skipped.\n");
+                    continue;
+                }
+                File.AppendAllText(logPath, $"  {name} result: {results[i]}\n");
+                if (results[i] == 0)
+                    successCount++;
+            }
+            File.AppendAllText(logPath, $"Applied {successCount}/{startupProfiles.Length} startup profile(s) in {stopwatch.Elapsed.TotalMilliseconds:F1} ms.\n");
+
+            File.AppendAllText(logPath, "Waiting 1 second for hardware to process...\n");
+            Thread.Sleep(1000);
+
+            DeinitializeNvApi();
+            File.AppendAllText(logPath, "Startup mode completed successfully.\n");
+        }
     }
 
 }
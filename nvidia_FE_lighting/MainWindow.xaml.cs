@@ -44,17 +44,30 @@ namespace nvidia_FE_lighting
         }
     }
 
+    public class GpuStartupProfile
+    {
+        public GpuIdentifier GpuIdentifier { get; set; } = new();
+        public List<ZoneProfile> Zones { get; set; } = new();
+    }
+
     public class StartupSettings
     {
+        public const int DefaultReadyTimeoutSeconds = 60;
+        // Fixed startup sleep of older versions, still read so their files load but no longer used
         public int DelaySeconds { get; set; } = 10;
+        // Longest wait for the driver at startup, startup continues as soon as the zones answer
+        public int ReadyTimeoutSeconds { get; set; } = DefaultReadyTimeoutSeconds;
         public uint GpuIndex { get; set; }
         public GpuIdentifier GpuIdentifier { get; set; } = new();
         public List<ZoneProfile> Zones { get; set; } = new();
+        // Every GPU brought up by startup mode, older settings files only have the single GPU above
+        public List<GpuStartupProfile> Gpus { get; set; } = new();
     }
 
     public partial class MainWindow : Window
     {
-        private CustomIlluminationZoneControl[] globalZoneControls;
+        private IlluminationZoneControlV2[] globalZoneControls;
+        private IlluminationZonesInfoV2 globalZoneInfo;
         private uint currentGpuIndex;
         private readonly Dictionary<(uint gpuIdx, int zoneIdx), byte> pendingBrightnessChanges = new();
         private readonly string profilesFolder;
@@ -62,6 +75,14 @@ namespace nvidia_FE_lighting
         private readonly string appDataFolder;
         private readonly string appDataExePath;
         private bool isInitializing = true;
+        // held here so the delegate outlives the native reconciler thread that calls it
+        private readonly IlluminationDriftCallback driftCallback;
+        private readonly ZoneChangeCallback zoneChangeCallback;
+        private uint zoneChangeSubscription;
+        private uint zoneChangeGpuIndex;
+        // a color picker drag writes continuously, the sampler may report a state the cache has already moved past
+        private long lastColorEditTicks;
+        private const long ColorEditSettleMs = 1000;
         private void SetStatus(string message)
         {
             statusText.Text = message;
@@ -76,6 +97,7 @@ namespace nvidia_FE_lighting
             startupSettingsPath = Path.Combine(appDataFolder, "startup_settings.json");
             appDataExePath = Path.Combine(appDataFolder, "FELighting.exe");
             Directory.CreateDirectory(profilesFolder);
+            ProfileFile.ConvertJsonProfiles(profilesFolder, startupSettingsPath);
 
             if (!InitializeNvApi())
             {
@@ -85,6 +107,19 @@ namespace nvidia_FE_lighting
             }
             SetStatus("NVAPI initialized.");
 
+            // Put back zones that the driver or another tool changed, e.g. after resume
+            driftCallback = OnIlluminationDrift;
+            SetIlluminationDriftCallback(driftCallback, IntPtr.Zero);
+            StartIlluminationReconciler(1000, 60000);
+            SystemEvents.PowerModeChanged += OnPowerModeChanged;
+            zoneChangeCallback = OnZoneChanged;
+            Closed += (_, _) =>
+            {
+                SystemEvents.PowerModeChanged -= OnPowerModeChanged;
+                UnregisterZoneChangeCallback(zoneChangeSubscription);
+                StopIlluminationReconciler();
+            };
+
             var gpuCount = GetNumberOfGPUs();
             for (uint i = 0; i < gpuCount; i++)
             {
@@ -131,98 +166,169 @@ namespace nvidia_FE_lighting
             pendingBrightnessChanges.Clear();
             applyAllButton.IsEnabled = false;
 
-            var zoneInfo = new NvApiWrapper.CustomIlluminationZonesInfo { zones = new NvApiWrapper.CustomIlluminationZonesInfoData[32] };
-            NvApiWrapper.GetIlluminationZonesInfo(gpuIndex, ref zoneInfo);
-
-            var zoneControls = new NvApiWrapper.CustomIlluminationZoneControls { zones = new NvApiWrapper.CustomIlluminationZoneControl[32] };
-            NvApiWrapper.GetIlluminationZonesControl(gpuIndex, false, ref zoneControls);
+            // Subscribe before reading so no change between the read and the subscription goes unnoticed
+            UnregisterZoneChangeCallback(zoneChangeSubscription);
+            zoneChangeGpuIndex = gpuIndex;
+            zoneChangeSubscription = RegisterZoneChangeCallback(gpuIndex, zoneChangeCallback, IntPtr.Zero);
 
-            globalZoneControls = new CustomIlluminationZoneControl[zoneControls.numZones];
-            Array.Copy(zoneControls.zones, globalZoneControls, zoneControls.numZones);
+            GetIlluminationZonesInfoV2(gpuIndex, out globalZoneInfo);
+            GetIlluminationZonesControlV2(gpuIndex, false, out var zoneControls);
+            globalZoneControls = ((ReadOnlySpan<IlluminationZoneControlV2>)zoneControls.zones).Slice(0, (int)zoneControls.numZones).ToArray();
 
-            if (zoneInfo.numIllumZones == 0)
+            if (globalZoneInfo.numZones == 0)
             {
                 gpuIlluminationZones.Items.Add(new TextBlock { Text = "No illumination zones found.", Margin = new Thickness(35, 0, 0, 10) });
                 SetStatus("No illumination zones found.");
                 return;
             }
 
-            for (int i = 0; i < zoneControls.numZones; i++)
+            for (int i = 0; i < globalZoneControls.Length; i++)
             {
-                var zone = zoneControls.zones[i];
-                var zoneMeta = zoneInfo.zones[i];
+                gpuIlluminationZones.Items.Add(BuildZoneCard(gpuIndex, i));
+            }
+            SetDesiredState(gpuIndex);
+            SetStatus($"Found {zoneControls.numZones} illumination zone(s).");
+        }
 
-                var panel = new StackPanel
-                {
-                    Orientation = Orientation.Vertical
-                };
+        private Border BuildZoneCard(uint gpuIndex, int i)
+        {
+            var zone = globalZoneControls[i];
+            var zoneMeta = globalZoneInfo.zones[i];
 
-                TextBlock header = new TextBlock
-                {
-                    Text = $"Zone {i}: {zone.controlMode} for {zoneMeta.zoneType} @ {zoneMeta.zoneLocation}",
-                    FontWeight = FontWeights.Bold,
-                    Margin = new Thickness(0, 0, 0, 10)
-                };
-                panel.Children.Add(header);
+            var panel = new StackPanel
+            {
+                Orientation = Orientation.Vertical
+            };
+
+            TextBlock header = new TextBlock
+            {
+                Text = $"Zone {i}: {ControlModeName(zone.ctrlMode)} for {ZoneTypeName(zoneMeta.zoneType)} @ {ZoneLocationName(zoneMeta.zoneLocation)}",
+                FontWeight = FontWeights.Bold,
+                Margin = new Thickness(0, 0, 0, 10)
+            };
+            panel.Children.Add(header);
 
-                if (zone.controlMode == "Manual")
+            if (zone.ctrlMode == IllumControlMode.Manual)
+            {
+                if (zone.zoneType == IllumZoneType.RGB)
                 {
-                    if (zone.zoneType == "RGB")
-                    {
-                        panel.Children.Add(new TextBlock { Text = $"Active RGB: R={zone.manualColorData.rgb.r}, G={zone.manualColorData.rgb.g}, B={zone.manualColorData.rgb.b}", Margin = new Thickness(0, 0, 0, 10), Foreground = (Brush)FindResource("TextSecondaryBrush") });
-                    }
-                    else if (zone.zoneType == "RGBW")
-                    {
-                        panel.Children.Add(new TextBlock { Text = $"Active RGBW: R={zone.manualColorData.rgbw.r}, G={zone.manualColorData.rgbw.g}, B={zone.manualColorData.rgbw.b}, W={zone.manualColorData.rgbw.w}", Margin = new Thickness(0, 0, 0, 10), Foreground = (Brush)FindResource("TextSecondaryBrush") });
-                    }
-                    else if (zone.zoneType == "Invalid")
-                    {
-                        panel.Children.Add(new TextBlock { Text = "Invalid", Margin = new Thickness(0, 0, 0, 10), Foreground = (Brush)FindResource("TextSecondaryBrush") });
-                    }
+                    panel.Children.Add(new TextBlock { Text = $"Active RGB: R={zone.manualColor.r}, G={zone.manualColor.g}, B={zone.manualColor.b}", Margin = new Thickness(0, 0, 0, 10), Foreground = (Brush)FindResource("TextSecondaryBrush") });
+                }
+                else if (zone.zoneType == IllumZoneType.RGBW)
+                {
+                    panel.Children.Add(new TextBlock { Text = $"Active RGBW: R={zone.manualColor.r}, G={zone.manualColor.g}, B={zone.manualColor.b}, W={zone.manualColor.w}", Margin = new Thickness(0, 0, 0, 10), Foreground = (Brush)FindResource("TextSecondaryBrush") });
                 }
-                else if (zone.controlMode == "Piecewise Linear")
+                else if (zone.zoneType == IllumZoneType.Invalid)
                 {
-                    panel.Children.Add(new TextBlock { Text = $"Piecewise Mode: {zone.piecewiseData.cycleType}, Group Count: {zone.piecewiseData.grpCount}" });
-                    for (int j = 0; j < zone.piecewiseColorData.Length; j++)
+                    panel.Children.Add(new TextBlock { Text = "Invalid", Margin = new Thickness(0, 0, 0, 10), Foreground = (Brush)FindResource("TextSecondaryBrush") });
+                }
+            }
+            else if (zone.ctrlMode == IllumControlMode.PiecewiseLinear)
+            {
+                panel.Children.Add(new TextBlock { Text = $"Piecewise Mode: {CycleTypeName(zone.piecewise.cycleType)}, Group Count: {zone.piecewise.grpCount}" });
+                for (int j = 0; j < 2; j++)
+                {
+                    var color = zone.piecewiseColors[j];
+                    string colorText = zone.zoneType switch
                     {
-                        var color = zone.piecewiseColorData[j];
-                        string colorText = zone.zoneType switch
-                        {
-                            "Active: RGB" => $"  [{j}] R={color.rgb.r}, G={color.rgb.g}, B={color.rgb.b}, Bright={color.rgb.brightness}",
-                            "Active: RGBW" => $"  [{j}] R={color.rgbw.r}, G={color.rgbw.g}, B={color.rgbw.b}, W={color.rgbw.w}, Bright={color.rgbw.brightness}",
-                            "Active: Single Color" => $"  [{j}] Brightness={color.singleColor.brightness}",
-                            _ => $"  [{j}] Unknown"
-                        };
-                        panel.Children.Add(new TextBlock { Text = colorText, Margin = new Thickness(0, 0, 0, 10), Foreground = (Brush)FindResource("TextSecondaryBrush") });
-                    }
+                        IllumZoneType.RGB => $"  [{j}] R={color.r}, G={color.g}, B={color.b}, Bright={color.brightness}",
+                        IllumZoneType.RGBW => $"  [{j}] R={color.r}, G={color.g}, B={color.b}, W={color.w}, Bright={color.brightness}",
+                        IllumZoneType.SingleColor or IllumZoneType.ColorFixed => $"  [{j}] Brightness={color.brightness}",
+                        _ => $"  [{j}] Unknown"
+                    };
+                    panel.Children.Add(new TextBlock { Text = colorText, Margin = new Thickness(0, 0, 0, 10), Foreground = (Brush)FindResource("TextSecondaryBrush") });
                 }
+            }
+
+            AddZoneControls(panel, zoneMeta.zoneType, gpuIndex, i);
+            var card = new Border
+            {
+                Background = (Brush)FindResource("CardBackgroundBrush"),
+                BorderBrush = (Brush)FindResource("CardBorderBrush"),
+                BorderThickness = new Thickness(1),
+                CornerRadius = new CornerRadius(10),
+                Padding = new Thickness(12),
+                Margin = new Thickness(0, 0, 0, 12)
+            };
+            card.Child = panel;
+            return card;
+        }
+
+        // Runs on the native sampler thread, changes is a managed copy so it can be handed to the UI thread as is
+        private void OnZoneChanged(uint gpuIndex, IlluminationZoneChange[] changes, uint count, IntPtr context)
+        {
+            Dispatcher.BeginInvoke(() => ApplyZoneChanges(gpuIndex, changes));
+        }
 
-                AddZoneControls(panel, zoneMeta.zoneType, gpuIndex, i);
-                var card = new Border
+        // Rebuilds only the cards of zones whose state differs from the cache, the app's own writes match it already
+        private void ApplyZoneChanges(uint gpuIndex, IlluminationZoneChange[] changes)
+        {
+            if (gpuIndex != zoneChangeGpuIndex || globalZoneControls == null)
+                return;
+            if (Environment.TickCount64 - lastColorEditTicks < ColorEditSettleMs)
+                return;
+            int updated = 0;
+            foreach (var change in changes)
+            {
+                int zoneIdx = (int)change.zoneIndex;
+                if (zoneIdx >= globalZoneControls.Length || zoneIdx >= gpuIlluminationZones.Items.Count)
                 {
-                    Background = (Brush)FindResource("CardBackgroundBrush"),
-                    BorderBrush = (Brush)FindResource("CardBorderBrush"),
-                    BorderThickness = new Thickness(1),
-                    CornerRadius = new CornerRadius(10),
-                    Padding = new Thickness(12),
-                    Margin = new Thickness(0, 0, 0, 12)
-                };
-                card.Child = panel;
-                gpuIlluminationZones.Items.Add(card);
+                    // the zone layout itself changed, start over
+                    PopulateIlluminationZones(gpuIndex);
+                    return;
+                }
+                var control = change.control;
+                if (MemoryMarshal.AsBytes(new ReadOnlySpan<IlluminationZoneControlV2>(in control))
+                    .SequenceEqual(MemoryMarshal.AsBytes(new ReadOnlySpan<IlluminationZoneControlV2>(in globalZoneControls[zoneIdx]))))
+                    continue;
+                globalZoneControls[zoneIdx] = control;
+                pendingBrightnessChanges.Remove((gpuIndex, zoneIdx));
+                gpuIlluminationZones.Items[zoneIdx] = BuildZoneCard(gpuIndex, zoneIdx);
+                updated++;
             }
-            SetStatus($"Found {zoneControls.numZones} illumination zone(s).");
+            if (updated > 0)
+                SetStatus($"{updated} zone(s) on GPU {gpuIndex} changed outside the app.");
         }
-        private void AddZoneControls(StackPanel panel, string zoneType, uint gpuIndex, int zoneIndex)
+
+        // Hands the manual zones just read to the reconciler, later writes through the DLL keep it up to date
+        private void SetDesiredState(uint gpuIndex)
         {
-            if (zoneType == "Invalid")
+            var updates = new List<ZoneUpdate>();
+            for (int i = 0; i < globalZoneControls.Length; i++)
+            {
+                var zone = globalZoneControls[i];
+                if (zone.ctrlMode != IllumControlMode.Manual || zone.zoneType == IllumZoneType.Invalid)
+                    continue;
+                updates.Add(BuildZoneUpdate(i, zone.manualColor.brightness));
+            }
+            SetIlluminationDesiredState(gpuIndex, updates.ToArray(), (uint)updates.Count);
+        }
+
+        private void OnIlluminationDrift(uint gpuIndex, uint driftedZoneMask, int repairStatus, IntPtr context)
+        {
+            int zoneCount = System.Numerics.BitOperations.PopCount(driftedZoneMask);
+            string message = repairStatus == 0
+                ? $"Restored {zoneCount} zone(s) on GPU {gpuIndex} changed outside the app."
+                : $"{zoneCount} zone(s) on GPU {gpuIndex} changed outside the app, restore failed ({repairStatus}).";
+            Dispatcher.BeginInvoke(() => SetStatus(message));
+        }
+
+        private void OnPowerModeChanged(object sender, PowerModeChangedEventArgs e)
+        {
+            if (e.Mode == PowerModes.Resume)
+                NotifyIlluminationPowerEvent();
+        }
+        private void AddZoneControls(StackPanel panel, IllumZoneType zoneType, uint gpuIndex, int zoneIndex)
+        {
+            if (zoneType == IllumZoneType.Invalid)
             {
                 return;
             }
 
             // Add RGB/RGBW color picker if applicable
-            if (zoneType == "RGB")
+            if (zoneType == IllumZoneType.RGB)
             {
-                var rgb = globalZoneControls[zoneIndex].manualColorData.rgb;
+                var rgb = globalZoneControls[zoneIndex].manualColor;
                 var colorPickerPanel = new StackPanel { Orientation = Orientation.Horizontal, Margin = new Thickness(0, 0, 0, 10) };
 
                 var colorLabel = new TextBlock { Text = "Color: ", VerticalAlignment = VerticalAlignment.Center, Margin = new Thickness(0, 0, 10, 0) };
@@ -244,9 +350,9 @@ namespace nvidia_FE_lighting
 
                 panel.Children.Add(colorPickerPanel);
             }
-            else if (zoneType == "RGBW")
+            else if (zoneType == IllumZoneType.RGBW)
             {
-                var rgbw = globalZoneControls[zoneIndex].manualColorData.rgbw;
+                var rgbw = globalZoneControls[zoneIndex].manualColor;
                 var colorPickerPanel = new StackPanel { Orientation = Orientation.Horizontal, Margin = new Thickness(0, 0, 0, 10) };
 
                 var colorLabel = new TextBlock { Text = "Color: ", VerticalAlignment = VerticalAlignment.Center, Margin = new Thickness(0, 0, 10, 0) };
@@ -294,12 +400,7 @@ namespace nvidia_FE_lighting
             var brightnessLabel = new TextBlock { Text = "Brightness: ", VerticalAlignment = VerticalAlignment.Center, Margin = new Thickness(0, 0, 10, 0) };
             brightnessPanel.Children.Add(brightnessLabel);
 
-            byte brightnessValue = zoneType switch
-            {
-                "RGB" => globalZoneControls[zoneIndex].manualColorData.rgb.brightness,
-                "RGBW" => globalZoneControls[zoneIndex].manualColorData.rgbw.brightness,
-                _ => globalZoneControls[zoneIndex].manualColorData.singleColor.brightness
-            };
+            byte brightnessValue = globalZoneControls[zoneIndex].manualColor.brightness;
             var brightnessSlider = new Slider
             {
                 Minimum = 0,
@@ -366,9 +467,10 @@ namespace nvidia_FE_lighting
 
         private void ApplySliderValue(Slider slider)
         {
-            var tag = ((uint gpuIdx, int zoneIdx, string zoneType))slider.Tag;
+            var tag = ((uint gpuIdx, int zoneIdx, IllumZoneType zoneType))slider.Tag;
             byte brightness = (byte)slider.Value;
             QueueBrightnessChange(tag.gpuIdx, tag.zoneIdx, brightness);
+            FlushIlluminationQueue(tag.gpuIdx, 500);
             if (!ApplyBrightnessForZone(tag.gpuIdx, tag.zoneIdx, tag.zoneType, brightness))
             {
                 Xceed.Wpf.Toolkit.MessageBox.Show($"Failed to set brightness for zone {tag.zoneIdx}");
@@ -383,30 +485,29 @@ namespace nvidia_FE_lighting
             applyAllButton.IsEnabled = true;
         }
 
-        private bool ApplyBrightnessForZone(uint gpuIdx, int zoneIdx, string zoneType, byte brightness)
+        private bool ApplyBrightnessForZone(uint gpuIdx, int zoneIdx, IllumZoneType zoneType, byte brightness)
         {
             bool result = false;
-            if (zoneType == "RGB")
+            var color = globalZoneControls[zoneIdx].manualColor;
+            if (zoneType == IllumZoneType.RGB)
             {
-                var color = globalZoneControls[zoneIdx].manualColorData.rgb;
                 result = SetIlluminationZoneManualRGB(gpuIdx, (uint)zoneIdx, color.r, color.g, color.b, brightness, false);
-                globalZoneControls[zoneIdx].manualColorData.rgb.brightness = brightness;
+                globalZoneControls[zoneIdx].manualColor.brightness = brightness;
             }
-            else if (zoneType == "RGBW")
+            else if (zoneType == IllumZoneType.RGBW)
             {
-                var color = globalZoneControls[zoneIdx].manualColorData.rgbw;
                 result = SetIlluminationZoneManualRGBW(gpuIdx, (uint)zoneIdx, color.r, color.g, color.b, color.w, brightness, false);
-                globalZoneControls[zoneIdx].manualColorData.rgbw.brightness = brightness;
+                globalZoneControls[zoneIdx].manualColor.brightness = brightness;
             }
-            else if (zoneType == "Single Color")
+            else if (zoneType == IllumZoneType.SingleColor)
             {
                 result = SetIlluminationZoneManualSingleColor(gpuIdx, (uint)zoneIdx, brightness, false);
-                if (result) globalZoneControls[zoneIdx].manualColorData.singleColor.brightness = brightness;
+                if (result) globalZoneControls[zoneIdx].manualColor.brightness = brightness;
             }
-            else if (zoneType == "Color Fixed")
+            else if (zoneType == IllumZoneType.ColorFixed)
             {
                 result = SetIlluminationZoneManualColorFixed(gpuIdx, (uint)zoneIdx, brightness, false);
-                if (result) globalZoneControls[zoneIdx].manualColorData.singleColor.brightness = brightness;
+                if (result) globalZoneControls[zoneIdx].manualColor.brightness = brightness;
             }
             else
             {
@@ -416,7 +517,7 @@ namespace nvidia_FE_lighting
                 {
                     result = SetIlluminationZoneManualColorFixed(gpuIdx, (uint)zoneIdx, brightness, false);
                 }
-                if (result) globalZoneControls[zoneIdx].manualColorData.singleColor.brightness = brightness;
+                if (result) globalZoneControls[zoneIdx].manualColor.brightness = brightness;
             }
             return result;
         }
@@ -429,55 +530,91 @@ namespace nvidia_FE_lighting
                 return;
             }
 
-            foreach (var kvp in pendingBrightnessChanges)
+            // One batched write per GPU instead of a read-modify-write per zone
+            int failedCount = 0;
+            foreach (var gpuGroup in pendingBrightnessChanges.GroupBy(kvp => kvp.Key.gpuIdx))
             {
-                var (gpuIdx, zoneIdx) = kvp.Key;
-                byte brightness = kvp.Value;
-                string zoneType = globalZoneControls[zoneIdx].zoneType;
-                if (ApplyBrightnessForZone(gpuIdx, zoneIdx, zoneType, brightness))
+                FlushIlluminationQueue(gpuGroup.Key, 500);
+                var pending = gpuGroup.ToArray();
+                var updates = pending.Select(kvp => BuildZoneUpdate(kvp.Key.zoneIdx, kvp.Value)).ToArray();
+                var results = new int[updates.Length];
+                SetIlluminationZonesBatch(gpuGroup.Key, updates, (uint)updates.Length, false, results);
+                for (int i = 0; i < pending.Length; i++)
                 {
-                    Thread.Sleep(100);
+                    if (results[i] == 0)
+                        StoreZoneBrightness(pending[i].Key.zoneIdx, pending[i].Value);
+                    else
+                        failedCount++;
                 }
             }
 
             pendingBrightnessChanges.Clear();
             applyAllButton.IsEnabled = false;
-            SetStatus("Applied brightness to all pending zones.");
+            SetStatus(failedCount == 0 ? "Applied brightness to all pending zones." : $"Applied brightness, {failedCount} zone(s) failed.");
+        }
+
+        // Builds a batched update for a zone from its cached colors and the given brightness
+        private ZoneUpdate BuildZoneUpdate(int zoneIdx, byte brightness)
+        {
+            var zone = globalZoneControls[zoneIdx];
+            return new ZoneUpdate
+            {
+                zoneIndex = (uint)zoneIdx,
+                zoneType = (uint)zone.zoneType,
+                r = zone.manualColor.r,
+                g = zone.manualColor.g,
+                b = zone.manualColor.b,
+                w = zone.manualColor.w,
+                brightness = brightness
+            };
+        }
+
+        // Snapshot of a zone's cached state as saved in profiles and startup settings
+        private ZoneProfile BuildZoneProfile(int zoneIdx)
+        {
+            var zone = globalZoneControls[zoneIdx];
+            return new ZoneProfile
+            {
+                ZoneIndex = zoneIdx,
+                ZoneType = ZoneTypeName(zone.zoneType),
+                R = zone.manualColor.r,
+                G = zone.manualColor.g,
+                B = zone.manualColor.b,
+                W = zone.manualColor.w,
+                Brightness = zone.manualColor.brightness
+            };
+        }
+
+        private void StoreZoneBrightness(int zoneIdx, byte brightness)
+        {
+            globalZoneControls[zoneIdx].manualColor.brightness = brightness;
         }
 
         private void ColorPicker_SelectedColorChanged(object sender, RoutedPropertyChangedEventArgs<System.Windows.Media.Color?> e)
         {
             if (sender is Xceed.Wpf.Toolkit.ColorPicker colorPicker && e.NewValue.HasValue)
             {
-                var tag = ((uint gpuIdx, int zoneIdx, string zoneType))colorPicker.Tag;
+                var tag = ((uint gpuIdx, int zoneIdx, IllumZoneType zoneType))colorPicker.Tag;
                 var color = e.NewValue.Value;
 
-                if (tag.zoneType == "RGB")
+                // This fires continuously while dragging, so hand the write to the native queue which
+                // coalesces it with newer colors for the same zone instead of blocking the UI thread
+                if (tag.zoneType != IllumZoneType.RGB && tag.zoneType != IllumZoneType.RGBW)
                 {
-                    var currentColor = globalZoneControls[tag.zoneIdx].manualColorData.rgb;
-                    if (!SetIlluminationZoneManualRGB(tag.gpuIdx, (uint)tag.zoneIdx, color.R, color.G, color.B, currentColor.brightness, false))
-                    {
-                        Xceed.Wpf.Toolkit.MessageBox.Show($"Failed to set color for zone {tag.zoneIdx}");
-                        return;
-                    }
-                    globalZoneControls[tag.zoneIdx].manualColorData.rgb.r = color.R;
-                    globalZoneControls[tag.zoneIdx].manualColorData.rgb.g = color.G;
-                    globalZoneControls[tag.zoneIdx].manualColorData.rgb.b = color.B;
-                    SetStatus($"Set RGB color ({color.R}, {color.G}, {color.B}) on zone {tag.zoneIdx}");
+                    return;
                 }
-                else if (tag.zoneType == "RGBW")
+                lastColorEditTicks = Environment.TickCount64;
+                globalZoneControls[tag.zoneIdx].manualColor.r = color.R;
+                globalZoneControls[tag.zoneIdx].manualColor.g = color.G;
+                globalZoneControls[tag.zoneIdx].manualColor.b = color.B;
+                var update = BuildZoneUpdate(tag.zoneIdx, globalZoneControls[tag.zoneIdx].manualColor.brightness);
+
+                if (!EnqueueIlluminationZoneUpdate(tag.gpuIdx, ref update, false))
                 {
-                    var currentColor = globalZoneControls[tag.zoneIdx].manualColorData.rgbw;
-                    if (!SetIlluminationZoneManualRGBW(tag.gpuIdx, (uint)tag.zoneIdx, color.R, color.G, color.B, currentColor.w, currentColor.brightness, false))
-                    {
-                        Xceed.Wpf.Toolkit.MessageBox.Show($"Failed to set color for zone {tag.zoneIdx}");
-                        return;
-                    }
-                    globalZoneControls[tag.zoneIdx].manualColorData.rgbw.r = color.R;
-                    globalZoneControls[tag.zoneIdx].manualColorData.rgbw.g = color.G;
-                    globalZoneControls[tag.zoneIdx].manualColorData.rgbw.b = color.B;
-                    SetStatus($"Set RGBW color ({color.R}, {color.G}, {color.B}) on zone {tag.zoneIdx}");
+                    Xceed.Wpf.Toolkit.MessageBox.Show($"Failed to set color for zone {tag.zoneIdx}");
+                    return;
                 }
+                SetStatus($"Set {ZoneTypeName(tag.zoneType)} color ({color.R}, {color.G}, {color.B}) on zone {tag.zoneIdx}");
             }
         }
 
@@ -499,18 +636,19 @@ namespace nvidia_FE_lighting
 
         private void ApplyWhiteValue(Slider slider)
         {
-            var tag = ((uint gpuIdx, int zoneIdx, string zoneType))slider.Tag;
+            var tag = ((uint gpuIdx, int zoneIdx, IllumZoneType zoneType))slider.Tag;
             byte white = (byte)slider.Value;
 
-            if (tag.zoneType == "RGBW")
+            if (tag.zoneType == IllumZoneType.RGBW)
             {
-                var currentColor = globalZoneControls[tag.zoneIdx].manualColorData.rgbw;
+                FlushIlluminationQueue(tag.gpuIdx, 500);
+                var currentColor = globalZoneControls[tag.zoneIdx].manualColor;
                 if (!SetIlluminationZoneManualRGBW(tag.gpuIdx, (uint)tag.zoneIdx, currentColor.r, currentColor.g, currentColor.b, white, currentColor.brightness, false))
                 {
                     Xceed.Wpf.Toolkit.MessageBox.Show($"Failed to set white level for zone {tag.zoneIdx}");
                     return;
                 }
-                globalZoneControls[tag.zoneIdx].manualColorData.rgbw.w = white;
+                globalZoneControls[tag.zoneIdx].manualColor.w = white;
                 SetStatus($"Set white level {white} on zone {tag.zoneIdx}");
             }
         }
@@ -533,34 +671,7 @@ namespace nvidia_FE_lighting
 
                 for (int i = 0; i < globalZoneControls.Length; i++)
                 {
-                    var zone = globalZoneControls[i];
-                    var zoneProfile = new ZoneProfile
-                    {
-                        ZoneIndex = i,
-                        ZoneType = zone.zoneType
-                    };
-
-                    if (zone.zoneType == "RGB")
-                    {
-                        zoneProfile.R = zone.manualColorData.rgb.r;
-                        zoneProfile.G = zone.manualColorData.rgb.g;
-                        zoneProfile.B = zone.manualColorData.rgb.b;
-                        zoneProfile.Brightness = zone.manualColorData.rgb.brightness;
-                    }
-                    else if (zone.zoneType == "RGBW")
-                    {
-                        zoneProfile.R = zone.manualColorData.rgbw.r;
-                        zoneProfile.G = zone.manualColorData.rgbw.g;
-                        zoneProfile.B = zone.manualColorData.rgbw.b;
-                        zoneProfile.W = zone.manualColorData.rgbw.w;
-                        zoneProfile.Brightness = zone.manualColorData.rgbw.brightness;
-                    }
-                    else
-                    {
-                        zoneProfile.Brightness = zone.manualColorData.singleColor.brightness;
-                    }
-
-                    profile.Zones.Add(zoneProfile);
+                    profile.Zones.Add(BuildZoneProfile(i));
                 }
 
                 try
@@ -568,6 +679,7 @@ namespace nvidia_FE_lighting
                     string profilePath = Path.Combine(profilesFolder, $"profile_{profileNumber}.json");
                     string json = JsonSerializer.Serialize(profile, new JsonSerializerOptions { WriteIndented = true });
                     File.WriteAllText(profilePath, json);
+                    ProfileFile.Write(Path.ChangeExtension(profilePath, ProfileFile.Extension), GetCurrentGpuIdentifier(), globalZoneControls.Length, profile.Zones);
                     SetStatus($"Saved profile {profileNumber}");
                     Xceed.Wpf.Toolkit.MessageBox.Show($"Profile {profileNumber} saved successfully!");
                 }
@@ -584,6 +696,20 @@ namespace nvidia_FE_lighting
             {
                 string profilePath = Path.Combine(profilesFolder, $"profile_{profileNumber}.json");
 
+                // The DLL applies the binary profile in one call if it was saved on this GPU, anything else goes through the JSON below
+                string binaryPath = Path.ChangeExtension(profilePath, ProfileFile.Extension);
+                if (File.Exists(binaryPath))
+                {
+                    FlushIlluminationQueue(currentGpuIndex, 500);
+                    if (ApplyProfileFile(binaryPath, currentGpuIndex, out _))
+                    {
+                        PopulateIlluminationZones(currentGpuIndex);
+                        SetStatus($"Loaded profile {profileNumber}");
+                        Xceed.Wpf.Toolkit.MessageBox.Show($"Profile {profileNumber} loaded successfully!");
+                        return;
+                    }
+                }
+
                 if (!File.Exists(profilePath))
                 {
                     Xceed.Wpf.Toolkit.MessageBox.Show($"Profile {profileNumber} does not exist.");
@@ -601,84 +727,34 @@ namespace nvidia_FE_lighting
                         return;
                     }
 
-                    // Apply profile to GPU
-                    foreach (var zoneProfile in profile.Zones)
+                    // Apply the whole profile to the GPU with a single batched write
+                    var zoneProfiles = profile.Zones.Where(z => z.ZoneIndex < globalZoneControls.Length).ToArray();
+                    var updates = zoneProfiles.Select(z => new ZoneUpdate
                     {
-                        if (zoneProfile.ZoneIndex >= globalZoneControls.Length)
+                        zoneIndex = (uint)z.ZoneIndex,
+                        zoneType = ZoneTypeFromName(z.ZoneType),
+                        r = z.R,
+                        g = z.G,
+                        b = z.B,
+                        w = z.W,
+                        brightness = z.Brightness
+                    }).ToArray();
+                    var results = new int[updates.Length];
+                    FlushIlluminationQueue(currentGpuIndex, 500);
+                    if (updates.Length > 0)
+                        SetIlluminationZonesBatch(currentGpuIndex, updates, (uint)updates.Length, false, results);
+
+                    for (int i = 0; i < zoneProfiles.Length; i++)
+                    {
+                        if (results[i] != 0)
                             continue;
-
-                        bool success = false;
-                        if (zoneProfile.ZoneType == "RGB")
-                        {
-                            success = SetIlluminationZoneManualRGB(currentGpuIndex, (uint)zoneProfile.ZoneIndex,
-                                zoneProfile.R, zoneProfile.G, zoneProfile.B, zoneProfile.Brightness, false);
-                            if (success)
-                            {
-                                globalZoneControls[zoneProfile.ZoneIndex].manualColorData.rgb.r = zoneProfile.R;
-                                globalZoneControls[zoneProfile.ZoneIndex].manualColorData.rgb.g = zoneProfile.G;
-                                globalZoneControls[zoneProfile.ZoneIndex].manualColorData.rgb.b = zoneProfile.B;
-                                globalZoneControls[zoneProfile.ZoneIndex].manualColorData.rgb.brightness = zoneProfile.Brightness;
-                            }
-                        }
-                        else if (zoneProfile.ZoneType == "RGBW")
-                        {
-                            success = SetIlluminationZoneManualRGBW(currentGpuIndex, (uint)zoneProfile.ZoneIndex,
-                                zoneProfile.R, zoneProfile.G, zoneProfile.B, zoneProfile.W, zoneProfile.Brightness, false);
-                            if (success)
-                            {
-                                globalZoneControls[zoneProfile.ZoneIndex].manualColorData.rgbw.r = zoneProfile.R;
-                                globalZoneControls[zoneProfile.ZoneIndex].manualColorData.rgbw.g = zoneProfile.G;
-                                globalZoneControls[zoneProfile.ZoneIndex].manualColorData.rgbw.b = zoneProfile.B;
-                                globalZoneControls[zoneProfile.ZoneIndex].manualColorData.rgbw.w = zoneProfile.W;
-                                globalZoneControls[zoneProfile.ZoneIndex].manualColorData.rgbw.brightness = zoneProfile.Brightness;
-                            }
-                        }
-                        else if (zoneProfile.ZoneType == "Single Color")
-                        {
-                            success = SetIlluminationZoneManualSingleColor(currentGpuIndex, (uint)zoneProfile.ZoneIndex,
-                                zoneProfile.Brightness, false);
-                            if (success)
-                            {
-                                globalZoneControls[zoneProfile.ZoneIndex].manualColorData.singleColor.brightness = zoneProfile.Brightness;
-                            }
-                            if (!success)
-                            {
-                                success = SetIlluminationZoneManualColorFixed(currentGpuIndex, (uint)zoneProfile.ZoneIndex,
-                                    zoneProfile.Brightness, false);
-                                if (success)
-                                {
-                                    globalZoneControls[zoneProfile.ZoneIndex].manualColorData.singleColor.brightness = zoneProfile.Brightness;
-                                }
-                            }
-                        }
-                        else if (zoneProfile.ZoneType == "Color Fixed")
-                        {
-                            success = SetIlluminationZoneManualColorFixed(currentGpuIndex, (uint)zoneProfile.ZoneIndex,
-                                zoneProfile.Brightness, false);
-                            if (success)
-                            {
-                                globalZoneControls[zoneProfile.ZoneIndex].manualColorData.singleColor.brightness = zoneProfile.Brightness;
-                            }
-                        }
-                        else
-                        {
-                            // Unknown zone type, try both
-                            success = SetIlluminationZoneManualSingleColor(currentGpuIndex, (uint)zoneProfile.ZoneIndex,
-                                zoneProfile.Brightness, false);
-                            if (!success)
-                            {
-                                success = SetIlluminationZoneManualColorFixed(currentGpuIndex, (uint)zoneProfile.ZoneIndex,
-                                    zoneProfile.Brightness, false);
-                            }
-                            if (success)
-                            {
-                                globalZoneControls[zoneProfile.ZoneIndex].manualColorData.singleColor.brightness = zoneProfile.Brightness;
-                            }
-                        }
-                        if (success)
-                        {
-                            Thread.Sleep(100);
-                        }
+                        var zoneProfile = zoneProfiles[i];
+                        ref var manualColor = ref globalZoneControls[zoneProfile.ZoneIndex].manualColor;
+                        manualColor.r = zoneProfile.R;
+                        manualColor.g = zoneProfile.G;
+                        manualColor.b = zoneProfile.B;
+                        manualColor.w = zoneProfile.W;
+                        manualColor.brightness = zoneProfile.Brightness;
                     }
 
                     // Refresh the UI by re-detecting zones
@@ -731,7 +807,6 @@ namespace nvidia_FE_lighting
 
             var settings = new StartupSettings
             {
-                DelaySeconds = 10,
                 GpuIndex = currentGpuIndex,
                 GpuIdentifier = gpuId,
                 Zones = new List<ZoneProfile>()
@@ -739,40 +814,23 @@ namespace nvidia_FE_lighting
 
             for (int i = 0; i < globalZoneControls.Length; i++)
             {
-                var zone = globalZoneControls[i];
-                var zoneProfile = new ZoneProfile
-                {
-                    ZoneIndex = i,
-                    ZoneType = zone.zoneType
-                };
-
-                if (zone.zoneType == "RGB")
-                {
-                    zoneProfile.R = zone.manualColorData.rgb.r;
-                    zoneProfile.G = zone.manualColorData.rgb.g;
-                    zoneProfile.B = zone.manualColorData.rgb.b;
-                    zoneProfile.Brightness = zone.manualColorData.rgb.brightness;
-                }
-                else if (zone.zoneType == "RGBW")
-                {
-                    zoneProfile.R = zone.manualColorData.rgbw.r;
-                    zoneProfile.G = zone.manualColorData.rgbw.g;
-                    zoneProfile.B = zone.manualColorData.rgbw.b;
-                    zoneProfile.W = zone.manualColorData.rgbw.w;
-                    zoneProfile.Brightness = zone.manualColorData.rgbw.brightness;
-                }
-                else
-                {
-                    zoneProfile.Brightness = zone.manualColorData.singleColor.brightness;
-                }
+                settings.Zones.Add(BuildZoneProfile(i));
+            }
 
-                settings.Zones.Add(zoneProfile);
+            // Keep the other GPUs saved earlier so startup mode brings up every card, not just the current one
+            var previousSettings = LoadStartupSettings();
+            if (previousSettings != null)
+            {
+                settings.ReadyTimeoutSeconds = previousSettings.ReadyTimeoutSeconds;
+                settings.Gpus.AddRange(previousSettings.Gpus.Where(g => !g.GpuIdentifier.Matches(gpuId)));
             }
+            settings.Gpus.Add(new GpuStartupProfile { GpuIdentifier = gpuId, Zones = settings.Zones });
 
             try
             {
                 string json = JsonSerializer.Serialize(settings, new JsonSerializerOptions { WriteIndented = true });
                 File.WriteAllText(startupSettingsPath, json);
+                ProfileFile.WriteStartupProfiles(appDataFolder, settings);
                 SetStatus("Startup settings saved");
             }
             catch (Exception ex)
@@ -1,4 +1,6 @@
-﻿using System.Runtime.InteropServices;
+﻿using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Text;
 
 namespace nvidia_FE_lighting
 {
@@ -91,6 +93,332 @@ namespace nvidia_FE_lighting
             public CustomIlluminationZonesInfoData[] zones;
         }
 
+        // NV_GPU_CLIENT_ILLUM_ZONE_TYPE
+        public enum IllumZoneType : uint
+        {
+            Invalid = 0,
+            RGB = 1,
+            ColorFixed = 2,
+            RGBW = 3,
+            SingleColor = 4
+        }
+
+        // NV_GPU_CLIENT_ILLUM_CTRL_MODE
+        public enum IllumControlMode : uint
+        {
+            Manual = 0,
+            PiecewiseLinear = 1,
+            Invalid = 0xFF
+        }
+
+        // v2 structs are blittable, the DLL writes straight into the pinned struct without marshaling copies
+        [StructLayout(LayoutKind.Sequential)]
+        public struct IlluminationZoneInfoV2
+        {
+            public IllumZoneType zoneType;
+            public uint zoneLocation; // NV_GPU_CLIENT_ILLUM_ZONE_LOCATION
+        }
+
+        [InlineArray(32)]
+        public struct IlluminationZoneInfoV2Array
+        {
+            private IlluminationZoneInfoV2 element;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct IlluminationZonesInfoV2
+        {
+            public uint numZones;
+            public IlluminationZoneInfoV2Array zones;
+        }
+
+        // RGB zones leave w at 0, single color and color fixed zones only use brightness
+        [StructLayout(LayoutKind.Sequential)]
+        public struct IlluminationColorV2
+        {
+            public byte r, g, b, w, brightness;
+            private byte padding0, padding1, padding2;
+        }
+
+        [InlineArray(2)]
+        public struct IlluminationColorV2Pair
+        {
+            private IlluminationColorV2 element;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct IlluminationPiecewiseV2
+        {
+            public uint cycleType; // NV_GPU_CLIENT_ILLUM_PIECEWISE_LINEAR_CYCLE_TYPE
+            public ushort riseTimeMs, fallTimeMs;
+            public ushort aTimeMs, bTimeMs;
+            public ushort idleTimeMs, phaseOffsetMs;
+            public byte grpCount;
+            private byte padding0, padding1, padding2;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct IlluminationZoneControlV2
+        {
+            public IllumZoneType zoneType;
+            public IllumControlMode ctrlMode;
+            public IlluminationColorV2 manualColor;
+            public IlluminationColorV2Pair piecewiseColors;
+            public IlluminationPiecewiseV2 piecewise;
+        }
+
+        [InlineArray(32)]
+        public struct IlluminationZoneControlV2Array
+        {
+            private IlluminationZoneControlV2 element;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct IlluminationZoneControlsV2
+        {
+            public uint numZones;
+            public IlluminationZoneControlV2Array zones;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct IlluminationZoneChange
+        {
+            public uint zoneIndex;
+            public IlluminationZoneControlV2 control;
+        }
+
+        [StructLayout(LayoutKind.Sequential, Pack = 4)]
+        public struct ZoneUpdate
+        {
+            public uint zoneIndex;
+            public uint zoneType; // NV_GPU_CLIENT_ILLUM_ZONE_TYPE, 0 accepts any type
+            public byte r, g, b, w, brightness; // padded to 16 bytes by Pack = 4
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct GpuPciIdentity
+        {
+            public uint busId, deviceId, subSystemId;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct GpuZoneBatch
+        {
+            public GpuPciIdentity identity;
+            public uint firstUpdate, updateCount; // slice of the shared updates and zone results arrays
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct IlluminationReadyReport
+        {
+            public ulong initializeUs, enumerateUs, zonesUs, totalUs;
+            public uint initializeAttempts, enumerateAttempts, zonesAttempts;
+            public uint gpuCount, readyGpuCount;
+            public int lastStatus;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct IlluminationReconcilerStats
+        {
+            public ulong polls, pollTimeUs, maxPollUs;
+            public ulong drifts, zonesRepaired, repairFailures, powerEvents;
+            public uint currentIntervalMs, padding;
+        }
+
+        // Color processing of one zone, see SetZoneColorPipeline. Stages are picked with the ColorPipeline* flags.
+        [StructLayout(LayoutKind.Sequential)]
+        public struct ColorPipelineConfig
+        {
+            public uint flags;
+
+            // row-major 3x3 applied to r,g,b, coefficients within (-8, 8)
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = 9)]
+            public float[] whiteBalance;
+
+            public float whiteExtraction; // share of min(r,g,b) moved to w on RGBW zones, 0 to 1
+            public float gamma;
+            public float brightnessGamma;
+
+            // r, g, b and w lookup tables of 256 entries each, back to back
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = 1024)]
+            public byte[] calibration;
+        }
+
+        // Part of the screen that drives one zone, edges are fractions of the frame from its top left corner
+        [StructLayout(LayoutKind.Sequential)]
+        public struct AmbientZoneRegion
+        {
+            public uint zoneIndex;
+            public uint zoneType; // single color and color fixed zones get the luma as brightness
+            public uint mode; // AmbientMode*
+            public float left, top, right, bottom;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct AmbientStats
+        {
+            public ulong frames, writes, writeFailures, sampleTimeUs;
+            public uint lastSampleUs, maxSampleUs;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct AudioReactiveConfig
+        {
+            public uint gpuIndex;
+            public uint sampleRate; // 8000 to 192000 Hz
+            public uint fftSize; // power of two from 256 to 4096
+            public uint updateRateHz; // most writes per second, 1 to 120
+            public float dynamicRangeDb; // 6 to 96
+            public float beatSensitivity; // above 1
+        }
+
+        // The zone fades from quiet to loud as the band level rises
+        [StructLayout(LayoutKind.Sequential)]
+        public struct AudioBandMapping
+        {
+            public uint zoneIndex;
+            public uint zoneType; // 0 accepts any type
+            public uint flags; // AudioBand*
+            public float lowHz, highHz;
+            public float attackMs, releaseMs;
+            public CustomRGBW quiet;
+            public CustomRGBW loud;
+            public ushort padding;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct AudioReactiveStats
+        {
+            public ulong samples, dropped, analyses, beats, writes, writeFailures, analysisTimeUs;
+            public uint maxAnalysisUs, padding;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct TelemetrySample
+        {
+            // indexed by TelemetryMetric*
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = 4)]
+            public float[] values;
+
+            public uint validMask; // bit per metric the GPU reported
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct TelemetryCurvePoint
+        {
+            public float value;
+            public CustomRGBW color;
+        }
+
+        // The zone follows the metric along the curve once the metric moved hysteresis away from the last shown value
+        [StructLayout(LayoutKind.Sequential)]
+        public struct TelemetryZoneMapping
+        {
+            public uint gpuIndex;
+            public uint zoneIndex;
+            public uint zoneType; // 0 accepts any type
+            public uint metric; // TelemetryMetric*
+            public float hysteresis;
+            public uint pointCount;
+
+            // ascending values, colors clamp outside the first and last point
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = 8)]
+            public TelemetryCurvePoint[] points;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct TelemetryStats
+        {
+            public ulong samples, driverCalls, sampleFailures, writes, writeFailures;
+            public uint currentIntervalMs, padding;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct IlluminationTimelineInfo
+        {
+            public uint durationMs, zoneMask, keyframeCount, loop;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct IlluminationChannelStats
+        {
+            public ulong received, coalesced, writes, writeFailures, rejected, dropped;
+        }
+
+        // Called on the reconciler thread after zones were found changed, status is the result of rewriting them
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate void IlluminationDriftCallback(uint gpuIndex, uint driftedZoneMask, int repairStatus, IntPtr context);
+
+        // Called on the sampler thread with only the zones that changed since the last notification
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate void ZoneChangeCallback(uint gpuIndex, [MarshalAs(UnmanagedType.LPArray, SizeParamIndex = 2)] IlluminationZoneChange[] changes, uint count, IntPtr context);
+
+        [StructLayout(LayoutKind.Sequential, CharSet = CharSet.Ansi)]
+        public struct PerfCounterSnapshot
+        {
+            [MarshalAs(UnmanagedType.ByValTStr, SizeConst = 48)]
+            public string name;
+
+            public uint kind; // 0 NvAPI call, 1 wrapper export
+            public uint padding;
+            public ulong calls, errors, totalNs, maxNs;
+
+            // bucket 0 counts calls under 128 ns, bucket i calls under 128 ns << i
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = 24)]
+            public ulong[] histogram;
+
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = 16)]
+            public int[] statusCodes;
+
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = 16)]
+            public ulong[] statusCounts;
+        }
+
+        // ColorPipelineConfig.flags
+        public const uint ColorPipelineWhiteBalance = 0x1;
+        public const uint ColorPipelineExtractWhite = 0x2;
+        public const uint ColorPipelineGamma = 0x4;
+        public const uint ColorPipelineCalibration = 0x8;
+
+        // AmbientZoneRegion.mode
+        public const uint AmbientModeAverage = 0;
+        public const uint AmbientModeDominant = 1;
+
+        // SubmitAudioSamples format
+        public const uint AudioFormatFloat32 = 0;
+        public const uint AudioFormatInt16 = 1;
+
+        // AudioBandMapping.flags
+        public const uint AudioBandBeat = 0x1;
+
+        // TelemetryZoneMapping.metric
+        public const uint TelemetryMetricGpuTemperature = 0; // degrees Celsius
+        public const uint TelemetryMetricGpuUtilization = 1; // percent
+        public const uint TelemetryMetricMemoryUtilization = 2;
+        public const uint TelemetryMetricVideoUtilization = 3;
+
+        // NvAPI_Status returned for GPUs that are not present
+        public const int NvApiStatusDeviceNotFound = -6;
+
+        // ApplyProfileFile gpuIndex that applies the profile to the GPU matching the PCI identity stored in it
+        public const uint ProfileMatchGpuIdentity = 0xFFFFFFFF;
+
+        // Maps the zone type names returned by the DLL to NV_GPU_CLIENT_ILLUM_ZONE_TYPE values
+        public static uint ZoneTypeFromName(string zoneType) => zoneType switch
+        {
+            "RGB" => 1,
+            "Color Fixed" => 2,
+            "RGBW" => 3,
+            "Single Color" => 4,
+            _ => 0
+        };
+
+        // Display names for the v2 enum values, the same names the v1 structs carry
+        public static string ZoneTypeName(IllumZoneType zoneType) => Marshal.PtrToStringAnsi(GetIlluminationZoneTypeName((uint)zoneType)) ?? "";
+        public static string ZoneLocationName(uint zoneLocation) => Marshal.PtrToStringAnsi(GetIlluminationZoneLocationName(zoneLocation)) ?? "";
+        public static string ControlModeName(IllumControlMode ctrlMode) => Marshal.PtrToStringAnsi(GetIlluminationControlModeName((uint)ctrlMode)) ?? "";
+        public static string CycleTypeName(uint cycleType) => Marshal.PtrToStringAnsi(GetIlluminationCycleTypeName(cycleType)) ?? "";
+
         // Function imports
         [DllImport(DllName, CharSet = CharSet.Ansi)]
         public static extern bool InitializeNvApi();
@@ -98,6 +426,9 @@ namespace nvidia_FE_lighting
         [DllImport(DllName, CharSet = CharSet.Ansi)]
         public static extern bool DeinitializeNvApi();
 
+        [DllImport(DllName)]
+        public static extern bool WaitForIlluminationReady(uint timeoutMs, out IlluminationReadyReport report);
+
         [DllImport(DllName, CharSet = CharSet.Ansi)]
         public static extern IntPtr GetInterfaceVersionString();
 
@@ -128,6 +459,36 @@ namespace nvidia_FE_lighting
         [DllImport(DllName, CharSet = CharSet.Ansi)]
         public static extern IntPtr GetIlluminationZonesControl(uint index, bool useDefault, ref CustomIlluminationZoneControls controls);
 
+        [DllImport(DllName)]
+        public static extern bool GetIlluminationZonesInfoData(uint index, ref CustomIlluminationZonesInfo info);
+
+        [DllImport(DllName)]
+        public static extern bool GetIlluminationZonesInfoV2(uint index, out IlluminationZonesInfoV2 info);
+
+        [DllImport(DllName)]
+        public static extern bool GetIlluminationZonesControlV2(uint index, [MarshalAs(UnmanagedType.U1)] bool useDefault, out IlluminationZoneControlsV2 controls);
+
+        [DllImport(DllName)]
+        public static extern IntPtr GetIlluminationZoneTypeName(uint zoneType);
+
+        [DllImport(DllName)]
+        public static extern IntPtr GetIlluminationZoneLocationName(uint zoneLocation);
+
+        [DllImport(DllName)]
+        public static extern IntPtr GetIlluminationControlModeName(uint ctrlMode);
+
+        [DllImport(DllName)]
+        public static extern IntPtr GetIlluminationCycleTypeName(uint cycleType);
+
+        [DllImport(DllName)]
+        public static extern bool GetIlluminationZonesControlData(uint index, bool useDefault, ref CustomIlluminationZoneControls controls);
+
+        [DllImport(DllName, CharSet = CharSet.Ansi)]
+        public static extern bool FormatIlluminationZonesInfo(uint index, StringBuilder buffer, UIntPtr bufferSize, out UIntPtr required);
+
+        [DllImport(DllName, CharSet = CharSet.Ansi)]
+        public static extern bool FormatIlluminationZonesControl(uint index, bool useDefault, StringBuilder buffer, UIntPtr bufferSize, out UIntPtr required);
+
         [DllImport(DllName)]
         public static extern bool SetIlluminationZoneManualRGB(uint gpuIndex, uint zoneIndex, byte red, byte green, byte blue, byte brightness, bool Default);
 
@@ -139,5 +500,183 @@ namespace nvidia_FE_lighting
 
         [DllImport(DllName)]
         public static extern bool SetIlluminationZoneManualColorFixed(uint gpuIndex, uint zoneIndex, byte brightness, bool Default);
+
+        [DllImport(DllName)]
+        public static extern bool SetIlluminationZonePiecewiseLinearRGB(uint gpuIndex, uint zoneIndex, [In] CustomRGB[] endpoints, ref CustomPiecewiseLinear piecewiseData, bool Default);
+
+        [DllImport(DllName)]
+        public static extern bool SetIlluminationZonePiecewiseLinearRGBW(uint gpuIndex, uint zoneIndex, [In] CustomRGBW[] endpoints, ref CustomPiecewiseLinear piecewiseData, bool Default);
+
+        [DllImport(DllName)]
+        public static extern bool SetIlluminationZonePiecewiseLinearSingleColor(uint gpuIndex, uint zoneIndex, [In] CustomSingleColor[] endpoints, ref CustomPiecewiseLinear piecewiseData, bool Default);
+
+        [DllImport(DllName)]
+        public static extern bool SetIlluminationZonePiecewiseLinearColorFixed(uint gpuIndex, uint zoneIndex, [In] CustomSingleColor[] endpoints, ref CustomPiecewiseLinear piecewiseData, bool Default);
+
+        [DllImport(DllName)]
+        public static extern bool SetIlluminationZoneControlMode(uint gpuIndex, uint zoneIndex, uint ctrlMode, bool Default);
+
+        // null regions stop the sampler for the GPU
+        [DllImport(DllName)]
+        public static extern bool SetAmbientRegions(uint gpuIndex, [In] AmbientZoneRegion[]? regions, uint count, uint smoothingMs, byte brightness);
+
+        [DllImport(DllName)]
+        public static extern bool ComputeAmbientColors(IntPtr frame, uint width, uint height, int stride, [In] AmbientZoneRegion[] regions, uint count, byte brightness, [Out] ZoneUpdate[] updates);
+
+        // frame is 32-bit BGRA, e.g. a mapped desktop duplication texture
+        [DllImport(DllName)]
+        public static extern bool SubmitAmbientFrame(uint gpuIndex, IntPtr frame, uint width, uint height, int stride, ulong timestampUs);
+
+        [DllImport(DllName)]
+        public static extern void GetAmbientStats(out AmbientStats stats);
+
+        [DllImport(DllName)]
+        public static extern bool SetIlluminationZonesBatch(uint gpuIndex, [In] ZoneUpdate[] updates, uint count, bool Default, [Out] int[] results);
+
+        [DllImport(DllName)]
+        public static extern bool FindGPUByPciIdentity(ref GpuPciIdentity identity, out uint index);
+
+        [DllImport(DllName)]
+        public static extern bool ApplyIlluminationZonesMultiGpu([In] GpuZoneBatch[] batches, uint batchCount, [In] ZoneUpdate[] updates, uint updateCount, bool Default, [Out] int[] gpuResults, [Out] int[] zoneResults, out ulong wallTimeUs);
+
+        [DllImport(DllName)]
+        public static extern bool EnqueueIlluminationZoneUpdate(uint gpuIndex, ref ZoneUpdate update, bool Default);
+
+        [DllImport(DllName)]
+        public static extern bool FlushIlluminationQueue(uint gpuIndex, uint timeoutMs);
+
+        [DllImport(DllName, CharSet = CharSet.Unicode)]
+        public static extern bool ApplyProfileFile(string path, uint gpuIndex, out int status);
+
+        [DllImport(DllName)]
+        public static extern bool GetIlluminationQueueStats(uint gpuIndex, out uint depth, out ulong coalesced, out ulong dispatched, out ulong failed);
+
+        [DllImport(DllName)]
+        public static extern bool SetIlluminationDesiredState(uint gpuIndex, [In] ZoneUpdate[]? updates, uint count);
+
+        [DllImport(DllName)]
+        public static extern bool StartIlluminationReconciler(uint minIntervalMs, uint maxIntervalMs);
+
+        [DllImport(DllName)]
+        public static extern void StopIlluminationReconciler();
+
+        [DllImport(DllName)]
+        public static extern void NotifyIlluminationPowerEvent();
+
+        [DllImport(DllName)]
+        public static extern bool SetIlluminationDriftCallback(IlluminationDriftCallback? callback, IntPtr context);
+
+        [DllImport(DllName)]
+        public static extern void GetIlluminationReconcilerStats(out IlluminationReconcilerStats stats);
+
+        [DllImport(DllName)]
+        public static extern uint RegisterZoneChangeCallback(uint gpuIndex, ZoneChangeCallback callback, IntPtr context);
+
+        [DllImport(DllName)]
+        public static extern bool UnregisterZoneChangeCallback(uint subscription);
+
+        [DllImport(DllName)]
+        public static extern bool SetZoneChangeSamplerTiming(uint pollIntervalMs, uint coalesceWindowMs);
+
+        [DllImport(DllName)]
+        public static extern void GetZoneChangeSamplerStats(out ulong samples, out ulong notifications, out ulong coalesced);
+
+        [DllImport(DllName)]
+        public static extern bool SetZoneColorPipeline(uint gpuIndex, uint zoneIndex, in ColorPipelineConfig config);
+
+        // IntPtr.Zero removes the pipeline of the zone
+        [DllImport(DllName)]
+        public static extern bool SetZoneColorPipeline(uint gpuIndex, uint zoneIndex, IntPtr config);
+
+        [DllImport(DllName)]
+        public static extern uint GetColorPipelineIsa();
+
+        [DllImport(DllName)]
+        public static extern bool SetColorPipelineIsa(uint isa);
+
+        [DllImport(DllName)]
+        public static extern bool SetAudioReactiveConfig(in AudioReactiveConfig config, [In] AudioBandMapping[] mappings, uint count);
+
+        [DllImport(DllName)]
+        public static extern bool StartAudioReactive();
+
+        [DllImport(DllName)]
+        public static extern void StopAudioReactive();
+
+        // samples are interleaved frames in the AudioFormat* layout, call from a single capture thread
+        [DllImport(DllName)]
+        public static extern bool SubmitAudioSamples(IntPtr samples, uint frameCount, uint channels, uint format);
+
+        [DllImport(DllName)]
+        public static extern bool StepAudioReactive();
+
+        [DllImport(DllName)]
+        public static extern void GetAudioReactiveStats(out AudioReactiveStats stats);
+
+        [DllImport(DllName)]
+        public static extern bool GetGpuTelemetry(uint gpuIndex, out TelemetrySample sample);
+
+        // null and 0 clear the mappings
+        [DllImport(DllName)]
+        public static extern bool SetTelemetryMappings([In] TelemetryZoneMapping[] mappings, uint count);
+
+        [DllImport(DllName)]
+        public static extern bool StartTelemetrySampler(uint minIntervalMs, uint maxIntervalMs);
+
+        [DllImport(DllName)]
+        public static extern void StopTelemetrySampler();
+
+        [DllImport(DllName)]
+        public static extern void GetTelemetryStats(out TelemetryStats stats);
+
+        // json is UTF-8 without a terminator, returns IntPtr.Zero and the reason in error if it does not compile
+        [DllImport(DllName)]
+        public static extern IntPtr CompileIlluminationTimeline([In] byte[] json, UIntPtr length, StringBuilder error, UIntPtr errorSize);
+
+        [DllImport(DllName)]
+        public static extern void FreeIlluminationTimeline(IntPtr timeline);
+
+        [DllImport(DllName)]
+        public static extern bool GetIlluminationTimelineInfo(IntPtr timeline, out IlluminationTimelineInfo info);
+
+        // updates needs one entry per zone in the timeline, returns how many were written
+        [DllImport(DllName)]
+        public static extern uint EvaluateIlluminationTimeline(IntPtr timeline, ulong timeUs, [Out] ZoneUpdate[] updates, uint capacity);
+
+        // name is Local\... on Windows, capacity a power of two, drainIntervalMs 0 leaves draining to DrainIlluminationChannel
+        [DllImport(DllName, CharSet = CharSet.Ansi)]
+        public static extern bool OpenIlluminationChannel(string name, uint capacity, uint drainIntervalMs);
+
+        [DllImport(DllName)]
+        public static extern void CloseIlluminationChannel();
+
+        [DllImport(DllName)]
+        public static extern uint DrainIlluminationChannel();
+
+        [DllImport(DllName)]
+        public static extern void GetIlluminationChannelStats(out IlluminationChannelStats stats);
+
+        // producer side, returns IntPtr.Zero if no channel is open under name
+        [DllImport(DllName, CharSet = CharSet.Ansi)]
+        public static extern IntPtr ConnectIlluminationChannel(string name);
+
+        // false if the channel is full or closed, never blocks
+        [DllImport(DllName)]
+        public static extern bool PushIlluminationChannelUpdate(IntPtr producer, uint gpuIndex, ref ZoneUpdate update);
+
+        [DllImport(DllName)]
+        public static extern void DisconnectIlluminationChannel(IntPtr producer);
+
+        [DllImport(DllName)]
+        public static extern bool GetPerfCountersEnabled();
+
+        [DllImport(DllName)]
+        public static extern uint GetPerfCounterCount();
+
+        [DllImport(DllName)]
+        public static extern uint GetPerfCounters([Out] PerfCounterSnapshot[] snapshots, uint capacity);
+
+        [DllImport(DllName)]
+        public static extern void ResetPerfCounters();
     }
 }
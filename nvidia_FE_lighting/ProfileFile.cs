@@ -0,0 +1,143 @@
+﻿using System.IO;
+using System.Text;
+using System.Text.Json;
+using static nvidia_FE_lighting.NvApiWrapper;
+
+namespace nvidia_FE_lighting
+{
+    // Binary profiles (.nvfl) applied by the DLL with ApplyProfileFile. The layout matches ProfileFileHeader in
+    // NvApiProfile.h followed by one ZoneUpdate record per zone, all little-endian.
+    public static class ProfileFile
+    {
+        public const string Extension = ".nvfl";
+        private const string StartupPattern = "startup_gpu_*" + Extension;
+
+        private const ushort Version = 1;
+        private const ushort HeaderSize = 36;
+        private const int ChecksumOffset = 8;
+        private const int ChecksumEnd = 12;
+        private const uint FlagAnyGpu = 0x2;
+
+        // Writes a profile for the GPU with the given identity, profiles without one apply to any GPU with the same zones
+        public static void Write(string path, GpuIdentifier? gpuId, int gpuZoneCount, IReadOnlyList<ZoneProfile> zones)
+        {
+            using var stream = new MemoryStream(HeaderSize + zones.Count * 16);
+            using (var writer = new BinaryWriter(stream, Encoding.ASCII, true))
+            {
+                writer.Write(Encoding.ASCII.GetBytes("NVFL"));
+                writer.Write(Version);
+                writer.Write(HeaderSize);
+                writer.Write(0u); // checksum, filled in once the rest is written
+                writer.Write(gpuId == null ? FlagAnyGpu : 0u);
+                writer.Write(gpuId?.BusId ?? 0u);
+                writer.Write(gpuId?.DeviceId ?? 0u);
+                writer.Write(gpuId?.SubSystemId ?? 0u);
+                writer.Write((uint)gpuZoneCount);
+                writer.Write((uint)zones.Count);
+
+                foreach (var zone in zones)
+                {
+                    writer.Write((uint)zone.ZoneIndex);
+                    // single color profiles also apply to color fixed zones, so only check the other types
+                    writer.Write(zone.ZoneType == "Single Color" ? 0u : ZoneTypeFromName(zone.ZoneType));
+                    writer.Write(zone.R);
+                    writer.Write(zone.G);
+                    writer.Write(zone.B);
+                    writer.Write(zone.W);
+                    writer.Write(zone.Brightness);
+                    writer.Write(new byte[3]);
+                }
+            }
+
+            byte[] data = stream.ToArray();
+            BitConverter.TryWriteBytes(data.AsSpan(ChecksumOffset), Checksum(data.AsSpan(ChecksumEnd)));
+
+            // replace the file in one step so the DLL never maps a half written profile
+            string tempPath = path + ".tmp";
+            File.WriteAllBytes(tempPath, data);
+            File.Move(tempPath, path, true);
+        }
+
+        // FNV-1a, same as profileChecksum in the DLL
+        private static uint Checksum(ReadOnlySpan<byte> data)
+        {
+            uint hash = 2166136261;
+            foreach (byte value in data)
+                hash = (hash ^ value) * 16777619;
+            return hash;
+        }
+
+        // Saved profiles cover every zone of the GPU, so the highest zone index gives the zone count
+        private static int ZoneCountOf(IReadOnlyList<ZoneProfile> zones)
+        {
+            return zones.Count == 0 ? 0 : zones.Max(z => z.ZoneIndex) + 1;
+        }
+
+        public static string StartupPath(string folder, GpuIdentifier gpuId)
+        {
+            return Path.Combine(folder, $"startup_gpu_{gpuId.BusId}_{gpuId.DeviceId:X8}_{gpuId.SubSystemId:X8}{Extension}");
+        }
+
+        public static string[] StartupProfiles(string folder)
+        {
+            return Directory.Exists(folder) ? Directory.GetFiles(folder, StartupPattern) : Array.Empty<string>();
+        }
+
+        // One profile per saved GPU, startup mode applies each to the GPU with the matching PCI identity
+        public static void WriteStartupProfiles(string folder, StartupSettings settings)
+        {
+            var targets = settings.Gpus.Count > 0
+                ? settings.Gpus
+                : new List<GpuStartupProfile> { new GpuStartupProfile { GpuIdentifier = settings.GpuIdentifier, Zones = settings.Zones } };
+
+            foreach (string stale in StartupProfiles(folder))
+                File.Delete(stale);
+            foreach (var target in targets.Where(t => t.Zones.Count > 0))
+                Write(StartupPath(folder, target.GpuIdentifier), target.GpuIdentifier, ZoneCountOf(target.Zones), target.Zones);
+        }
+
+        // Converts the JSON profiles and startup settings of older versions, files already converted are skipped
+        public static int ConvertJsonProfiles(string profilesFolder, string startupSettingsPath)
+        {
+            int converted = 0;
+            foreach (string jsonPath in Directory.GetFiles(profilesFolder, "profile_*.json"))
+            {
+                string binaryPath = Path.ChangeExtension(jsonPath, Extension);
+                if (File.Exists(binaryPath) && File.GetLastWriteTimeUtc(binaryPath) >= File.GetLastWriteTimeUtc(jsonPath))
+                    continue;
+                try
+                {
+                    var profile = JsonSerializer.Deserialize<LightingProfile>(File.ReadAllText(jsonPath));
+                    if (profile == null || profile.Zones.Count == 0)
+                        continue;
+                    // these profiles never recorded their GPU, only the GPU index they were saved from
+                    Write(binaryPath, null, ZoneCountOf(profile.Zones), profile.Zones);
+                    converted++;
+                }
+                catch (Exception ex) when (ex is JsonException or IOException)
+                {
+                    // leave unreadable profiles to the JSON path
+                }
+            }
+
+            string? folder = Path.GetDirectoryName(startupSettingsPath);
+            if (folder != null && File.Exists(startupSettingsPath) && StartupProfiles(folder).Length == 0)
+            {
+                try
+                {
+                    var settings = JsonSerializer.Deserialize<StartupSettings>(File.ReadAllText(startupSettingsPath));
+                    if (settings != null)
+                    {
+                        WriteStartupProfiles(folder, settings);
+                        converted++;
+                    }
+                }
+                catch (Exception ex) when (ex is JsonException or IOException)
+                {
+                    // startup mode falls back to the JSON settings
+                }
+            }
+            return converted;
+        }
+    }
+}